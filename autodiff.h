@@ -0,0 +1,517 @@
+#ifndef AUTODIFF_H
+#define AUTODIFF_H
+
+/**
+* @file
+* Diferenciación automática de los programas compilados de las expresiones
+* Calcula el valor de la expresión y su gradiente respecto a los valores de entrada en una sola
+* pasada: en modo directo (números duales), conveniente para pocas variables, o en modo reverso
+* (cinta de adjuntos), cuyo costo no depende de la cantidad de variables.
+* Las derivadas de los operadores y de las funciones predefinidas son exactas, con las mismas
+* reglas y la misma convención en los puntos sin derivada que ExpressionGraph::derivative(); las
+* funciones personalizadas se derivan por diferencias centrales. Las comparaciones y los
+* operadores lógicos tienen derivada 0, y la de if(c, a, b) es la de la rama elegida, sin
+* evaluar la derivada de la otra. Los términos con derivada parcial 0 se omiten en ambos modos,
+* de modo que forward() y reverse() coinciden aunque la derivada de un operando sea infinita o NAN.
+* @author Erwin Meza Vega <emezav@unicauca.edu.co>
+* @copyright MIT License
+*/
+
+#include <cfloat>
+#include <cmath>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "expression.h"
+
+/**
+* @brief Número dual: un valor y su derivada en una dirección
+*/
+struct Dual {
+	double val; /*!< Valor */
+	double der; /*!< Derivada */
+};
+
+/**
+* @brief Evaluador del gradiente de un programa compilado
+*
+* Reutiliza sus arreglos de trabajo entre evaluaciones, por lo que no reserva memoria después
+* de la primera. Cada hilo debe usar su propia instancia; el programa se comparte.
+*/
+class Gradient {
+public:
+	/** Cantidad máxima de variables para la que eval() usa el modo directo */
+	static const size_t FORWARD_LIMIT = 4;
+
+	/**
+	* @brief Crea un evaluador del gradiente
+	* @param program Programa compilado, con las variables en el orden de sus valores de entrada
+	*/
+	explicit Gradient(std::shared_ptr<const CompiledExpression> program): program(std::move(program)) {
+	}
+
+	/**
+	* @brief Crea un evaluador del gradiente de una expresión, con las variables asociadas mediante bind()
+	* @param expr Expresión
+	*/
+	explicit Gradient(expression & expr): Gradient(expr.compiled()) {
+	}
+
+	/**
+	* @brief Calcula el valor y el gradiente, eligiendo el modo según la cantidad de variables
+	* @param values Valores de entrada, en el orden de program->variables()
+	* @param gradient Arreglo con capacidad para program->inputs() derivadas parciales
+	* @return Valor de la expresión, NAN si no es válida
+	*/
+	double eval(const double * values, double * gradient) {
+		if (program->inputs() <= FORWARD_LIMIT) {
+			return forward(values, gradient);
+		}
+		return reverse(values, gradient);
+	}
+
+	/**
+	* @brief Calcula el valor y la derivada respecto a una variable, en modo directo
+	* @param values Valores de entrada
+	* @param input Posición de la variable
+	* @return Valor de la expresión y derivada parcial respecto a la variable
+	*/
+	Dual derivative(const double * values, size_t input) {
+		const Program & code = program->instructions();
+		size_t base = program->stackSize() - program->temporaries(); //Posición del primer temporal
+		duals.resize(program->stackSize());
+
+		if (!program->isValid()) {
+			return {NAN, NAN};
+		}
+
+		size_t top = 0;
+		for (auto & ins: code) {
+			size_t k = CompiledExpression::arity(ins);
+			if (ins.op == OpCode::Store) {
+				duals[base + ins.arg] = duals[top - 1];
+				continue;
+			}
+			if (ins.op == OpCode::CallN) {
+				top -= k;
+				args.resize(k);
+				partials.resize(k);
+				for (size_t j = 0; j < k; j++) {
+					args[j] = duals[top + j].val;
+				}
+				double y = applyArgs(ins, args.data(), k, partials.data());
+				double d = 0.0;
+				for (size_t j = 0; j < k; j++) {
+					d = combine(partials[j], duals[top + j].der, 1.0, d);
+				}
+				duals[top++] = {y, d};
+				continue;
+			}
+			if (ins.op == OpCode::Temp) {
+				duals[top++] = duals[base + ins.arg];
+				continue;
+			}
+			if (ins.op == OpCode::Select) {
+				top -= 2;
+				duals[top - 1] = (duals[top - 1].val != 0.0) ? duals[top] : duals[top + 1];
+				continue;
+			}
+			if (k == 0) {
+				bool load = (ins.op == OpCode::Load);
+				duals[top++] = {load ? values[ins.arg] : ins.val, (load && ins.arg == input) ? 1.0 : 0.0};
+				continue;
+			}
+			top -= k;
+			Dual a = duals[top];
+			Dual b = (k == 2) ? duals[top + 1] : Dual{0.0, 0.0};
+			double pa, pb;
+			double y = apply(ins, a.val, b.val, pa, pb);
+			duals[top++] = {y, combine(pa, a.der, pb, b.der)};
+		}
+		return duals[0];
+	}
+
+	/**
+	* @brief Calcula el valor y el gradiente en modo directo
+	*
+	* Propaga una derivada por cada variable junto con cada valor de la pila: el costo es
+	* proporcional al tamaño del programa por la cantidad de variables.
+	* @param values Valores de entrada
+	* @param gradient Arreglo con capacidad para program->inputs() derivadas parciales
+	* @return Valor de la expresión, NAN si no es válida
+	*/
+	double forward(const double * values, double * gradient) {
+		const Program & code = program->instructions();
+		size_t n = program->inputs();
+
+		if (!program->isValid()) {
+			std::fill(gradient, gradient + n, NAN);
+			return NAN;
+		}
+
+		size_t base = program->stackSize() - program->temporaries(); //Posición del primer temporal
+		stack.resize(program->stackSize());
+		tangents.resize(program->stackSize() * n);
+
+		size_t top = 0;
+		for (auto & ins: code) {
+			size_t k = CompiledExpression::arity(ins);
+			if (ins.op == OpCode::CallN) {
+				top -= k;
+				args.assign(stack.begin() + top, stack.begin() + top + k);
+				partials.resize(k);
+				double y = applyArgs(ins, args.data(), k, partials.data());
+				//La derivada de cada variable combina las de todos los argumentos
+				for (size_t j = 0; j < n; j++) {
+					double d = 0.0;
+					for (size_t m = 0; m < k; m++) {
+						d = combine(partials[m], tangents[(top + m) * n + j], 1.0, d);
+					}
+					tangents[top * n + j] = d;
+				}
+				stack[top++] = y;
+				continue;
+			}
+			if (ins.op == OpCode::Store || ins.op == OpCode::Temp) {
+				//Copiar el valor y sus derivadas entre el tope de la pila y el temporal
+				size_t from = (ins.op == OpCode::Store) ? top - 1 : base + ins.arg;
+				size_t to = (ins.op == OpCode::Store) ? base + ins.arg : top++;
+				stack[to] = stack[from];
+				std::copy(&tangents[from * n], &tangents[from * n] + n, &tangents[to * n]);
+				continue;
+			}
+			if (ins.op == OpCode::Select) {
+				//El valor y las derivadas de la rama elegida reemplazan a la condición
+				top -= 2;
+				size_t from = (stack[top - 1] != 0.0) ? top : top + 1;
+				stack[top - 1] = stack[from];
+				std::copy(&tangents[from * n], &tangents[from * n] + n, &tangents[(top - 1) * n]);
+				continue;
+			}
+			if (k == 0) {
+				bool load = (ins.op == OpCode::Load);
+				stack[top] = load ? values[ins.arg] : ins.val;
+				double * t = &tangents[top * n];
+				std::fill(t, t + n, 0.0);
+				if (load) {
+					t[ins.arg] = 1.0;
+				}
+				top++;
+				continue;
+			}
+			top -= k;
+			double pa, pb;
+			double y = apply(ins, stack[top], (k == 2) ? stack[top + 1] : 0.0, pa, pb);
+			double * ta = &tangents[top * n];
+			if (k == 2) {
+				const double * tb = &tangents[(top + 1) * n];
+				for (size_t j = 0; j < n; j++) {
+					ta[j] = combine(pa, ta[j], pb, tb[j]);
+				}
+			}else {
+				for (size_t j = 0; j < n; j++) {
+					ta[j] = combine(pa, ta[j], 0.0, 0.0);
+				}
+			}
+			stack[top++] = y;
+		}
+
+		std::copy(tangents.begin(), tangents.begin() + n, gradient);
+		return stack[0];
+	}
+
+	/**
+	* @brief Calcula el valor y el gradiente en modo reverso
+	*
+	* Registra en una cinta el valor y los operandos de cada instrucción, y luego propaga los
+	* adjuntos desde el resultado hacia las variables: el costo es de dos recorridos del
+	* programa, sin importar la cantidad de variables.
+	* @param values Valores de entrada
+	* @param gradient Arreglo con capacidad para program->inputs() derivadas parciales
+	* @return Valor de la expresión, NAN si no es válida
+	*/
+	double reverse(const double * values, double * gradient) {
+		const Program & code = program->instructions();
+		size_t n = program->inputs();
+
+		std::fill(gradient, gradient + n, program->isValid() ? 0.0 : NAN);
+		if (!program->isValid()) {
+			return NAN;
+		}
+
+		size_t base = program->stackSize() - program->temporaries(); //Posición del primer temporal
+		tape.resize(code.size());
+		adjoints.assign(code.size(), 0.0);
+		nodes.resize(program->stackSize());
+		links.clear();
+
+		//Recorrido hacia adelante: valor y derivadas locales de cada instrucción
+		size_t top = 0;
+		for (size_t i = 0; i < code.size(); i++) {
+			const Instruction & ins = code[i];
+			size_t k = CompiledExpression::arity(ins);
+			Entry & e = tape[i];
+			if (ins.op == OpCode::CallN) {
+				//Los operandos y sus derivadas se registran en links
+				top -= k;
+				args.resize(k);
+				partials.resize(k);
+				for (size_t m = 0; m < k; m++) {
+					args[m] = tape[nodes[top + m]].val;
+				}
+				e = {applyArgs(ins, args.data(), k, partials.data()), 0.0, 0.0, links.size(), k};
+				for (size_t m = 0; m < k; m++) {
+					links.push_back({nodes[top + m], partials[m]});
+				}
+			}else if (ins.op == OpCode::Store || ins.op == OpCode::Temp) {
+				//Identidad sobre la instrucción que calculó el valor
+				size_t from = (ins.op == OpCode::Store) ? nodes[--top] : nodes[base + ins.arg];
+				e = {tape[from].val, 1.0, 0.0, from, 0};
+				if (ins.op == OpCode::Store) {
+					nodes[base + ins.arg] = i;
+				}
+			}else if (ins.op == OpCode::Select) {
+				//Identidad sobre la instrucción de la rama elegida
+				top -= k;
+				size_t from = (tape[nodes[top]].val != 0.0) ? nodes[top + 1] : nodes[top + 2];
+				e = {tape[from].val, 1.0, 0.0, from, 0};
+			}else if (k == 0) {
+				e = {(ins.op == OpCode::Load) ? values[ins.arg] : ins.val, 0.0, 0.0, 0, 0};
+			}else {
+				top -= k;
+				e.a = nodes[top];
+				e.b = (k == 2) ? nodes[top + 1] : 0;
+				e.val = apply(ins, tape[e.a].val, (k == 2) ? tape[e.b].val : 0.0, e.pa, e.pb);
+			}
+			nodes[top++] = i;
+		}
+
+		//Recorrido hacia atrás: propagar los adjuntos
+		adjoints[code.size() - 1] = 1.0;
+		for (size_t i = code.size(); i-- > 0;) {
+			const Instruction & ins = code[i];
+			double adj = adjoints[i];
+			size_t k = CompiledExpression::arity(ins);
+			if (ins.op == OpCode::Load) {
+				gradient[ins.arg] += adj;
+			}else if (ins.op == OpCode::CallN) {
+				for (size_t m = tape[i].a; m < tape[i].a + tape[i].b && adj != 0.0; m++) {
+					if (links[m].partial != 0.0) {
+						adjoints[links[m].node] += links[m].partial * adj;
+					}
+				}
+			}else if ((k >= 1 || ins.op == OpCode::Temp) && adj != 0.0) {
+				if (tape[i].pa != 0.0) {
+					adjoints[tape[i].a] += tape[i].pa * adj;
+				}
+				if (k == 2 && tape[i].pb != 0.0) {
+					adjoints[tape[i].b] += tape[i].pb * adj;
+				}
+			}
+		}
+
+		return tape[code.size() - 1].val;
+	}
+
+	/**
+	* @brief Calcula el resultado de una instrucción y sus derivadas parciales
+	*
+	* En x^y, la derivada respecto a y se define como 0 cuando x^y es 0, y la derivada respecto
+	* a x como 0 cuando y es 0, para evitar productos 0 * infinito en los extremos del dominio.
+	* @param ins Instrucción (unaria o binaria); if(c, a, b) se resuelve en cada modo
+	* @param a Primer operando
+	* @param b Segundo operando (operaciones binarias)
+	* @param pa Referencia a la derivada del resultado respecto al primer operando
+	* @param pb Referencia a la derivada del resultado respecto al segundo operando
+	* @return Resultado de la instrucción
+	*/
+	double apply(const Instruction & ins, double a, double b, double & pa, double & pb) const {
+		double y;
+		pb = 0.0;
+
+		switch (ins.op) {
+			case OpCode::Add:
+				pa = 1.0;
+				pb = 1.0;
+				return a + b;
+			case OpCode::Sub:
+				pa = 1.0;
+				pb = -1.0;
+				return a - b;
+			case OpCode::Mul:
+				pa = b;
+				pb = a;
+				return a * b;
+			case OpCode::Div:
+				y = a / b;
+				pa = 1.0 / b;
+				pb = -y / b;
+				return y;
+			case OpCode::Pow:
+				y = pow(a, b);
+				pa = (b == 0.0) ? 0.0 : b * pow(a, b - 1.0);
+				pb = (y == 0.0) ? 0.0 : y * log(a);
+				return y;
+			case OpCode::Neg:
+				pa = -1.0;
+				return -a;
+			case OpCode::Sqrt:
+				y = sqrt(a);
+				pa = 0.5 / y;
+				return y;
+			case OpCode::Sin:
+				pa = cos(a);
+				return sin(a);
+			case OpCode::Cos:
+				pa = -sin(a);
+				return cos(a);
+			case OpCode::Tan:
+				y = tan(a);
+				pa = 1.0 + y * y;
+				return y;
+			case OpCode::Ln:
+				pa = 1.0 / a;
+				return log(a);
+			case OpCode::Log:
+				pa = 1.0 / (a * M_LN10);
+				return log10(a);
+			case OpCode::Exp:
+				y = exp(a);
+				pa = y;
+				return y;
+			case OpCode::Abs:
+				pa = (a > 0.0) - (a < 0.0);
+				return fabs(a);
+			case OpCode::Lt:
+			case OpCode::Le:
+			case OpCode::Gt:
+			case OpCode::Ge:
+			case OpCode::Eq:
+			case OpCode::Ne:
+			case OpCode::And:
+			case OpCode::Or:
+				pa = 0.0;
+				return CompiledExpression::calculate(a, b, ins.op);
+			case OpCode::Not:
+				pa = 0.0;
+				return a == 0.0;
+			case OpCode::Call: {
+				//Diferencias centrales, con paso proporcional a la escala de a
+				const CustomFunction & f = program->customFunctions()[ins.arg];
+				double h = std::cbrt(DBL_EPSILON) * std::max(1.0, fabs(a));
+				pa = (f(a + h) - f(a - h)) / (2.0 * h);
+				return f(a);
+			}
+			default:
+				pa = NAN;
+				return NAN;
+		}
+	}
+
+private:
+	/**
+	* @brief Calcula el resultado de una función de varios argumentos y sus derivadas parciales
+	*
+	* atan2, hypot, min, max y clamp tienen derivadas parciales exactas; min, max y clamp derivan
+	* respecto al primer argumento igual al resultado, o al último si ninguno lo es. En las
+	* funciones personalizadas, igual que en las de un argumento, cada derivada parcial se calcula
+	* por diferencias centrales, con paso proporcional a la escala de su argumento.
+	* @param ins Instrucción CallN
+	* @param x Valores de los argumentos
+	* @param n Cantidad de argumentos
+	* @param partials Arreglo con capacidad para n derivadas parciales
+	* @return Resultado de la instrucción
+	*/
+	double applyArgs(const Instruction & ins, const double * x, size_t n, double * partials) {
+		const CustomFunction & f = program->customFunctions()[ins.arg];
+		std::string_view name = ExpressionGraph::builtinName(f);
+		if (name == "atan2" && n == 2) {
+			//atan2(y, x): x / (x^2 + y^2) y -y / (x^2 + y^2)
+			double r = x[1] * x[1] + x[0] * x[0];
+			partials[0] = x[1] / r;
+			partials[1] = -x[0] / r;
+			return f(x, n);
+		}
+		if (name == "hypot" && n == 2) {
+			double y = f(x, n);
+			partials[0] = x[0] / y;
+			partials[1] = x[1] / y;
+			return y;
+		}
+		if (name == "min" || name == "max" || name == "clamp") {
+			double y = f(x, n);
+			size_t chosen = (n > 0) ? n - 1 : 0;
+			for (size_t j = n; j-- > 0;) {
+				partials[j] = 0.0;
+				if (j + 1 < n && x[j] == y) {
+					chosen = j;
+				}
+			}
+			if (n > 0) {
+				partials[chosen] = 1.0;
+			}
+			return y;
+		}
+		shifted.assign(x, x + n);
+		for (size_t j = 0; j < n; j++) {
+			double h = std::cbrt(DBL_EPSILON) * std::max(1.0, fabs(x[j]));
+			shifted[j] = x[j] + h;
+			double up = f(shifted.data(), n);
+			shifted[j] = x[j] - h;
+			double down = f(shifted.data(), n);
+			shifted[j] = x[j];
+			partials[j] = (up - down) / (2.0 * h);
+		}
+		return f(x, n);
+	}
+
+	/**
+	* @brief Combina las derivadas de los operandos: pa * da + pb * db
+	*
+	* Los términos con derivada del operando cero se omiten, de modo que una derivada local
+	* indefinida (e.g. respecto al exponente constante de una base negativa) no afecta el resultado,
+	* y también los términos con derivada local cero, como los de las comparaciones, aunque la
+	* derivada del operando sea infinita o NAN.
+	*/
+	static double combine(double pa, double da, double pb, double db) {
+		double d = (pa != 0.0 && da != 0.0) ? pa * da : 0.0;
+		if (pb != 0.0 && db != 0.0) {
+			d += pb * db;
+		}
+		return d;
+	}
+
+	/**
+	* @brief Instrucción registrada en la cinta del modo reverso
+	*/
+	struct Entry {
+		double val; /*!< Resultado de la instrucción */
+		double pa; /*!< Derivada respecto al primer operando */
+		double pb; /*!< Derivada respecto al segundo operando */
+		size_t a; /*!< Instrucción del primer operando; para CallN, posición del primer operando en links */
+		size_t b; /*!< Instrucción del segundo operando; para CallN, cantidad de operandos */
+	};
+
+	/**
+	* @brief Operando de una instrucción CallN registrada en la cinta
+	*/
+	struct Link {
+		size_t node; /*!< Instrucción del operando */
+		double partial; /*!< Derivada respecto al operando */
+	};
+
+	std::shared_ptr<const CompiledExpression> program; /*!< Programa a derivar */
+	vector<Dual> duals; /*!< Pila de derivative() */
+	vector<double> stack; /*!< Pila de valores de forward() */
+	vector<double> tangents; /*!< Derivadas de cada posición de la pila de forward() */
+	vector<Entry> tape; /*!< Cinta de reverse() */
+	vector<double> adjoints; /*!< Adjuntos de cada instrucción */
+	vector<size_t> nodes; /*!< Pila de instrucciones de reverse() */
+	vector<Link> links; /*!< Operandos de las instrucciones CallN de la cinta */
+	vector<double> args; /*!< Argumentos de una instrucción CallN */
+	vector<double> partials; /*!< Derivadas parciales de una instrucción CallN */
+	vector<double> shifted; /*!< Argumentos desplazados para las diferencias centrales */
+};
+
+#endif
@@ -0,0 +1,325 @@
+#ifndef BATCHEVALUATOR_H
+#define BATCHEVALUATOR_H
+
+/**
+* @file
+* Evaluación asíncrona de solicitudes individuales agrupadas en lotes
+* Las solicitudes concurrentes sobre un mismo programa compilado se acumulan en un lote, que se
+* evalúa por columnas (ver CompiledExpression::evalRange()) cuando alcanza su tamaño máximo o
+* cuando su primera solicitud cumple el tiempo máximo de espera. Los resultados se entregan
+* mediante std::future o, con C++20, reanudando la corrutina que espera con co_await.
+* @author Erwin Meza Vega <emezav@unicauca.edu.co>
+* @copyright MIT License
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+/** Soporte de co_await en BatchEvaluator::evaluate() */
+#define BATCHEVALUATOR_COROUTINES 1
+#endif
+
+#include "expression.h"
+#include "threadpool.h"
+
+/**
+* @brief Evaluador que agrupa solicitudes individuales en lotes
+*
+* Un hilo planificador despacha los lotes listos: todos los que están listos en un mismo instante
+* se evalúan juntos en el conjunto de hilos, con tareas de hasta PARALLEL_CHUNK filas. Mientras
+* se evalúa una ronda, las solicitudes nuevas se siguen acumulando. maxBatch acota la cantidad de
+* filas por lote y maxLatency el tiempo que una solicitud espera a que su lote se llene: un
+* tiempo mayor produce lotes más grandes y más resultados por segundo, a cambio de latencia.
+* Los métodos se pueden invocar desde varios hilos.
+*/
+class BatchEvaluator {
+public:
+	/** Tamaño máximo predeterminado de un lote */
+	static const size_t MAX_BATCH = 1024;
+
+	/** Filas por tarea al evaluar los lotes */
+	static const size_t PARALLEL_CHUNK = CompiledExpression::PARALLEL_CHUNK;
+
+	/**
+	* @brief Crea el evaluador e inicia el hilo planificador
+	* @param pool Conjunto de hilos que evalúa los lotes; debe existir mientras exista el evaluador
+	* @param maxBatch Cantidad máxima de solicitudes por lote (al menos 1)
+	* @param maxLatency Tiempo máximo que la primera solicitud de un lote espera antes de evaluarlo
+	*/
+	explicit BatchEvaluator(ThreadPool & pool, size_t maxBatch = MAX_BATCH,
+			std::chrono::microseconds maxLatency = std::chrono::microseconds(200)):
+		pool(pool), maxBatch(std::max(maxBatch, size_t(1))), maxLatency(maxLatency), stopping(false),
+		scratch(pool.size() + 1), stacks(pool.size() + 1) {
+		scheduler = std::thread([this] {
+			schedule();
+		});
+	}
+
+	BatchEvaluator(const BatchEvaluator &) = delete;
+	BatchEvaluator & operator=(const BatchEvaluator &) = delete;
+
+	/**
+	* @brief Evalúa las solicitudes pendientes y detiene el hilo planificador
+	*/
+	~BatchEvaluator() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		ready.notify_one();
+		scheduler.join();
+	}
+
+	/**
+	* @brief Solicita una evaluación
+	* @param program Programa compilado, que identifica el lote de la solicitud
+	* @param values Valores de entrada, uno por cada program->inputs(); se copian antes de retornar
+	* @return Resultado futuro de program->eval(values)
+	*/
+	std::future<double> submit(std::shared_ptr<const CompiledExpression> program, const double * values) {
+		Waiter waiter;
+		std::future<double> result = waiter.promise.get_future();
+		enqueue(std::move(program), values, std::move(waiter));
+		return result;
+	}
+
+	/**
+	* @brief Solicita una evaluación
+	* @param program Programa compilado, que identifica el lote de la solicitud
+	* @param values Valores de entrada, en el orden de program->variables()
+	* @return Resultado futuro de program->eval(values)
+	*/
+	std::future<double> submit(std::shared_ptr<const CompiledExpression> program, const vector<double> & values) {
+		return submit(std::move(program), values.data());
+	}
+
+#ifdef BATCHEVALUATOR_COROUTINES
+	/**
+	* @brief Espera de una evaluación en una corrutina
+	*/
+	class Awaiter {
+	public:
+		bool await_ready() const noexcept {
+			return false;
+		}
+
+		void await_suspend(std::coroutine_handle<> h) {
+			handle = h;
+			Waiter waiter;
+			waiter.resume = &Awaiter::resume;
+			waiter.frame = this;
+			evaluator.enqueue(std::move(program), values, std::move(waiter));
+		}
+
+		double await_resume() const noexcept {
+			return value;
+		}
+
+	private:
+		friend class BatchEvaluator;
+
+		BatchEvaluator & evaluator; /*!< Evaluador de la solicitud */
+		std::shared_ptr<const CompiledExpression> program; /*!< Programa de la solicitud */
+		const double * values; /*!< Valores de entrada, se copian al suspender la corrutina */
+		std::coroutine_handle<> handle; /*!< Corrutina que espera el resultado */
+		double value; /*!< Resultado */
+
+		Awaiter(BatchEvaluator & evaluator, std::shared_ptr<const CompiledExpression> program, const double * values):
+			evaluator(evaluator), program(std::move(program)), values(values), value(NAN) {
+		}
+
+		static void resume(void * frame, double value) {
+			Awaiter * self = static_cast<Awaiter *>(frame);
+			self->value = value;
+			self->handle.resume();
+		}
+	};
+
+	/**
+	* @brief Solicita una evaluación desde una corrutina: double y = co_await evaluator.evaluate(p, values)
+	*
+	* La corrutina se reanuda en uno de los hilos que evalúan el lote, así que no debe bloquearse
+	* esperando otras solicitudes del mismo evaluador.
+	* @param program Programa compilado, que identifica el lote de la solicitud
+	* @param values Valores de entrada, uno por cada program->inputs(); deben existir hasta co_await
+	* @return Objeto de espera cuyo resultado es program->eval(values)
+	*/
+	Awaiter evaluate(std::shared_ptr<const CompiledExpression> program, const double * values) {
+		return Awaiter(*this, std::move(program), values);
+	}
+#endif
+
+	/**
+	* @brief Retorna la cantidad de lotes evaluados
+	* @return Lotes despachados desde la creación del evaluador
+	*/
+	size_t batches() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return dispatched;
+	}
+
+private:
+	/**
+	* @brief Entrega del resultado de una solicitud: una promesa o la reanudación de una corrutina
+	*/
+	struct Waiter {
+		std::promise<double> promise; /*!< Promesa, si resume es nullptr */
+		void (*resume)(void * frame, double value) = nullptr; /*!< Reanuda la corrutina con el resultado */
+		void * frame = nullptr; /*!< Objeto de espera de la corrutina */
+
+		void complete(double value) {
+			if (resume != nullptr) {
+				resume(frame, value);
+			}else {
+				promise.set_value(value);
+			}
+		}
+	};
+
+	/**
+	* @brief Solicitudes acumuladas sobre un mismo programa
+	*/
+	struct Batch {
+		std::shared_ptr<const CompiledExpression> program; /*!< Programa del lote */
+		vector<double> inputs; /*!< Columnas de entrada; la columna j empieza en inputs[j * capacity] */
+		size_t capacity = 0; /*!< Filas reservadas por columna */
+		vector<Waiter> waiters; /*!< Solicitudes, en el orden de las filas */
+		vector<double> out; /*!< Resultados */
+		std::chrono::steady_clock::time_point deadline; /*!< Instante en que se debe evaluar el lote */
+	};
+
+	ThreadPool & pool; /*!< Hilos que evalúan los lotes */
+	size_t maxBatch; /*!< Cantidad máxima de solicitudes por lote */
+	std::chrono::microseconds maxLatency; /*!< Espera máxima de la primera solicitud de un lote */
+	std::mutex mutex; /*!< Protege los lotes pendientes */
+	std::condition_variable ready; /*!< Notifica lotes nuevos, lotes llenos o la detención */
+	bool stopping; /*!< Verdadero cuando se destruye el evaluador */
+	std::unordered_map<const CompiledExpression *, Batch> pending; /*!< Lotes que se están llenando */
+	vector<Batch> full; /*!< Lotes llenos que esperan al planificador */
+	size_t dispatched = 0; /*!< Cantidad de lotes evaluados */
+	vector<vector<double>> scratch; /*!< Memoria de trabajo por número de hilo, incluyendo el planificador */
+	vector<vector<CompiledExpression::BatchValue>> stacks; /*!< Pilas de evaluación por número de hilo */
+	std::thread scheduler; /*!< Hilo planificador */
+
+	/**
+	* @brief Agrega una solicitud al lote de su programa
+	*/
+	void enqueue(std::shared_ptr<const CompiledExpression> program, const double * values, Waiter waiter) {
+		size_t inputs = program->inputs();
+		bool notify;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			Batch & batch = pending[program.get()];
+			notify = batch.waiters.empty();
+			if (notify) {
+				batch.capacity = maxBatch;
+				batch.inputs.resize(inputs * maxBatch);
+				batch.waiters.reserve(maxBatch);
+				batch.deadline = std::chrono::steady_clock::now() + maxLatency;
+				batch.program = std::move(program);
+			}
+			size_t row = batch.waiters.size();
+			for (size_t j = 0; j < inputs; j++) {
+				batch.inputs[j * batch.capacity + row] = values[j];
+			}
+			batch.waiters.push_back(std::move(waiter));
+			if (batch.waiters.size() >= maxBatch) {
+				auto it = pending.find(batch.program.get());
+				full.push_back(std::move(it->second));
+				pending.erase(it);
+				notify = true;
+			}
+		}
+		if (notify) {
+			ready.notify_one();
+		}
+	}
+
+	/**
+	* @brief Ciclo del hilo planificador: espera lotes listos y los evalúa
+	*/
+	void schedule() {
+		std::unique_lock<std::mutex> lock(mutex);
+		vector<Batch> round;
+		for (;;) {
+			//Lotes llenos, vencidos o pendientes al detener el evaluador
+			auto now = std::chrono::steady_clock::now();
+			auto next = std::chrono::steady_clock::time_point::max();
+			round = std::move(full);
+			full.clear();
+			for (auto it = pending.begin(); it != pending.end();) {
+				if (stopping || it->second.deadline <= now) {
+					round.push_back(std::move(it->second));
+					it = pending.erase(it);
+				}else {
+					next = std::min(next, it->second.deadline);
+					++it;
+				}
+			}
+			if (round.empty()) {
+				if (stopping) {
+					return;
+				}
+				if (next == std::chrono::steady_clock::time_point::max()) {
+					ready.wait(lock);
+				}else {
+					ready.wait_until(lock, next);
+				}
+				continue;
+			}
+			dispatched += round.size();
+			lock.unlock();
+			run(round);
+			round.clear();
+			lock.lock();
+		}
+	}
+
+	/**
+	* @brief Evalúa una ronda de lotes y entrega sus resultados
+	* @param round Lotes
+	*/
+	void run(vector<Batch> & round) {
+		//Una tarea por cada PARALLEL_CHUNK filas de cada lote
+		vector<std::pair<size_t, size_t>> tasks;
+		for (size_t b = 0; b < round.size(); b++) {
+			round[b].out.resize(round[b].waiters.size());
+			for (size_t begin = 0; begin < round[b].waiters.size(); begin += PARALLEL_CHUNK) {
+				tasks.emplace_back(b, begin);
+			}
+		}
+
+		pool.parallelFor(tasks.size(), [&](size_t task, size_t worker) {
+			Batch & batch = round[tasks[task].first];
+			const CompiledExpression & program = *batch.program;
+			size_t begin = tasks[task].second;
+			size_t end = std::min(batch.waiters.size(), begin + PARALLEL_CHUNK);
+
+			if (stacks[worker].size() < program.stackSize()) {
+				scratch[worker].resize(program.stackSize() * CompiledExpression::BATCH_SIZE);
+				stacks[worker].resize(program.stackSize());
+			}
+			vector<const double *> columns(program.inputs());
+			for (size_t j = 0; j < columns.size(); j++) {
+				columns[j] = batch.inputs.data() + j * batch.capacity;
+			}
+			program.evalRange(columns.data(), batch.out.data(), begin, end, scratch[worker].data(), stacks[worker].data());
+
+			for (size_t i = begin; i < end; i++) {
+				batch.waiters[i].complete(batch.out[i]);
+			}
+		});
+	}
+};
+
+#endif
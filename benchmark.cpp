@@ -0,0 +1,444 @@
+/**
+* @file
+* Medición del rendimiento del evaluador de expresiones aritméticas
+*
+* Mide la construcción, la carga desde el formato binario, la conversión a RPN, la evaluación individual (interpretada y en código
+* nativo), la evaluación por lotes (en double y en float) y sobre una malla, la evaluación conjunta de todas las expresiones, las solicitudes
+* asíncronas agrupadas en lotes, la evaluación desde el registro de fórmulas y la cantidad de reservas
+* de memoria por evaluación, sobre las expresiones de main.cpp y un conjunto de expresiones grandes generadas.
+*
+* Compilación (requiere Google Benchmark):
+*   g++ -std=c++17 -O3 benchmark.cpp -o benchmark -lbenchmark -lpthread
+*
+* Los resultados se emiten en JSON; para guardarlos en un archivo:
+*   ./benchmark --benchmark_out=results.json
+* @author Erwin Meza Vega <emezav@unicauca.edu.co>
+* @copyright MIT License
+*/
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+
+#include <benchmark/benchmark.h>
+
+#include "batchevaluator.h"
+#include "expression.h"
+#include "expressionset.h"
+#include "formulafile.h"
+#include "formularegistry.h"
+#include "typedexpression.h"
+#include "jit.h"
+
+/**
+* @brief Cantidad de reservas de memoria realizadas por el programa
+*/
+static std::atomic<size_t> allocations(0);
+
+//Reemplazo de los operadores globales para contar las reservas
+#ifdef __GNUC__
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void * operator new(size_t size) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void * p = std::malloc(size ? size : 1)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void * p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void * p, size_t) noexcept {
+	std::free(p);
+}
+
+//std::pmr::new_delete_resource() reserva con la versión alineada
+void * operator new(size_t size, std::align_val_t align) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	size_t a = (size_t) align;
+	if (void * p = std::aligned_alloc(a, (size + a - 1) / a * a)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void * p, std::align_val_t) noexcept {
+	std::free(p);
+}
+
+void operator delete(void * p, size_t, std::align_val_t) noexcept {
+	std::free(p);
+}
+
+/**
+* @brief Genera un polinomio trigonométrico de un tamaño dado
+* @param terms Cantidad de términos
+* @return Texto de la expresión, e.g. 0.5*sin(x)^2 - 1.25*x^3 + ...
+*/
+static string generate(size_t terms) {
+	std::mt19937 gen(terms);
+	std::uniform_int_distribution<int> kind(0, 5);
+	std::uniform_int_distribution<int> power(1, 6);
+	std::uniform_real_distribution<double> coef(0.1, 10.0);
+	const char * funcs[] = {"sin", "cos", "exp", "sqrt"};
+
+	ostringstream oss;
+	oss.precision(4);
+	for (size_t i = 0; i < terms; i++) {
+		if (i > 0) {
+			oss << ((i % 3 == 0) ? " - " : " + ");
+		}
+		oss << coef(gen) << "*";
+		int k = kind(gen);
+		if (k < 4) {
+			oss << funcs[k] << "(x/" << power(gen) << ")^" << power(gen);
+		}else if (k == 4) {
+			oss << "x^" << power(gen);
+		}else {
+			oss << "(x + " << coef(gen) << ")/(x^2 + " << coef(gen) << ")";
+		}
+	}
+	return oss.str();
+}
+
+/**
+* @brief Expresiones medidas: las de main.cpp, una con funciones de varios argumentos, una por tramos
+*        y las generadas
+* @return Textos de las expresiones
+*/
+static const vector<string> & formulas() {
+	static const vector<string> all = []() {
+		vector<string> f = {
+			"x^3 - 2*x^2 -x + 1",
+			"2*a + 1",
+			"e^~x - ln(x)",
+			"e^~(x^2) - x",
+			"x^4 - 6*x^3 + 12*x^2 - 10*x + 3",
+			"e",
+			"pi",
+			"~pi",
+			"sin(x)",
+			"~7*e^~x + sin(tan(x^3) + cos(x - pi))",
+			"clamp(x, 0.5, 3) * max(sin(x), cos(x), 0.25) + atan2(x, 2)",
+			"if(x < 1, x^2, 2*x - 1) + (x > 2 && x < 3)",
+		};
+		for (size_t terms: {10, 100, 1000}) {
+			f.push_back(generate(terms));
+		}
+		return f;
+	}();
+	return all;
+}
+
+/**
+* @brief Registra una medición para cada una de las expresiones
+* @param b Medición
+*/
+static void formulaArgs(benchmark::internal::Benchmark * b) {
+	b->DenseRange(0, formulas().size() - 1);
+}
+
+/**
+* @brief Asigna la etiqueta y el contador de reservas por evaluación
+* @param state Estado de la medición
+* @param text Texto de la expresión
+* @param allocs Reservas realizadas durante la medición
+*/
+static void report(benchmark::State & state, const string & text, size_t allocs) {
+	state.SetLabel(text.size() > 40 ? text.substr(0, 37) + "..." : text);
+	state.counters["allocs"] = benchmark::Counter(allocs, benchmark::Counter::kAvgIterations);
+}
+
+static void BM_Construct(benchmark::State & state) {
+	const string & text = formulas()[state.range(0)];
+	size_t start = allocations.load();
+	for (auto _: state) {
+		expression e(text);
+		benchmark::DoNotOptimize(e);
+	}
+	report(state, text, allocations.load() - start);
+}
+BENCHMARK(BM_Construct)->Apply(formulaArgs);
+
+static void BM_ConstructArena(benchmark::State & state) {
+	const string & text = formulas()[state.range(0)];
+	std::pmr::monotonic_buffer_resource arena(1 << 20);
+	size_t start = allocations.load();
+	for (auto _: state) {
+		{
+			expression e(text, &arena);
+			benchmark::DoNotOptimize(e);
+		}
+		arena.release();
+	}
+	report(state, text, allocations.load() - start);
+}
+BENCHMARK(BM_ConstructArena)->Apply(formulaArgs);
+
+static void BM_Load(benchmark::State & state) {
+	const string & text = formulas()[state.range(0)];
+	FormulaWriter writer;
+	writer.add(*expression(text).compiled());
+	vector<unsigned char> bytes = writer.bytes();
+	FormulaFile file(bytes.data(), bytes.size());
+	size_t start = allocations.load();
+	for (auto _: state) {
+		benchmark::DoNotOptimize(file.load(0));
+	}
+	report(state, text, allocations.load() - start);
+}
+BENCHMARK(BM_Load)->Apply(formulaArgs);
+
+static void BM_GetRPN(benchmark::State & state) {
+	const string & text = formulas()[state.range(0)];
+	expression e(text);
+	std::pmr::vector<Token> tokens = expression::lex(text);
+	size_t start = allocations.load();
+	for (auto _: state) {
+		std::pmr::vector<Token> rpn = e.getRPN(tokens, text);
+		benchmark::DoNotOptimize(rpn.data());
+	}
+	report(state, text, allocations.load() - start);
+}
+BENCHMARK(BM_GetRPN)->Apply(formulaArgs);
+
+static void BM_Eval(benchmark::State & state) {
+	const string & text = formulas()[state.range(0)];
+	expression e(text);
+	double x = 0.25;
+	size_t start = allocations.load();
+	for (auto _: state) {
+		benchmark::DoNotOptimize(e(x));
+		x += 1e-6;
+	}
+	report(state, text, allocations.load() - start);
+}
+BENCHMARK(BM_Eval)->Apply(formulaArgs);
+
+static void BM_EvalVariables(benchmark::State & state) {
+	const string & text = formulas()[state.range(0)];
+	expression e(text);
+	vector<Variable> vars = {{"x", 0.25}, {"a", 0.5}};
+	size_t start = allocations.load();
+	for (auto _: state) {
+		benchmark::DoNotOptimize(e.eval(vars));
+	}
+	report(state, text, allocations.load() - start);
+}
+BENCHMARK(BM_EvalVariables)->Apply(formulaArgs);
+
+static void BM_EvalNative(benchmark::State & state) {
+	const string & text = formulas()[state.range(0)];
+	expression e(text);
+	e.bind({"x"});
+	NativeExpression native(e);
+	double x = 0.25;
+	size_t start = allocations.load();
+	for (auto _: state) {
+		benchmark::DoNotOptimize(native(&x));
+		x += 1e-6;
+	}
+	report(state, text, allocations.load() - start);
+	state.counters["native"] = native.isNative();
+}
+BENCHMARK(BM_EvalNative)->Apply(formulaArgs);
+
+static void BM_EvalBatch(benchmark::State & state) {
+	const string & text = formulas()[state.range(0)];
+	const size_t n = 1 << 16;
+	expression e(text);
+	vector<double> x(n);
+	vector<double> y(n);
+	for (size_t i = 0; i < n; i++) {
+		x[i] = 0.1 + 4.0 * i / n;
+	}
+	size_t start = allocations.load();
+	for (auto _: state) {
+		e.evalBatch(x.data(), y.data(), n);
+		benchmark::DoNotOptimize(y.data());
+		benchmark::ClobberMemory();
+	}
+	size_t allocs = allocations.load() - start;
+	report(state, text, allocs);
+	//Reservas por evaluación, no por lote
+	state.counters["allocs"] = benchmark::Counter((double) allocs / n, benchmark::Counter::kAvgIterations);
+	state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_EvalBatch)->Apply(formulaArgs);
+
+static void BM_EvalBatchFloat(benchmark::State & state) {
+	const string & text = formulas()[state.range(0)];
+	const size_t n = 1 << 16;
+	TypedExpression<float> e(text);
+	vector<float> x(n);
+	vector<float> y(n);
+	for (size_t i = 0; i < n; i++) {
+		x[i] = 0.1f + 4.0f * i / n;
+	}
+	size_t start = allocations.load();
+	for (auto _: state) {
+		e.evalBatch(x.data(), y.data(), n);
+		benchmark::DoNotOptimize(y.data());
+		benchmark::ClobberMemory();
+	}
+	size_t allocs = allocations.load() - start;
+	report(state, text, allocs);
+	state.counters["allocs"] = benchmark::Counter((double) allocs / n, benchmark::Counter::kAvgIterations);
+	state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_EvalBatchFloat)->Apply(formulaArgs);
+
+/**
+* @brief Evalúa todas las expresiones sobre las mismas columnas, una pasada por expresión
+*        (argumento 0) o en una sola pasada con ExpressionSet (argumento 1)
+* @param state Estado de la medición
+*/
+static void BM_EvalSet(benchmark::State & state) {
+	const size_t n = 1 << 14;
+	vector<expression> exprs(formulas().begin(), formulas().end());
+	ExpressionSet set;
+	for (auto & e: exprs) {
+		set.add(e);
+	}
+	vector<vector<double>> inputs(set.variables().size(), vector<double>(n));
+	vector<const double *> columns;
+	for (auto & c: inputs) {
+		for (size_t i = 0; i < n; i++) {
+			c[i] = 0.1 + 4.0 * i / n;
+		}
+		columns.push_back(c.data());
+	}
+	vector<vector<double>> results(exprs.size(), vector<double>(n));
+	vector<double *> outs;
+	for (size_t j = 0; j < exprs.size(); j++) {
+		exprs[j].bind(set.variables());
+		outs.push_back(results[j].data());
+	}
+	set.compiled();
+
+	size_t start = allocations.load();
+	for (auto _: state) {
+		if (state.range(0) == 0) {
+			for (size_t j = 0; j < exprs.size(); j++) {
+				exprs[j].evalBatch(columns.data(), outs[j], n);
+			}
+		}else {
+			set.evalBatch(columns.data(), outs.data(), n);
+		}
+		benchmark::DoNotOptimize(outs.data());
+		benchmark::ClobberMemory();
+	}
+	state.counters["allocs"] = benchmark::Counter((double) (allocations.load() - start) / n,
+			benchmark::Counter::kAvgIterations);
+	state.SetLabel(state.range(0) == 0 ? "separate" : "ExpressionSet");
+	state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_EvalSet)->Arg(0)->Arg(1);
+
+/**
+* @brief Evaluación sobre una malla de x: 0 llena un arreglo con la malla y usa evalBatch(), 1 usa evalRange()
+*/
+static void BM_EvalRange(benchmark::State & state) {
+	const size_t n = 1 << 16;
+	expression e("x^3 - 2*x^2 - x + 1");
+	vector<double> x(n), out(n);
+
+	for (auto _: state) {
+		if (state.range(0) == 0) {
+			for (size_t i = 0; i < n; i++) {
+				x[i] = -2.0 + i * (4.0 / (n - 1));
+			}
+			e.evalBatch(x.data(), out.data(), n);
+		}else {
+			e.evalRange(-2.0, 2.0, n, out.data());
+		}
+		benchmark::DoNotOptimize(out.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetLabel(state.range(0) == 0 ? "evalBatch" : "evalRange");
+	state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_EvalRange)->Arg(0)->Arg(1);
+
+/**
+* @brief Solicitudes individuales agrupadas por BatchEvaluator, con el tamaño máximo de lote como argumento
+*/
+static void BM_Submit(benchmark::State & state) {
+	const size_t n = 4096;
+	ThreadPool pool;
+	BatchEvaluator evaluator(pool, state.range(0), std::chrono::microseconds(100));
+	expression e("x^2 + sin(y) * 3 - ln(x + 1)");
+	e.bind({"x", "y"});
+	std::shared_ptr<const CompiledExpression> program = e.compiled();
+	vector<double> values(2 * n);
+	for (size_t i = 0; i < values.size(); i++) {
+		values[i] = 0.5 + i * 0.001;
+	}
+	vector<std::future<double>> results(n);
+
+	for (auto _: state) {
+		for (size_t i = 0; i < n; i++) {
+			results[i] = evaluator.submit(program, values.data() + 2 * i);
+		}
+		double sum = 0;
+		for (auto & r: results) {
+			sum += r.get();
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_Submit)->Arg(1)->Arg(64)->Arg(1024)->UseRealTime();
+
+/**
+* @brief Evaluación desde el registro de fórmulas en varios hilos; con el argumento 1, un escritor
+* que reemplaza la fórmula continuamente
+*/
+static void BM_RegistryEval(benchmark::State & state) {
+	static FormulaRegistry registry;
+	static std::atomic<bool> stop(false);
+	static std::thread writer;
+	if (state.thread_index() == 0) {
+		registry.update("f", "x^2 + sin(y) * 3 - ln(x + 1)", {"x", "y"});
+		stop = false;
+		if (state.range(0) != 0) {
+			writer = std::thread([] {
+				for (int k = 0; !stop; k++) {
+					registry.update("f", "x^2 + sin(y) * " + std::to_string(k % 8) + " - ln(x + 1)", {"x", "y"});
+				}
+			});
+		}
+	}
+	double values[2] = {0.5, 1.5};
+
+	for (auto _: state) {
+		benchmark::DoNotOptimize(registry.eval("f", values));
+	}
+	if (state.thread_index() == 0 && writer.joinable()) {
+		stop = true;
+		writer.join();
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RegistryEval)->Arg(0)->Arg(1)->Threads(1)->Threads(4)->UseRealTime();
+
+int main(int argc, char ** argv) {
+	//JSON por defecto; un --benchmark_format posterior lo reemplaza
+	vector<char *> args(argv, argv + argc);
+	char json[] = "--benchmark_format=json";
+	char out[] = "--benchmark_out_format=json";
+	args.insert(args.begin() + 1, {json, out});
+	argc = (int) args.size();
+
+	benchmark::Initialize(&argc, args.data());
+	if (benchmark::ReportUnrecognizedArguments(argc, args.data())) {
+		return 1;
+	}
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
@@ -0,0 +1,515 @@
+#ifndef COLUMNSTREAM_H
+#define COLUMNSTREAM_H
+
+/**
+* @file
+* Evaluación de expresiones sobre archivos de datos por columnas
+* Los archivos se leen por bloques de filas de tamaño fijo: mientras se evalúa un bloque con
+* la evaluación por lotes, otro hilo lee el bloque siguiente en un segundo búfer.
+* @author Erwin Meza Vega <emezav@unicauca.edu.co>
+* @copyright MIT License
+*/
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "expression.h"
+#include "threadpool.h"
+
+/**
+* @brief Origen de datos organizado en columnas con nombre
+*
+* Las implementaciones no se invocan de forma concurrente: ColumnStream lee un solo bloque a la vez.
+*/
+class ColumnSource {
+public:
+	virtual ~ColumnSource() = default;
+
+	/**
+	* @brief Retorna los nombres de las columnas
+	* @return Nombres de las columnas, en el orden del archivo
+	*/
+	virtual const vector<string> & columns() const = 0;
+
+	/**
+	* @brief Lee el siguiente bloque de filas
+	* @param selected Posiciones de las columnas a leer, dentro de columns()
+	* @param dest Un arreglo de rows valores por cada columna de selected
+	* @param rows Cantidad máxima de filas a leer
+	* @return Cantidad de filas leídas, 0 al final de los datos
+	*/
+	virtual size_t read(const vector<size_t> & selected, double * const * dest, size_t rows) = 0;
+};
+
+/**
+* @brief Columnas de valores double binarios en orden little-endian, un archivo por columna
+*
+* Los valores se leen directamente en los búferes de destino, sin conversión en los equipos
+* little-endian. Los datos terminan con la columna más corta.
+*/
+class BinaryColumnSource: public ColumnSource {
+public:
+	/**
+	* @brief Abre los archivos de las columnas
+	* @param files Pares (nombre de la columna, ruta del archivo)
+	*/
+	explicit BinaryColumnSource(const vector<std::pair<string, string>> & files): open(true) {
+		for (auto & f: files) {
+			names.push_back(f.first);
+			handles.push_back(std::fopen(f.second.c_str(), "rb"));
+			open = open && handles.back() != nullptr;
+		}
+	}
+
+	BinaryColumnSource(const BinaryColumnSource &) = delete;
+	BinaryColumnSource & operator=(const BinaryColumnSource &) = delete;
+
+	/**
+	* @brief Cierra los archivos
+	*/
+	~BinaryColumnSource() override {
+		for (FILE * h: handles) {
+			if (h != nullptr) {
+				std::fclose(h);
+			}
+		}
+	}
+
+	/**
+	* @brief Verifica si se abrieron todos los archivos
+	* @return Verdadero si todos los archivos están abiertos
+	*/
+	bool isOpen() const {
+		return open;
+	}
+
+	const vector<string> & columns() const override {
+		return names;
+	}
+
+	size_t read(const vector<size_t> & selected, double * const * dest, size_t rows) override {
+		if (!open) {
+			return 0;
+		}
+		for (size_t j = 0; j < selected.size(); j++) {
+			rows = std::min(rows, std::fread(dest[j], sizeof(double), rows, handles[selected[j]]));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+			for (size_t i = 0; i < rows; i++) {
+				dest[j][i] = swap(dest[j][i]);
+			}
+#endif
+		}
+		return selected.empty() ? 0 : rows;
+	}
+
+	/**
+	* @brief Invierte el orden de los bytes de un valor
+	* @param v Valor
+	* @return Valor con los bytes en orden inverso
+	*/
+	static double swap(double v) {
+		unsigned char b[sizeof(double)];
+		std::memcpy(b, &v, sizeof(double));
+		std::reverse(b, b + sizeof(double));
+		std::memcpy(&v, b, sizeof(double));
+		return v;
+	}
+
+private:
+	vector<string> names; /*!< Nombres de las columnas */
+	vector<FILE *> handles; /*!< Archivo de cada columna */
+	bool open; /*!< Indica si se abrieron todos los archivos */
+};
+
+/**
+* @brief Archivo de texto con valores separados por un delimitador y una fila de encabezado
+*
+* La primera línea contiene los nombres de las columnas. Los campos vacíos, faltantes o que no son
+* números toman el valor NAN; se ignoran los espacios y las comillas alrededor de cada campo, pero
+* no se admiten delimitadores dentro de las comillas. El archivo se lee por bloques de bytes y los
+* números se convierten con std::from_chars, sin depender de la configuración regional.
+*/
+class CsvColumnSource: public ColumnSource {
+public:
+	/** Tamaño inicial del búfer de lectura, en bytes */
+	static const size_t BLOCK_SIZE = 1 << 20;
+
+	/**
+	* @brief Abre el archivo y lee la fila de encabezado
+	* @param path Ruta del archivo
+	* @param delimiter Separador de los campos
+	*/
+	explicit CsvColumnSource(const string & path, char delimiter = ','):
+		handle(std::fopen(path.c_str(), "rb")), delimiter(delimiter), buffer(BLOCK_SIZE), pos(0), end(0) {
+		const char * b;
+		const char * e;
+		if (handle == nullptr || !nextLine(b, e)) {
+			return;
+		}
+		for (const char * f = b; f <= e; ) {
+			const char * d = field(f, e);
+			const char * s = f;
+			const char * t = d;
+			trim(s, t);
+			names.emplace_back(s, t);
+			f = d + 1;
+		}
+	}
+
+	CsvColumnSource(const CsvColumnSource &) = delete;
+	CsvColumnSource & operator=(const CsvColumnSource &) = delete;
+
+	/**
+	* @brief Cierra el archivo
+	*/
+	~CsvColumnSource() override {
+		if (handle != nullptr) {
+			std::fclose(handle);
+		}
+	}
+
+	/**
+	* @brief Verifica si se abrió el archivo
+	* @return Verdadero si el archivo está abierto
+	*/
+	bool isOpen() const {
+		return handle != nullptr;
+	}
+
+	const vector<string> & columns() const override {
+		return names;
+	}
+
+	size_t read(const vector<size_t> & selected, double * const * dest, size_t rows) override {
+		//Columna de destino de cada campo, o -1 si no se lee
+		target.assign(names.size(), -1);
+		for (size_t j = 0; j < selected.size(); j++) {
+			target[selected[j]] = static_cast<long>(j);
+		}
+
+		size_t count = 0;
+		const char * b;
+		const char * e;
+		while (count < rows && handle != nullptr && nextLine(b, e)) {
+			if (b == e) {
+				continue;
+			}
+			for (size_t j = 0; j < selected.size(); j++) {
+				dest[j][count] = NAN;
+			}
+			const char * f = b;
+			for (size_t c = 0; c < names.size() && f <= e; c++) {
+				const char * d = field(f, e);
+				if (target[c] >= 0) {
+					dest[target[c]][count] = parse(f, d);
+				}
+				f = d + 1;
+			}
+			count++;
+		}
+		return count;
+	}
+
+private:
+	/**
+	* @brief Obtiene la siguiente línea del archivo, sin el fin de línea
+	* @param b Inicio de la línea
+	* @param e Fin de la línea
+	* @return Falso al final del archivo
+	*/
+	bool nextLine(const char * & b, const char * & e) {
+		while (true) {
+			const char * nl = static_cast<const char *>(std::memchr(buffer.data() + pos, '\n', end - pos));
+			bool eof = nl == nullptr && (std::feof(handle) || std::ferror(handle));
+			if (nl != nullptr || (eof && pos < end)) {
+				b = buffer.data() + pos;
+				e = nl != nullptr ? nl : buffer.data() + end;
+				pos = nl != nullptr ? nl - buffer.data() + 1 : end;
+				if (e > b && e[-1] == '\r') {
+					e--;
+				}
+				return true;
+			}
+			if (eof) {
+				return false;
+			}
+			//Conservar la línea incompleta al inicio del búfer y completar el bloque
+			std::memmove(buffer.data(), buffer.data() + pos, end - pos);
+			end -= pos;
+			pos = 0;
+			if (end == buffer.size()) {
+				buffer.resize(2 * buffer.size());
+			}
+			end += std::fread(buffer.data() + end, 1, buffer.size() - end, handle);
+		}
+	}
+
+	/**
+	* @brief Busca el fin de un campo
+	* @param f Inicio del campo
+	* @param e Fin de la línea
+	* @return Posición del delimitador que termina el campo, o e
+	*/
+	const char * field(const char * f, const char * e) const {
+		const char * d = static_cast<const char *>(std::memchr(f, delimiter, e - f));
+		return d != nullptr ? d : e;
+	}
+
+	/**
+	* @brief Descarta los espacios y las comillas alrededor de un campo
+	* @param b Inicio del campo
+	* @param e Fin del campo
+	*/
+	static void trim(const char * & b, const char * & e) {
+		while (b < e && (*b == ' ' || *b == '\t')) {
+			b++;
+		}
+		while (e > b && (e[-1] == ' ' || e[-1] == '\t')) {
+			e--;
+		}
+		if (e - b >= 2 && *b == '"' && e[-1] == '"') {
+			b++;
+			e--;
+		}
+	}
+
+	/**
+	* @brief Convierte un campo en número
+	* @param b Inicio del campo
+	* @param e Fin del campo
+	* @return Valor del campo, o NAN si no es un número
+	*/
+	static double parse(const char * b, const char * e) {
+		trim(b, e);
+		if (b < e && *b == '+') {
+			b++;
+		}
+		double v;
+		auto r = std::from_chars(b, e, v);
+		return (r.ec == std::errc() && r.ptr == e) ? v : NAN;
+	}
+
+	FILE * handle; /*!< Archivo de datos */
+	char delimiter; /*!< Separador de los campos */
+	vector<char> buffer; /*!< Bloque de bytes leído del archivo */
+	size_t pos; /*!< Inicio de la siguiente línea dentro del búfer */
+	size_t end; /*!< Cantidad de bytes válidos en el búfer */
+	vector<string> names; /*!< Nombres de las columnas */
+	vector<long> target; /*!< Columna de destino de cada campo */
+};
+
+/**
+* @brief Columna de salida de valores double binarios en orden little-endian
+*/
+class ColumnWriter {
+public:
+	/**
+	* @brief Crea el archivo de salida
+	* @param path Ruta del archivo
+	*/
+	explicit ColumnWriter(const string & path): handle(std::fopen(path.c_str(), "wb")) {
+	}
+
+	ColumnWriter(const ColumnWriter &) = delete;
+	ColumnWriter & operator=(const ColumnWriter &) = delete;
+
+	/**
+	* @brief Cierra el archivo
+	*/
+	~ColumnWriter() {
+		if (handle != nullptr) {
+			std::fclose(handle);
+		}
+	}
+
+	/**
+	* @brief Verifica si se creó el archivo
+	* @return Verdadero si el archivo está abierto
+	*/
+	bool isOpen() const {
+		return handle != nullptr;
+	}
+
+	/**
+	* @brief Agrega valores al final del archivo
+	* @param values Valores
+	* @param n Cantidad de valores
+	*/
+	void operator()(const double * values, size_t n) {
+		if (handle == nullptr) {
+			return;
+		}
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		for (size_t i = 0; i < n; i++) {
+			double v = BinaryColumnSource::swap(values[i]);
+			std::fwrite(&v, sizeof(double), 1, handle);
+		}
+#else
+		std::fwrite(values, sizeof(double), n, handle);
+#endif
+	}
+
+private:
+	FILE * handle; /*!< Archivo de salida */
+};
+
+/**
+* @brief Evalúa una expresión por cada fila de un origen de datos por columnas
+*
+* Las variables de la expresión se asocian a las columnas del mismo nombre; las demás toman su
+* valor de expression::defaultVariables(), o NAN si no están definidas. Cada bloque de filas se
+* evalúa con CompiledExpression::evalRange() mientras un segundo hilo lee el bloque siguiente.
+* Solo se leen las columnas que usa la expresión.
+*/
+class ColumnStream {
+public:
+	/**
+	* @brief Destino de los resultados de un bloque de filas
+	* @param values Resultados, en el orden de las filas
+	* @param n Cantidad de resultados
+	*/
+	typedef std::function<void(const double * values, size_t n)> Sink;
+
+	/** Cantidad predeterminada de filas por bloque */
+	static const size_t CHUNK_ROWS = 1 << 16;
+
+	/**
+	* @brief Asocia las variables de una expresión a las columnas de un origen de datos
+	* @param expr Expresión a evaluar
+	* @param source Origen de los datos; debe existir mientras exista el evaluador
+	* @param chunkRows Cantidad de filas por bloque
+	*/
+	ColumnStream(expression & expr, ColumnSource & source, size_t chunkRows = CHUNK_ROWS):
+		source(source), chunkRows(std::max(chunkRows, size_t(1))) {
+		const vector<string> & columns = source.columns();
+		vector<string> names;
+
+		for (auto & v: expr.variables()) {
+			auto it = std::find(columns.begin(), columns.end(), v);
+			if (it == columns.end()) {
+				unmatched.push_back(v);
+				continue;
+			}
+			names.push_back(v);
+			selected.push_back(it - columns.begin());
+		}
+		//Sin variables se lee una columna para conocer la cantidad de filas
+		if (selected.empty() && !columns.empty()) {
+			selected.push_back(0);
+		}
+
+		bool resolved;
+		program = expr.compiled(names, resolved);
+	}
+
+	/**
+	* @brief Retorna las variables de la expresión que no corresponden a ninguna columna
+	* @return Nombres de las variables
+	*/
+	const vector<string> & missing() const {
+		return unmatched;
+	}
+
+	/**
+	* @brief Evalúa la expresión sobre todas las filas restantes del origen de datos
+	* @param sink Destino de los resultados de cada bloque
+	* @return Cantidad de filas evaluadas
+	*/
+	size_t run(const Sink & sink) {
+		return run(sink, nullptr);
+	}
+
+	/**
+	* @brief Evalúa la expresión sobre las filas restantes, repartiendo cada bloque entre hilos
+	* @param sink Destino de los resultados de cada bloque
+	* @param pool Conjunto de hilos que ejecuta la evaluación
+	* @return Cantidad de filas evaluadas
+	*/
+	size_t run(const Sink & sink, ThreadPool & pool) {
+		return run(sink, &pool);
+	}
+
+	/**
+	* @brief Evalúa la expresión sobre las filas restantes y escribe los resultados en un archivo
+	* @param writer Columna de salida
+	* @return Cantidad de filas evaluadas
+	*/
+	size_t run(ColumnWriter & writer) {
+		return run([&writer](const double * values, size_t n) { writer(values, n); }, nullptr);
+	}
+
+private:
+	/**
+	* @brief Búfer de un bloque de filas
+	*/
+	struct Chunk {
+		vector<double> data; /*!< Valores de las columnas leídas, chunkRows por columna */
+		vector<const double *> columns; /*!< Inicio de cada columna dentro de data */
+		vector<double *> dest; /*!< Inicio de cada columna, para la lectura */
+	};
+
+	/**
+	* @brief Evalúa las filas restantes con lectura anticipada del bloque siguiente
+	* @param sink Destino de los resultados de cada bloque
+	* @param pool Conjunto de hilos que ejecuta la evaluación, o nullptr para usar el hilo actual
+	* @return Cantidad de filas evaluadas
+	*/
+	size_t run(const Sink & sink, ThreadPool * pool) {
+		if (selected.empty()) {
+			return 0;
+		}
+
+		Chunk chunks[2];
+		for (Chunk & c: chunks) {
+			c.data.resize(selected.size() * chunkRows);
+			for (size_t j = 0; j < selected.size(); j++) {
+				c.dest.push_back(c.data.data() + j * chunkRows);
+				c.columns.push_back(c.dest.back());
+			}
+		}
+		vector<double> out(chunkRows);
+		vector<double> scratch(program->stackSize() * CompiledExpression::BATCH_SIZE);
+		vector<CompiledExpression::BatchValue> st(program->stackSize());
+
+		auto fetch = [this](Chunk & c) {
+			return std::async(std::launch::async, [this, &c]() {
+				return source.read(selected, c.dest.data(), chunkRows);
+			});
+		};
+
+		size_t total = 0;
+		size_t current = 0;
+		std::future<size_t> next = fetch(chunks[current]);
+		while (size_t rows = next.get()) {
+			//Leer el bloque siguiente mientras se evalúa el actual
+			next = fetch(chunks[1 - current]);
+			const double * const * columns = chunks[current].columns.data();
+			if (pool != nullptr) {
+				program->evalParallel(columns, out.data(), rows, *pool);
+			}else {
+				program->evalRange(columns, out.data(), 0, rows, scratch.data(), st.data());
+			}
+			sink(out.data(), rows);
+			total += rows;
+			current = 1 - current;
+		}
+
+		return total;
+	}
+
+	ColumnSource & source; /*!< Origen de los datos */
+	size_t chunkRows; /*!< Cantidad de filas por bloque */
+	vector<size_t> selected; /*!< Columna del origen asociada a cada valor de entrada */
+	vector<string> unmatched; /*!< Variables sin columna asociada */
+	std::shared_ptr<const CompiledExpression> program; /*!< Programa asociado a las columnas */
+};
+
+#endif
@@ -0,0 +1,875 @@
+#ifndef DEVICEKERNEL_H
+#define DEVICEKERNEL_H
+
+/**
+* @file
+* Evaluación por lotes en un dispositivo (GPU) de los programas compilados de las expresiones
+* DeviceKernel traduce las instrucciones de un CompiledExpression a un kernel en OpenCL C o en
+* CUDA, con un hilo por fila y la pila de evaluación en variables locales. Las funciones
+* personalizadas que no tienen equivalente en el dispositivo hacen que el programa no sea válido.
+* La compilación y ejecución de los kernels requiere OpenCL: se habilita definiendo
+* EXPRESSION_OPENCL y enlazando con la biblioteca de OpenCL (-lOpenCL). Sin OpenCL,
+* DeviceExpression evalúa los lotes con el intérprete.
+* @author Erwin Meza Vega <emezav@unicauca.edu.co>
+* @copyright MIT License
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "expression.h"
+
+#ifdef EXPRESSION_OPENCL
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 120
+#endif
+#ifdef __APPLE__
+#include <OpenCL/opencl.h>
+#else
+#include <CL/cl.h>
+#endif
+#endif
+
+/**
+* @brief Lenguaje del código fuente de un kernel
+*/
+enum class DeviceLanguage {
+	OpenCL, /*!< OpenCL C 1.2 con la extensión cl_khr_fp64 */
+	CUDA /*!< CUDA C++, para compilar con NVRTC o nvcc */
+};
+
+/**
+* @brief Kernel de dispositivo generado a partir de un programa compilado
+*
+* El kernel se llama DeviceKernel::NAME y recibe, en este orden: las entradas en un solo arreglo
+* por columnas (la entrada j de la fila i está en in[j * stride + i]), stride, el arreglo de
+* salida y la cantidad de filas n. Los operadores, pow y las funciones predefinidas se traducen a
+* las funciones del dispositivo, y las comparaciones, los operadores lógicos e if(c, a, b) a
+* expresiones condicionales que el compilador del dispositivo convierte en selecciones; min, max, clamp, atan2 e hypot solo se reconocen si son las de
+* defaultFunctions(). Los resultados pueden diferir en algunos ULP de eval(), según la precisión
+* de las funciones matemáticas del dispositivo.
+*/
+class DeviceKernel {
+public:
+	/** Nombre de la función del kernel */
+	static constexpr const char * NAME = "evaluate";
+
+	/**
+	* @brief Genera el kernel de un programa
+	* @param program Programa compilado, con las variables en el orden de sus columnas de entrada
+	* @param language Lenguaje del código generado
+	*/
+	explicit DeviceKernel(const CompiledExpression & program, DeviceLanguage language = DeviceLanguage::OpenCL):
+		lang(language), count(program.inputs()), valid(false) {
+		if (!program.isValid()) {
+			message = "El programa no es válido";
+			return;
+		}
+		string body;
+		if (translate(program, body)) {
+			src = header() + body + footer();
+			valid = true;
+		}
+	}
+
+	/**
+	* @brief Verifica si el programa se pudo traducir
+	* @return Falso si el programa no es válido o usa funciones que no se pueden ejecutar en el dispositivo
+	*/
+	bool isValid() const {
+		return valid;
+	}
+
+	/**
+	* @brief Retorna la causa por la que el programa no se pudo traducir
+	* @return Mensaje de error, vacío si isValid()
+	*/
+	const string & error() const {
+		return message;
+	}
+
+	/**
+	* @brief Retorna el código fuente del kernel
+	* @return Código fuente, vacío si no isValid()
+	*/
+	const string & source() const {
+		return src;
+	}
+
+	/**
+	* @brief Retorna el lenguaje del código fuente
+	* @return Lenguaje del kernel
+	*/
+	DeviceLanguage language() const {
+		return lang;
+	}
+
+	/**
+	* @brief Retorna la cantidad de columnas de entrada
+	* @return Cantidad de valores de entrada del programa
+	*/
+	size_t inputs() const {
+		return count;
+	}
+
+	/**
+	* @brief Verifica si una función personalizada se puede ejecutar en el dispositivo
+	* @param f Función personalizada
+	* @return Verdadero si es una función predefinida con equivalente en el dispositivo
+	*/
+	static bool offloadable(const CustomFunction & f) {
+		return f.op != OpCode::Call || builtin(f) != nullptr;
+	}
+
+private:
+	DeviceLanguage lang; /*!< Lenguaje del código generado */
+	size_t count; /*!< Cantidad de columnas de entrada */
+	bool valid; /*!< Verdadero si el programa se tradujo */
+	string src; /*!< Código fuente del kernel */
+	string message; /*!< Causa del error de traducción */
+
+	/**
+	* @brief Busca la función predefinida de varios argumentos que corresponde a una función
+	* @param f Función personalizada
+	* @return Nombre de la función predefinida, nullptr si no es una de ellas
+	*/
+	static const char * builtin(const CustomFunction & f) {
+		if (f.fnArgs == nullptr) {
+			return nullptr;
+		}
+		for (auto & b: BUILTIN_MULTI_FUNCTIONS) {
+			if (f.fnArgs == b.fn) {
+				return b.name;
+			}
+		}
+		return nullptr;
+	}
+
+	/**
+	* @brief Escribe una constante real sin pérdida de precisión
+	* @param x Valor
+	* @return Literal hexadecimal de C99, o una expresión constante para NAN e infinito
+	*/
+	static string literal(double x) {
+		if (x != x) {
+			return "(0.0 / 0.0)";
+		}
+		if (x == HUGE_VAL) {
+			return "(1.0 / 0.0)";
+		}
+		if (x == -HUGE_VAL) {
+			return "(-1.0 / 0.0)";
+		}
+		char buf[40];
+		snprintf(buf, sizeof(buf), (x < 0) ? "(%a)" : "%a", x);
+		return buf;
+	}
+
+	/**
+	* @brief Retorna el nombre de la variable local de una posición de la pila
+	*/
+	static string slot(size_t i) {
+		return "s" + std::to_string(i);
+	}
+
+	/**
+	* @brief Retorna el encabezado del kernel, hasta la lectura del índice de la fila
+	*/
+	string header() const {
+		if (lang == DeviceLanguage::CUDA) {
+			return string("extern \"C\" __global__ void ") + NAME +
+				"(const double * __restrict__ in, unsigned long long stride, double * __restrict__ out, unsigned long long n) {\n"
+				"\tfor (unsigned long long i = blockIdx.x * (unsigned long long)blockDim.x + threadIdx.x; i < n;"
+				" i += (unsigned long long)blockDim.x * gridDim.x) {\n";
+		}
+		return string("#pragma OPENCL EXTENSION cl_khr_fp64 : enable\n"
+			"__kernel void ") + NAME +
+			"(__global const double * restrict in, ulong stride, __global double * restrict out, ulong n) {\n"
+			"\tulong i = get_global_id(0);\n"
+			"\tif (i < n) {\n";
+	}
+
+	/**
+	* @brief Retorna el final del kernel, después de escribir el resultado
+	*/
+	string footer() const {
+		return "\t}\n}\n";
+	}
+
+	/**
+	* @brief Traduce las instrucciones del programa al cuerpo del kernel
+	* @param program Programa compilado válido
+	* @param body Cuerpo del kernel
+	* @return Falso si alguna instrucción no se puede ejecutar en el dispositivo
+	*/
+	bool translate(const CompiledExpression & program, string & body) {
+		const vector<CustomFunction> & functions = program.customFunctions();
+		size_t depth = program.stackSize() - program.temporaries();
+
+		//La pila y los temporales son variables locales
+		body = "\t\tdouble ";
+		for (size_t i = 0; i < depth; i++) {
+			body += (i > 0 ? ", " : "") + slot(i);
+		}
+		for (size_t i = 0; i < program.temporaries(); i++) {
+			body += ", t" + std::to_string(i);
+		}
+		body += ";\n";
+
+		size_t top = 0;
+		for (auto & ins: program.instructions()) {
+			string line;
+			switch (ins.op) {
+				case OpCode::Const:
+					line = slot(top++) + " = " + literal(ins.val);
+					break;
+				case OpCode::Load:
+					line = slot(top++) + " = in[" + std::to_string(ins.arg) + " * stride + i]";
+					break;
+				case OpCode::Store:
+					line = "t" + std::to_string(ins.arg) + " = " + slot(top - 1);
+					break;
+				case OpCode::Temp:
+					line = slot(top++) + " = t" + std::to_string(ins.arg);
+					break;
+				case OpCode::Add:
+				case OpCode::Sub:
+				case OpCode::Mul:
+				case OpCode::Div:
+				case OpCode::Pow:
+				case OpCode::Lt:
+				case OpCode::Le:
+				case OpCode::Gt:
+				case OpCode::Ge:
+				case OpCode::Eq:
+				case OpCode::Ne:
+				case OpCode::And:
+				case OpCode::Or:
+					top--;
+					line = slot(top - 1) + " = " + binary(ins.op, slot(top - 1), slot(top));
+					break;
+				case OpCode::Select:
+					top -= 2;
+					line = slot(top - 1) + " = (" + slot(top - 1) + " != 0.0) ? " + slot(top) + " : " + slot(top + 1);
+					break;
+				case OpCode::Call: {
+					const CustomFunction & f = functions[ins.arg];
+					if (f.op == OpCode::Call) {
+						return reject(f);
+					}
+					line = slot(top - 1) + " = " + unary(f.op, slot(top - 1));
+					break;
+				}
+				case OpCode::CallN: {
+					const CustomFunction & f = functions[ins.arg];
+					top -= ins.count;
+					if (f.op == OpCode::Pow && ins.count == 2) {
+						line = slot(top) + " = " + binary(OpCode::Pow, slot(top), slot(top + 1));
+					}else if (!multi(f, top, ins.count, line)) {
+						return reject(f);
+					}
+					top++;
+					break;
+				}
+				default:
+					line = slot(top - 1) + " = " + unary(ins.op, slot(top - 1));
+					break;
+			}
+			body += "\t\t" + line + ";\n";
+		}
+		body += "\t\tout[i] = s0;\n";
+		return true;
+	}
+
+	/**
+	* @brief Registra el error de una función que no se puede ejecutar en el dispositivo
+	* @param f Función personalizada
+	* @return Falso
+	*/
+	bool reject(const CustomFunction & f) {
+		message = "La función " + f.name + " no se puede ejecutar en el dispositivo";
+		return false;
+	}
+
+	/**
+	* @brief Traduce una operación binaria
+	*/
+	static string binary(OpCode op, const string & a, const string & b) {
+		switch (op) {
+			case OpCode::Add:
+				return a + " + " + b;
+			case OpCode::Sub:
+				return a + " - " + b;
+			case OpCode::Mul:
+				return a + " * " + b;
+			case OpCode::Div:
+				return a + " / " + b;
+			case OpCode::Lt:
+				return "(" + a + " < " + b + ") ? 1.0 : 0.0";
+			case OpCode::Le:
+				return "(" + a + " <= " + b + ") ? 1.0 : 0.0";
+			case OpCode::Gt:
+				return "(" + a + " > " + b + ") ? 1.0 : 0.0";
+			case OpCode::Ge:
+				return "(" + a + " >= " + b + ") ? 1.0 : 0.0";
+			case OpCode::Eq:
+				return "(" + a + " == " + b + ") ? 1.0 : 0.0";
+			case OpCode::Ne:
+				return "(" + a + " != " + b + ") ? 1.0 : 0.0";
+			case OpCode::And:
+				return "(" + a + " != 0.0 && " + b + " != 0.0) ? 1.0 : 0.0";
+			case OpCode::Or:
+				return "(" + a + " != 0.0 || " + b + " != 0.0) ? 1.0 : 0.0";
+			default:
+				return "pow(" + a + ", " + b + ")";
+		}
+	}
+
+	/**
+	* @brief Traduce una operación unaria o una función predefinida
+	*/
+	static string unary(OpCode op, const string & a) {
+		switch (op) {
+			case OpCode::Neg:
+				return "-" + a;
+			case OpCode::Not:
+				return "(" + a + " == 0.0) ? 1.0 : 0.0";
+			case OpCode::Sqrt:
+				return "sqrt(" + a + ")";
+			case OpCode::Sin:
+				return "sin(" + a + ")";
+			case OpCode::Cos:
+				return "cos(" + a + ")";
+			case OpCode::Tan:
+				return "tan(" + a + ")";
+			case OpCode::Ln:
+				return "log(" + a + ")";
+			case OpCode::Log:
+				return "log10(" + a + ")";
+			case OpCode::Exp:
+				return "exp(" + a + ")";
+			default:
+				return "fabs(" + a + ")";
+		}
+	}
+
+	/**
+	* @brief Traduce una función predefinida de varios argumentos
+	* @param f Función personalizada
+	* @param first Posición de la pila del primer argumento, y del resultado
+	* @param n Cantidad de argumentos
+	* @param line Asignación del resultado
+	* @return Falso si la función no tiene equivalente en el dispositivo
+	*/
+	static bool multi(const CustomFunction & f, size_t first, size_t n, string & line) {
+		const char * name = builtin(f);
+		if (name == nullptr) {
+			return false;
+		}
+		string fn(name);
+		string value;
+		if (fn == "min" || fn == "max") {
+			//fmin y fmax ignoran los argumentos NAN, igual que vmath::minimum y vmath::maximum
+			value = (n > 0) ? slot(first) : literal(NAN);
+			for (size_t j = 1; j < n; j++) {
+				value = "f" + fn + "(" + value + ", " + slot(first + j) + ")";
+			}
+		}else if (fn == "clamp") {
+			value = "fmin(fmax(" + slot(first) + ", " + slot(first + 1) + "), " + slot(first + 2) + ")";
+		}else if (fn == "atan2" || fn == "hypot") {
+			value = fn + "(" + slot(first) + ", " + slot(first + 1) + ")";
+		}else {
+			return false;
+		}
+		line = slot(first) + " = " + value;
+		return true;
+	}
+};
+
+/**
+* @brief Dispositivo OpenCL con los kernels ya compilados
+*
+* Usa el primer dispositivo GPU disponible, o cualquier dispositivo si no hay GPU. Los kernels se
+* compilan una sola vez por código fuente: las expresiones con el mismo programa comparten el
+* kernel, y los lanzamientos siguientes no vuelven a compilar. Una instancia se puede compartir
+* entre hilos. Sin EXPRESSION_OPENCL, isOpen() es falso y todas las operaciones fallan.
+*/
+class DeviceContext {
+public:
+	/**
+	* @brief Arreglo de valores reales en la memoria del dispositivo
+	*/
+	class Buffer {
+	public:
+		/**
+		* @brief Reserva un arreglo en el dispositivo
+		* @param context Dispositivo
+		* @param size Cantidad de valores
+		*/
+		Buffer(DeviceContext & context, size_t size): context(context), count(size), memory(nullptr) {
+#ifdef EXPRESSION_OPENCL
+			if (context.isOpen() && size > 0) {
+				cl_int status;
+				memory = clCreateBuffer(context.context, CL_MEM_READ_WRITE, size * sizeof(double), nullptr, &status);
+				if (status != CL_SUCCESS) {
+					memory = nullptr;
+				}
+			}
+#endif
+		}
+
+		Buffer(const Buffer &) = delete;
+		Buffer & operator=(const Buffer &) = delete;
+
+		/**
+		* @brief Libera el arreglo
+		*/
+		~Buffer() {
+#ifdef EXPRESSION_OPENCL
+			if (memory != nullptr) {
+				clReleaseMemObject(memory);
+			}
+#endif
+		}
+
+		/**
+		* @brief Verifica si el arreglo se reservó
+		* @return Verdadero si el arreglo existe en el dispositivo
+		*/
+		bool isValid() const {
+			return memory != nullptr;
+		}
+
+		/**
+		* @brief Retorna la cantidad de valores del arreglo
+		* @return Capacidad del arreglo
+		*/
+		size_t size() const {
+			return count;
+		}
+
+		/**
+		* @brief Copia valores de la memoria del host al arreglo
+		* @param values Valores
+		* @param n Cantidad de valores
+		* @param offset Posición del primer valor dentro del arreglo
+		* @return Falso si la copia falló o excede el arreglo
+		*/
+		bool write(const double * values, size_t n, size_t offset = 0) {
+#ifdef EXPRESSION_OPENCL
+			if (memory == nullptr || offset > count || n > count - offset) {
+				return false;
+			}
+			return n == 0 || clEnqueueWriteBuffer(context.queue, memory, CL_TRUE, offset * sizeof(double),
+					n * sizeof(double), values, 0, nullptr, nullptr) == CL_SUCCESS;
+#else
+			(void)values;
+			(void)n;
+			(void)offset;
+			return false;
+#endif
+		}
+
+		/**
+		* @brief Copia valores del arreglo a la memoria del host
+		* @param values Arreglo de destino
+		* @param n Cantidad de valores
+		* @param offset Posición del primer valor dentro del arreglo
+		* @return Falso si la copia falló o excede el arreglo
+		*/
+		bool read(double * values, size_t n, size_t offset = 0) const {
+#ifdef EXPRESSION_OPENCL
+			if (memory == nullptr || offset > count || n > count - offset) {
+				return false;
+			}
+			return n == 0 || clEnqueueReadBuffer(context.queue, memory, CL_TRUE, offset * sizeof(double),
+					n * sizeof(double), values, 0, nullptr, nullptr) == CL_SUCCESS;
+#else
+			(void)values;
+			(void)n;
+			(void)offset;
+			return false;
+#endif
+		}
+
+	private:
+		friend class DeviceContext;
+
+		DeviceContext & context; /*!< Dispositivo del arreglo */
+		size_t count; /*!< Cantidad de valores */
+#ifdef EXPRESSION_OPENCL
+		cl_mem memory; /*!< Arreglo en el dispositivo */
+#else
+		void * memory; /*!< Sin OpenCL siempre es nullptr */
+#endif
+	};
+
+	/**
+	* @brief Abre el primer dispositivo disponible
+	*/
+	DeviceContext() {
+#ifdef EXPRESSION_OPENCL
+		cl_uint platforms = 0;
+		if (clGetPlatformIDs(0, nullptr, &platforms) != CL_SUCCESS || platforms == 0) {
+			return;
+		}
+		vector<cl_platform_id> ids(platforms);
+		clGetPlatformIDs(platforms, ids.data(), nullptr);
+		for (cl_device_type type: {(cl_device_type) CL_DEVICE_TYPE_GPU, (cl_device_type) CL_DEVICE_TYPE_ALL}) {
+			for (auto id: ids) {
+				if (clGetDeviceIDs(id, type, 1, &device, nullptr) == CL_SUCCESS) {
+					open();
+					return;
+				}
+			}
+		}
+#endif
+	}
+
+	DeviceContext(const DeviceContext &) = delete;
+	DeviceContext & operator=(const DeviceContext &) = delete;
+
+	/**
+	* @brief Libera los kernels y el dispositivo
+	*/
+	~DeviceContext() {
+#ifdef EXPRESSION_OPENCL
+		for (auto & entry: kernels) {
+			if (entry.second.kernel != nullptr) {
+				clReleaseKernel(entry.second.kernel);
+				clReleaseProgram(entry.second.program);
+			}
+		}
+		if (queue != nullptr) {
+			clReleaseCommandQueue(queue);
+		}
+		if (context != nullptr) {
+			clReleaseContext(context);
+		}
+#endif
+	}
+
+	/**
+	* @brief Verifica si se puede compilar y ejecutar kernels
+	* @return Verdadero si se compiló con EXPRESSION_OPENCL
+	*/
+	static bool available() {
+#ifdef EXPRESSION_OPENCL
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	/**
+	* @brief Verifica si se abrió un dispositivo
+	* @return Verdadero si hay un dispositivo para ejecutar los kernels
+	*/
+	bool isOpen() const {
+#ifdef EXPRESSION_OPENCL
+		return queue != nullptr;
+#else
+		return false;
+#endif
+	}
+
+	/**
+	* @brief Compila un kernel, o lo toma de los ya compilados
+	* @param kernel Kernel en OpenCL C
+	* @param log Si no es nullptr, recibe la causa del error o el registro de compilación cuando falla
+	* @return Falso si el dispositivo no está abierto o el kernel no compila
+	*/
+	bool prepare(const DeviceKernel & kernel, string * log = nullptr) {
+		std::lock_guard<std::mutex> lock(mutex);
+		return find(kernel, log) != nullptr;
+	}
+
+	/**
+	* @brief Evalúa un kernel sobre arreglos que ya están en el dispositivo
+	*
+	* La entrada j de la fila i está en in[j * stride + i]; el kernel se compila en el primer lanzamiento.
+	* @param kernel Kernel en OpenCL C
+	* @param in Entradas, con capacidad para kernel.inputs() columnas de stride valores
+	* @param stride Distancia entre las columnas de entrada, al menos n
+	* @param out Salida, con capacidad para n valores
+	* @param n Cantidad de filas
+	* @return Falso si el kernel no es válido, no compila o los arreglos no son suficientes
+	*/
+	bool run(const DeviceKernel & kernel, const Buffer & in, size_t stride, Buffer & out, size_t n) {
+#ifdef EXPRESSION_OPENCL
+		if (n == 0) {
+			return kernel.isValid();
+		}
+		if (stride < n || out.memory == nullptr || out.count < n ||
+				(kernel.inputs() > 0 && (in.memory == nullptr || in.count / stride < kernel.inputs()))) {
+			return false;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		Entry * entry = find(kernel, nullptr);
+		if (entry == nullptr) {
+			return false;
+		}
+		cl_mem input = in.memory != nullptr ? in.memory : out.memory;
+		cl_ulong s = stride;
+		cl_ulong rows = n;
+		size_t global = n;
+		return clSetKernelArg(entry->kernel, 0, sizeof(cl_mem), &input) == CL_SUCCESS &&
+			clSetKernelArg(entry->kernel, 1, sizeof(cl_ulong), &s) == CL_SUCCESS &&
+			clSetKernelArg(entry->kernel, 2, sizeof(cl_mem), &out.memory) == CL_SUCCESS &&
+			clSetKernelArg(entry->kernel, 3, sizeof(cl_ulong), &rows) == CL_SUCCESS &&
+			clEnqueueNDRangeKernel(queue, entry->kernel, 1, nullptr, &global, nullptr, 0, nullptr, nullptr) == CL_SUCCESS &&
+			clFinish(queue) == CL_SUCCESS;
+#else
+		(void)kernel;
+		(void)in;
+		(void)stride;
+		(void)out;
+		(void)n;
+		return false;
+#endif
+	}
+
+	/**
+	* @brief Retorna la cantidad de kernels compilados
+	* @return Cantidad de códigos fuente distintos compilados, incluyendo los que fallaron
+	*/
+	size_t cached() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return kernels.size();
+	}
+
+private:
+	/**
+	* @brief Kernel compilado
+	*/
+	struct Entry {
+#ifdef EXPRESSION_OPENCL
+		cl_program program = nullptr; /*!< Programa de OpenCL */
+		cl_kernel kernel = nullptr; /*!< Kernel, nullptr si no compiló */
+#endif
+		string log; /*!< Registro de compilación */
+	};
+
+	std::mutex mutex; /*!< Protege los kernels y sus argumentos */
+	std::unordered_map<string, Entry> kernels; /*!< Kernels por código fuente */
+#ifdef EXPRESSION_OPENCL
+	cl_device_id device = nullptr; /*!< Dispositivo */
+	cl_context context = nullptr; /*!< Contexto del dispositivo */
+	cl_command_queue queue = nullptr; /*!< Cola de comandos, nullptr si no se abrió el dispositivo */
+
+	/**
+	* @brief Crea el contexto y la cola de comandos del dispositivo
+	*/
+	void open() {
+		cl_int status;
+		context = clCreateContext(nullptr, 1, &device, nullptr, nullptr, &status);
+		if (status != CL_SUCCESS) {
+			context = nullptr;
+			return;
+		}
+		queue = clCreateCommandQueue(context, device, 0, &status);
+		if (status != CL_SUCCESS) {
+			queue = nullptr;
+		}
+	}
+#endif
+
+	/**
+	* @brief Busca o compila un kernel; requiere el mutex
+	* @param kernel Kernel en OpenCL C
+	* @param log Si no es nullptr, recibe el registro de compilación cuando falla
+	* @return Kernel compilado, nullptr si no compila
+	*/
+	Entry * find(const DeviceKernel & kernel, string * log) {
+#ifdef EXPRESSION_OPENCL
+		const char * cause = !isOpen() ? "El dispositivo OpenCL no está abierto"
+				: !kernel.isValid() ? "El programa no se tradujo a un kernel"
+				: (kernel.language() != DeviceLanguage::OpenCL) ? "El kernel no está en OpenCL C" : nullptr;
+		if (cause != nullptr) {
+			if (log != nullptr) {
+				*log = cause;
+			}
+			return nullptr;
+		}
+		auto it = kernels.find(kernel.source());
+		if (it == kernels.end()) {
+			it = kernels.emplace(kernel.source(), Entry()).first;
+			build(kernel.source(), it->second);
+		}
+		if (it->second.kernel == nullptr) {
+			if (log != nullptr) {
+				*log = it->second.log;
+			}
+			return nullptr;
+		}
+		return &it->second;
+#else
+		(void)kernel;
+		if (log != nullptr) {
+			*log = "Compilado sin soporte de OpenCL (EXPRESSION_OPENCL)";
+		}
+		return nullptr;
+#endif
+	}
+
+#ifdef EXPRESSION_OPENCL
+	/**
+	* @brief Compila el código fuente de un kernel
+	* @param source Código fuente
+	* @param entry Kernel compilado, o el registro de compilación si falla
+	*/
+	void build(const string & source, Entry & entry) {
+		cl_int status;
+		const char * text = source.c_str();
+		size_t length = source.size();
+		cl_program program = clCreateProgramWithSource(context, 1, &text, &length, &status);
+		if (status != CL_SUCCESS) {
+			entry.log = "clCreateProgramWithSource falló";
+			return;
+		}
+		if (clBuildProgram(program, 1, &device, nullptr, nullptr, nullptr) != CL_SUCCESS) {
+			size_t size = 0;
+			clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, 0, nullptr, &size);
+			entry.log.assign(size, '\0');
+			clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, size, &entry.log[0], nullptr);
+			clReleaseProgram(program);
+			return;
+		}
+		cl_kernel k = clCreateKernel(program, DeviceKernel::NAME, &status);
+		if (status != CL_SUCCESS) {
+			entry.log = "clCreateKernel falló";
+			clReleaseProgram(program);
+			return;
+		}
+		entry.program = program;
+		entry.kernel = k;
+	}
+#endif
+};
+
+/**
+* @brief Expresión que evalúa sus lotes en un dispositivo
+*
+* Si el programa usa funciones que no se pueden ejecutar en el dispositivo, isValid() es falso y
+* error() indica la función. Cuando el lote no se puede evaluar en el dispositivo (programa no
+* válido, dispositivo no disponible, kernel que no compila o error de ejecución), evalBatch()
+* retorna falso y error() indica la causa; el intérprete solo se usa si se solicita explícitamente.
+*/
+class DeviceExpression {
+public:
+	/**
+	* @brief Genera el kernel de un programa
+	* @param program Programa compilado, con las variables en el orden de sus columnas de entrada
+	* @param context Dispositivo que ejecuta los kernels; debe existir mientras exista la expresión
+	*/
+	DeviceExpression(std::shared_ptr<const CompiledExpression> program, DeviceContext & context):
+		program(std::move(program)), kernel(*this->program), context(context) {
+	}
+
+	/**
+	* @brief Genera el kernel del programa de una expresión, con las variables asociadas mediante bind()
+	* @param expr Expresión
+	* @param context Dispositivo que ejecuta los kernels
+	*/
+	DeviceExpression(expression & expr, DeviceContext & context): DeviceExpression(expr.compiled(), context) {
+	}
+
+	/**
+	* @brief Verifica si el programa se tradujo a un kernel
+	* @return Falso si el programa no es válido o usa funciones que no se pueden ejecutar en el dispositivo
+	*/
+	bool isValid() const {
+		return kernel.isValid();
+	}
+
+	/**
+	* @brief Retorna la causa por la que el programa no se pudo traducir, compilar o evaluar en el dispositivo
+	* @return Mensaje de error, o el registro de compilación del kernel
+	*/
+	const string & error() const {
+		return kernel.isValid() ? log : kernel.error();
+	}
+
+	/**
+	* @brief Verifica si las evaluaciones se ejecutan en el dispositivo
+	* @return Verdadero si el kernel compiló en un dispositivo abierto
+	*/
+	bool isDevice() {
+		return kernel.isValid() && context.prepare(kernel, &log);
+	}
+
+	/**
+	* @brief Retorna el kernel generado
+	* @return Kernel en OpenCL C
+	*/
+	const DeviceKernel & deviceKernel() const {
+		return kernel;
+	}
+
+	/**
+	* @brief Retorna el programa compilado
+	* @return Programa evaluado por el intérprete cuando no se usa el dispositivo
+	*/
+	const CompiledExpression & compiled() const {
+		return *program;
+	}
+
+	/**
+	* @brief Evalúa el programa sobre arreglos que ya están en el dispositivo
+	*
+	* Ver DeviceContext::run(); los valores no se copian a la memoria del host.
+	* @return Falso si no se pudo ejecutar en el dispositivo
+	*/
+	bool evalDevice(const DeviceContext::Buffer & in, size_t stride, DeviceContext::Buffer & out, size_t n) {
+		return kernel.isValid() && context.run(kernel, in, stride, out, n);
+	}
+
+	/**
+	* @brief Evalúa el programa sobre columnas de valores en la memoria del host
+	*
+	* Copia las columnas al dispositivo, ejecuta el kernel y copia los resultados.
+	* @param columns Una columna de n valores por cada valor de entrada
+	* @param out Arreglo de salida, con capacidad para n valores
+	* @param n Cantidad de valores a evaluar
+	* @param fallback Si el lote no se puede evaluar en el dispositivo: verdadero para evaluarlo con
+	*        CompiledExpression::evalBatch(), falso para llenar out con NAN
+	* @return Verdadero si el lote se evaluó en el dispositivo; si es falso, error() indica la causa
+	*/
+	bool evalBatch(const double * const * columns, double * out, size_t n, bool fallback = false) {
+		if (isDevice()) {
+			if (n == 0) {
+				return true;
+			}
+			DeviceContext::Buffer in(context, kernel.inputs() * n);
+			DeviceContext::Buffer result(context, n);
+			bool ok = result.isValid() && (kernel.inputs() == 0 || in.isValid());
+			for (size_t j = 0; ok && j < kernel.inputs(); j++) {
+				ok = in.write(columns[j], n, j * n);
+			}
+			if (ok && context.run(kernel, in, n, result, n) && result.read(out, n)) {
+				return true;
+			}
+			log = "No se pudo copiar o evaluar el lote en el dispositivo";
+		}
+		if (fallback) {
+			program->evalBatch(columns, out, n);
+		}else {
+			std::fill(out, out + n, NAN);
+		}
+		return false;
+	}
+
+private:
+	std::shared_ptr<const CompiledExpression> program; /*!< Programa compilado */
+	DeviceKernel kernel; /*!< Kernel generado */
+	DeviceContext & context; /*!< Dispositivo */
+	string log; /*!< Causa del último error en el dispositivo, o registro de compilación del kernel */
+};
+
+#endif
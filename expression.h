@@ -1,739 +1,4271 @@
-#ifndef EXPRESSION_H
-#define EXPRESSION_H
-
-/**
-* @file
-* Arithmethic expression evaluator
-* C++ implementation of the Shunting Yard  Algorithm by E.W. Dijkstra.
-* Implementación en C++ del algoritmo Shunting Yard propuesto por E. W. Dijkstra.
-* Adaptado para aceptar variables, funciones personalizadas y el operador unario de negación "~"
-* @author Erwin Meza Vega <emezav@unicauca.edu.co>
-* @copyright MIT License
-*/
-
-#include <cfloat>
-#include <cmath>
-#include <functional>
-#include <list>
-#include <map>
-#include <stack>
-#include <string>
-#include <sstream>
-#include <vector>
-
-#include <bits/stdc++.h>
-
-
-/*
- Shunting Yard Algorithm by Edsger Wybe Dijkstra (E. W. Dijkstra)
- (Wikipedia Version)
-  https://en.wikipedia.org/wiki/Shunting_yard_algorithm
-
-	while there are tokens to be read:
-	  read a token
-	  if the token is:
-	  - a number:
-	    put it into the output queue
-	  - a function:
-	    push it onto the operator stack
-	  - an operator o1:
-	   while (
-	     there is an operator o2 at the top of the operator stack which is not a left parenthesis,
-	     and (o2 has greater precedence than o1 or (o1 and o2 have the same precedence and o1 is left-associative))
-	    ):
-	       pop o2 from the operator stack into the output queue
-	   push o1 onto the operator stack
-	  - a left parenthesis (i.e. "("):
-	    push it onto the operator stack
-	  - a right parenthesis (i.e. ")"):
-	    while the operator at the top of the operator stack is not a left parenthesis:
-	      {assert the operator stack is not empty}
-	       // If the stack runs out without finding a left parenthesis, then there are mismatched parenthesis.
-	        pop the operator from the operator stack into the output queue
-	        {assert there is a left parenthesis at the top of the operator stack}
-		pop the left parenthesis from the operator stack and discard it
-		if there is a function token at the top of the operator stack, then:
-			pop the function from the operator stack into the output queue
-
-	// After the while loop, pop the remaining items from the operator stack into the output queue.
-	while there are tokens on the operator stack:
-		// If the operator token on the top of the stack is a parenthesis, then there are mismatched parenthesis.
-	    {assert the operator on top of the stack is not a (left) parenthesis}
-        pop the operator from the operator stack onto the output queue
-*/
-
-using std::function;
-using std::list;
-using std::map;
-using std::stack;
-using std::string;
-using std::vector;
-using std::ostringstream;
-
-
-/**
-* @brief Función personalizada sobre una variable real
-*/
-struct CustomFunction {
-	string name; /*!< Nombre de la función */
-	function<double(double)> f; /*!< Función a aplicar a la variable */
-
-	/**
-	* @brief Evalóa la función en x
-	* @param x Valor de la variable
-	* @return Valor de la función en x
-	*/
-	double operator()(double x) {
-		return f(x);
-	}
-};
-
-/**
-* @brief Variable de la expresión aritmética
-*/
-struct Variable {
-	string name; /*!< Nombre de la variable */
-	double val;	/*!< Valor de la variable */
-};
-
-/**
-* @brief Expresión aritmética de una variable
-*/
-class expression {
-public:
-	/**
-	* @brief Crea una expresión a partir de una cadena de caracteres
-	* @param exprText Texto de la expresión en notación infija
-	*/
-	expression(string exprText): expression(exprText, defaultFunctions()) {
-	}
-
-	/**
-	* @brief Crea una expresión a partir de una cadena de caracteres y un conjunto de funciones personalizadas
-	* @param exprText Texto de la expresión en notación infija
-	* @param funcs Vector de funciones personalizadas
-	*/
-	expression(string exprText, vector<CustomFunction> funcs): text(exprText), functions(funcs) {
-		balanced = false;
-
-		//Remove spaces
-		text.erase(std::remove(text.begin(),text.end(), ' '), text.end());
-		//Separate into tokens
-		tokens = getTokens();
-
-		//Create RPN expression
-		rpn = getRPN(tokens);
-
-		//Save string of the original expression
-		ostringstream tokens_oss;
-		for (auto & t: tokens) {
-			tokens_oss << t << " ";
-		}
-		tokensStr = tokens_oss.str();
-
-		//Save string of the RPN expression
-		ostringstream rpn_oss;
-		for (auto & t: rpn) {
-			rpn_oss << t << " ";
-		}
-		rpnStr = rpn_oss.str();
-
-	}
-
-	/**
-	* @brief Funciones predeterminadas
-	* @return Arreglo de funciones predeterminadas
-	*/
-	vector<CustomFunction> defaultFunctions() {
-		return {
-				{ "sin" ,
-					[](double x) -> double {
-						return sin(x);
-					}
-				},
-				{ "cos" ,
-					[](double x) -> double {
-						return cos(x);
-					}
-				},
-				{ "tan" ,
-					[](double x) -> double {
-						return tan(x);
-					}
-				},
-				{ "ln" ,
-					[](double x) -> double {
-						return log(x);
-					}
-				},
-				{ "log" ,
-					[](double x) -> double {
-						return log10(x);
-					}
-				},
-				{ "exp" ,
-					[](double x) -> double {
-						return exp(x);
-					}
-				},
-				{ "sqrt" ,
-					[](double x) -> double {
-						return sqrt(x);
-					}
-				},
-				{ "abs" ,
-					[](double x) -> double {
-						return abs(x);
-					}
-				}
-		};
-	}
-
-	/**
-	* @brief Variables predeterminadas
-	* @return Vector de variables predeterminadas
-	*/
-	vector<Variable> defaultVariables() {
-		return {
-			{"pi", 3.141592654f},
-			{"e",  2.718281828f }
-		};
-	}
-
-	/**
-	* @brief Verifica si la expresión estó bien balanceada
-	* @return verdadero si los paróntesis estón balanceados, falso en caso contrario
-	*/
-	bool checkParenthesis() {
-		int cnt = 0;
-
-		size_t pos = 0;
-
-		while (pos < text.length() && cnt >= 0) {
-			if (text[pos] == '(') {
-				cnt ++;
-			}
-			else if (text[pos] == ')') {
-				cnt--;
-			}
-			pos++;
-		}
-
-		balanced = (cnt == 0);
-
-		return balanced;
-	}
-
-	/**
-	* @brief Retorna la condición de balance de paróntesis
-	* @return Verdadero si los paróntesis estón balanceados
-	*/
-	bool isBalanced() {
-		return balanced;
-	}
-
-	/**
-	* @brief Verifica si una cadena es un operador aritmótico válido
-	* @param str Cadena a verificar
-	* @return Verdadero si la cadena es un operador aritmótico válido
-	*/
-	bool isOperator(string str) {
-		return (
-				str == "+"
-				|| str == "-"
-				|| str == "*"
-				|| str == "/"
-				|| str == "^"
-				|| str == "~"
-				);
-	}
-
-	/**
-	* @brief Verifica si una cadena es un nómero válido
-	* @param str Cadena a verificar
-	* @return Verdadero si la cadena representa un nómero válido
-	*/
-	bool isNumber(string str)
-	{
-		char* p;
-		strtod(str.c_str(), &p);
-		return *p == 0;
-	}
-
-	/**
-	* @brief Verifica la asociatividad a la izquierda de un operador
-	* @param str Operador
-	* @return Verdadero si el operador tiene asociatividad a la izquierda
-	*/
-	bool isLeftAssociative(string str) {
-		return (
-				str == "+"
-				|| str == "-"
-				|| str == "*"
-				|| str == "/"
-				);
-	}
-
-	/**
-	* @brief Verifica si un operador es binario
-	* @param str Operador
-	* @return Verdadero si el operador es binario, e.g. requiere dos operandos
-	*/
-	bool isBinaryOperator(string str) {
-		return (
-				str == "+"
-				|| str == "-"
-				|| str == "*"
-				|| str == "/"
-				|| str == "^"
-				);
-	}
-
-	/**
-	* @brief Verifica si un operador es unario
-	* @param str Operador
-	* @return Verdadero si el operador es unario, e.g. requiere un operando
-	*/
-	bool isUnaryOperator(string str) {
-		return (str == "~");
-	}
-
-	/**
-	* @brief Verifica y obtiene un valor a partir de una cadena
-	* @param str Cadena a evaluar
-	* @param val Referencia a la variable que almacena el valor de salida
-	* @return Verdadero si se puede transformar el texto en un numero
-	*/
-	bool getNumber(string str, double & val) {
-		char* p;
-		if (str.length() > 0 && str[0] == '~') {
-			str[0] = '-';
-		}
-		val = strtod(str.c_str(), &p);
-		return *p == 0;
-	}
-
-	/**
-	* @brief Convierte un valor real a cadena
-	* @param val Valor a convertir
-	* @return Valor convertido a cadena de caracteres
-	*/
-	string numberToString(double val) {
-		ostringstream oss;
-
-		oss<< val;
-
-		return oss.str();
-	}
-
-	/**
-	* @brief Retorna la representación en cadena de la expresión
-	* @return Representación en cadena de la expresión
-	*/
-	string str() {
-		return tokensStr;
-	}
-
-	/**
-	* @brief Retorna la representación en cadena de la expresión en RPN
-	* @return Representación en RPN (Reverse Polish Notation) de la expresión
-	*/
-	string rpnstr() {
-		return rpnStr;
-	}
-
-	/**
-	* @brief Calcula el resultado de una operación binaria
-	* @param a Primer operando
-	* @param b Segundo operando
-	* @param op Operando
-	* @return Resultado de la operación, NAN si no es válida
-	*/
-	double calculate(double a, double b, string op){
-		if (op == "+") {
-			return a + b;
-		}else if (op == "-") {
-			return a - b;
-		}else if (op == "*") {
-			return a * b;
-		}else if (op == "/") {
-			return a / b;
-		}else if (op == "^") {
-			return pow(a, b);
-		}
-		return NAN;
-	}
-
-	/**
-	* @brief Calcula el resultado de una operación unaria
-	* @param x Valor al cual se aplica la operación
-    * @param op Operando
-	* @return Resultado de la operación, NAN si no es válida
-	*/
-	double calculateUnary(double x, string op) {
-		if (op == "~") {
-			return -1.0 * x;
-		}
-		return NAN;
-	}
-
-	/**
-	* @brief Calcula la precedencia de un operador
-	* @param op Operador
-	* @return Precedencia (1 para suma y resta, 2 para producto y división, 3 para potencia y negación
-	*/
-	int precedence(string op){
-		if(op == "+"||op == "-") {
-			return 1;
-		}
-		else if(op == "*"||op == "/" ) {
-			return 2;
-		}
-		else if (op == "^"|| op == "~" ) {
-			return 3;
-		}
-		return 0;
-	}
-
-	/**
-	* @brief Determina si un nombre dado corresponde a una variable, obteniendo su valor
-	* @param name Nombre de la variable
-	* @param vars Arreglo de variables definidas
-	* @param val Referencia a la variable que almacena el valor obtenido
-	* @return Verdadero si el nombre corresponde a una variable, valor almacenado en val.
-	*/
-	bool isVariable(string name, vector<Variable> & vars, double & val) {
-		if (isOperator(name)) {
-			return false;
-		}
-		for (auto & v: vars) {
-			if (v.name == name) {
-				val = v.val;
-				return true;
-			}else if ("~" + v.name ==  name) {
-				val = -1.0 * v.val;
-				return true;
-			}
-		}
-		return false;
-	}
-
-	/**
-	* @brief Verifica si un nombre dado corresponde a una función
-	* @param name Nombre a verificar
-	* @param func Referencia a la función obtenida, si existe
-	* @return Verdadero si la función estó definida, falso en caso contrario
-	*/
-	bool isFunction(string name, function<double(double)> & func) {
-		for (auto & f : functions) {
-			if (f.name == name) {
-				func = f;
-				return true;
-			}
-		}
-
-		return false;
-	}
-
-	/**
-	* @brief Separa los elementos de la expresión
-	* @return Vector de cadenas con los elementos separados
-	*/
-	vector<string> getTokens() {
-
-		vector<string> tokens;
-
-		string token;
-		string opchar;
-
-		size_t pos = 0;
-		size_t nextPos;
-
-
-		// Verificar parentesis
-		if (!checkParenthesis()) {
-			return tokens;
-		}
-
-		nextPos = string::npos;
-
-		while ((nextPos = text.find_first_of("()+-*/^~", pos)) != string::npos) {
-			if (nextPos != string::npos) {
-				opchar =  std::string(1, text[nextPos]);
-
-				token = text.substr(pos, nextPos - pos);
-				if (token.length() > 0) {
-					tokens.push_back(token);
-				}
-				tokens.push_back(opchar);
-			}else {
-				token = text.substr(pos, nextPos - pos);
-				tokens.push_back(token);
-			}
-			pos = nextPos;
-			if (pos != string::npos) {
-				pos++;
-			}
-		}
-		token = text.substr(pos, nextPos);
-		if (token.length() > 0) {
-			tokens.push_back(token);
-		}
-		return tokens;
-	}
-
-	/**
-	* @brief Obtiene la representación RPN de la expresión original
-	* @param tokens Vector de elementos separados
-	* @return Vector de elementos de la expresión en Notación Reversa Polaca (RPN)
-	*/
-	vector<string> getRPN(vector<string> tokens) {
-
-		vector<string> input(tokens);
-		vector<string> rpn;
-		stack<string> operators;
-		double val;
-		function<double(double)> func;
-		string op;
-
-		string token;
-
-		size_t i;
-		//Shunting Yard Algorithm
-
-		//while there are tokens to be read:
-
-		for (i = 0; i < input.size(); i++)  {
-			//Read a token
-			token = input[i];
-			//If the token is:
-			//a number:
-			if (getNumber(token, val)) {
-				//put it into the output queue
-				rpn.push_back(numberToString(val));
-			}
-			//a function:
-			else if (isFunction(token, func)) {
-				//push it into the operator stack
-				operators.push(token);
-			}
-			//an operator o1:
-			else if (isOperator(token)) {
-				//while (
-				//there is an operator o2 at the top of the operator stack which is not a left parenthesis,
-				//and (o2 has greater precedence than o1 or (o1 and o2 have the same precedence and o1 is left-associative))
-				//)
-				while (!operators.empty() && operators.top() != "("
-					   && (precedence(operators.top()) > precedence(token) ||
-						   (precedence(operators.top()) == precedence(token) && isLeftAssociative(token)))) {
-					//pop o2 from the operator stack into the output queue
-					op = operators.top();
-					operators.pop();
-
-					rpn.push_back(op);
-				}
-				//push o1 onto the operators stack
-				operators.push(token);
-			}
-			//a left parenthesis i.e. "("
-			else if (token == "(") {
-				// push it onto the operator stack
-				operators.push(token);
-			}
-			//a right parenthesis (i.e. ")")
-			else if (token == ")") {
-				//while the operator at the top of the operator stack is not a left parenthesis:
-				//{assert the operator stack is not empty}
-				//// If the stack runs out without finding a left parenthesis, then there are mismatched parenthesis.
-
-				while (!operators.empty() && operators.top() != "(") {
-					//pop the operator from the operator stack into the output queue
-					op = operators.top();
-					operators.pop();
-					rpn.push_back(op);
-				}
-				//{assert there is a left parenthesis at the top of the operator stack}
-				//pop the left parenthesis from the operator stack and discard it
-
-				if (!operators.empty() && operators.top() == "(") {
-					operators.pop();
-				}
-
-				//if there is a function token at the top of the operator stack, then:
-				//pop the function from the operator stack into the output queue
-				if (!operators.empty() && isFunction(operators.top(), func)) {
-					op = operators.top();
-					operators.pop();
-					rpn.push_back(op);
-				}
-			}
-			//Variable! colocarla en la salida
-			else {
-				//Variable
-				rpn.push_back(token);
-			}
-		}
-
-		/*
-		After the while loop, pop the remaining items from the operator stack into the output queue.
-		while there are tokens on the operator stack:
-		*/
-		while (!operators.empty()) {
-			// If the operator token on the top of the stack is a parenthesis, then there are mismatched parenthesis.
-			// Ya se ha verificado el balance de parentesis
-			//{assert the operator on top of the stack is not a (left) parenthesis}
-			//pop the operator from the operator stack onto the output queue
-			op = operators.top();
-			operators.pop();
-			if (op != "(") {
-				rpn.push_back(op);
-			}
-		}
-
-		// rpn almacena la representación RPN de la expresión
-		return rpn;
-	}
-
-	/**
-	* @brief Sobrecarga del operador ()
-	* @return Resultado de evaluar la expresión
-	*/
-	double operator()() {
-		return eval();
-	}
-
-	/**
-	* @brief Sobrecarga del operador () sobre x
-	* @param val Valor de la variable x de la expresión
-	* @return Resultado de evaluar la expresión
-	*/
-	double operator()(double val) {
-		return eval(val);
-	}
-
-	/**
-	* @brief Sobrecarga del operador () sobre variables
-	* @param vars Arreglo de variables a reemplazar
-	* @return Resultado de evaluar la expresión
-	*/
-	double operator()(vector<Variable> vars) {
-		return eval(vars);
-	}
-
-	/**
-	* @brief Evalóa la expresión usando las variables por defecto
-	* @return Resultado de evaluar la expresión
-	*/
-	double eval() {
-		vector<Variable> vars = defaultVariables();
-		return eval(vars);
-	}
-
-	/**
-	* @brief Evalóa la expresión para un valor de x
-	* @param val Valor para una única variable llamada x
-	* @return Resultado de la expresión
-	*/
-	double eval(double val) {
-
-		vector<Variable> vars = defaultVariables();
-		bool updated = false;
-
-		for (auto & v: vars) {
-			if (v.name == "x") {
-				v.val = val;
-				updated = true;
-			}
-		}
-
-		if (!updated) {
-			vars.push_back({"x", val});
-		}
-
-		return eval(vars);
-	}
-
-	/**
-	* @brief Evalóa la expresión para una un más variables
-	* @param vars Vector de variables
-	* @return Resultado de la expresión
-	*/
-	double eval(vector<Variable> vars) {
-		return evalRPN(rpn, vars);
-	}
-
-
-	/**
-	* @brief Evalóa la expresión para una un más variables y una o más funciones
-	* @param rpn Expresión (vector de cadenas) en RPN
-	* @param vars Vector de variables
-	* @return Resultado de la expresión
-	*/
-	double evalRPN(vector<string> rpn, vector<Variable> vars) {
-		double result = NAN;
-
-		stack<double> values;
-
-		vector<string> items = rpn;
-		function<double(double)> func;
-		double val;
-
-
-		for (auto & item: rpn) {
-			if (getNumber(item, val)) {
-				values.push(val);
-			}
-			else if (isFunction(item, func)) {
-				//Verificar si existe un valor en la pila
-				if (values.empty()) {
-					return result;
-				}
-				//Obtener el valor del tope de la pila
-				val = values.top();
-				//Eliminar el valor obtenido de la pila
-				values.pop();
-				//Evaluar la funcion y almacenar el resultado en la pila
-				values.push(func(val));
-			}
-			else if (isOperator(item)) {
-				if (isBinaryOperator(item) && values.size() >= 2) {
-					//Obtener b, a de la pila (b esta en el tope)
-					double b = values.top();
-					values.pop();
-					double a = values.top();
-					values.pop();
-					//Calcular y almacenar el resultado en la pila
-					values.push(calculate(a, b, item));
-				}else if (isUnaryOperator(item) && values.size() > 0) {
-					//Obtener un valor del tope de la pila
-					val = values.top();
-					values.pop();
-					//Calcular y almacenar el resultado en la pila
-					values.push(calculateUnary(val, item));
-				}
-			}
-			else if (isVariable(item, vars, val)) {
-				//Almacenar el valor de la variable en la pila
-				values.push(val);
-			}
-		}
-		//Al final de la ejecucion, el tope de la pila contiene el resultado
-		if (values.size() == 1) {
-			result = values.top();
-			values.pop();
-		}
-
-		return result;
-	}
-
-private:
-	string text; /*!< Texto original de la expresión */
-	vector<CustomFunction> functions; /*!< Vector de funciones personalizadas */
-	vector<string> tokens; /*!< Elementos separados de la expresión */
-	string tokensStr; /*!< Cadena de texto de la expresión */
-	vector<string> rpn; /*!< Elementos separados de la expresión en RPN */
-	string rpnStr; /*!< Cadena de texto de la expresión  en RPN */
-	bool balanced; /*!< Verdadero si los parentesis se encuentran balanceados */
-};
-
-#endif
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+/**
+* @file
+* Arithmethic expression evaluator
+* C++ implementation of the Shunting Yard  Algorithm by E.W. Dijkstra.
+* Implementación en C++ del algoritmo Shunting Yard propuesto por E. W. Dijkstra.
+* Adaptado para aceptar variables, funciones personalizadas y el operador unario de negación "~"
+* @author Erwin Meza Vega <emezav@unicauca.edu.co>
+* @copyright MIT License
+*/
+
+#include <cfloat>
+#include <charconv>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <list>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <stack>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <sstream>
+#include <vector>
+
+#if __has_include(<span>)
+#include <span>
+#endif
+
+#include <bits/stdc++.h>
+
+#include "threadpool.h"
+#include "vmath.h"
+
+#ifdef EXPRESSION_PROFILE
+#include "profile.h"
+#endif
+
+
+/*
+ Shunting Yard Algorithm by Edsger Wybe Dijkstra (E. W. Dijkstra)
+ (Wikipedia Version)
+  https://en.wikipedia.org/wiki/Shunting_yard_algorithm
+
+	while there are tokens to be read:
+	  read a token
+	  if the token is:
+	  - a number:
+	    put it into the output queue
+	  - a function:
+	    push it onto the operator stack
+	  - an operator o1:
+	   while (
+	     there is an operator o2 at the top of the operator stack which is not a left parenthesis,
+	     and (o2 has greater precedence than o1 or (o1 and o2 have the same precedence and o1 is left-associative))
+	    ):
+	       pop o2 from the operator stack into the output queue
+	   push o1 onto the operator stack
+	  - a left parenthesis (i.e. "("):
+	    push it onto the operator stack
+	  - a right parenthesis (i.e. ")"):
+	    while the operator at the top of the operator stack is not a left parenthesis:
+	      {assert the operator stack is not empty}
+	       // If the stack runs out without finding a left parenthesis, then there are mismatched parenthesis.
+	        pop the operator from the operator stack into the output queue
+	        {assert there is a left parenthesis at the top of the operator stack}
+		pop the left parenthesis from the operator stack and discard it
+		if there is a function token at the top of the operator stack, then:
+			pop the function from the operator stack into the output queue
+
+	// After the while loop, pop the remaining items from the operator stack into the output queue.
+	while there are tokens on the operator stack:
+		// If the operator token on the top of the stack is a parenthesis, then there are mismatched parenthesis.
+	    {assert the operator on top of the stack is not a (left) parenthesis}
+        pop the operator from the operator stack onto the output queue
+*/
+
+using std::function;
+using std::list;
+using std::map;
+using std::stack;
+using std::string;
+using std::vector;
+using std::ostringstream;
+
+
+/**
+* @brief Código de operación de una instrucción del programa compilado
+*/
+enum class OpCode : unsigned char {
+	Const, /*!< Apila la constante almacenada en la instrucción */
+	Load, /*!< Apila el valor de la variable en la posición indicada */
+	Call, /*!< Aplica la función en la posición indicada al tope de la pila */
+	Neg, /*!< Negación unaria (~) */
+	Add, /*!< Suma */
+	Sub, /*!< Resta */
+	Mul, /*!< Producto */
+	Div, /*!< División */
+	Pow, /*!< Potencia */
+	Sqrt, /*!< Raíz cuadrada, resultado de reescribir x^0.5 o función predefinida sqrt */
+	Sin, /*!< Función predefinida sin */
+	Cos, /*!< Función predefinida cos */
+	Tan, /*!< Función predefinida tan */
+	Ln, /*!< Función predefinida ln */
+	Log, /*!< Función predefinida log (base 10) */
+	Exp, /*!< Función predefinida exp */
+	Abs, /*!< Función predefinida abs */
+	Store, /*!< Copia el tope de la pila al temporal en la posición indicada, sin desapilarlo */
+	Temp, /*!< Apila el valor del temporal en la posición indicada */
+	CallN, /*!< Reemplaza los argumentos del tope de la pila por el resultado de la función de varios argumentos en la posición indicada */
+	Arg, /*!< Solo en ExpressionGraph: argumentos de un nodo CallN, los anteriores en el primer operando y el último en el segundo */
+	Lt, /*!< Comparación a < b: 1 si se cumple, 0 en otro caso */
+	Le, /*!< Comparación a <= b */
+	Gt, /*!< Comparación a > b */
+	Ge, /*!< Comparación a >= b */
+	Eq, /*!< Comparación a == b */
+	Ne, /*!< Comparación a != b */
+	And, /*!< Conjunción lógica (&&): 1 si ambos operandos son distintos de 0, 0 en otro caso */
+	Or, /*!< Disyunción lógica (||) */
+	Not, /*!< Negación lógica (!): 1 si el operando es 0, 0 en otro caso */
+	Select /*!< Condicional if(c, a, b): a si c es distinta de 0, b en otro caso; ambas ramas se evalúan */
+};
+
+/**
+* @brief Función personalizada sobre una variable real, o sobre varios argumentos
+*
+* Las funciones de varios argumentos (ver arguments()) se invocan con comas, e.g. clamp(x, 0, 1),
+* y reciben los valores de sus argumentos en un arreglo.
+*/
+struct CustomFunction {
+	/** Cantidad de argumentos de una función que admite cualquier cantidad */
+	static constexpr size_t VARIADIC = SIZE_MAX;
+
+	string name; /*!< Nombre de la función */
+	function<double(double)> f; /*!< Función a aplicar a la variable */
+
+	/**
+	* @brief Evalóa la función en x
+	* @param x Valor de la variable
+	* @return Valor de la función en x
+	*/
+	double operator()(double x) const {
+		return fn ? fn(x) : f(x);
+	}
+
+	/** Núcleo opcional que aplica la función a un arreglo de valores, usado por evalBatch() */
+	void (*batch)(const double * x, double * y, size_t n) = nullptr;
+
+	/** Función sin estado que se invoca directamente, sin la indirección de f */
+	double (*fn)(double) = nullptr;
+
+	/** Código de operación de las funciones predefinidas, OpCode::Call para las demás */
+	OpCode op = OpCode::Call;
+
+	/** Cantidad de argumentos, o VARIADIC */
+	size_t args = 1;
+
+	/** Función de varios argumentos: recibe los valores de los argumentos y su cantidad */
+	function<double(const double *, size_t)> fargs = nullptr;
+
+	/** Función sin estado de varios argumentos, que se invoca sin la indirección de fargs */
+	double (*fnArgs)(const double * x, size_t n) = nullptr;
+
+	/**
+	* Núcleo opcional que aplica la función de varios argumentos a columnas de valores, usado por
+	* evalBatch(); x[j] es la columna del argumento j y y puede coincidir con x[0]
+	*/
+	void (*batchArgs)(const double * const * x, size_t n, double * y, size_t len) = nullptr;
+
+	/**
+	* Verdadero si la función no tiene estado ni efectos: con Optimization::Strict, sus llamadas
+	* con argumentos constantes se calculan al compilar, y la evaluación por lotes las calcula una
+	* vez por bloque. Las funciones impuras se invocan una vez por fila. Las funciones predefinidas
+	* son puras
+	*/
+	bool pure = false;
+
+	/**
+	* @brief Evalúa la función sobre los valores de sus argumentos
+	* @param x Valores de los argumentos
+	* @param n Cantidad de argumentos, aceptada por accepts()
+	* @return Valor de la función
+	*/
+	double operator()(const double * x, size_t n) const {
+		if (fnArgs != nullptr) {
+			return fnArgs(x, n);
+		}
+		return fargs ? fargs(x, n) : (*this)(x[0]);
+	}
+
+	/**
+	* @brief Verifica si la función se invoca sobre un arreglo de argumentos (OpCode::CallN)
+	* @return Verdadero si la función se definió con arguments() o con pointer() con cantidad de argumentos
+	*/
+	bool isMultiArgument() const {
+		return fnArgs != nullptr || fargs;
+	}
+
+	/**
+	* @brief Verifica si la función admite una cantidad de argumentos
+	* @param n Cantidad de argumentos
+	* @return Verdadero si la función es VARIADIC o tiene exactamente n argumentos
+	*/
+	bool accepts(size_t n) const {
+		return args == VARIADIC || args == n;
+	}
+
+	/**
+	* @brief Crea una función de varios argumentos
+	* @param name Nombre de la función
+	* @param args Cantidad de argumentos (puede ser 0), o VARIADIC
+	* @param f Función que recibe los valores de los argumentos y su cantidad
+	* @param batch Núcleo opcional que aplica la función a columnas de valores
+	* @return Función personalizada
+	*/
+	static CustomFunction arguments(string name, size_t args, function<double(const double *, size_t)> f,
+			void (*batch)(const double * const *, size_t, double *, size_t) = nullptr) {
+		CustomFunction func;
+		func.name = std::move(name);
+		func.args = args;
+		func.fargs = std::move(f);
+		func.batchArgs = batch;
+		return func;
+	}
+
+	/**
+	* @brief Crea una función de varios argumentos a partir de un apuntador a función
+	* @param name Nombre de la función
+	* @param args Cantidad de argumentos (puede ser 0), o VARIADIC
+	* @param fn Función que recibe los valores de los argumentos y su cantidad
+	* @param batch Núcleo opcional que aplica la función a columnas de valores
+	* @return Función personalizada que se invoca sin la indirección de std::function
+	*/
+	static CustomFunction pointer(string name, size_t args, double (*fn)(const double *, size_t),
+			void (*batch)(const double * const *, size_t, double *, size_t) = nullptr) {
+		CustomFunction func = arguments(std::move(name), args, nullptr, batch);
+		func.fnArgs = fn;
+		return func;
+	}
+
+	/**
+	* @brief Crea una función a partir de un apuntador a función
+	* @param name Nombre de la función
+	* @param fn Función a aplicar a la variable
+	* @param batch Núcleo opcional que aplica la función a un arreglo de valores
+	* @return Función personalizada que se invoca sin la indirección de std::function
+	*/
+	static CustomFunction pointer(string name, double (*fn)(double),
+			void (*batch)(const double *, double *, size_t) = nullptr) {
+		CustomFunction func = {std::move(name), fn, batch};
+		func.fn = fn;
+		return func;
+	}
+};
+
+/**
+* @brief Función predefinida, compilada como una instrucción propia del programa
+*/
+struct BuiltinFunction {
+	const char * name; /*!< Nombre de la función */
+	OpCode op; /*!< Código de operación */
+	double (*fn)(double); /*!< Función a aplicar a la variable */
+	void (*batch)(const double * x, double * y, size_t n); /*!< Núcleo sobre arreglos, nullptr si no existe */
+};
+
+/**
+* @brief Tabla de funciones predefinidas
+*
+* Las instrucciones de estas funciones se ejecutan directamente en el ciclo de evaluación, sin
+* invocar un apuntador, de modo que el compilador puede expandir sin, sqrt, etc. en línea.
+*/
+static constexpr BuiltinFunction BUILTIN_FUNCTIONS[] = {
+	{"sin", OpCode::Sin, [](double x) -> double { return sin(x); }, vmath::vsin},
+	{"cos", OpCode::Cos, [](double x) -> double { return cos(x); }, vmath::vcos},
+	{"tan", OpCode::Tan, [](double x) -> double { return tan(x); }, nullptr},
+	{"ln", OpCode::Ln, [](double x) -> double { return log(x); }, vmath::vlog},
+	{"log", OpCode::Log, [](double x) -> double { return log10(x); }, nullptr},
+	{"exp", OpCode::Exp, [](double x) -> double { return exp(x); }, vmath::vexp},
+	{"sqrt", OpCode::Sqrt, [](double x) -> double { return sqrt(x); }, vmath::vsqrt},
+	{"abs", OpCode::Abs, [](double x) -> double { return fabs(x); }, vmath::vabs}
+};
+
+/**
+* @brief Función predefinida de varios argumentos
+*/
+struct BuiltinMultiFunction {
+	const char * name; /*!< Nombre de la función */
+	size_t args; /*!< Cantidad de argumentos, o CustomFunction::VARIADIC */
+	OpCode op; /*!< Código de operación si la función equivale a una instrucción, OpCode::Call en otro caso */
+	double (*fn)(const double * x, size_t n); /*!< Función a aplicar a los argumentos */
+	void (*batch)(const double * const * x, size_t n, double * y, size_t len); /*!< Núcleo sobre columnas */
+};
+
+/**
+* @brief Tabla de funciones predefinidas de varios argumentos
+*
+* min y max ignoran los argumentos NAN, como std::fmin y std::fmax, y retornan NAN sin argumentos.
+* clamp(x, a, b) es min(max(x, a), b); pow(a, b) se compila como a^b e if(c, a, b) como OpCode::Select.
+*/
+static constexpr BuiltinMultiFunction BUILTIN_MULTI_FUNCTIONS[] = {
+	{"min", CustomFunction::VARIADIC, OpCode::Call,
+		[](const double * x, size_t n) -> double {
+			double y = (n > 0) ? x[0] : NAN;
+			for (size_t j = 1; j < n; j++) {
+				y = vmath::minimum(y, x[j]);
+			}
+			return y;
+		},
+		[](const double * const * x, size_t n, double * y, size_t len) {
+			if (n == 0) {
+				std::fill(y, y + len, NAN);
+				return;
+			}
+			if (y != x[0]) {
+				std::copy(x[0], x[0] + len, y);
+			}
+			for (size_t j = 1; j < n; j++) {
+				vmath::vmin(y, x[j], y, len);
+			}
+		}},
+	{"max", CustomFunction::VARIADIC, OpCode::Call,
+		[](const double * x, size_t n) -> double {
+			double y = (n > 0) ? x[0] : NAN;
+			for (size_t j = 1; j < n; j++) {
+				y = vmath::maximum(y, x[j]);
+			}
+			return y;
+		},
+		[](const double * const * x, size_t n, double * y, size_t len) {
+			if (n == 0) {
+				std::fill(y, y + len, NAN);
+				return;
+			}
+			if (y != x[0]) {
+				std::copy(x[0], x[0] + len, y);
+			}
+			for (size_t j = 1; j < n; j++) {
+				vmath::vmax(y, x[j], y, len);
+			}
+		}},
+	{"clamp", 3, OpCode::Call,
+		[](const double * x, size_t) -> double { return vmath::minimum(vmath::maximum(x[0], x[1]), x[2]); },
+		[](const double * const * x, size_t, double * y, size_t len) {
+			vmath::vmax(x[0], x[1], y, len);
+			vmath::vmin(y, x[2], y, len);
+		}},
+	{"atan2", 2, OpCode::Call,
+		[](const double * x, size_t) -> double { return atan2(x[0], x[1]); },
+		[](const double * const * x, size_t, double * y, size_t len) { vmath::vatan2(x[0], x[1], y, len); }},
+	{"hypot", 2, OpCode::Call,
+		[](const double * x, size_t) -> double { return hypot(x[0], x[1]); },
+		[](const double * const * x, size_t, double * y, size_t len) { vmath::vhypot(x[0], x[1], y, len); }},
+	{"pow", 2, OpCode::Pow,
+		[](const double * x, size_t) -> double { return pow(x[0], x[1]); },
+		[](const double * const * x, size_t, double * y, size_t len) { vmath::vpow(x[0], x[1], y, len); }},
+	{"if", 3, OpCode::Select,
+		[](const double * x, size_t) -> double { return vmath::select(x[0] != 0.0, x[1], x[2]); },
+		[](const double * const * x, size_t, double * y, size_t len) { vmath::vselect(x[0], x[1], x[2], y, len); }}
+};
+
+/**
+* @brief Variable de la expresión aritmética
+*/
+struct Variable {
+	string name; /*!< Nombre de la variable */
+	double val;	/*!< Valor de la variable */
+};
+
+/**
+* @brief Tipo de un elemento de la expresión
+*/
+enum class TokenKind : unsigned char {
+	Number, /*!< Número */
+	Name, /*!< Nombre de una variable */
+	Function, /*!< Nombre de una función personalizada */
+	Operator, /*!< Operador aritmético */
+	LeftParen, /*!< Paréntesis izquierdo */
+	RightParen, /*!< Paréntesis derecho */
+	Comma /*!< Separador de los argumentos de una función */
+};
+
+/**
+* @brief Elemento de la expresión, referenciado por su posición en el texto
+*/
+struct Token {
+	TokenKind kind; /*!< Tipo del elemento */
+	size_t offset; /*!< Posición del elemento en el texto */
+	size_t length; /*!< Cantidad de caracteres del elemento */
+	double val; /*!< Valor del número (Number) */
+	size_t args = 1; /*!< Cantidad de argumentos de la función entre paréntesis (Function, en la RPN) */
+};
+
+/**
+* @brief Nivel de optimización del programa compilado
+*/
+enum class Optimization {
+	None, /*!< Sin optimizaciones */
+	Strict, /*!< Plegado de constantes y de funciones puras, y reescrituras que conservan la semántica IEEE 754 */
+	Fast /*!< Además, reescrituras que pueden cambiar el signo de cero o los resultados con NAN o infinito, y plegado de todas las funciones */
+};
+
+/**
+* @brief Instrucción del programa compilado a partir de la expresión en RPN
+*/
+struct Instruction {
+	OpCode op; /*!< Código de operación */
+	size_t arg; /*!< Posición de la variable (Load) o de la función (Call, CallN) */
+	double val; /*!< Valor de la constante (Const) */
+	size_t count = 0; /*!< Cantidad de argumentos de la función (CallN) */
+};
+
+/**
+* @brief Instrucciones de un programa, en la memoria del recurso de memoria de la expresión
+*/
+typedef std::pmr::vector<Instruction> Program;
+
+/**
+* @brief Programa compilado e inmutable de una expresión
+*
+* Contiene las instrucciones y las funciones de la expresión, con las variables ya asociadas
+* a posiciones de un arreglo de valores. Todos sus métodos son constantes: una misma instancia
+* se puede compartir entre hilos, siempre que cada hilo suministre su propia pila de evaluación
+* y que las funciones personalizadas se puedan invocar de forma concurrente.
+*/
+class CompiledExpression {
+public:
+	/** Cantidad de valores por bloque en la evaluación por lotes */
+	static const size_t BATCH_SIZE = 256;
+
+	/** Cantidad de valores por tarea en la evaluación en paralelo */
+	static const size_t PARALLEL_CHUNK = 16 * BATCH_SIZE;
+
+	/** Profundidad máxima de la pila que eval(const double *) reserva en la pila del hilo */
+	static const size_t LOCAL_STACK = 64;
+
+	/** Cantidad máxima de argumentos de CallN que la evaluación por lotes reúne en la pila del hilo */
+	static const size_t LOCAL_ARGS = 16;
+
+	/**
+	* @brief Elemento de la pila de evaluación por lotes: una columna de valores o un escalar
+	*/
+	struct BatchValue {
+		const double * col; /*!< Columna de valores, nullptr si el elemento es escalar */
+		double val; /*!< Valor del elemento escalar */
+	};
+
+	/**
+	* @brief Crea un programa compilado
+	* @param code Instrucciones del programa
+	* @param funcs Funciones referenciadas por las instrucciones Call
+	* @param names Nombres de los valores de entrada referenciados por las instrucciones Load
+	*/
+	CompiledExpression(const vector<Instruction> & code, vector<CustomFunction> funcs, const vector<string> & names):
+		CompiledExpression(Program(code.begin(), code.end()),
+				std::make_shared<const vector<CustomFunction>>(std::move(funcs)),
+				std::pmr::vector<string>(names.begin(), names.end())) {
+	}
+
+	/**
+	* @brief Crea un programa compilado que comparte la tabla de funciones
+	*
+	* Las instrucciones y los nombres conservan el recurso de memoria con el que se crearon.
+	* @param code Instrucciones del programa
+	* @param funcs Funciones referenciadas por las instrucciones Call
+	* @param names Nombres de los valores de entrada referenciados por las instrucciones Load
+	*/
+	CompiledExpression(Program code, std::shared_ptr<const vector<CustomFunction>> funcs,
+			std::pmr::vector<string> names):
+		code(std::move(code)), functions(std::move(funcs)), names(std::move(names)) {
+		valid = validate(this->code, depth, temps);
+
+		//Cada función de varios argumentos debe admitir la cantidad con la que se invoca
+		for (auto & ins: this->code) {
+			if (ins.op == OpCode::CallN && !(*functions)[ins.arg].accepts(ins.count)) {
+				valid = false;
+			}
+		}
+	}
+
+	/**
+	* @brief Retorna la cantidad de operandos de una instrucción
+	*
+	* La cantidad de argumentos de CallN depende de la instrucción (ver arity(const Instruction &));
+	* en ExpressionGraph, un nodo CallN o Select tiene un solo operando, sus argumentos.
+	* @param op Código de operación
+	* @return 0 para las instrucciones que apilan un valor, 2 para los operadores binarios, 3 para Select,
+	* 1 para las demás
+	*/
+	static constexpr size_t arity(OpCode op) {
+		switch (op) {
+			case OpCode::Const:
+			case OpCode::Load:
+			case OpCode::Temp:
+				return 0;
+			case OpCode::Add:
+			case OpCode::Sub:
+			case OpCode::Mul:
+			case OpCode::Div:
+			case OpCode::Pow:
+			case OpCode::Arg:
+			case OpCode::Lt:
+			case OpCode::Le:
+			case OpCode::Gt:
+			case OpCode::Ge:
+			case OpCode::Eq:
+			case OpCode::Ne:
+			case OpCode::And:
+			case OpCode::Or:
+				return 2;
+			case OpCode::Select:
+				return 3;
+			default:
+				return 1;
+		}
+	}
+
+	/**
+	* @brief Retorna la cantidad de valores que una instrucción toma de la pila
+	* @param ins Instrucción
+	* @return Cantidad de argumentos para CallN, arity(ins.op) para las demás
+	*/
+	static constexpr size_t arity(const Instruction & ins) {
+		return (ins.op == OpCode::CallN) ? ins.count : arity(ins.op);
+	}
+
+	/**
+	* @brief Valida un programa y calcula la profundidad máxima de su pila
+	*
+	* Igual que evalRPN(), los operadores sin suficientes operandos se descartan. El programa
+	* no es válido si una función no tiene sus argumentos, si se lee un temporal antes de guardarlo,
+	* si contiene instrucciones OpCode::Arg o si al final la pila no tiene exactamente un valor. Un
+	* programa válido se evalúa sin verificar el tope de la pila.
+	* @param code Programa a validar, del cual se eliminan los operadores sin operandos
+	* @param depth Referencia a la profundidad máxima de la pila
+	* @return Verdadero si el programa es válido
+	*/
+	static bool validate(Program & code, size_t & depth) {
+		size_t temps;
+		return validate(code, depth, temps);
+	}
+
+	/**
+	* @brief Valida un programa y calcula la profundidad máxima de su pila y sus temporales
+	* @param code Programa a validar, del cual se eliminan los operadores sin operandos
+	* @param depth Referencia a la profundidad máxima de la pila
+	* @param temps Referencia a la cantidad de temporales
+	* @return Verdadero si el programa es válido
+	*/
+	static bool validate(Program & code, size_t & depth, size_t & temps) {
+		size_t top = 0;
+		size_t n = 0;
+
+		depth = 0;
+		temps = 0;
+		for (auto & ins: code) {
+			size_t k = arity(ins);
+			if (ins.op == OpCode::Arg) {
+				return false;
+			}
+			if (top < k) {
+				if (ins.op == OpCode::Call || ins.op == OpCode::CallN || ins.op == OpCode::Select || ins.op == OpCode::Store) {
+					return false;
+				}
+				continue;
+			}
+			//Los temporales se guardan en orden: solo se puede leer uno ya guardado
+			if (ins.op == OpCode::Store) {
+				temps = std::max(temps, ins.arg + 1);
+			}else if (ins.op == OpCode::Temp && ins.arg >= temps) {
+				return false;
+			}
+			top = top - k + 1;
+			depth = std::max(depth, top);
+			code[n++] = ins;
+		}
+		code.resize(n);
+
+		return top == 1;
+	}
+
+	/**
+	* @brief Retorna las instrucciones del programa
+	* @return Instrucciones del programa
+	*/
+	const Program & instructions() const {
+		return code;
+	}
+
+	/**
+	* @brief Retorna la cantidad de valores de entrada del programa
+	* @return Cantidad de valores de entrada
+	*/
+	size_t inputs() const {
+		return names.size();
+	}
+
+	/**
+	* @brief Retorna los nombres de los valores de entrada del programa
+	*
+	* El vector usa el recurso de memoria del programa; cada nombre es un std::string que, si no
+	* cabe en su búfer interno, se reserva con operator new.
+	* @return Nombres de las variables, en el orden esperado por eval()
+	*/
+	const std::pmr::vector<string> & variables() const {
+		return names;
+	}
+
+	/**
+	* @brief Retorna las funciones referenciadas por las instrucciones Call
+	* @return Funciones personalizadas del programa
+	*/
+	const vector<CustomFunction> & customFunctions() const {
+		return *functions;
+	}
+
+	/**
+	* @brief Retorna la capacidad requerida de la pila de evaluación
+	*
+	* Los temporales se almacenan en las últimas temporaries() posiciones de la pila.
+	* @return Cantidad de valores de la pila, incluyendo los temporales
+	*/
+	size_t stackSize() const {
+		return depth + temps;
+	}
+
+	/**
+	* @brief Retorna la cantidad de temporales del programa
+	* @return Cantidad de subexpresiones compartidas que se guardan con OpCode::Store
+	*/
+	size_t temporaries() const {
+		return temps;
+	}
+
+	/**
+	* @brief Verifica si el programa se puede evaluar
+	* @return Falso si el programa no produce exactamente un valor; eval() retorna NAN
+	*/
+	bool isValid() const {
+		return valid;
+	}
+
+	/**
+	* @brief Evalúa el programa sobre una pila reservada en la pila del hilo
+	*
+	* No reserva memoria si stackSize() no excede LOCAL_STACK.
+	* @param values Valores de entrada
+	* @return Resultado de la expresión, NAN si no es válida
+	*/
+	double eval(const double * values) const {
+		if (stackSize() <= LOCAL_STACK) {
+			double st[LOCAL_STACK];
+			return eval(values, st);
+		}
+		vector<double> st(stackSize());
+		return eval(values, st.data());
+	}
+
+	/**
+	* @brief Evalúa el programa
+	* @param values Valores de entrada
+	* @param st Pila de evaluación, con capacidad para stackSize() valores
+	* @return Resultado de la expresión, NAN si no es válida
+	*/
+	double eval(const double * values, double * st) const {
+#ifdef EXPRESSION_PROFILE
+		if (counters) {
+			bool timed = ExpressionProfile::sample();
+			ExpressionProfile::Clock::time_point start = timed ? ExpressionProfile::Clock::now() : ExpressionProfile::Clock::time_point();
+			double result = execute(values, st);
+			uint64_t nanos = timed ? ExpressionProfile::since(start) * ExpressionProfile::SAMPLE : 0;
+			record(1, nanos, result != result);
+			return result;
+		}
+#endif
+		return execute(values, st);
+	}
+
+	/**
+	* @brief Evalúa el programa sobre columnas de valores
+	*
+	* Equivale a evaluar out[i] = eval(fila i), ejecutando el programa por bloques de
+	* BATCH_SIZE valores: cada instrucción se aplica a un bloque completo mediante los
+	* núcleos vectoriales de vmath.h. Los operadores + - * / ~, las comparaciones, los operadores
+	* lógicos e if(c, a, b) producen los mismos valores que eval(); x^k con k entero, |k| <= 16,
+	* difiere a lo sumo |k| + 1 ULP de pow() cuando el resultado es normal y coincide con pow()
+	* cuando es subnormal (ver vmath::vpowi()), y sin, cos, exp y ln difieren a lo sumo 2 ULP de
+	* sus equivalentes en cmath.
+	* @param columns Una columna de n valores por cada valor de entrada
+	* @param out Arreglo de salida, con capacidad para n valores
+	* @param n Cantidad de valores a evaluar
+	*/
+	void evalBatch(const double * const * columns, double * out, size_t n) const {
+		vector<double> scratch(stackSize() * BATCH_SIZE);
+		vector<BatchValue> st(stackSize());
+
+		evalRange(columns, out, 0, n, scratch.data(), st.data());
+	}
+
+	/**
+	* @brief Evalúa el programa sobre una malla uniforme del primer valor de entrada
+	*
+	* Equivale a evalBatch() sobre la columna x[i] = x0 + i * (x1 - x0) / (n - 1), con x[n - 1] = x1,
+	* pero la malla se genera por bloques de BATCH_SIZE valores dentro de la evaluación, sin leer
+	* un arreglo de entrada. Los demás valores de entrada, si los hay, son NAN.
+	* @param x0 Primer punto de la malla
+	* @param x1 Último punto de la malla
+	* @param n Cantidad de puntos; con n = 1 se evalúa solo x0
+	* @param out Arreglo de salida, con capacidad para n valores
+	*/
+	void evalGrid(double x0, double x1, size_t n, double * out) const {
+		if (!valid) {
+			std::fill(out, out + n, NAN);
+			return;
+		}
+#ifdef EXPRESSION_PROFILE
+		ExpressionProfile::Clock::time_point start = counters ? ExpressionProfile::Clock::now() : ExpressionProfile::Clock::time_point();
+#endif
+		//Un bloque para la malla y otro, de NAN, para las demás entradas
+		vector<double> scratch((stackSize() + 2) * BATCH_SIZE);
+		vector<BatchValue> st(stackSize());
+		double * x = scratch.data() + stackSize() * BATCH_SIZE;
+		std::fill(x + BATCH_SIZE, x + 2 * BATCH_SIZE, NAN);
+		vector<const double *> columns(std::max(inputs(), size_t(1)), x + BATCH_SIZE);
+		columns[0] = x;
+
+		//Los índices se generan como reales, sin conversiones de enteros dentro del ciclo
+		static const vector<double> ramp = [] {
+			vector<double> r(BATCH_SIZE);
+			for (size_t i = 0; i < r.size(); i++) {
+				r[i] = double(i);
+			}
+			return r;
+		}();
+		double h = (n > 1) ? (x1 - x0) / double(n - 1) : 0.0;
+		for (size_t base = 0; base < n; base += BATCH_SIZE) {
+			size_t len = std::min(size_t(BATCH_SIZE), n - base);
+			double b = double(base);
+			for (size_t i = 0; i < len; i++) {
+				x[i] = x0 + (b + ramp[i]) * h;
+			}
+			if (base + len == n && n > 1) {
+				x[len - 1] = x1;
+			}
+			evalBlock(columns.data(), 0, len, scratch.data(), st.data(), out + base);
+		}
+#ifdef EXPRESSION_PROFILE
+		if (counters && n > 0) {
+			record(n, ExpressionProfile::since(start), std::count_if(out, out + n, [](double v) { return v != v; }));
+		}
+#endif
+	}
+
+	/**
+	* @brief Evalúa el programa sobre columnas de valores, repartiendo el trabajo entre hilos
+	*
+	* El rango se divide en tareas de PARALLEL_CHUNK valores. Cada hilo usa su propia pila de
+	* evaluación; el programa se comparte sin copiarlo.
+	* @param columns Una columna de n valores por cada valor de entrada
+	* @param out Arreglo de salida, con capacidad para n valores
+	* @param n Cantidad de valores a evaluar
+	* @param pool Conjunto de hilos que ejecuta las tareas
+	*/
+	void evalParallel(const double * const * columns, double * out, size_t n, ThreadPool & pool) const {
+		//Pilas de evaluación por hilo, incluyendo el hilo que invoca
+		vector<vector<double>> scratch(pool.size() + 1);
+		vector<vector<BatchValue>> stacks(pool.size() + 1);
+		size_t tasks = (n + PARALLEL_CHUNK - 1) / PARALLEL_CHUNK;
+
+		pool.parallelFor(tasks, [&](size_t task, size_t worker) {
+			if (stacks[worker].size() != stackSize()) {
+				scratch[worker].resize(stackSize() * BATCH_SIZE);
+				stacks[worker].resize(stackSize());
+			}
+			size_t begin = task * PARALLEL_CHUNK;
+			size_t end = std::min(n, begin + PARALLEL_CHUNK);
+			evalRange(columns, out, begin, end, scratch[worker].data(), stacks[worker].data());
+		});
+	}
+
+	/**
+	* @brief Evalúa el programa sobre un rango de filas de las columnas de valores
+	* @param columns Columnas de valores de entrada
+	* @param out Arreglo de salida, indexado igual que las columnas
+	* @param begin Primera fila a evaluar
+	* @param end Fila siguiente a la última a evaluar
+	* @param scratch Bloques de la pila de evaluación, BATCH_SIZE valores por posición de la pila
+	* @param st Pila de evaluación, con capacidad para stackSize() elementos
+	*/
+	void evalRange(const double * const * columns, double * out, size_t begin, size_t end,
+			double * scratch, BatchValue * st) const {
+#ifdef EXPRESSION_PROFILE
+		ExpressionProfile::Clock::time_point start = counters ? ExpressionProfile::Clock::now() : ExpressionProfile::Clock::time_point();
+#endif
+		if (!valid) {
+			std::fill(out + begin, out + end, NAN);
+		}else {
+			for (size_t base = begin; base < end; base += BATCH_SIZE) {
+				size_t len = std::min(size_t(BATCH_SIZE), end - base);
+				evalBlock(columns, base, len, scratch, st, out + base);
+			}
+		}
+#ifdef EXPRESSION_PROFILE
+		if (counters && end > begin) {
+			uint64_t nanos = ExpressionProfile::since(start);
+			record(end - begin, nanos, std::count_if(out + begin, out + end, [](double v) { return v != v; }));
+		}
+#endif
+	}
+
+	/**
+	* @brief Evalúa el programa sobre un bloque de valores
+	*
+	* Cada posición de la pila y cada temporal tiene un bloque de BATCH_SIZE valores en scratch.
+	* Las constantes se mantienen como escalares hasta que una operación las combina con una columna.
+	* @param columns Columnas de valores de entrada
+	* @param base Posición del bloque dentro de las columnas
+	* @param len Cantidad de valores del bloque
+	* @param scratch Bloques de la pila de evaluación
+	* @param st Pila de evaluación
+	* @param out Arreglo de salida del bloque
+	*/
+	void evalBlock(const double * const * columns, size_t base, size_t len,
+			double * scratch, BatchValue * st, double * out) const {
+		size_t top = 0;
+
+		for (auto & ins: code) {
+			switch (ins.op) {
+				case OpCode::Const:
+					st[top++] = {nullptr, ins.val};
+					break;
+				case OpCode::Load:
+					st[top++] = {columns[ins.arg] + base, 0.0};
+					break;
+				case OpCode::Call: {
+					BatchValue & v = st[top - 1];
+					const CustomFunction & f = (*functions)[ins.arg];
+					if (v.col == nullptr && f.pure) {
+						v.val = f(v.val);
+						break;
+					}
+					double * y = scratch + (top - 1) * BATCH_SIZE;
+					if (v.col == nullptr) {
+						//Una función impura se invoca una vez por fila, como en eval()
+						for (size_t i = 0; i < len; i++) {
+							y[i] = f(v.val);
+						}
+					}else if (f.batch != nullptr) {
+						f.batch(v.col, y, len);
+					}else {
+						for (size_t i = 0; i < len; i++) {
+							y[i] = f(v.col[i]);
+						}
+					}
+					v.col = y;
+					break;
+				}
+				case OpCode::CallN:
+					top -= ins.count;
+					callBatch((*functions)[ins.arg], st + top, ins.count, scratch + top * BATCH_SIZE, len);
+					top++;
+					break;
+				case OpCode::Store: {
+					//El temporal conserva su propio bloque: el de la pila se reutiliza
+					BatchValue & v = st[top - 1];
+					if (v.col != nullptr) {
+						double * t = scratch + (depth + ins.arg) * BATCH_SIZE;
+						std::copy(v.col, v.col + len, t);
+						v.col = t;
+					}
+					st[depth + ins.arg] = v;
+					break;
+				}
+				case OpCode::Temp:
+					st[top++] = st[depth + ins.arg];
+					break;
+				case OpCode::Add:
+				case OpCode::Sub:
+				case OpCode::Mul:
+				case OpCode::Div:
+				case OpCode::Pow:
+				case OpCode::Lt:
+				case OpCode::Le:
+				case OpCode::Gt:
+				case OpCode::Ge:
+				case OpCode::Eq:
+				case OpCode::Ne:
+				case OpCode::And:
+				case OpCode::Or:
+					top--;
+					calculateBatch(st[top - 1], st[top], ins.op, scratch + (top - 1) * BATCH_SIZE,
+							scratch + top * BATCH_SIZE, len);
+					break;
+				case OpCode::Select:
+					top -= 2;
+					selectBatch(st + top - 1, scratch + (top - 1) * BATCH_SIZE, len);
+					break;
+				default: {
+					BatchValue & v = st[top - 1];
+					if (v.col == nullptr) {
+						v.val = calculateUnary(v.val, ins.op);
+					}else {
+						double * y = scratch + (top - 1) * BATCH_SIZE;
+						calculateUnaryBatch(v.col, y, ins.op, len);
+						v.col = y;
+					}
+					break;
+				}
+			}
+		}
+
+		if (st[0].col == nullptr) {
+			std::fill(out, out + len, st[0].val);
+		}else {
+			std::copy(st[0].col, st[0].col + len, out);
+		}
+	}
+
+	/**
+	* @brief Calcula el resultado de una operación binaria
+	*
+	* Las comparaciones y los operadores lógicos retornan 1 o 0. Igual que en C, las comparaciones
+	* con NAN no se cumplen, excepto !=, y los operadores lógicos consideran verdadero todo valor
+	* distinto de 0, incluyendo NAN.
+	* @param a Primer operando
+	* @param b Segundo operando
+	* @param op Código de operación
+	* @return Resultado de la operación, NAN si no es válida
+	*/
+	static double calculate(double a, double b, OpCode op) {
+		switch (op) {
+			case OpCode::Add:
+				return a + b;
+			case OpCode::Sub:
+				return a - b;
+			case OpCode::Mul:
+				return a * b;
+			case OpCode::Div:
+				return a / b;
+			case OpCode::Pow:
+				return pow(a, b);
+			case OpCode::Lt:
+				return a < b;
+			case OpCode::Le:
+				return a <= b;
+			case OpCode::Gt:
+				return a > b;
+			case OpCode::Ge:
+				return a >= b;
+			case OpCode::Eq:
+				return a == b;
+			case OpCode::Ne:
+				return a != b;
+			case OpCode::And:
+				return (a != 0.0) && (b != 0.0);
+			case OpCode::Or:
+				return (a != 0.0) || (b != 0.0);
+			default:
+				return NAN;
+		}
+	}
+
+	/**
+	* @brief Calcula el resultado de una operación unaria o de una función predefinida
+	* @param a Operando
+	* @param op Código de operación
+	* @return Resultado de la operación, NAN si no es válida
+	*/
+	static double calculateUnary(double a, OpCode op) {
+		switch (op) {
+			case OpCode::Neg:
+				return -a;
+			case OpCode::Sqrt:
+				return sqrt(a);
+			case OpCode::Sin:
+				return sin(a);
+			case OpCode::Cos:
+				return cos(a);
+			case OpCode::Tan:
+				return tan(a);
+			case OpCode::Ln:
+				return log(a);
+			case OpCode::Log:
+				return log10(a);
+			case OpCode::Exp:
+				return exp(a);
+			case OpCode::Abs:
+				return fabs(a);
+			case OpCode::Not:
+				return a == 0.0;
+			default:
+				return NAN;
+		}
+	}
+
+	/**
+	* @brief Calcula una operación unaria o una función predefinida sobre un bloque de valores
+	* @param x Operando
+	* @param y Bloque de resultados
+	* @param op Código de operación
+	* @param len Cantidad de valores del bloque
+	*/
+	static void calculateUnaryBatch(const double * x, double * y, OpCode op, size_t len) {
+		switch (op) {
+			case OpCode::Neg:
+				vmath::vneg(x, y, len);
+				break;
+			case OpCode::Sqrt:
+				vmath::vsqrt(x, y, len);
+				break;
+			case OpCode::Sin:
+				vmath::vsin(x, y, len);
+				break;
+			case OpCode::Cos:
+				vmath::vcos(x, y, len);
+				break;
+			case OpCode::Ln:
+				vmath::vlog(x, y, len);
+				break;
+			case OpCode::Exp:
+				vmath::vexp(x, y, len);
+				break;
+			case OpCode::Abs:
+				vmath::vabs(x, y, len);
+				break;
+			case OpCode::Not:
+				vmath::vnot(x, y, len);
+				break;
+			default:
+				for (size_t i = 0; i < len; i++) {
+					y[i] = calculateUnary(x[i], op);
+				}
+				break;
+		}
+	}
+
+	/**
+	* @brief Calcula una operación binaria sobre un bloque de valores
+	* @param a Primer operando, donde se almacena el resultado
+	* @param b Segundo operando
+	* @param op Código de operación
+	* @param bufA Bloque de la pila asociado al primer operando
+	* @param bufB Bloque de la pila asociado al segundo operando
+	* @param len Cantidad de valores del bloque
+	*/
+	static void calculateBatch(BatchValue & a, BatchValue & b, OpCode op, double * bufA, double * bufB, size_t len) {
+		if (a.col == nullptr && b.col == nullptr) {
+			a.val = calculate(a.val, b.val, op);
+			return;
+		}
+		//Potencia con exponente entero: multiplicaciones sucesivas
+		if (op == OpCode::Pow && b.col == nullptr && b.val == std::trunc(b.val) && std::fabs(b.val) <= 16.0) {
+			vmath::vpowi(column(a, bufA, len), (int) b.val, bufA, len);
+			a.col = bufA;
+			return;
+		}
+
+		const double * pa = column(a, bufA, len);
+		const double * pb = column(b, bufB, len);
+
+		switch (op) {
+			case OpCode::Add:
+				vmath::vadd(pa, pb, bufA, len);
+				break;
+			case OpCode::Sub:
+				vmath::vsub(pa, pb, bufA, len);
+				break;
+			case OpCode::Mul:
+				vmath::vmul(pa, pb, bufA, len);
+				break;
+			case OpCode::Div:
+				vmath::vdiv(pa, pb, bufA, len);
+				break;
+			case OpCode::Pow:
+				vmath::vpow(pa, pb, bufA, len);
+				break;
+			case OpCode::Lt:
+				vmath::vlt(pa, pb, bufA, len);
+				break;
+			case OpCode::Le:
+				vmath::vle(pa, pb, bufA, len);
+				break;
+			case OpCode::Gt:
+				vmath::vgt(pa, pb, bufA, len);
+				break;
+			case OpCode::Ge:
+				vmath::vge(pa, pb, bufA, len);
+				break;
+			case OpCode::Eq:
+				vmath::veq(pa, pb, bufA, len);
+				break;
+			case OpCode::Ne:
+				vmath::vne(pa, pb, bufA, len);
+				break;
+			case OpCode::And:
+				vmath::vand(pa, pb, bufA, len);
+				break;
+			case OpCode::Or:
+				vmath::vor(pa, pb, bufA, len);
+				break;
+			default:
+				std::fill(bufA, bufA + len, NAN);
+				break;
+		}
+		a.col = bufA;
+	}
+
+	/**
+	* @brief Calcula if(c, a, b) sobre un bloque de valores, sin saltos
+	*
+	* Con una condición escalar el resultado es una de las ramas. En otro caso las ramas escalares
+	* se expanden en sus bloques y cada valor se elige con una máscara (ver vmath::vselect()).
+	* @param args Condición y ramas, en posiciones consecutivas de la pila; el resultado queda en args[0]
+	* @param scratch Bloque de la pila de la condición, seguido de los bloques de las ramas
+	* @param len Cantidad de valores del bloque
+	*/
+	static void selectBatch(BatchValue * args, double * scratch, size_t len) {
+		if (args[0].col == nullptr) {
+			//La rama elegida se copia al bloque del resultado: el de la rama se reutiliza
+			BatchValue v = (args[0].val != 0.0) ? args[1] : args[2];
+			if (v.col != nullptr) {
+				std::copy(v.col, v.col + len, scratch);
+				v.col = scratch;
+			}
+			args[0] = v;
+			return;
+		}
+		const double * a = column(args[1], scratch + BATCH_SIZE, len);
+		const double * b = column(args[2], scratch + 2 * BATCH_SIZE, len);
+		vmath::vselect(args[0].col, a, b, scratch, len);
+		args[0].col = scratch;
+	}
+
+	/**
+	* @brief Aplica una función de varios argumentos a un bloque de valores
+	*
+	* Si la función es pura y todos sus argumentos, al menos uno, son escalares, el resultado es
+	* escalar. En otro caso los argumentos escalares se expanden en sus bloques y la función se
+	* aplica con su núcleo batchArgs o, si no lo tiene, fila por fila: las funciones impuras y las
+	* que no tienen argumentos se invocan una vez por fila, como en eval().
+	* @param f Función
+	* @param args Argumentos, en posiciones consecutivas de la pila; el resultado queda en args[0]
+	* @param n Cantidad de argumentos
+	* @param scratch Bloque de la pila del primer argumento, seguido de los bloques de los demás
+	* @param len Cantidad de valores del bloque
+	*/
+	static void callBatch(const CustomFunction & f, BatchValue * args, size_t n, double * scratch, size_t len) {
+		const double * localCols[LOCAL_ARGS];
+		double localRow[LOCAL_ARGS];
+		vector<const double *> heapCols;
+		vector<double> heapRow;
+		const double ** cols = localCols;
+		double * row = localRow;
+		if (n > LOCAL_ARGS) {
+			heapCols.resize(n);
+			heapRow.resize(n);
+			cols = heapCols.data();
+			row = heapRow.data();
+		}
+
+		bool scalar = true;
+		for (size_t j = 0; j < n; j++) {
+			scalar = scalar && args[j].col == nullptr;
+			row[j] = args[j].val;
+		}
+		if (scalar && f.pure && n > 0) {
+			args[0] = {nullptr, f(row, n)};
+			return;
+		}
+
+		//Los bloques de los argumentos posteriores al primero no coinciden con el resultado
+		for (size_t j = 0; j < n; j++) {
+			cols[j] = column(args[j], scratch + j * BATCH_SIZE, len);
+		}
+		if (f.batchArgs != nullptr) {
+			f.batchArgs(cols, n, scratch, len);
+		}else {
+			for (size_t i = 0; i < len; i++) {
+				for (size_t j = 0; j < n; j++) {
+					row[j] = cols[j][i];
+				}
+				scratch[i] = f(row, n);
+			}
+		}
+		args[0].col = scratch;
+	}
+
+	/**
+	* @brief Obtiene la columna de valores de un elemento de la pila
+	* @param v Elemento de la pila
+	* @param buf Bloque donde se expande el valor si es escalar
+	* @param len Cantidad de valores del bloque
+	* @return Columna de valores del elemento
+	*/
+	static const double * column(const BatchValue & v, double * buf, size_t len) {
+		if (v.col != nullptr) {
+			return v.col;
+		}
+		std::fill(buf, buf + len, v.val);
+		return buf;
+	}
+
+private:
+	Program code; /*!< Instrucciones del programa */
+	std::shared_ptr<const vector<CustomFunction>> functions; /*!< Funciones referenciadas por el programa */
+	size_t depth; /*!< Profundidad máxima de la pila de evaluación, sin los temporales */
+	size_t temps; /*!< Cantidad de temporales */
+	bool valid; /*!< Verdadero si el programa produce exactamente un valor */
+	std::pmr::vector<string> names; /*!< Nombres de los valores de entrada */
+
+#ifdef EXPRESSION_PROFILE
+	std::shared_ptr<ExpressionProfile> counters; /*!< Contadores de la expresión, nullptr si no se registran */
+	vector<size_t> calls; /*!< Posición de la función de cada instrucción Call y CallN */
+
+	/**
+	* @brief Asocia los contadores de la expresión que creó el programa
+	* @param profile Contadores
+	*/
+	void attach(std::shared_ptr<ExpressionProfile> profile) {
+		counters = std::move(profile);
+		calls.clear();
+		for (auto & ins: code) {
+			if (ins.op == OpCode::Call || ins.op == OpCode::CallN) {
+				calls.push_back(ins.arg);
+			}else if (ins.op >= OpCode::Sqrt && ins.op <= OpCode::Abs) {
+				//Las funciones predefinidas se compilan a su instrucción
+				for (size_t f = 0; f < functions->size(); f++) {
+					if ((*functions)[f].op == ins.op) {
+						calls.push_back(f);
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	/**
+	* @brief Registra evaluaciones del programa
+	* @param evals Cantidad de evaluaciones
+	* @param nanos Duración en nanosegundos, 0 si no se midió
+	* @param nans Resultados NAN
+	*/
+	void record(uint64_t evals, uint64_t nanos, uint64_t nans) const {
+		if (!valid) {
+			counters->evaluated(evals, 0, nanos, 0, evals);
+			return;
+		}
+		counters->evaluated(evals, evals * code.size(), nanos, nans, 0);
+		for (size_t f: calls) {
+			counters->called(f, evals);
+		}
+	}
+#endif
+
+	friend class expression;
+
+	/**
+	* @brief Ejecuta las instrucciones del programa, sin registrar contadores
+	* @param values Valores de entrada
+	* @param st Pila de evaluación, con capacidad para stackSize() valores
+	* @return Resultado de la expresión, NAN si no es válida
+	*/
+	double execute(const double * values, double * st) const {
+		if (!valid) {
+			return NAN;
+		}
+
+		//La validación garantiza los operandos de cada instrucción
+		size_t top = 0;
+
+		for (auto & ins: code) {
+			switch (ins.op) {
+				case OpCode::Const:
+					st[top++] = ins.val;
+					break;
+				case OpCode::Load:
+					st[top++] = values[ins.arg];
+					break;
+				case OpCode::Call:
+					st[top - 1] = (*functions)[ins.arg](st[top - 1]);
+					break;
+				case OpCode::CallN:
+					//Los argumentos ocupan posiciones consecutivas de la pila
+					top -= ins.count;
+					st[top] = (*functions)[ins.arg](st + top, ins.count);
+					top++;
+					break;
+				case OpCode::Store:
+					st[depth + ins.arg] = st[top - 1];
+					break;
+				case OpCode::Temp:
+					st[top++] = st[depth + ins.arg];
+					break;
+				case OpCode::Add:
+				case OpCode::Sub:
+				case OpCode::Mul:
+				case OpCode::Div:
+				case OpCode::Pow:
+				case OpCode::Lt:
+				case OpCode::Le:
+				case OpCode::Gt:
+				case OpCode::Ge:
+				case OpCode::Eq:
+				case OpCode::Ne:
+				case OpCode::And:
+				case OpCode::Or:
+					top--;
+					st[top - 1] = calculate(st[top - 1], st[top], ins.op);
+					break;
+				case OpCode::Select:
+					//Ambas ramas ya están calculadas: la selección no requiere un salto
+					top -= 2;
+					st[top - 1] = vmath::select(st[top - 1] != 0.0, st[top], st[top + 1]);
+					break;
+				default:
+					st[top - 1] = calculateUnary(st[top - 1], ins.op);
+					break;
+			}
+		}
+
+		//Al final de la ejecucion, el tope de la pila contiene el resultado
+		return st[0];
+	}
+};
+
+/**
+* @brief Grafo acíclico de las subexpresiones de uno o más programas
+*
+* Cada nodo es una instrucción cuyos operandos son otros nodos. Agregar un nodo igual a uno
+* existente (mismo código de operación, argumento, constante y operandos) retorna el existente,
+* de modo que cada subexpresión común aparece una sola vez. Los operandos de un nodo siempre
+* tienen un identificador menor que el del nodo. Los argumentos de una función de varios
+* argumentos f(x1, ..., xn) son una lista de nodos OpCode::Arg: Arg(...Arg(x1, x2)..., xn) es el
+* operando del nodo CallN, o x1 si n = 1; sin argumentos, el nodo CallN no tiene operandos. De la
+* misma forma, el operando de un nodo Select es la lista Arg(Arg(c, a), b) de if(c, a, b).
+*/
+class ExpressionGraph {
+public:
+	/** Identificador de un nodo inexistente */
+	static constexpr size_t NONE = SIZE_MAX;
+
+	/**
+	* @brief Nodo del grafo
+	*/
+	struct Node {
+		OpCode op; /*!< Código de operación */
+		size_t arg; /*!< Posición del valor de entrada (Load) o de la función (Call, CallN) */
+		double val; /*!< Valor de la constante (Const) */
+		size_t a; /*!< Primer operando, NONE si no tiene */
+		size_t b; /*!< Segundo operando, NONE si no tiene */
+	};
+
+	/**
+	* @brief Crea un grafo vacío
+	* @param memory Recurso de memoria de los nodos
+	*/
+	explicit ExpressionGraph(std::pmr::memory_resource * memory = std::pmr::get_default_resource()):
+		graph(memory), index(memory) {
+	}
+
+	/**
+	* @brief Retorna los nodos del grafo
+	* @return Nodos, en orden de creación
+	*/
+	const std::pmr::vector<Node> & nodes() const {
+		return graph;
+	}
+
+	/**
+	* @brief Retorna un nodo del grafo
+	* @param id Identificador del nodo
+	* @return Nodo
+	*/
+	const Node & node(size_t id) const {
+		return graph[id];
+	}
+
+	/**
+	* @brief Agrega una constante
+	* @param val Valor de la constante
+	* @return Identificador del nodo
+	*/
+	size_t constant(double val) {
+		return add({OpCode::Const, 0, val, NONE, NONE});
+	}
+
+	/**
+	* @brief Agrega un valor de entrada
+	* @param input Posición del valor de entrada
+	* @return Identificador del nodo
+	*/
+	size_t load(size_t input) {
+		return add({OpCode::Load, input, 0.0, NONE, NONE});
+	}
+
+	/**
+	* @brief Agrega una operación
+	*
+	* Las operaciones cuyos operandos son constantes se reemplazan por su valor, excepto las
+	* funciones personalizadas; Select con una condición constante, o con ramas iguales, se
+	* reemplaza por la rama elegida.
+	* @param op Código de operación
+	* @param a Primer operando; los argumentos para CallN y Select
+	* @param b Segundo operando (operaciones binarias y Arg)
+	* @param arg Posición de la función (Call, CallN)
+	* @return Identificador del nodo
+	*/
+	size_t apply(OpCode op, size_t a, size_t b = NONE, size_t arg = 0) {
+		if (op == OpCode::Select) {
+			size_t c = graph[graph[a].a].a;
+			size_t x = graph[graph[a].a].b;
+			size_t y = graph[a].b;
+			if (x == y || isConstant(c)) {
+				return (x == y || graph[c].val != 0.0) ? x : y;
+			}
+			return add({op, 0, 0.0, a, NONE});
+		}
+		if (op == OpCode::CallN || op == OpCode::Arg) {
+			return add({op, (op == OpCode::CallN) ? arg : 0, 0.0, a, (op == OpCode::Arg) ? b : NONE});
+		}
+		size_t k = CompiledExpression::arity(op);
+		if (k == 2 && isConstant(a) && isConstant(b)) {
+			return constant(CompiledExpression::calculate(graph[a].val, graph[b].val, op));
+		}
+		if (k == 1 && op != OpCode::Call && isConstant(a)) {
+			return constant(CompiledExpression::calculateUnary(graph[a].val, op));
+		}
+		return add({op, (op == OpCode::Call) ? arg : 0, 0.0, a, (k == 2) ? b : NONE});
+	}
+
+	/**
+	* @brief Agrega las subexpresiones de un programa
+	* @param code Programa, validado con CompiledExpression::validate()
+	* @param functions Funciones referenciadas por el programa; si no es nullptr, cada llamada a una
+	*        función que varía entre invocaciones (ver varies()) es un nodo propio, que no se comparte
+	* @return Identificador del resultado del programa, NONE si no produce exactamente un valor
+	*/
+	size_t insert(const Program & code, const vector<CustomFunction> * functions = nullptr) {
+		std::pmr::vector<size_t> st(graph.get_allocator().resource());
+		std::pmr::vector<size_t> temps(graph.get_allocator().resource());
+
+		for (auto & ins: code) {
+			size_t k = CompiledExpression::arity(ins);
+			if (st.size() < k || ins.op == OpCode::Arg) {
+				return NONE;
+			}
+			if (ins.op == OpCode::CallN || ins.op == OpCode::Select) {
+				//Lista de argumentos, del primero al último
+				size_t first = st.size() - k;
+				size_t args = (k > 0) ? st[first] : NONE;
+				for (size_t j = first + 1; j < st.size(); j++) {
+					args = apply(OpCode::Arg, args, st[j]);
+				}
+				st.resize(first);
+				if (functions != nullptr && ins.op == OpCode::CallN && varies((*functions)[ins.arg], k)) {
+					st.push_back(distinct({ins.op, ins.arg, 0.0, args, NONE}));
+				}else {
+					st.push_back(apply(ins.op, args, NONE, ins.arg));
+				}
+			}else if (ins.op == OpCode::Store) {
+				temps.resize(std::max(temps.size(), ins.arg + 1), NONE);
+				temps[ins.arg] = st.back();
+			}else if (ins.op == OpCode::Temp) {
+				if (ins.arg >= temps.size() || temps[ins.arg] == NONE) {
+					return NONE;
+				}
+				st.push_back(temps[ins.arg]);
+			}else if (ins.op == OpCode::Const) {
+				st.push_back(constant(ins.val));
+			}else if (ins.op == OpCode::Load) {
+				st.push_back(load(ins.arg));
+			}else if (k == 2) {
+				size_t b = st.back();
+				st.pop_back();
+				st.back() = apply(ins.op, st.back(), b);
+			}else if (functions != nullptr && ins.op == OpCode::Call && varies((*functions)[ins.arg], 1)) {
+				st.back() = distinct({ins.op, ins.arg, 0.0, st.back(), NONE});
+			}else {
+				st.back() = apply(ins.op, st.back(), NONE, ins.arg);
+			}
+		}
+
+		return (st.size() == 1) ? st[0] : NONE;
+	}
+
+	/**
+	* @brief Identifica una función predefinida de varios argumentos
+	* @param f Función
+	* @return Nombre de la función predefinida cuya implementación usa f, vacío si no es una de ellas
+	*/
+	static std::string_view builtinName(const CustomFunction & f) {
+		for (auto & b: BUILTIN_MULTI_FUNCTIONS) {
+			if (f.fnArgs != nullptr && f.fnArgs == b.fn) {
+				return b.name;
+			}
+		}
+		return std::string_view();
+	}
+
+	/**
+	* @brief Verifica si una llamada puede producir valores distintos con los mismos argumentos
+	*
+	* Las llamadas a funciones impuras y las llamadas sin argumentos se calculan en cada evaluación,
+	* igual que en CompiledExpression::eval(), y no se comparten ni se calculan al compilar.
+	* @param f Función
+	* @param args Cantidad de argumentos de la llamada
+	* @return Verdadero si la función no es pura o la llamada no tiene argumentos
+	*/
+	static bool varies(const CustomFunction & f, size_t args) {
+		return !f.pure || args == 0;
+	}
+
+	/**
+	* @brief Agrega la derivada simbólica de una subexpresión respecto a un valor de entrada
+	*
+	* Las derivadas de los operandos se calculan una sola vez y los términos con derivada cero
+	* se omiten. La derivada reutiliza los nodos de la subexpresión: por ejemplo, la de e^~x
+	* se construye a partir del mismo nodo e^~x. atan2 e hypot tienen sus derivadas exactas; las
+	* funciones personalizadas, que no tienen derivada conocida, se derivan como NAN. En los puntos
+	* sin derivada se usa una convención, la misma de Gradient: la derivada de abs(a) es la de a por
+	* el signo de a, 0 en a = 0; la de min, max y clamp es la del primer argumento igual al
+	* resultado, expresada con if(), y en a^b el término de a' es 0 si b = 0 y el de b' es 0 si
+	* a^b = 0. Las comparaciones y los operadores lógicos son constantes por
+	* partes, con derivada 0, y la derivada de if(c, a, b) es if(c, a', b').
+	* @param root Subexpresión a derivar
+	* @param input Posición del valor de entrada, NONE para derivar respecto a una constante
+	* @param functions Funciones referenciadas por los nodos CallN, para reconocer las predefinidas;
+	*        con nullptr, todas las funciones de varios argumentos se derivan como NAN
+	* @return Identificador de la derivada
+	*/
+	size_t derivative(size_t root, size_t input, const vector<CustomFunction> * functions = nullptr) {
+		//Marcar las subexpresiones de root; sus operandos tienen identificadores menores
+		vector<bool> used(root + 1, false);
+		used[root] = true;
+		for (size_t i = root + 1; i-- > 0;) {
+			if (used[i]) {
+				if (graph[i].a != NONE) {
+					used[graph[i].a] = true;
+				}
+				if (graph[i].b != NONE) {
+					used[graph[i].b] = true;
+				}
+			}
+		}
+
+		vector<size_t> d(root + 1, NONE);
+		for (size_t i = 0; i <= root; i++) {
+			if (used[i]) {
+				d[i] = derivativeOf(i, input, d, functions);
+			}
+		}
+
+		return d[root];
+	}
+
+	/**
+	* @brief Cuenta los argumentos de un nodo CallN
+	* @param nodes Nodos, con los operandos como posiciones en nodes
+	* @param id Posición del nodo CallN
+	* @return Cantidad de argumentos
+	*/
+	static size_t arguments(const Node * nodes, size_t id) {
+		size_t c = nodes[id].a;
+		if (c == NONE) {
+			return 0;
+		}
+		size_t n = 1;
+		for (; nodes[c].op == OpCode::Arg; c = nodes[c].a) {
+			n++;
+		}
+		return n;
+	}
+
+	/**
+	* @brief Evalúa un nodo CallN a partir de los valores de sus argumentos
+	*
+	* Reúne los valores en la pila del hilo si no exceden CompiledExpression::LOCAL_ARGS.
+	* @param f Función del nodo
+	* @param nodes Nodos, con los operandos como posiciones en nodes y en values
+	* @param id Posición del nodo CallN
+	* @param values Valores de los nodos
+	* @return Valor de la función
+	*/
+	static double call(const CustomFunction & f, const Node * nodes, size_t id, const double * values) {
+		size_t n = arguments(nodes, id);
+		double local[CompiledExpression::LOCAL_ARGS];
+		vector<double> heap;
+		double * x = local;
+		if (n > CompiledExpression::LOCAL_ARGS) {
+			heap.resize(n);
+			x = heap.data();
+		}
+
+		//La lista tiene el último argumento en el segundo operando de cada nodo Arg
+		size_t c = nodes[id].a;
+		for (size_t j = n; j > 1; j--, c = nodes[c].a) {
+			x[j - 1] = values[nodes[c].b];
+		}
+		if (n > 0) {
+			x[0] = values[c];
+		}
+		return f(x, n);
+	}
+
+	/**
+	* @brief Verifica si un nodo es una constante
+	* @param id Identificador del nodo
+	* @return Verdadero si el nodo es una constante
+	*/
+	bool isConstant(size_t id) const {
+		return graph[id].op == OpCode::Const;
+	}
+
+	/**
+	* @brief Verifica si un nodo es una constante con un valor dado
+	* @param id Identificador del nodo
+	* @param val Valor
+	* @return Verdadero si el nodo es la constante val (0 y -0 se consideran iguales)
+	*/
+	bool isConstant(size_t id, double val) const {
+		return graph[id].op == OpCode::Const && graph[id].val == val;
+	}
+
+private:
+	/**
+	* @brief Calcula la derivada de un nodo a partir de las derivadas de sus operandos
+	* @param id Identificador del nodo
+	* @param input Posición del valor de entrada
+	* @param d Derivadas de los nodos anteriores
+	* @param functions Funciones referenciadas por los nodos CallN, o nullptr
+	* @return Identificador de la derivada
+	*/
+	size_t derivativeOf(size_t id, size_t input, const vector<size_t> & d, const vector<CustomFunction> * functions) {
+		Node n = graph[id];
+		size_t da = (n.a != NONE) ? d[n.a] : NONE;
+		size_t db = (n.b != NONE) ? d[n.b] : NONE;
+
+		switch (n.op) {
+			case OpCode::Const:
+				return constant(0.0);
+			case OpCode::Load:
+				return constant((n.arg == input) ? 1.0 : 0.0);
+			case OpCode::Add:
+				return sum(da, db);
+			case OpCode::Sub:
+				return difference(da, db);
+			case OpCode::Mul:
+				return sum(product(da, n.b), product(n.a, db));
+			case OpCode::Div:
+				//(a/b)' = (a' - (a/b)*b') / b
+				return quotient(difference(da, product(id, db)), n.b);
+			case OpCode::Pow: {
+				//b*a^(b-1)*a' + a^b*ln(a)*b', con el primer término 0 si b = 0 y el segundo 0 si a^b = 0
+				size_t r = constant(0.0);
+				if (!isConstant(da, 0.0)) {
+					size_t pa = product(n.b, power(n.a, apply(OpCode::Sub, n.b, constant(1.0))));
+					if (!isConstant(n.b)) {
+						pa = select(apply(OpCode::Eq, n.b, constant(0.0)), constant(0.0), pa);
+					}
+					r = product(pa, da);
+				}
+				if (!isConstant(db, 0.0)) {
+					size_t pb = product(id, apply(OpCode::Ln, n.a));
+					if (!isConstant(n.a) || !(graph[n.a].val > 0.0 && std::isfinite(graph[n.a].val))) {
+						pb = select(apply(OpCode::Eq, id, constant(0.0)), constant(0.0), pb);
+					}
+					r = sum(r, product(pb, db));
+				}
+				return r;
+			}
+			case OpCode::Neg:
+				return negate(da);
+			case OpCode::Sqrt:
+				return quotient(da, product(constant(2.0), id));
+			case OpCode::Sin:
+				return product(apply(OpCode::Cos, n.a), da);
+			case OpCode::Cos:
+				return negate(product(apply(OpCode::Sin, n.a), da));
+			case OpCode::Tan:
+				return product(sum(constant(1.0), product(id, id)), da);
+			case OpCode::Ln:
+				return quotient(da, n.a);
+			case OpCode::Log:
+				return quotient(da, product(n.a, constant(M_LN10)));
+			case OpCode::Exp:
+				return product(id, da);
+			case OpCode::Abs:
+				//Signo de a, 0 en a = 0
+				return product(difference(apply(OpCode::Gt, n.a, constant(0.0)), apply(OpCode::Lt, n.a, constant(0.0))), da);
+			case OpCode::Arg:
+				//Derivada cero solo si todos los argumentos tienen derivada cero
+				return (isConstant(da, 0.0) && isConstant(db, 0.0)) ? constant(0.0) : constant(NAN);
+			case OpCode::Lt:
+			case OpCode::Le:
+			case OpCode::Gt:
+			case OpCode::Ge:
+			case OpCode::Eq:
+			case OpCode::Ne:
+			case OpCode::And:
+			case OpCode::Or:
+			case OpCode::Not:
+				return constant(0.0);
+			case OpCode::Select: {
+				size_t c = graph[graph[n.a].a].a;
+				size_t dx = d[graph[graph[n.a].a].b];
+				size_t dy = d[graph[n.a].b];
+				return select(c, dx, dy);
+			}
+			case OpCode::CallN:
+				if (functions != nullptr && n.arg < functions->size()) {
+					size_t r = builtinDerivative(id, (*functions)[n.arg], d);
+					if (r != NONE) {
+						return r;
+					}
+				}
+				return (da == NONE || isConstant(da, 0.0)) ? constant(0.0) : constant(NAN);
+			default:
+				return (da == NONE || isConstant(da, 0.0)) ? constant(0.0) : constant(NAN);
+		}
+	}
+
+	/**
+	* @brief Calcula la derivada de una llamada a atan2, hypot, min, max o clamp
+	* @param id Identificador del nodo CallN
+	* @param f Función del nodo
+	* @param d Derivadas de los nodos anteriores
+	* @return Identificador de la derivada, NONE si la función no es una de las predefinidas
+	*/
+	size_t builtinDerivative(size_t id, const CustomFunction & f, const vector<size_t> & d) {
+		std::string_view name = builtinName(f);
+
+		//Argumentos, del primero al último
+		vector<size_t> x(arguments(graph.data(), id));
+		size_t c = graph[id].a;
+		for (size_t j = x.size(); j > 1; j--, c = graph[c].a) {
+			x[j - 1] = graph[c].b;
+		}
+		if (!x.empty()) {
+			x[0] = c;
+		}
+
+		if (name == "atan2" && x.size() == 2) {
+			//(x*y' - y*x') / (x^2 + y^2), con atan2(y, x)
+			return quotient(difference(product(x[1], d[x[0]]), product(x[0], d[x[1]])),
+					sum(product(x[1], x[1]), product(x[0], x[0])));
+		}
+		if (name == "hypot" && x.size() == 2) {
+			return quotient(sum(product(x[0], d[x[0]]), product(x[1], d[x[1]])), id);
+		}
+		if (name == "min" || name == "max" || name == "clamp") {
+			//Derivada del primer argumento igual al resultado; los argumentos NAN nunca lo son
+			if (x.empty()) {
+				return constant(0.0);
+			}
+			size_t r = d[x.back()];
+			for (size_t j = x.size() - 1; j-- > 0;) {
+				r = select(apply(OpCode::Eq, id, x[j]), d[x[j]], r);
+			}
+			return r;
+		}
+		return NONE;
+	}
+
+	/** a + b, omitiendo los términos cero */
+	size_t sum(size_t a, size_t b) {
+		if (isConstant(a, 0.0)) {
+			return b;
+		}
+		if (isConstant(b, 0.0)) {
+			return a;
+		}
+		return apply(OpCode::Add, a, b);
+	}
+
+	/** a - b, omitiendo los términos cero */
+	size_t difference(size_t a, size_t b) {
+		if (isConstant(b, 0.0)) {
+			return a;
+		}
+		if (isConstant(a, 0.0)) {
+			return negate(b);
+		}
+		return apply(OpCode::Sub, a, b);
+	}
+
+	/** a * b, con 0 * b = 0, 1 * b = b y -1 * b = ~b */
+	size_t product(size_t a, size_t b) {
+		if (isConstant(a, 0.0) || isConstant(b, 0.0)) {
+			return constant(0.0);
+		}
+		if (isConstant(a, 1.0)) {
+			return b;
+		}
+		if (isConstant(b, 1.0)) {
+			return a;
+		}
+		if (isConstant(a, -1.0)) {
+			return negate(b);
+		}
+		if (isConstant(b, -1.0)) {
+			return negate(a);
+		}
+		return apply(OpCode::Mul, a, b);
+	}
+
+	/** a / b, con 0 / b = 0 y a / 1 = a */
+	size_t quotient(size_t a, size_t b) {
+		if (isConstant(a, 0.0)) {
+			return constant(0.0);
+		}
+		if (isConstant(b, 1.0)) {
+			return a;
+		}
+		return apply(OpCode::Div, a, b);
+	}
+
+	/** a ^ b, con a^1 = a */
+	size_t power(size_t a, size_t b) {
+		if (isConstant(b, 1.0)) {
+			return a;
+		}
+		return apply(OpCode::Pow, a, b);
+	}
+
+	/** if(c, a, b), con la lista de sus operandos */
+	size_t select(size_t c, size_t a, size_t b) {
+		return apply(OpCode::Select, apply(OpCode::Arg, apply(OpCode::Arg, c, a), b));
+	}
+
+	/** ~a, con ~~a = a */
+	size_t negate(size_t a) {
+		if (graph[a].op == OpCode::Neg) {
+			return graph[a].a;
+		}
+		return apply(OpCode::Neg, a);
+	}
+
+	/**
+	* @brief Agrega un nodo que no se comparte con los nodos iguales
+	* @param n Nodo
+	* @return Identificador del nodo
+	*/
+	size_t distinct(const Node & n) {
+		graph.push_back(n);
+		return graph.size() - 1;
+	}
+
+	/**
+	* @brief Agrega un nodo, o retorna el nodo igual si ya existe
+	* @param n Nodo
+	* @return Identificador del nodo
+	*/
+	size_t add(const Node & n) {
+		//Las constantes se comparan por su representación, para distinguir 0 de -0
+		Key key = {n.op, n.arg, 0, n.a, n.b};
+		std::memcpy(&key.bits, &n.val, sizeof key.bits);
+
+		auto it = index.emplace(key, graph.size());
+		if (it.second) {
+			graph.push_back(n);
+		}
+		return it.first->second;
+	}
+
+	/**
+	* @brief Contenido de un nodo, con la constante como su representación binaria
+	*/
+	struct Key {
+		OpCode op; /*!< Código de operación */
+		size_t arg; /*!< Argumento */
+		uint64_t bits; /*!< Representación de la constante */
+		size_t a; /*!< Primer operando */
+		size_t b; /*!< Segundo operando */
+
+		bool operator==(const Key & k) const {
+			return op == k.op && arg == k.arg && bits == k.bits && a == k.a && b == k.b;
+		}
+	};
+
+	/**
+	* @brief Función de dispersión del contenido de un nodo
+	*/
+	struct KeyHash {
+		size_t operator()(const Key & k) const {
+			size_t h = (size_t) k.op;
+			for (size_t v: {k.arg, (size_t) k.bits, k.a, k.b}) {
+				h = (h ^ v) * 0x100000001B3ull;
+			}
+			return h ^ (h >> 29);
+		}
+	};
+
+	std::pmr::vector<Node> graph; /*!< Nodos del grafo */
+	std::pmr::unordered_map<Key, size_t, KeyHash> index; /*!< Identificador de cada nodo, por su contenido */
+};
+
+/**
+* @brief Programa que calcula varios resultados en una sola pasada
+*
+* Se construye a partir de un grafo de subexpresiones: cada subexpresión común a varios
+* resultados se calcula una sola vez, en un registro propio. Igual que CompiledExpression,
+* es inmutable y se puede compartir entre hilos.
+*/
+class FusedExpression {
+public:
+	/** Cantidad máxima de registros que eval(const double *, double *) reserva en la pila del hilo */
+	static const size_t LOCAL_REGISTERS = 256;
+
+	/**
+	* @brief Crea un programa que calcula los resultados dados
+	* @param graph Grafo de subexpresiones
+	* @param roots Nodo de cada resultado; NONE para un resultado indefinido (NAN)
+	* @param funcs Funciones referenciadas por los nodos Call
+	* @param names Nombres de los valores de entrada referenciados por los nodos Load
+	*/
+	FusedExpression(const ExpressionGraph & graph, const vector<size_t> & roots, vector<CustomFunction> funcs,
+			vector<string> names): functions(std::move(funcs)), names(std::move(names)) {
+		const std::pmr::vector<ExpressionGraph::Node> & nodes = graph.nodes();
+		vector<size_t> reg(nodes.size(), ExpressionGraph::NONE);
+
+		//Marcar las subexpresiones de los resultados
+		for (size_t r: roots) {
+			if (r != ExpressionGraph::NONE) {
+				reg[r] = 0;
+			}
+		}
+		for (size_t i = nodes.size(); i-- > 0;) {
+			if (reg[i] != ExpressionGraph::NONE) {
+				if (nodes[i].a != ExpressionGraph::NONE) {
+					reg[nodes[i].a] = 0;
+				}
+				if (nodes[i].b != ExpressionGraph::NONE) {
+					reg[nodes[i].b] = 0;
+				}
+			}
+		}
+
+		//Un registro por subexpresión, en orden: los operandos se calculan primero
+		for (size_t i = 0; i < nodes.size(); i++) {
+			if (reg[i] == ExpressionGraph::NONE) {
+				continue;
+			}
+			ExpressionGraph::Node n = nodes[i];
+			n.a = (n.a != ExpressionGraph::NONE) ? reg[n.a] : ExpressionGraph::NONE;
+			n.b = (n.b != ExpressionGraph::NONE) ? reg[n.b] : ExpressionGraph::NONE;
+			reg[i] = code.size();
+			code.push_back(n);
+		}
+
+		for (size_t r: roots) {
+			results.push_back((r != ExpressionGraph::NONE) ? reg[r] : ExpressionGraph::NONE);
+		}
+
+		assignBlocks();
+	}
+
+	/**
+	* @brief Retorna la cantidad de resultados
+	* @return Cantidad de resultados que calcula eval()
+	*/
+	size_t outputs() const {
+		return results.size();
+	}
+
+	/**
+	* @brief Retorna la cantidad de valores de entrada
+	* @return Cantidad de valores de entrada
+	*/
+	size_t inputs() const {
+		return names.size();
+	}
+
+	/**
+	* @brief Retorna los nombres de los valores de entrada
+	* @return Nombres de los valores de entrada, en orden
+	*/
+	const vector<string> & variables() const {
+		return names;
+	}
+
+	/**
+	* @brief Retorna las instrucciones del programa
+	*
+	* Los operandos de cada instrucción son las posiciones de las instrucciones que los calculan,
+	* NONE si no los tiene.
+	* @return Instrucciones, una por subexpresión distinta
+	*/
+	const vector<ExpressionGraph::Node> & instructions() const {
+		return code;
+	}
+
+	/**
+	* @brief Evalúa el programa sobre registros reservados en la pila del hilo
+	*
+	* No reserva memoria si instructions().size() no excede LOCAL_REGISTERS.
+	* @param values Valores de entrada
+	* @param out Arreglo de salida, con capacidad para outputs() valores
+	*/
+	void eval(const double * values, double * out) const {
+		if (code.size() <= LOCAL_REGISTERS) {
+			double regs[LOCAL_REGISTERS];
+			eval(values, out, regs);
+			return;
+		}
+		vector<double> regs(code.size());
+		eval(values, out, regs.data());
+	}
+
+	/**
+	* @brief Evalúa el programa
+	* @param values Valores de entrada
+	* @param out Arreglo de salida, con capacidad para outputs() valores
+	* @param regs Registros, con capacidad para instructions().size() valores
+	*/
+	void eval(const double * values, double * out, double * regs) const {
+		for (size_t i = 0; i < code.size(); i++) {
+			const ExpressionGraph::Node & ins = code[i];
+			switch (ins.op) {
+				case OpCode::Const:
+					regs[i] = ins.val;
+					break;
+				case OpCode::Load:
+					regs[i] = values[ins.arg];
+					break;
+				case OpCode::Call:
+					regs[i] = functions[ins.arg](regs[ins.a]);
+					break;
+				case OpCode::CallN:
+					regs[i] = ExpressionGraph::call(functions[ins.arg], code.data(), i, regs);
+					break;
+				case OpCode::Select: {
+					const ExpressionGraph::Node & list = code[ins.a];
+					regs[i] = vmath::select(regs[code[list.a].a] != 0.0, regs[code[list.a].b], regs[list.b]);
+					break;
+				}
+				case OpCode::Arg:
+					//Los argumentos se leen de sus propios registros
+					break;
+				case OpCode::Add:
+				case OpCode::Sub:
+				case OpCode::Mul:
+				case OpCode::Div:
+				case OpCode::Pow:
+				case OpCode::Lt:
+				case OpCode::Le:
+				case OpCode::Gt:
+				case OpCode::Ge:
+				case OpCode::Eq:
+				case OpCode::Ne:
+				case OpCode::And:
+				case OpCode::Or:
+					regs[i] = CompiledExpression::calculate(regs[ins.a], regs[ins.b], ins.op);
+					break;
+				default:
+					regs[i] = CompiledExpression::calculateUnary(regs[ins.a], ins.op);
+					break;
+			}
+		}
+
+		for (size_t j = 0; j < results.size(); j++) {
+			out[j] = (results[j] != ExpressionGraph::NONE) ? regs[results[j]] : NAN;
+		}
+	}
+
+	/**
+	* @brief Retorna la cantidad de valores que requiere la evaluación por lotes
+	* @return Tamaño del arreglo scratch de evalRange()
+	*/
+	size_t scratchSize() const {
+		return blocks * CompiledExpression::BATCH_SIZE;
+	}
+
+	/**
+	* @brief Retorna la cantidad de registros que requiere la evaluación por lotes
+	* @return Tamaño del arreglo regs de evalRange()
+	*/
+	size_t registers() const {
+		return code.size() + args;
+	}
+
+	/**
+	* @brief Evalúa el programa sobre columnas de valores
+	*
+	* Equivale a evaluar la fila i con eval() y escribir el resultado j en outs[j][i]. Todos los
+	* resultados se calculan por bloques de CompiledExpression::BATCH_SIZE filas, de modo que cada
+	* bloque de entrada se lee una sola vez mientras permanece en caché. Los bloques intermedios se
+	* reutilizan cuando su subexpresión deja de usarse.
+	* @param columns Una columna de n valores por cada valor de entrada
+	* @param outs Una columna de salida de n valores por cada resultado
+	* @param n Cantidad de filas a evaluar
+	*/
+	void evalBatch(const double * const * columns, double * const * outs, size_t n) const {
+		vector<double> scratch(scratchSize());
+		vector<CompiledExpression::BatchValue> regs(registers());
+
+		evalRange(columns, outs, 0, n, scratch.data(), regs.data());
+	}
+
+	/**
+	* @brief Evalúa el programa sobre columnas de valores, repartiendo el trabajo entre hilos
+	* @param columns Una columna de n valores por cada valor de entrada
+	* @param outs Una columna de salida de n valores por cada resultado
+	* @param n Cantidad de filas a evaluar
+	* @param pool Conjunto de hilos que ejecuta las tareas
+	*/
+	void evalParallel(const double * const * columns, double * const * outs, size_t n, ThreadPool & pool) const {
+		vector<vector<double>> scratch(pool.size() + 1);
+		vector<vector<CompiledExpression::BatchValue>> regs(pool.size() + 1);
+		size_t tasks = (n + CompiledExpression::PARALLEL_CHUNK - 1) / CompiledExpression::PARALLEL_CHUNK;
+
+		pool.parallelFor(tasks, [&](size_t task, size_t worker) {
+			if (regs[worker].size() != registers()) {
+				scratch[worker].resize(scratchSize());
+				regs[worker].resize(registers());
+			}
+			size_t begin = task * CompiledExpression::PARALLEL_CHUNK;
+			size_t end = std::min(n, begin + CompiledExpression::PARALLEL_CHUNK);
+			evalRange(columns, outs, begin, end, scratch[worker].data(), regs[worker].data());
+		});
+	}
+
+	/**
+	* @brief Evalúa el programa sobre un rango de filas de las columnas de valores
+	* @param columns Columnas de valores de entrada
+	* @param outs Columnas de salida, indexadas igual que las de entrada
+	* @param begin Primera fila a evaluar
+	* @param end Fila siguiente a la última a evaluar
+	* @param scratch Bloques intermedios, con capacidad para scratchSize() valores
+	* @param regs Registros, con capacidad para registers() elementos
+	*/
+	void evalRange(const double * const * columns, double * const * outs, size_t begin, size_t end,
+			double * scratch, CompiledExpression::BatchValue * regs) const {
+		const size_t B = CompiledExpression::BATCH_SIZE;
+		for (size_t base = begin; base < end; base += B) {
+			size_t len = std::min(B, end - base);
+			evalBlock(columns, base, len, scratch, regs);
+			for (size_t j = 0; j < results.size(); j++) {
+				double * y = outs[j] + base;
+				if (results[j] == ExpressionGraph::NONE) {
+					std::fill(y, y + len, NAN);
+				}else if (regs[results[j]].col == nullptr) {
+					std::fill(y, y + len, regs[results[j]].val);
+				}else {
+					std::copy(regs[results[j]].col, regs[results[j]].col + len, y);
+				}
+			}
+		}
+	}
+
+private:
+	/**
+	* @brief Evalúa el programa sobre un bloque de filas
+	*
+	* Las constantes y las operaciones sobre constantes se mantienen como escalares; los valores
+	* de entrada se leen directamente de sus columnas.
+	* @param columns Columnas de valores de entrada
+	* @param base Posición del bloque dentro de las columnas
+	* @param len Cantidad de filas del bloque
+	* @param scratch Bloques intermedios
+	* @param regs Registros
+	*/
+	void evalBlock(const double * const * columns, size_t base, size_t len, double * scratch,
+			CompiledExpression::BatchValue * regs) const {
+		const size_t B = CompiledExpression::BATCH_SIZE;
+		//Los últimos bloques expanden los operandos escalares y reúnen los argumentos de CallN
+		double * expand = scratch + (blocks - 1 - args) * B;
+
+		for (size_t i = 0; i < code.size(); i++) {
+			const ExpressionGraph::Node & ins = code[i];
+			double * y = (slots[i] != ExpressionGraph::NONE) ? scratch + slots[i] * B : nullptr;
+			CompiledExpression::BatchValue & v = regs[i];
+			switch (ins.op) {
+				case OpCode::Const:
+					v = {nullptr, ins.val};
+					break;
+				case OpCode::Load:
+					v = {columns[ins.arg] + base, 0.0};
+					break;
+				case OpCode::Arg:
+					break;
+				case OpCode::Call: {
+					const CustomFunction & f = functions[ins.arg];
+					v = regs[ins.a];
+					if (v.col == nullptr && f.pure) {
+						v.val = f(v.val);
+					}else if (v.col == nullptr) {
+						for (size_t k = 0; k < len; k++) {
+							y[k] = f(v.val);
+						}
+						v.col = y;
+					}else if (f.batch != nullptr) {
+						f.batch(v.col, y, len);
+						v.col = y;
+					}else {
+						for (size_t k = 0; k < len; k++) {
+							y[k] = f(v.col[k]);
+						}
+						v.col = y;
+					}
+					break;
+				}
+				case OpCode::CallN:
+				case OpCode::Select: {
+					size_t n = ExpressionGraph::arguments(code.data(), i);
+					//Argumentos en registros consecutivos, después de los de las instrucciones
+					CompiledExpression::BatchValue * list = regs + code.size();
+					size_t c = ins.a;
+					for (size_t j = n; j > 1; j--, c = code[c].a) {
+						list[j - 1] = regs[code[c].b];
+					}
+					if (n > 0) {
+						list[0] = regs[c];
+					}
+					if (ins.op == OpCode::Select) {
+						CompiledExpression::selectBatch(list, expand + B, len);
+					}else {
+						CompiledExpression::callBatch(functions[ins.arg], list, n, expand + B, len);
+					}
+					v = list[0];
+					if (v.col != nullptr) {
+						std::copy(v.col, v.col + len, y);
+						v.col = y;
+					}
+					break;
+				}
+				case OpCode::Add:
+				case OpCode::Sub:
+				case OpCode::Mul:
+				case OpCode::Div:
+				case OpCode::Pow:
+				case OpCode::Lt:
+				case OpCode::Le:
+				case OpCode::Gt:
+				case OpCode::Ge:
+				case OpCode::Eq:
+				case OpCode::Ne:
+				case OpCode::And:
+				case OpCode::Or: {
+					CompiledExpression::BatchValue b = regs[ins.b];
+					v = regs[ins.a];
+					CompiledExpression::calculateBatch(v, b, ins.op, y, expand, len);
+					break;
+				}
+				default:
+					v = regs[ins.a];
+					if (v.col == nullptr) {
+						v.val = CompiledExpression::calculateUnary(v.val, ins.op);
+					}else {
+						CompiledExpression::calculateUnaryBatch(v.col, y, ins.op, len);
+						v.col = y;
+					}
+					break;
+			}
+		}
+	}
+
+	/**
+	* @brief Asigna un bloque intermedio a cada instrucción que calcula una columna
+	*
+	* Un bloque se libera después de la última instrucción que usa su valor; los argumentos de
+	* CallN y Select se usan en ese nodo, no en los nodos Arg que los enlazan. Los bloques de los
+	* resultados no se liberan.
+	*/
+	void assignBlocks() {
+		const size_t NONE = ExpressionGraph::NONE;
+		vector<size_t> last(code.size(), 0);
+		args = 0;
+
+		for (size_t i = 0; i < code.size(); i++) {
+			const ExpressionGraph::Node & ins = code[i];
+			if (ins.op == OpCode::CallN || ins.op == OpCode::Select) {
+				size_t n = ExpressionGraph::arguments(code.data(), i);
+				size_t c = ins.a;
+				for (size_t j = n; j > 1; j--, c = code[c].a) {
+					last[code[c].b] = i;
+				}
+				if (n > 0) {
+					last[c] = i;
+				}
+				//El resultado se escribe en el bloque del primer argumento, aunque no haya argumentos
+				args = std::max(args, std::max(n, size_t(1)));
+			}else if (ins.op != OpCode::Arg) {
+				for (size_t c: {ins.a, ins.b}) {
+					if (c != NONE) {
+						last[c] = i;
+					}
+				}
+			}
+		}
+		for (size_t r: results) {
+			if (r != NONE) {
+				last[r] = NONE;
+			}
+		}
+
+		vector<size_t> free;
+		blocks = 0;
+		slots.assign(code.size(), NONE);
+		for (size_t i = 0; i < code.size(); i++) {
+			OpCode op = code[i].op;
+			if (op != OpCode::Const && op != OpCode::Load && op != OpCode::Arg) {
+				if (free.empty()) {
+					slots[i] = blocks++;
+				}else {
+					slots[i] = free.back();
+					free.pop_back();
+				}
+			}
+			//Liberar los bloques de los operandos cuyo último uso es esta instrucción
+			const ExpressionGraph::Node & ins = code[i];
+			if (op == OpCode::Arg) {
+				continue;
+			}
+			size_t c = ins.a;
+			if (op == OpCode::CallN || op == OpCode::Select) {
+				size_t n = ExpressionGraph::arguments(code.data(), i);
+				for (size_t j = n; j > 1; j--, c = code[c].a) {
+					release(code[c].b, i, last, free);
+				}
+				if (n > 0) {
+					release(c, i, last, free);
+				}
+				continue;
+			}
+			if (c != NONE) {
+				release(c, i, last, free);
+			}
+			if (ins.b != NONE) {
+				release(ins.b, i, last, free);
+			}
+		}
+		//Bloque de expansión de los operandos escalares y bloques de los argumentos de CallN y Select
+		blocks += 1 + args;
+	}
+
+	/**
+	* @brief Libera el bloque de un operando si la instrucción actual es su último uso
+	* @param c Operando
+	* @param i Instrucción actual
+	* @param last Último uso de cada instrucción; se marca como NONE al liberar el bloque
+	* @param free Bloques libres
+	*/
+	void release(size_t c, size_t i, vector<size_t> & last, vector<size_t> & free) const {
+		if (last[c] != i) {
+			return;
+		}
+		//Un operando repetido en la misma instrucción se libera una sola vez
+		last[c] = ExpressionGraph::NONE;
+		if (slots[c] != ExpressionGraph::NONE) {
+			free.push_back(slots[c]);
+		}
+	}
+
+	vector<ExpressionGraph::Node> code; /*!< Instrucciones, con los operandos como posiciones de registros */
+	vector<size_t> results; /*!< Registro de cada resultado, NONE si está indefinido */
+	vector<size_t> slots; /*!< Bloque intermedio de cada instrucción en la evaluación por lotes, NONE si no tiene */
+	size_t blocks; /*!< Cantidad de bloques intermedios */
+	size_t args; /*!< Cantidad máxima de argumentos de las instrucciones CallN y Select, al menos 1 si las hay */
+	vector<CustomFunction> functions; /*!< Funciones referenciadas por el programa */
+	vector<string> names; /*!< Nombres de los valores de entrada */
+};
+
+/**
+* @brief Expresión aritmética de una variable
+*/
+class expression {
+public:
+	/**
+	* @brief Crea una expresión a partir de una cadena de caracteres
+	* @param exprText Texto de la expresión en notación infija
+	*/
+	expression(string exprText):
+		expression(exprText, defaultFunctionTable(), Optimization::Strict, std::pmr::get_default_resource()) {
+	}
+
+	/**
+	* @brief Crea una expresión a partir de una cadena de caracteres con un nivel de optimización
+	* @param exprText Texto de la expresión en notación infija
+	* @param opt Nivel de optimización del programa compilado
+	*/
+	expression(string exprText, Optimization opt):
+		expression(exprText, defaultFunctionTable(), opt, std::pmr::get_default_resource()) {
+	}
+
+	/**
+	* @brief Crea una expresión a partir de una cadena de caracteres y un conjunto de funciones personalizadas
+	* @param exprText Texto de la expresión en notación infija
+	* @param funcs Vector de funciones personalizadas
+	* @param opt Nivel de optimización del programa compilado
+	*/
+	expression(string exprText, vector<CustomFunction> funcs, Optimization opt = Optimization::Strict):
+		expression(exprText, std::make_shared<const vector<CustomFunction>>(std::move(funcs)), opt,
+				std::pmr::get_default_resource()) {
+	}
+
+	/**
+	* @brief Crea una expresión con las funciones predeterminadas, reservando su memoria en un recurso de memoria
+	* @param exprText Texto de la expresión en notación infija
+	* @param memory Recurso de memoria (ver el constructor con tabla de funciones)
+	* @param opt Nivel de optimización del programa compilado
+	*/
+	expression(std::string_view exprText, std::pmr::memory_resource * memory, Optimization opt = Optimization::Strict):
+		expression(exprText, defaultFunctionTable(), opt, memory) {
+	}
+
+	/**
+	* @brief Crea una expresión que comparte una tabla de funciones, reservando su memoria en un recurso de memoria
+	*
+	* El texto, los elementos, los programas compilados y las estructuras temporales de la
+	* compilación se reservan en memory. Con un std::pmr::monotonic_buffer_resource, la memoria
+	* de una expresión, o de un lote de expresiones que comparten el recurso, ocupa bloques
+	* contiguos sin fragmentar el montículo, y se libera de una sola vez con release(). El recurso
+	* debe existir mientras existan la expresión, sus copias y los programas obtenidos con compiled().
+	* La excepción son los nombres de las variables y de las funciones, que se guardan como
+	* std::string: los vectores y tablas que los contienen se reservan en memory, pero un nombre
+	* más largo que el búfer interno de std::string (15 caracteres en libstdc++, 22 en libc++) se
+	* reserva con operator new.
+	* @param exprText Texto de la expresión en notación infija
+	* @param funcs Tabla de funciones, compartida sin copiarla (ver defaultFunctionTable())
+	* @param opt Nivel de optimización del programa compilado
+	* @param memory Recurso de memoria
+	*/
+	expression(std::string_view exprText, std::shared_ptr<const vector<CustomFunction>> funcs, Optimization opt,
+			std::pmr::memory_resource * memory):
+		memory(memory), text(exprText, memory), functions(std::move(funcs)), functionIndex(memory),
+		tokens(memory), tokensStr(memory), rpn(memory), rpnStr(memory), optimization(opt),
+		program(memory), slots(memory), evalStack(memory) {
+		balanced = false;
+#ifdef EXPRESSION_PROFILE
+		ExpressionProfile::Clock::time_point start = ExpressionProfile::Clock::now();
+		vector<string> names;
+		for (auto & f: *functions) {
+			names.push_back(f.name);
+		}
+		counters = std::make_shared<ExpressionProfile>(std::move(names));
+#endif
+
+		//Separate into tokens
+		if (checkParenthesis()) {
+			tokens = lex(text, memory);
+		}
+
+		//Create RPN expression
+		rpn = getRPN(tokens, text);
+
+		//Save string of the original expression
+		for (auto & t: tokens) {
+			tokensStr.append(text, t.offset, t.length);
+			tokensStr.push_back(' ');
+		}
+
+		//Save string of the RPN expression
+		for (auto & t: rpn) {
+			rpnStr += tokenString(t, text);
+			rpnStr.push_back(' ');
+		}
+#ifdef EXPRESSION_PROFILE
+		counters->parsed(ExpressionProfile::since(start));
+#endif
+
+		//Lower the RPN expression into the compiled program
+		compile();
+	}
+
+	/**
+	* @brief Funciones predeterminadas
+	* @return Arreglo de funciones predeterminadas
+	*/
+	static vector<CustomFunction> defaultFunctions() {
+		vector<CustomFunction> funcs;
+		for (auto & b: BUILTIN_FUNCTIONS) {
+			CustomFunction func = CustomFunction::pointer(b.name, b.fn, b.batch);
+			func.op = b.op;
+			func.pure = true;
+			funcs.push_back(std::move(func));
+		}
+		for (auto & b: BUILTIN_MULTI_FUNCTIONS) {
+			CustomFunction func = CustomFunction::pointer(b.name, b.args, b.fn, b.batch);
+			func.op = b.op;
+			func.pure = true;
+			funcs.push_back(std::move(func));
+		}
+		return funcs;
+	}
+
+	/**
+	* @brief Tabla compartida de funciones predeterminadas
+	*
+	* Se crea una sola vez; las expresiones creadas sin funciones personalizadas la comparten
+	* en lugar de copiar defaultFunctions().
+	* @return Tabla inmutable de funciones predeterminadas
+	*/
+	static const std::shared_ptr<const vector<CustomFunction>> & defaultFunctionTable() {
+		static const std::shared_ptr<const vector<CustomFunction>> table =
+				std::make_shared<const vector<CustomFunction>>(defaultFunctions());
+		return table;
+	}
+
+	/**
+	* @brief Variables predeterminadas
+	* @return Vector de variables predeterminadas
+	*/
+	static vector<Variable> defaultVariables() {
+		return {
+			{"pi", 3.14159265358979323846},
+			{"e",  2.71828182845904523536}
+		};
+	}
+
+	/**
+	* @brief Retorna el valor predeterminado de una variable
+	* @param name Nombre de la variable
+	* @return Valor de la variable en defaultVariables(), NAN si no está definida
+	*/
+	static double defaultValue(const string & name) {
+		static const vector<Variable> defaults = defaultVariables();
+		auto def = std::find_if(defaults.begin(), defaults.end(), [&name](const Variable & v) { return v.name == name; });
+		return (def != defaults.end()) ? def->val : NAN;
+	}
+
+	/**
+	* @brief Verifica si la expresión estó bien balanceada
+	* @return verdadero si los paróntesis estón balanceados, falso en caso contrario
+	*/
+	bool checkParenthesis() {
+		int cnt = 0;
+
+		size_t pos = 0;
+
+		while (pos < text.length() && cnt >= 0) {
+			if (text[pos] == '(') {
+				cnt ++;
+			}
+			else if (text[pos] == ')') {
+				cnt--;
+			}
+			pos++;
+		}
+
+		balanced = (cnt == 0);
+
+		return balanced;
+	}
+
+	/**
+	* @brief Retorna la condición de balance de paróntesis
+	* @return Verdadero si los paróntesis estón balanceados
+	*/
+	bool isBalanced() {
+		return balanced;
+	}
+
+	/**
+	* @brief Verifica si una cadena es un operador aritmótico válido
+	* @param str Cadena a verificar
+	* @return Verdadero si la cadena es un operador aritmótico válido
+	*/
+	bool isOperator(string str) {
+		return (
+				str == "+"
+				|| str == "-"
+				|| str == "*"
+				|| str == "/"
+				|| str == "^"
+				|| str == "~"
+				|| str == "<"
+				|| str == "<="
+				|| str == ">"
+				|| str == ">="
+				|| str == "=="
+				|| str == "!="
+				|| str == "&&"
+				|| str == "||"
+				|| str == "!"
+				);
+	}
+
+	/**
+	* @brief Verifica si un caracter forma parte de un operador
+	*
+	* Los caracteres de los operadores separan los elementos de la expresión; = & y | solo son
+	* válidos en los operadores de dos caracteres (ver operatorLength()).
+	* @param c Caracter a verificar
+	* @return Verdadero si el caracter forma parte de un operador
+	*/
+	static constexpr bool isOperator(char c) {
+		return (c == '+' || c == '-' || c == '*' || c == '/' || c == '^' || c == '~'
+				|| c == '<' || c == '>' || c == '=' || c == '!' || c == '&' || c == '|');
+	}
+
+	/**
+	* @brief Calcula la longitud del operador que inicia en una posición del texto
+	* @param src Texto
+	* @param pos Posición de un caracter para el cual isOperator() es verdadero
+	* @return 2 para <=, >=, ==, !=, && y ||, 1 para los demás
+	*/
+	static constexpr size_t operatorLength(std::string_view src, size_t pos) {
+		if (pos + 1 < src.size()) {
+			char c = src[pos];
+			char d = src[pos + 1];
+			if ((d == '=' && (c == '<' || c == '>' || c == '=' || c == '!')) || (d == c && (c == '&' || c == '|'))) {
+				return 2;
+			}
+		}
+		return 1;
+	}
+
+	/**
+	* @brief Verifica si una cadena es un nómero válido
+	* @param str Cadena a verificar
+	* @return Verdadero si la cadena representa un nómero válido
+	*/
+	bool isNumber(string str)
+	{
+		double val;
+		return parseNumber(str, val);
+	}
+
+	/**
+	* @brief Verifica la asociatividad a la izquierda de un operador
+	* @param str Operador
+	* @return Verdadero si el operador tiene asociatividad a la izquierda
+	*/
+	bool isLeftAssociative(string str) {
+		return isLeftAssociative(getOpCode(std::string_view(str)));
+	}
+
+	/**
+	* @brief Verifica la asociatividad a la izquierda de un operador
+	* @param op Operador
+	* @return Verdadero si el operador tiene asociatividad a la izquierda
+	*/
+	static constexpr bool isLeftAssociative(char op) {
+		return (op == '+' || op == '-' || op == '*' || op == '/' || op == '<' || op == '>');
+	}
+
+	/**
+	* @brief Verifica la asociatividad a la izquierda de un operador
+	* @param op Código de operación del operador
+	* @return Verdadero para los operadores binarios excepto la potencia
+	*/
+	static constexpr bool isLeftAssociative(OpCode op) {
+		return CompiledExpression::arity(op) == 2 && op != OpCode::Pow && op != OpCode::Arg;
+	}
+
+	/**
+	* @brief Verifica si un operador es binario
+	* @param str Operador
+	* @return Verdadero si el operador es binario, e.g. requiere dos operandos
+	*/
+	bool isBinaryOperator(string str) {
+		return (
+				str == "+"
+				|| str == "-"
+				|| str == "*"
+				|| str == "/"
+				|| str == "^"
+				|| str == "<"
+				|| str == "<="
+				|| str == ">"
+				|| str == ">="
+				|| str == "=="
+				|| str == "!="
+				|| str == "&&"
+				|| str == "||"
+				);
+	}
+
+	/**
+	* @brief Verifica si un operador es unario
+	* @param str Operador
+	* @return Verdadero si el operador es unario, e.g. requiere un operando
+	*/
+	bool isUnaryOperator(string str) {
+		return (str == "~" || str == "!");
+	}
+
+	/**
+	* @brief Verifica y obtiene un valor a partir de una cadena
+	* @param str Cadena a evaluar
+	* @param val Referencia a la variable que almacena el valor de salida
+	* @return Verdadero si se puede transformar el texto en un numero
+	*/
+	bool getNumber(string str, double & val) {
+		if (str.length() > 0 && str[0] == '~') {
+			str[0] = '-';
+		}
+		return parseNumber(str, val);
+	}
+
+	/**
+	* @brief Convierte una cadena completa en un valor real, sin depender de la configuración regional
+	* @param str Cadena a convertir
+	* @param val Referencia a la variable que almacena el valor de salida
+	* @return Verdadero si toda la cadena representa un número
+	*/
+	static bool parseNumber(std::string_view str, double & val) {
+#ifdef __cpp_lib_to_chars
+		const char * first = str.data();
+		const char * last = first + str.size();
+		auto res = std::from_chars(first, last, val);
+		if (res.ec == std::errc::result_out_of_range && res.ptr == last) {
+			//Desbordamiento: strtod retorna infinito o cero
+			val = strtod(string(str).c_str(), nullptr);
+			return true;
+		}
+		return res.ec == std::errc() && res.ptr == last;
+#else
+		string s(str);
+		char* p;
+		val = strtod(s.c_str(), &p);
+		return *p == 0;
+#endif
+	}
+
+	/**
+	* @brief Convierte un valor real a cadena
+	*
+	* Usa la representación más corta que al leerse de nuevo produce el mismo valor.
+	* @param val Valor a convertir
+	* @return Valor convertido a cadena de caracteres
+	*/
+	static string numberToString(double val) {
+#ifdef __cpp_lib_to_chars
+		char buf[32];
+		auto res = std::to_chars(buf, buf + sizeof buf, val);
+		return string(buf, res.ptr);
+#else
+		ostringstream oss;
+
+		oss << std::setprecision(17) << val;
+
+		return oss.str();
+#endif
+	}
+
+	/**
+	* @brief Retorna la representación en cadena de la expresión
+	* @return Representación en cadena de la expresión
+	*/
+	string str() {
+		return string(tokensStr);
+	}
+
+	/**
+	* @brief Retorna la representación en cadena de la expresión en RPN
+	* @return Representación en RPN (Reverse Polish Notation) de la expresión
+	*/
+	string rpnstr() {
+		return string(rpnStr);
+	}
+
+	/**
+	* @brief Retorna la representación en cadena del programa optimizado
+	*
+	* Igual que rpnstr(), con una instrucción por elemento. "=$i" guarda el tope de la pila en
+	* el temporal i, "$i" apila el temporal i, "f/n" invoca la función de varios argumentos f
+	* con n argumentos e "if" selecciona entre los dos valores anteriores según el que los precede.
+	* @return Representación del programa compilado, con las variables en el orden de variables()
+	*/
+	string programstr() {
+		string str;
+
+		for (auto & ins: compiledProgram->instructions()) {
+			switch (ins.op) {
+				case OpCode::Const:
+					str += numberToString(ins.val);
+					break;
+				case OpCode::Load:
+					str += slots[ins.arg];
+					break;
+				case OpCode::Call:
+					str += (*functions)[ins.arg].name;
+					break;
+				case OpCode::CallN:
+					str += (*functions)[ins.arg].name + "/" + std::to_string(ins.count);
+					break;
+				case OpCode::Store:
+					str += "=$" + std::to_string(ins.arg);
+					break;
+				case OpCode::Temp:
+					str += "$" + std::to_string(ins.arg);
+					break;
+				case OpCode::Select:
+					str += "if";
+					break;
+				default:
+					if (CompiledExpression::arity(ins.op) == 2 || ins.op == OpCode::Neg || ins.op == OpCode::Not) {
+						str += getOperator(ins.op);
+					}
+					for (auto & b: BUILTIN_FUNCTIONS) {
+						if (b.op == ins.op) {
+							str += b.name;
+						}
+					}
+					break;
+			}
+			str.push_back(' ');
+		}
+
+		return str;
+	}
+
+	/**
+	* @brief Calcula el resultado de una operación binaria
+	* @param a Primer operando
+	* @param b Segundo operando
+	* @param op Operando
+	* @return Resultado de la operación, NAN si no es válida
+	*/
+	double calculate(double a, double b, string op){
+		if (op == "+") {
+			return a + b;
+		}else if (op == "-") {
+			return a - b;
+		}else if (op == "*") {
+			return a * b;
+		}else if (op == "/") {
+			return a / b;
+		}else if (op == "^") {
+			return pow(a, b);
+		}
+		//Comparaciones y operadores lógicos, NAN si no es un operador binario
+		return CompiledExpression::calculate(a, b, getOpCode(std::string_view(op)));
+	}
+
+	/**
+	* @brief Calcula el resultado de una operación unaria
+	* @param x Valor al cual se aplica la operación
+    * @param op Operando
+	* @return Resultado de la operación, NAN si no es válida
+	*/
+	double calculateUnary(double x, string op) {
+		if (op == "~") {
+			return -1.0 * x;
+		}else if (op == "!") {
+			return CompiledExpression::calculateUnary(x, OpCode::Not);
+		}
+		return NAN;
+	}
+
+	/**
+	* @brief Calcula la precedencia de un operador
+	* @param op Operador
+	* @return Precedencia, ver precedence(OpCode); 0 si no es un operador
+	*/
+	int precedence(string op){
+		return precedence(getOpCode(std::string_view(op)));
+	}
+
+	/**
+	* @brief Calcula la precedencia de un operador de un caracter
+	* @param op Operador
+	* @return Precedencia, ver precedence(OpCode); 0 si no es un operador de un caracter
+	*/
+	static constexpr int precedence(char op) {
+		switch (op) {
+			case '<':
+			case '>':
+				return 4;
+			case '+':
+			case '-':
+				return 5;
+			case '*':
+			case '/':
+				return 6;
+			case '^':
+			case '~':
+			case '!':
+				return 7;
+			default:
+				return 0;
+		}
+	}
+
+	/**
+	* @brief Calcula la precedencia del operador de un código de operación
+	* @param op Código de operación
+	* @return Precedencia, de menor a mayor: 1 para ||, 2 para &&, 3 para == y !=, 4 para < <= > >=,
+	* 5 para suma y resta, 6 para producto y división, 7 para potencia y negación (~ y !);
+	* 0 si no es un operador
+	*/
+	static constexpr int precedence(OpCode op) {
+		switch (op) {
+			case OpCode::Or:
+				return 1;
+			case OpCode::And:
+				return 2;
+			case OpCode::Eq:
+			case OpCode::Ne:
+				return 3;
+			case OpCode::Lt:
+			case OpCode::Le:
+			case OpCode::Gt:
+			case OpCode::Ge:
+				return 4;
+			case OpCode::Add:
+			case OpCode::Sub:
+				return 5;
+			case OpCode::Mul:
+			case OpCode::Div:
+				return 6;
+			case OpCode::Pow:
+			case OpCode::Neg:
+			case OpCode::Not:
+				return 7;
+			default:
+				return 0;
+		}
+	}
+
+	/**
+	* @brief Calcula la precedencia de un elemento de la pila de operadores
+	* @param t Elemento
+	* @param src Texto al que hace referencia el elemento
+	* @return Precedencia del operador, 0 si el elemento no es un operador
+	*/
+	int precedence(const Token & t, std::string_view src) {
+		return (t.kind == TokenKind::Operator) ? precedence(getOpCode(src.substr(t.offset, t.length))) : 0;
+	}
+
+	/**
+	* @brief Determina si un nombre dado corresponde a una variable, obteniendo su valor
+	* @param name Nombre de la variable
+	* @param vars Arreglo de variables definidas
+	* @param val Referencia a la variable que almacena el valor obtenido
+	* @return Verdadero si el nombre corresponde a una variable, valor almacenado en val.
+	*/
+	bool isVariable(string name, vector<Variable> & vars, double & val) {
+		if (isOperator(name)) {
+			return false;
+		}
+		for (auto & v: vars) {
+			if (v.name == name) {
+				val = v.val;
+				return true;
+			}else if ("~" + v.name ==  name) {
+				val = -1.0 * v.val;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	* @brief Verifica si un nombre dado corresponde a una función
+	* @param name Nombre a verificar
+	* @param func Referencia a la función obtenida, si existe
+	* @return Verdadero si la función estó definida y admite un argumento, falso en caso contrario
+	*/
+	bool isFunction(string name, function<double(double)> & func) {
+		size_t idx;
+		if (findFunction(name, idx) && (*functions)[idx].accepts(1)) {
+			CustomFunction f = (*functions)[idx];
+			func = [f](double x) { return f(&x, 1); };
+			return true;
+		}
+		return false;
+	}
+
+	/**
+	* @brief Separa los elementos de la expresión
+	* @return Vector de cadenas con los elementos separados
+	*/
+	vector<string> getTokens() {
+
+		vector<string> tokens;
+
+		// Verificar parentesis
+		if (!checkParenthesis()) {
+			return tokens;
+		}
+
+		for (auto & t: lex(text)) {
+			tokens.push_back(string(std::string_view(text).substr(t.offset, t.length)));
+		}
+		return tokens;
+	}
+
+	/**
+	* @brief Separa los elementos de un texto en un solo recorrido, sin copiar el texto
+	*
+	* Los espacios separan elementos y se descartan. Los paréntesis, las comas y los operadores
+	* forman elementos de un caracter, excepto los operadores de dos caracteres (<=, >=, ==, !=,
+	* && y ||); las demás secuencias de caracteres son números o nombres. Un signo después del
+	* exponente de un número (1e-5) forma parte del número.
+	* @param src Texto de la expresión
+	* @param memory Recurso de memoria del resultado
+	* @return Elementos de la expresión, referenciados por su posición en src
+	*/
+	static std::pmr::vector<Token> lex(std::string_view src,
+			std::pmr::memory_resource * memory = std::pmr::get_default_resource()) {
+		std::pmr::vector<Token> out(memory);
+		size_t n = src.size();
+		size_t pos = 0;
+
+		while (pos < n) {
+			char c = src[pos];
+			if (isspace((unsigned char) c)) {
+				pos++;
+				continue;
+			}
+			if (c == '(' || c == ')' || c == ',' || isOperator(c)) {
+				TokenKind kind = (c == '(') ? TokenKind::LeftParen : (c == ')') ? TokenKind::RightParen
+						: (c == ',') ? TokenKind::Comma : TokenKind::Operator;
+				size_t len = (kind == TokenKind::Operator) ? operatorLength(src, pos) : 1;
+				out.push_back({kind, pos, len, 0.0});
+				pos += len;
+				continue;
+			}
+
+			size_t start = pos;
+			while (pos < n && !isspace((unsigned char) src[pos]) && src[pos] != '(' && src[pos] != ')' && src[pos] != ','
+					&& !isOperator(src[pos])) {
+				pos++;
+				if ((src[pos - 1] == 'e' || src[pos - 1] == 'E') && pos + 1 < n && (src[pos] == '+' || src[pos] == '-')
+						&& isdigit((unsigned char) src[pos + 1]) && isMantissa(src.substr(start, pos - 1 - start))) {
+					pos++;
+				}
+			}
+
+			Token t = {TokenKind::Name, start, pos - start, 0.0};
+			if (parseNumber(src.substr(start, pos - start), t.val)) {
+				t.kind = TokenKind::Number;
+			}
+			out.push_back(t);
+		}
+		return out;
+	}
+
+	/**
+	* @brief Verifica si un texto es la mantisa de un número, e.g. 12, 1.5 o .5
+	* @param str Texto a verificar
+	* @return Verdadero si el texto tiene solo dígitos y a lo sumo un punto
+	*/
+	static bool isMantissa(std::string_view str) {
+		bool digits = false;
+		bool point = false;
+
+		for (char c: str) {
+			if (isdigit((unsigned char) c)) {
+				digits = true;
+			}else if (c == '.' && !point) {
+				point = true;
+			}else {
+				return false;
+			}
+		}
+		return digits;
+	}
+
+	/**
+	* @brief Obtiene el texto de un elemento
+	* @param t Elemento
+	* @param src Texto de la expresión
+	* @return Texto del elemento; los números se representan con numberToString()
+	*/
+	static string tokenString(const Token & t, std::string_view src) {
+		if (t.kind == TokenKind::Number) {
+			return numberToString(t.val);
+		}
+		return string(src.substr(t.offset, t.length));
+	}
+
+	/**
+	* @brief Obtiene la representación RPN de la expresión original
+	* @param tokens Vector de elementos separados
+	* @return Vector de elementos de la expresión en Notación Reversa Polaca (RPN)
+	*/
+	vector<string> getRPN(vector<string> tokens) {
+		string src;
+		std::pmr::vector<Token> input;
+		vector<string> rpn;
+		double val;
+
+		input.reserve(tokens.size());
+		for (auto & token: tokens) {
+			Token t = {TokenKind::Name, src.size(), token.size(), 0.0};
+			if (getNumber(token, val)) {
+				t.kind = TokenKind::Number;
+				t.val = val;
+			}else if (token == "(") {
+				t.kind = TokenKind::LeftParen;
+			}else if (token == ")") {
+				t.kind = TokenKind::RightParen;
+			}else if (token == ",") {
+				t.kind = TokenKind::Comma;
+			}else if (isOperator(token)) {
+				t.kind = TokenKind::Operator;
+			}
+			src += token;
+			input.push_back(t);
+		}
+
+		for (auto & t: getRPN(input, src)) {
+			rpn.push_back(tokenString(t, src));
+		}
+		return rpn;
+	}
+
+	/**
+	* @brief Obtiene la representación RPN de una secuencia de elementos
+	* @param input Elementos de la expresión, obtenidos con lex()
+	* @param src Texto al que hacen referencia los elementos
+	* @return Elementos de la expresión en Notación Reversa Polaca (RPN); los nombres de
+	* funciones personalizadas se marcan como TokenKind::Function, con la cantidad de argumentos
+	* separados por comas entre sus paréntesis (1 si la función no tiene paréntesis), en el
+	* recurso de memoria de input
+	*/
+	std::pmr::vector<Token> getRPN(const std::pmr::vector<Token> & input, std::string_view src) {
+
+		std::pmr::vector<Token> rpn(input.get_allocator());
+		std::pmr::vector<Token> operators(input.get_allocator());
+		std::pmr::vector<size_t> args(input.get_allocator()); //Argumentos de cada paréntesis abierto
+		TokenKind previous = TokenKind::Comma;
+		size_t idx;
+
+		rpn.reserve(input.size());
+
+		//Shunting Yard Algorithm
+
+		//while there are tokens to be read:
+		//Read a token
+		for (Token token: input) {
+			//If the token is:
+			switch (token.kind) {
+				//a number:
+				case TokenKind::Number:
+					//put it into the output queue
+					rpn.push_back(token);
+					break;
+				//a function:
+				case TokenKind::Name:
+				case TokenKind::Function:
+					if (findFunction(src.substr(token.offset, token.length), idx)) {
+						//push it into the operator stack
+						token.kind = TokenKind::Function;
+						operators.push_back(token);
+					}else {
+						//Variable! colocarla en la salida
+						rpn.push_back(token);
+					}
+					break;
+				//an operator o1:
+				case TokenKind::Operator: {
+					OpCode op = getOpCode(src.substr(token.offset, token.length));
+					int p = precedence(op);
+					//while (
+					//there is an operator o2 at the top of the operator stack which is not a left parenthesis,
+					//and (o2 has greater precedence than o1 or (o1 and o2 have the same precedence and o1 is left-associative))
+					//)
+					while (!operators.empty() && operators.back().kind != TokenKind::LeftParen
+						   && (precedence(operators.back(), src) > p ||
+							   (precedence(operators.back(), src) == p && isLeftAssociative(op)))) {
+						//pop o2 from the operator stack into the output queue
+						rpn.push_back(operators.back());
+						operators.pop_back();
+					}
+					//push o1 onto the operators stack
+					operators.push_back(token);
+					break;
+				}
+				//a left parenthesis i.e. "("
+				case TokenKind::LeftParen:
+					// push it onto the operator stack
+					operators.push_back(token);
+					args.push_back(1);
+					break;
+				//a comma:
+				case TokenKind::Comma:
+					//while the operator at the top of the operator stack is not a left parenthesis:
+					//pop the operator from the operator stack into the output queue
+					while (!operators.empty() && operators.back().kind != TokenKind::LeftParen) {
+						rpn.push_back(operators.back());
+						operators.pop_back();
+					}
+					//count one more argument
+					if (!args.empty()) {
+						args.back()++;
+					}
+					break;
+				//a right parenthesis (i.e. ")")
+				case TokenKind::RightParen: {
+					size_t count = 1;
+					//while the operator at the top of the operator stack is not a left parenthesis:
+					//pop the operator from the operator stack into the output queue
+					while (!operators.empty() && operators.back().kind != TokenKind::LeftParen) {
+						rpn.push_back(operators.back());
+						operators.pop_back();
+					}
+					//pop the left parenthesis from the operator stack and discard it
+					if (!operators.empty()) {
+						operators.pop_back();
+					}
+					if (!args.empty()) {
+						count = (previous == TokenKind::LeftParen) ? 0 : args.back();
+						args.pop_back();
+					}
+					//if there is a function token at the top of the operator stack, then:
+					//pop the function from the operator stack into the output queue, with its arguments
+					if (!operators.empty() && operators.back().kind == TokenKind::Function) {
+						rpn.push_back(operators.back());
+						rpn.back().args = count;
+						operators.pop_back();
+					}
+					break;
+				}
+			}
+			previous = token.kind;
+		}
+
+		//After the while loop, pop the remaining items from the operator stack into the output queue.
+		// Ya se ha verificado el balance de parentesis
+		while (!operators.empty()) {
+			if (operators.back().kind != TokenKind::LeftParen) {
+				rpn.push_back(operators.back());
+			}
+			operators.pop_back();
+		}
+
+		// rpn almacena la representación RPN de la expresión
+		return rpn;
+	}
+
+	/**
+	* @brief Sobrecarga del operador ()
+	* @return Resultado de evaluar la expresión
+	*/
+	double operator()() {
+		return eval();
+	}
+
+	/**
+	* @brief Sobrecarga del operador () sobre x
+	* @param val Valor de la variable x de la expresión
+	* @return Resultado de evaluar la expresión
+	*/
+	double operator()(double val) {
+		return eval(val);
+	}
+
+	/**
+	* @brief Sobrecarga del operador () sobre variables
+	* @param vars Arreglo de variables a reemplazar
+	* @return Resultado de evaluar la expresión
+	*/
+	double operator()(vector<Variable> vars) {
+		return eval(vars);
+	}
+
+	/**
+	* @brief Evalóa la expresión usando las variables por defecto
+	* @return Resultado de evaluar la expresión
+	*/
+	double eval() {
+		return defaultProgram->eval(nullptr, evalStack.data());
+	}
+
+	/**
+	* @brief Evalóa la expresión para un valor de x
+	* @param val Valor para una única variable llamada x
+	* @return Resultado de la expresión
+	*/
+	double eval(double val) {
+		return xProgram->eval(&val, evalStack.data());
+	}
+
+	/**
+	* @brief Evalóa la expresión para una un más variables
+	*
+	* Igual que en bind(), las variables que no aparecen en vars toman su valor de
+	* defaultVariables(), o NAN si no están definidas.
+	* @param vars Vector de variables
+	* @return Resultado de la expresión
+	*/
+	double eval(vector<Variable> vars) {
+		//Resolver el valor de cada variable una sola vez
+		vector<double> values(slots.size(), NAN);
+
+		for (size_t i = 0; i < slots.size(); i++) {
+			auto it = std::find_if(vars.begin(), vars.end(), [this, i](const Variable & v) { return v.name == slots[i]; });
+			values[i] = (it != vars.end()) ? it->val : defaultValue(slots[i]);
+		}
+
+		return compiledProgram->eval(values.data(), evalStack.data());
+	}
+
+	/**
+	* @brief Traduce la expresión en RPN a un programa de instrucciones
+	*
+	* Cada elemento se clasifica una sola vez: las constantes se almacenan como valores reales,
+	* las variables como posiciones en el vector de valores y las funciones como posiciones
+	* en el vector de funciones personalizadas. Las funciones de varios argumentos se traducen a
+	* OpCode::CallN, o a la instrucción equivalente de las predefinidas (pow, if); si una función se
+	* invoca con una cantidad de argumentos que no admite, el programa queda vacío y la
+	* expresión se evalúa como NAN.
+	*/
+	void compile() {
+#ifdef EXPRESSION_PROFILE
+		ExpressionProfile::Clock::time_point start = ExpressionProfile::Clock::now();
+#endif
+		std::string_view src(text);
+		bool matched = true;
+
+		program.clear();
+		slots.clear();
+		program.reserve(rpn.size());
+
+		for (auto & t: rpn) {
+			Instruction ins = {OpCode::Const, 0, t.val};
+			std::string_view item = src.substr(t.offset, t.length);
+			switch (t.kind) {
+				case TokenKind::Number:
+					break;
+				case TokenKind::Function: {
+					findFunction(item, ins.arg);
+					const CustomFunction & f = (*functions)[ins.arg];
+					matched = matched && f.accepts(t.args);
+					if (f.op != OpCode::Call && CompiledExpression::arity(f.op) == t.args) {
+						ins.op = f.op;
+					}else if (f.isMultiArgument()) {
+						ins.op = OpCode::CallN;
+						ins.count = t.args;
+					}else {
+						ins.op = OpCode::Call;
+					}
+					break;
+				}
+				case TokenKind::Operator:
+					//Un operador incompleto (= & |) deja el programa vacío, igual que una función mal invocada
+					ins.op = getOpCode(item);
+					matched = matched && ins.op != OpCode::Const;
+					break;
+				default:
+					ins.op = OpCode::Load;
+					ins.arg = getSlot(item);
+					break;
+			}
+			program.push_back(ins);
+		}
+		if (!matched) {
+			program.clear();
+		}
+
+		compiledProgram = makeProgram(optimize(program), std::pmr::vector<string>(slots, memory));
+		bound = compiledProgram;
+#ifdef EXPRESSION_PROFILE
+		counters->compiled(ExpressionProfile::since(start));
+#endif
+
+		//Programas para eval() y eval(double), sobre las variables predeterminadas
+		bool resolved;
+		defaultProgram = compiled({}, resolved);
+		static const vector<string> x = {"x"};
+		xProgram = compiled(x, resolved);
+
+		//Pila de evaluación con la profundidad calculada al compilar
+		evalStack.assign(std::max({size_t(1), compiledProgram->stackSize(), defaultProgram->stackSize(),
+				xProgram->stackSize()}), 0.0);
+	}
+
+	/**
+	* @brief Asocia las variables de la expresión a posiciones de un arreglo de valores
+	*
+	* Después de asociar las variables, eval(const double *) recibe los valores en el orden
+	* de names. Las variables de la expresión que no aparecen en names toman su valor
+	* de defaultVariables(), o NAN si no están definidas.
+	* @param names Nombres de las variables, en el orden en que se suministran sus valores
+	* @return Verdadero si todas las variables de la expresión quedaron definidas
+	*/
+	bool bind(vector<string> names) {
+		bool resolved;
+
+		bound = compiled(names, resolved);
+		if (bound->stackSize() > evalStack.size()) {
+			evalStack.resize(bound->stackSize());
+		}
+
+		return resolved;
+	}
+
+	/**
+	* @brief Retorna el programa compilado con las variables asociadas mediante bind()
+	*
+	* El programa es inmutable y se puede compartir entre hilos sin copiar la expresión.
+	* @return Programa compilado
+	*/
+	std::shared_ptr<const CompiledExpression> compiled() {
+		return bound;
+	}
+
+#ifdef EXPRESSION_PROFILE
+	/**
+	* @brief Retorna los contadores de perfilado de la expresión
+	*
+	* Solo existe si se define EXPRESSION_PROFILE. Las copias de la expresión comparten los
+	* contadores; los registran eval(), evalBatch(), evalParallel(), evalRPN() y los programas de
+	* compiled(), pero no NativeExpression ni FusedExpression.
+	* @return Contadores, ver ExpressionProfile::snapshot() y ExpressionProfile::prometheus()
+	*/
+	std::shared_ptr<const ExpressionProfile> profile() const {
+		return counters;
+	}
+#endif
+
+	/**
+	* @brief Compila la expresión con las variables asociadas a posiciones de un arreglo
+	*
+	* Las variables de la expresión que no aparecen en names toman su valor de
+	* defaultVariables(), o NAN si no están definidas.
+	* @param names Nombres de las variables, en el orden en que se suministran sus valores
+	* @param resolved Referencia que indica si todas las variables quedaron definidas
+	* @return Programa compilado con las variables asociadas
+	*/
+	std::shared_ptr<const CompiledExpression> compiled(const vector<string> & names, bool & resolved) {
+#ifdef EXPRESSION_PROFILE
+		ExpressionProfile::Clock::time_point start = ExpressionProfile::Clock::now();
+#endif
+		Program code(program, memory);
+
+		resolved = true;
+
+		for (auto & ins: code) {
+			if (ins.op != OpCode::Load) {
+				continue;
+			}
+			const string & name = slots[ins.arg];
+			auto it = std::find(names.begin(), names.end(), name);
+			if (it != names.end()) {
+				ins.arg = it - names.begin();
+				continue;
+			}
+			//Variable no suministrada: tomar el valor predeterminado como constante
+			ins.op = OpCode::Const;
+			ins.val = defaultValue(name);
+			if (ins.val != ins.val) {
+				resolved = false;
+			}
+		}
+
+		std::shared_ptr<const CompiledExpression> result =
+			makeProgram(optimize(code), std::pmr::vector<string>(names.begin(), names.end(), memory));
+#ifdef EXPRESSION_PROFILE
+		counters->compiled(ExpressionProfile::since(start));
+#endif
+		return result;
+	}
+
+	/**
+	* @brief Crea un programa compilado en el recurso de memoria de la expresión
+	* @param code Instrucciones del programa
+	* @param names Nombres de los valores de entrada
+	* @return Programa compilado que comparte la tabla de funciones de la expresión
+	*/
+	std::shared_ptr<const CompiledExpression> makeProgram(Program code, std::pmr::vector<string> names) {
+		std::shared_ptr<CompiledExpression> result = std::allocate_shared<CompiledExpression>(
+				std::pmr::polymorphic_allocator<CompiledExpression>(memory), std::move(code), functions, std::move(names));
+#ifdef EXPRESSION_PROFILE
+		result->attach(counters);
+#endif
+		return result;
+	}
+
+	/**
+	* @brief Calcula la derivada simbólica de la expresión respecto a una variable
+	*
+	* La derivada se construye a partir del programa de la expresión, se simplifica (ver
+	* ExpressionGraph::derivative()) y se compila como una nueva expresión, con el mismo nivel de
+	* optimización, que se puede evaluar con todos los métodos de evaluación. Las funciones
+	* predefinidas que aparecen en la derivada y no están en las funciones de la expresión se agregan.
+	* Las funciones personalizadas no tienen derivada simbólica: si el resultado depende de var a
+	* través de alguna de ellas, la derivada es NAN (Gradient las deriva numéricamente).
+	* @param var Nombre de la variable
+	* @return Expresión de la derivada; 0 si la expresión no depende de var, NAN si no es válida
+	*/
+	expression derivative(const string & var) {
+		Program code(program, memory);
+		size_t depth;
+		ExpressionGraph graph;
+
+		size_t root = CompiledExpression::validate(code, depth) ? graph.insert(code) : ExpressionGraph::NONE;
+		if (root == ExpressionGraph::NONE) {
+			return expression("nan", functions, optimization, memory);
+		}
+
+		auto it = std::find(slots.begin(), slots.end(), var);
+		size_t input = (it != slots.end()) ? size_t(it - slots.begin()) : ExpressionGraph::NONE;
+		size_t d = graph.derivative(root, input, functions.get());
+
+		vector<CustomFunction> funcs = *functions;
+		for (auto & b: BUILTIN_FUNCTIONS) {
+			size_t idx;
+			if (!findFunction(b.name, idx)) {
+				CustomFunction func = CustomFunction::pointer(b.name, b.fn, b.batch);
+				func.op = b.op;
+				func.pure = true;
+				funcs.push_back(std::move(func));
+			}
+		}
+		//if() aparece en las derivadas de min, max y clamp
+		for (auto & b: BUILTIN_MULTI_FUNCTIONS) {
+			size_t idx;
+			if (b.op == OpCode::Select && !findFunction(b.name, idx)) {
+				CustomFunction func = CustomFunction::pointer(b.name, b.args, b.fn, b.batch);
+				func.op = b.op;
+				func.pure = true;
+				funcs.push_back(std::move(func));
+			}
+		}
+
+		string derived = infix(graph, d, slots, funcs);
+		if (funcs.size() == functions->size()) {
+			return expression(derived, functions, optimization, memory);
+		}
+		return expression(derived, std::make_shared<const vector<CustomFunction>>(std::move(funcs)), optimization, memory);
+	}
+
+	/**
+	* @brief Compila un programa que calcula la expresión y su derivada en una sola pasada
+	*
+	* Las variables se asocian en el orden de bind(). Las subexpresiones comunes a la expresión y a
+	* su derivada, como e^~x en la derivada de e^~x, se calculan una sola vez.
+	* @param var Nombre de la variable
+	* @return Programa cuyo primer resultado es la expresión y el segundo su derivada respecto a var
+	*/
+	std::shared_ptr<const FusedExpression> fusedDerivative(const string & var) {
+		const std::pmr::vector<string> & names = bound->variables();
+		ExpressionGraph graph;
+
+		size_t root = bound->isValid() ? graph.insert(bound->instructions()) : ExpressionGraph::NONE;
+		auto it = std::find(names.begin(), names.end(), var);
+		size_t input = (it != names.end()) ? size_t(it - names.begin()) : ExpressionGraph::NONE;
+		size_t d = (root != ExpressionGraph::NONE) ? graph.derivative(root, input, functions.get()) : ExpressionGraph::NONE;
+
+		return std::make_shared<const FusedExpression>(graph, vector<size_t>{root, d}, *functions,
+				vector<string>(names.begin(), names.end()));
+	}
+
+	/**
+	* @brief Escribe una subexpresión de un grafo en notación infija
+	*
+	* Solo se agregan los paréntesis que requieren la precedencia y la asociatividad de los operadores.
+	* @param graph Grafo de subexpresiones
+	* @param root Subexpresión a escribir
+	* @param names Nombres de los valores de entrada referenciados por los nodos Load
+	* @param funcs Funciones referenciadas por los nodos Call; las funciones predefinidas se nombran
+	*        con la primera función que tenga su código de operación
+	* @return Texto de la subexpresión
+	*/
+	static string infix(const ExpressionGraph & graph, size_t root, const std::pmr::vector<string> & names,
+			const vector<CustomFunction> & funcs) {
+		const std::pmr::vector<ExpressionGraph::Node> & nodes = graph.nodes();
+		vector<string> texts(root + 1);
+		vector<int> levels(root + 1, 0); //Precedencia de cada texto; 8 para los que no requieren paréntesis
+
+		auto operand = [&](size_t id, bool parens) {
+			return parens ? "(" + texts[id] + ")" : texts[id];
+		};
+
+		for (size_t i = 0; i <= root; i++) {
+			const ExpressionGraph::Node & n = nodes[i];
+			size_t k = CompiledExpression::arity(n.op);
+			string & t = texts[i];
+			levels[i] = 8;
+			if (n.op == OpCode::Const) {
+				//El signo de NAN no se conserva: "-nan" se leería como una resta
+				if (std::isnan(n.val)) {
+					t = "nan";
+				}else if (std::signbit(n.val)) {
+					t = "~" + numberToString(-n.val);
+					levels[i] = 7;
+				}else {
+					t = numberToString(n.val);
+				}
+			}else if (n.op == OpCode::Load) {
+				t = names[n.arg];
+			}else if (n.op == OpCode::Arg) {
+				t = texts[n.a] + ", " + texts[n.b];
+			}else if (n.op == OpCode::CallN) {
+				t = funcs[n.arg].name + "(" + ((n.a != ExpressionGraph::NONE) ? texts[n.a] : string()) + ")";
+			}else if (n.op == OpCode::Select) {
+				t = "if(" + texts[n.a] + ")";
+			}else if (n.op == OpCode::Neg || n.op == OpCode::Not) {
+				t = getOperator(n.op) + operand(n.a, levels[n.a] < 7);
+				levels[i] = 7;
+			}else if (k == 2) {
+				string op = getOperator(n.op);
+				int p = precedence(n.op);
+				bool left = isLeftAssociative(n.op);
+				string sep = (p <= 5) ? " " + op + " " : op;
+				t = operand(n.a, left ? levels[n.a] < p : levels[n.a] <= p) + sep
+						+ operand(n.b, left ? levels[n.b] <= p : levels[n.b] < p);
+				levels[i] = p;
+			}else {
+				auto f = std::find_if(funcs.begin(), funcs.end(),
+						[&n](const CustomFunction & c) { return c.op == n.op; });
+				if (n.op == OpCode::Call) {
+					t = funcs[n.arg].name + "(" + texts[n.a] + ")";
+				}else if (f != funcs.end()) {
+					t = f->name + "(" + texts[n.a] + ")";
+				}else {
+					t = "nan";
+				}
+			}
+		}
+
+		return texts[root];
+	}
+
+	/**
+	* @brief Optimiza un programa según el nivel de optimización de la expresión
+	*
+	* Recorre el programa construyendo cada subexpresión en orden: los subárboles cuyos operandos son
+	* constantes se reemplazan por su valor (las llamadas a funciones personalizadas solo si
+	* la función es pura, ver CustomFunction::pure, o con Optimization::Fast, y nunca las llamadas sin
+	* argumentos), if(c, a, b) con una condición constante se reemplaza por la rama
+	* elegida, y se
+	* simplifican x^0, x^1, x^2, x*1, 1*x, x/1, x-0, x+(-0), ~~x, a+~b y a-~b. Con Optimization::Fast
+	* además se reescriben x^0.5 como sqrt(x), x+0 y 0+x como x, y x*0 y 0*x como 0.
+	* x^2 se calcula como x*x, correctamente redondeado, y puede diferir en 1 ULP de pow(x, 2).
+	* Por último, si el programa no llama funciones que no se pueden plegar, las subexpresiones
+	* repetidas se calculan una sola vez (ver shareSubexpressions()).
+	* Los programas mal formados no se modifican.
+	* @param code Programa a optimizar
+	* @return Programa optimizado
+	*/
+	Program optimize(const Program & code) {
+		if (optimization == Optimization::None || !isWellFormed(code)) {
+			return Program(code, memory);
+		}
+
+		bool fast = (optimization == Optimization::Fast);
+		Program out(memory);
+		std::pmr::vector<size_t> starts(memory); //Posición de inicio de cada subexpresión en la pila
+
+		out.reserve(code.size());
+
+		for (auto & ins: code) {
+			switch (ins.op) {
+				case OpCode::Const:
+				case OpCode::Load:
+					starts.push_back(out.size());
+					out.push_back(ins);
+					break;
+				case OpCode::Neg:
+				case OpCode::Sqrt:
+				case OpCode::Sin:
+				case OpCode::Cos:
+				case OpCode::Tan:
+				case OpCode::Ln:
+				case OpCode::Log:
+				case OpCode::Exp:
+				case OpCode::Abs:
+				case OpCode::Not:
+				case OpCode::Call: {
+					size_t s = starts.back();
+					bool constant = (out.size() - s == 1 && out[s].op == OpCode::Const) &&
+						(ins.op != OpCode::Call || foldable((*functions)[ins.arg]));
+					if (constant) {
+						double & v = out[s].val;
+						v = (ins.op == OpCode::Call) ? (*functions)[ins.arg](v) : CompiledExpression::calculateUnary(v, ins.op);
+					}else if (ins.op == OpCode::Neg && out.back().op == OpCode::Neg) {
+						//~~x
+						out.pop_back();
+					}else {
+						out.push_back(ins);
+					}
+					break;
+				}
+				case OpCode::CallN: {
+					//Los argumentos son las últimas ins.count subexpresiones
+					size_t first = starts.size() - ins.count;
+					size_t s = (ins.count > 0) ? starts[first] : out.size();
+					//Una función sin argumentos solo es útil si no es pura: nunca se pliega
+					const CustomFunction & f = (*functions)[ins.arg];
+					bool constant = ins.count > 0 && f.accepts(ins.count) && foldable(f) && out.size() - s == ins.count;
+					for (size_t j = s; constant && j < out.size(); j++) {
+						constant = (out[j].op == OpCode::Const);
+					}
+					starts.resize(first);
+					starts.push_back(s);
+					if (constant) {
+						std::pmr::vector<double> x(memory);
+						for (size_t j = s; j < out.size(); j++) {
+							x.push_back(out[j].val);
+						}
+						out.resize(s);
+						out.push_back({OpCode::Const, 0, f(x.data(), ins.count)});
+					}else {
+						out.push_back(ins);
+					}
+					break;
+				}
+				case OpCode::Select: {
+					//Condición, rama verdadera y rama falsa: las tres últimas subexpresiones
+					size_t sb = starts.back();
+					starts.pop_back();
+					size_t sa = starts.back();
+					starts.pop_back();
+					size_t sc = starts.back();
+					if (sa - sc == 1 && out[sc].op == OpCode::Const) {
+						if (out[sc].val != 0.0) {
+							out.resize(sb);
+							out.erase(out.begin() + sc);
+						}else {
+							out.erase(out.begin() + sc, out.begin() + sb);
+						}
+					}else {
+						out.push_back(ins);
+					}
+					break;
+				}
+				default: {
+					size_t sb = starts.back();
+					starts.pop_back();
+					size_t sa = starts.back();
+					bool ca = (sb - sa == 1 && out[sa].op == OpCode::Const);
+					bool cb = (out.size() - sb == 1 && out[sb].op == OpCode::Const);
+					double a = ca ? out[sa].val : NAN;
+					double b = cb ? out[sb].val : NAN;
+
+					if (ca && cb) {
+						out[sa].val = CompiledExpression::calculate(a, b, ins.op);
+						out.resize(sa + 1);
+						break;
+					}
+
+					switch (ins.op) {
+						case OpCode::Pow:
+							if (cb && b == 1.0) {
+								out.resize(sb);
+							}else if (cb && b == 0.0) {
+								out.resize(sa);
+								out.push_back({OpCode::Const, 0, 1.0});
+							}else if (cb && b == 2.0 && sb - sa == 1) {
+								out[sb] = out[sa];
+								out.push_back({OpCode::Mul, 0, 0.0});
+							}else if (cb && b == 0.5 && fast) {
+								out.resize(sb);
+								out.push_back({OpCode::Sqrt, 0, 0.0});
+							}else {
+								out.push_back(ins);
+							}
+							break;
+						case OpCode::Mul:
+							if (cb && b == 1.0) {
+								out.resize(sb);
+							}else if (ca && a == 1.0) {
+								out.erase(out.begin() + sa);
+							}else if (fast && ((cb && b == 0.0) || (ca && a == 0.0))) {
+								out.resize(sa);
+								out.push_back({OpCode::Const, 0, 0.0});
+							}else {
+								out.push_back(ins);
+							}
+							break;
+						case OpCode::Div:
+							if (cb && b == 1.0) {
+								out.resize(sb);
+							}else {
+								out.push_back(ins);
+							}
+							break;
+						case OpCode::Add:
+							if (cb && b == 0.0 && (std::signbit(b) || fast)) {
+								out.resize(sb);
+							}else if (ca && a == 0.0 && (std::signbit(a) || fast)) {
+								out.erase(out.begin() + sa);
+							}else if (out.back().op == OpCode::Neg) {
+								//a + ~b = a - b
+								out.back().op = OpCode::Sub;
+							}else {
+								out.push_back(ins);
+							}
+							break;
+						case OpCode::Sub:
+							if (cb && b == 0.0 && (!std::signbit(b) || fast)) {
+								out.resize(sb);
+							}else if (out.back().op == OpCode::Neg) {
+								//a - ~b = a + b
+								out.back().op = OpCode::Add;
+							}else {
+								out.push_back(ins);
+							}
+							break;
+						default:
+							out.push_back(ins);
+							break;
+					}
+					break;
+				}
+			}
+		}
+
+		//Dos llamadas iguales a una función impura pueden producir valores distintos
+		bool impure = std::any_of(out.begin(), out.end(), [this](const Instruction & i) {
+			return (i.op == OpCode::Call || i.op == OpCode::CallN) &&
+				(!foldable((*functions)[i.arg]) || (i.op == OpCode::CallN && i.count == 0));
+		});
+		return impure ? Program(std::move(out)) : shareSubexpressions(std::move(out));
+	}
+
+	/**
+	* @brief Verifica si optimize() puede calcular al compilar una llamada con argumentos constantes
+	* @param f Función
+	* @return Verdadero si la función es pura o el nivel de optimización es Optimization::Fast
+	*/
+	bool foldable(const CustomFunction & f) const {
+		return f.pure || optimization == Optimization::Fast;
+	}
+
+	/**
+	* @brief Elimina las subexpresiones comunes de un programa
+	*
+	* Construye el grafo de subexpresiones del programa, en el que las subexpresiones idénticas
+	* son un solo nodo, y lo recorre en el orden del programa original: la primera vez que se
+	* calcula una subexpresión usada más de una vez se guarda en un temporal (OpCode::Store) y
+	* las siguientes se reemplazan por la lectura del temporal (OpCode::Temp). Por ejemplo,
+	* sin(x)^2 + 2*sin(x)*cos(x) + cos(x)^2 calcula sin(x) y cos(x) una sola vez. Las funciones
+	* personalizadas se suponen puras. Si no hay subexpresiones repetidas, el programa no cambia.
+	* @param code Programa bien formado
+	* @return Programa equivalente, con un cálculo por cada subexpresión distinta, en el recurso
+	* de memoria de code
+	*/
+	static Program shareSubexpressions(Program code) {
+		const size_t NONE = ExpressionGraph::NONE;
+		std::pmr::memory_resource * memory = code.get_allocator().resource();
+
+		//Las estructuras temporales se reservan en la pila del hilo mientras quepan
+		char buffer[8192];
+		std::pmr::monotonic_buffer_resource scratch(buffer, sizeof buffer, memory);
+		ExpressionGraph graph(&scratch);
+		size_t root = graph.insert(code);
+		if (root == NONE) {
+			return code;
+		}
+
+		//Usos de cada subexpresión, contando cada operando de cada nodo alcanzable; los argumentos
+		//de una lista compartida por varias funciones se cuentan una vez por cada función
+		const std::pmr::vector<ExpressionGraph::Node> & nodes = graph.nodes();
+		std::pmr::vector<size_t> uses(root + 1, 0, &scratch);
+		bool shared = false;
+		uses[root] = 1;
+		for (size_t i = root + 1; i-- > 0;) {
+			if (uses[i] == 0) {
+				continue;
+			}
+			shared = shared || (uses[i] > 1 && CompiledExpression::arity(nodes[i].op) > 0 && nodes[i].op != OpCode::Arg);
+			for (size_t c: {nodes[i].a, nodes[i].b}) {
+				if (c != NONE) {
+					uses[c] += (nodes[i].op == OpCode::Arg) ? uses[i] : 1;
+				}
+			}
+		}
+		if (!shared) {
+			return code;
+		}
+
+		//Recorrido en postorden, operando izquierdo primero, igual que el programa original
+		Program out(memory);
+		std::pmr::vector<size_t> temp(root + 1, NONE, &scratch);
+		std::pmr::vector<std::pair<size_t, bool>> pending({{root, false}}, &scratch);
+		size_t temps = 0;
+
+		while (!pending.empty()) {
+			std::pair<size_t, bool> p = pending.back();
+			pending.pop_back();
+			const ExpressionGraph::Node & n = nodes[p.first];
+			if (temp[p.first] != NONE) {
+				out.push_back({OpCode::Temp, temp[p.first], 0.0});
+			}else if (n.op == OpCode::Const || n.op == OpCode::Load) {
+				out.push_back({n.op, n.arg, n.val});
+			}else if (!p.second) {
+				pending.push_back({p.first, true});
+				if (n.b != NONE) {
+					pending.push_back({n.b, false});
+				}
+				if (n.a != NONE) {
+					pending.push_back({n.a, false});
+				}
+			}else if (n.op == OpCode::Arg) {
+				//Los argumentos ya quedaron en la pila, en orden
+				continue;
+			}else {
+				out.push_back({n.op, n.arg, 0.0, (n.op == OpCode::CallN) ? ExpressionGraph::arguments(nodes.data(), p.first) : 0});
+				if (uses[p.first] > 1) {
+					temp[p.first] = temps++;
+					out.push_back({OpCode::Store, temp[p.first], 0.0});
+				}
+			}
+		}
+
+		return out;
+	}
+
+	/**
+	* @brief Verifica que cada operación de un programa tenga sus operandos y que el resultado sea único
+	* @param code Programa a verificar
+	* @return Verdadero si el programa está bien formado
+	*/
+	bool isWellFormed(const Program & code) {
+		size_t depth = 0;
+
+		for (auto & ins: code) {
+			size_t k = CompiledExpression::arity(ins);
+			if (depth < k || ins.op == OpCode::Arg) {
+				return false;
+			}
+			depth = depth - k + 1;
+		}
+
+		return depth == 1;
+	}
+
+	/**
+	* @brief Evalúa la expresión con las variables asociadas mediante bind()
+	*
+	* No realiza comparaciones de cadenas ni reserva memoria. Si no se ha llamado bind(),
+	* los valores se reciben en el orden de variables().
+	* @param values Valores de las variables asociadas
+	* @return Resultado de la expresión
+	*/
+	double eval(const double * values) {
+		return bound->eval(values, evalStack.data());
+	}
+
+	/**
+	* @brief Evalúa la expresión sobre un arreglo de valores de x
+	*
+	* Equivale a evaluar out[i] = eval(x[i]). Ver CompiledExpression::evalBatch().
+	* @param x Valores de la variable x
+	* @param out Arreglo de salida, con capacidad para n valores
+	* @param n Cantidad de valores a evaluar
+	*/
+	void evalBatch(const double * x, double * out, size_t n) {
+		const double * columns[] = {x};
+		xProgram->evalBatch(columns, out, n);
+	}
+
+	/**
+	* @brief Evalúa la expresión sobre n puntos equiespaciados de x entre x0 y x1
+	*
+	* Equivale a evaluar out[i] = eval(x0 + i * (x1 - x0) / (n - 1)), sin un arreglo de valores de
+	* x. Ver CompiledExpression::evalGrid().
+	* @param x0 Primer valor de x
+	* @param x1 Último valor de x
+	* @param n Cantidad de puntos
+	* @param out Arreglo de salida, con capacidad para n valores
+	*/
+	void evalRange(double x0, double x1, size_t n, double * out) {
+		xProgram->evalGrid(x0, x1, n, out);
+	}
+
+	/**
+	* @brief Evalúa la expresión por columnas, con las variables asociadas mediante bind()
+	* @param columns Una columna de n valores por cada variable asociada
+	* @param out Arreglo de salida, con capacidad para n valores
+	* @param n Cantidad de valores a evaluar
+	*/
+	void evalBatch(const double * const * columns, double * out, size_t n) {
+		bound->evalBatch(columns, out, n);
+	}
+
+	/**
+	* @brief Evalúa la expresión por columnas, con las variables asociadas mediante bind()
+	* @param columns Una columna de n valores por cada variable asociada
+	* @param out Arreglo de salida, con capacidad para n valores; NAN si faltan columnas
+	* @param n Cantidad de valores a evaluar
+	*/
+	void evalBatch(const vector<const double *> & columns, double * out, size_t n) {
+		if (columns.size() < bound->inputs()) {
+			std::fill(out, out + n, NAN);
+			return;
+		}
+		bound->evalBatch(columns.data(), out, n);
+	}
+
+	/**
+	* @brief Evalúa la expresión sobre un arreglo de valores de x, repartiendo el trabajo entre hilos
+	* @param x Valores de la variable x
+	* @param out Arreglo de salida, con capacidad para n valores
+	* @param n Cantidad de valores a evaluar
+	* @param pool Conjunto de hilos que ejecuta la evaluación
+	*/
+	void evalParallel(const double * x, double * out, size_t n, ThreadPool & pool) {
+		const double * columns[] = {x};
+		xProgram->evalParallel(columns, out, n, pool);
+	}
+
+	/**
+	* @brief Evalúa la expresión por columnas en paralelo, con las variables asociadas mediante bind()
+	* @param columns Una columna de n valores por cada variable asociada
+	* @param out Arreglo de salida, con capacidad para n valores
+	* @param n Cantidad de valores a evaluar
+	* @param pool Conjunto de hilos que ejecuta la evaluación
+	*/
+	void evalParallel(const double * const * columns, double * out, size_t n, ThreadPool & pool) {
+		bound->evalParallel(columns, out, n, pool);
+	}
+
+#ifdef __cpp_lib_span
+	/**
+	* @brief Evalúa la expresión con las variables asociadas mediante bind()
+	* @param values Valores de las variables asociadas
+	* @return Resultado de la expresión, NAN si faltan valores
+	*/
+	double eval(std::span<const double> values) {
+		if (values.size() < bound->inputs()) {
+			return NAN;
+		}
+		return bound->eval(values.data(), evalStack.data());
+	}
+#endif
+
+	/**
+	* @brief Obtiene el código de operación de un operador
+	* @param op Operador
+	* @return Código de operación correspondiente
+	*/
+	static constexpr OpCode getOpCode(char op) {
+		switch (op) {
+			case '+':
+				return OpCode::Add;
+			case '-':
+				return OpCode::Sub;
+			case '*':
+				return OpCode::Mul;
+			case '/':
+				return OpCode::Div;
+			case '^':
+				return OpCode::Pow;
+			case '<':
+				return OpCode::Lt;
+			case '>':
+				return OpCode::Gt;
+			case '!':
+				return OpCode::Not;
+			default:
+				return OpCode::Neg;
+		}
+	}
+
+	/**
+	* @brief Obtiene el código de operación de un operador de uno o dos caracteres
+	* @param op Texto del operador
+	* @return Código de operación correspondiente, OpCode::Const si el texto no es un operador
+	*/
+	static constexpr OpCode getOpCode(std::string_view op) {
+		if (op.size() == 2) {
+			switch (op[0]) {
+				case '<':
+					return (op[1] == '=') ? OpCode::Le : OpCode::Const;
+				case '>':
+					return (op[1] == '=') ? OpCode::Ge : OpCode::Const;
+				case '=':
+					return (op[1] == '=') ? OpCode::Eq : OpCode::Const;
+				case '!':
+					return (op[1] == '=') ? OpCode::Ne : OpCode::Const;
+				case '&':
+					return (op[1] == '&') ? OpCode::And : OpCode::Const;
+				case '|':
+					return (op[1] == '|') ? OpCode::Or : OpCode::Const;
+				default:
+					return OpCode::Const;
+			}
+		}
+		if (op.size() == 1 && isOperator(op[0]) && op[0] != '=' && op[0] != '&' && op[0] != '|') {
+			return getOpCode(op[0]);
+		}
+		return OpCode::Const;
+	}
+
+	/**
+	* @brief Obtiene el operador de un código de operación
+	* @param op Código de operación
+	* @return Operador correspondiente, "~" para los códigos que no son operadores
+	*/
+	static constexpr const char * getOperator(OpCode op) {
+		switch (op) {
+			case OpCode::Add:
+				return "+";
+			case OpCode::Sub:
+				return "-";
+			case OpCode::Mul:
+				return "*";
+			case OpCode::Div:
+				return "/";
+			case OpCode::Pow:
+				return "^";
+			case OpCode::Lt:
+				return "<";
+			case OpCode::Le:
+				return "<=";
+			case OpCode::Gt:
+				return ">";
+			case OpCode::Ge:
+				return ">=";
+			case OpCode::Eq:
+				return "==";
+			case OpCode::Ne:
+				return "!=";
+			case OpCode::And:
+				return "&&";
+			case OpCode::Or:
+				return "||";
+			case OpCode::Not:
+				return "!";
+			default:
+				return "~";
+		}
+	}
+
+	/**
+	* @brief Busca la posición de una función personalizada
+	* @param name Nombre de la función
+	* @param idx Referencia a la posición de la función, si existe
+	* @return Verdadero si la función está definida
+	*/
+	bool findFunction(std::string_view name, size_t & idx) {
+		if (functionIndex.empty()) {
+			//La primera definición de cada nombre tiene prioridad
+			for (size_t i = 0; i < functions->size(); i++) {
+				functionIndex.emplace((*functions)[i].name, i);
+			}
+		}
+		auto it = functionIndex.find(string(name));
+		if (it == functionIndex.end()) {
+			return false;
+		}
+		idx = it->second;
+		return true;
+	}
+
+	/**
+	* @brief Obtiene la posición de una variable, agregándola si no existe
+	* @param name Nombre de la variable
+	* @return Posición de la variable en el vector de valores
+	*/
+	size_t getSlot(std::string_view name) {
+		for (size_t i = 0; i < slots.size(); i++) {
+			if (slots[i] == name) {
+				return i;
+			}
+		}
+		slots.push_back(string(name));
+		return slots.size() - 1;
+	}
+
+	/**
+	* @brief Retorna los nombres de las variables de la expresión
+	* @return Nombres de las variables, en el orden esperado por eval(const double *)
+	*/
+	vector<string> variables() {
+		return vector<string>(slots.begin(), slots.end());
+	}
+
+
+	/**
+	* @brief Evalóa la expresión para una un más variables y una o más funciones
+	*
+	* La RPN en cadenas no indica la cantidad de argumentos de las funciones: cada función se
+	* aplica a un solo valor, y las que no admiten un argumento producen NAN.
+	* @param rpn Expresión (vector de cadenas) en RPN
+	* @param vars Vector de variables
+	* @return Resultado de la expresión
+	*/
+	double evalRPN(vector<string> rpn, vector<Variable> vars) {
+		double result = NAN;
+#ifdef EXPRESSION_PROFILE
+		ExpressionProfile::Clock::time_point start = ExpressionProfile::Clock::now();
+#endif
+		//Errores de pila: una función sin argumento, o un operador sin suficientes operandos
+		bool failed = false;
+		bool underflow = false;
+
+		stack<double> values;
+
+		vector<string> items = rpn;
+		size_t func;
+		double val;
+
+
+		for (auto & item: rpn) {
+			if (getNumber(item, val)) {
+				values.push(val);
+			}
+			else if (findFunction(item, func)) {
+				//Verificar si existe un valor en la pila
+				if (values.empty() || !(*functions)[func].accepts(1)) {
+					failed = true;
+					break;
+				}
+#ifdef EXPRESSION_PROFILE
+				counters->called(func, 1);
+#endif
+				//Obtener el valor del tope de la pila
+				val = values.top();
+				//Eliminar el valor obtenido de la pila
+				values.pop();
+				//Evaluar la funcion y almacenar el resultado en la pila
+				values.push((*functions)[func](&val, 1));
+			}
+			else if (isOperator(item)) {
+				if (isBinaryOperator(item) && values.size() >= 2) {
+					//Obtener b, a de la pila (b esta en el tope)
+					double b = values.top();
+					values.pop();
+					double a = values.top();
+					values.pop();
+					//Calcular y almacenar el resultado en la pila
+					values.push(calculate(a, b, item));
+				}else if (isUnaryOperator(item) && values.size() > 0) {
+					//Obtener un valor del tope de la pila
+					val = values.top();
+					values.pop();
+					//Calcular y almacenar el resultado en la pila
+					values.push(calculateUnary(val, item));
+				}else {
+					//El operador se descarta
+					underflow = true;
+				}
+			}
+			else if (isVariable(item, vars, val)) {
+				//Almacenar el valor de la variable en la pila
+				values.push(val);
+			}
+		}
+		//Al final de la ejecucion, el tope de la pila contiene el resultado
+		if (!failed && values.size() == 1) {
+			result = values.top();
+			values.pop();
+		}else {
+			failed = true;
+		}
+#ifdef EXPRESSION_PROFILE
+		counters->evaluated(1, rpn.size(), ExpressionProfile::since(start), !failed && result != result,
+				(failed || underflow) ? 1 : 0);
+#else
+		(void)underflow;
+#endif
+
+		return result;
+	}
+
+private:
+	std::pmr::memory_resource * memory; /*!< Recurso de memoria de la expresión y sus programas */
+	std::pmr::string text; /*!< Texto original de la expresión */
+	std::shared_ptr<const vector<CustomFunction>> functions; /*!< Vector de funciones personalizadas */
+	std::pmr::unordered_map<string, size_t> functionIndex; /*!< Posición de cada función, por nombre */
+	std::pmr::vector<Token> tokens; /*!< Elementos separados de la expresión */
+	std::pmr::string tokensStr; /*!< Cadena de texto de la expresión */
+	std::pmr::vector<Token> rpn; /*!< Elementos separados de la expresión en RPN */
+	std::pmr::string rpnStr; /*!< Cadena de texto de la expresión  en RPN */
+	bool balanced; /*!< Verdadero si los parentesis se encuentran balanceados */
+	Optimization optimization; /*!< Nivel de optimización del programa compilado */
+	Program program; /*!< Programa compilado a partir de la expresión en RPN */
+	std::pmr::vector<string> slots; /*!< Nombres de las variables, en el orden de sus posiciones */
+	std::shared_ptr<const CompiledExpression> compiledProgram; /*!< Programa en el orden de variables() */
+	std::shared_ptr<const CompiledExpression> bound; /*!< Programa con las variables asociadas mediante bind() */
+	std::shared_ptr<const CompiledExpression> defaultProgram; /*!< Programa con las variables predeterminadas, para eval() */
+	std::shared_ptr<const CompiledExpression> xProgram; /*!< Programa con x y las variables predeterminadas, para eval(double) */
+	std::pmr::vector<double> evalStack; /*!< Pila de evaluación del programa */
+#ifdef EXPRESSION_PROFILE
+	std::shared_ptr<ExpressionProfile> counters; /*!< Contadores de perfilado, compartidos con los programas */
+#endif
+};
+
+#endif
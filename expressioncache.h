@@ -0,0 +1,255 @@
+#ifndef EXPRESSIONCACHE_H
+#define EXPRESSIONCACHE_H
+
+/**
+* @file
+* Caché de expresiones compiladas, indexada por el texto de la expresión
+* @author Erwin Meza Vega <emezav@unicauca.edu.co>
+* @copyright MIT License
+*/
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "expression.h"
+
+/**
+* @brief Contadores de la caché de expresiones
+*/
+struct CacheStats {
+	size_t hits; /*!< Consultas resueltas sin compilar */
+	size_t misses; /*!< Consultas que requirieron compilar la expresión */
+	size_t evictions; /*!< Textos descartados por exceder la capacidad */
+	size_t size; /*!< Textos almacenados */
+};
+
+/**
+* @brief Caché de expresiones compiladas, segura para acceso concurrente
+*
+* Asocia el texto de una expresión y su conjunto de funciones a un programa compilado e
+* inmutable. Una consulta repetida se resuelve con el texto tal como se recibe, sin separarlo
+* en elementos ni reservar memoria; la primera consulta de un texto calcula una sola vez su
+* forma normalizada (sus elementos, separados por un espacio), de modo que los textos que solo
+* difieren en los espacios comparten el programa. Cada texto cuenta en la capacidad: cuando se
+* excede se descarta el texto usado hace más tiempo. Los programas descartados siguen siendo
+* válidos mientras existan referencias a ellos.
+*/
+class ExpressionCache {
+public:
+	/**
+	* @brief Crea una caché de expresiones
+	* @param capacity Cantidad máxima de textos almacenados
+	* @param opt Nivel de optimización de las expresiones compiladas
+	*/
+	explicit ExpressionCache(size_t capacity = 1024, Optimization opt = Optimization::Strict):
+		capacity(capacity), optimization(opt), hits(0), misses(0), evictions(0) {
+	}
+
+	/**
+	* @brief Obtiene una expresión compilada con las funciones predeterminadas
+	*
+	* Las funciones predeterminadas forman un conjunto propio, distinto de los conjuntos con nombre.
+	* @param text Texto de la expresión en notación infija
+	* @return Programa compilado, con las variables en el orden de aparición
+	*/
+	std::shared_ptr<const CompiledExpression> get(const string & text) {
+		return get(text, nullptr, []() { return expression::defaultFunctionTable(); });
+	}
+
+	/**
+	* @brief Obtiene una expresión compilada con un conjunto de funciones personalizadas
+	*
+	* El nombre identifica al conjunto de funciones: dos llamadas con el mismo nombre deben
+	* suministrar las mismas funciones. Las funciones se copian una sola vez por nombre, en una
+	* tabla que comparten todos los programas del conjunto.
+	* @param text Texto de la expresión en notación infija
+	* @param functionSet Nombre del conjunto de funciones, no vacío
+	* @param funcs Funciones personalizadas
+	* @return Programa compilado, con las variables en el orden de aparición; nullptr si functionSet es vacío
+	*/
+	std::shared_ptr<const CompiledExpression> get(const string & text, const string & functionSet,
+			const vector<CustomFunction> & funcs) {
+		if (functionSet.empty()) {
+			return nullptr;
+		}
+		return get(text, &functionSet, [&funcs]() { return std::make_shared<const vector<CustomFunction>>(funcs); });
+	}
+
+	/**
+	* @brief Retorna los contadores de la caché
+	* @return Contadores de consultas, descartes y tamaño
+	*/
+	CacheStats stats() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return {hits, misses, evictions, entries.size()};
+	}
+
+	/**
+	* @brief Descarta todas las expresiones almacenadas
+	*/
+	void clear() {
+		std::lock_guard<std::mutex> lock(mutex);
+		entries.clear();
+		defaults = FunctionSet();
+		sets.clear();
+	}
+
+	/**
+	* @brief Normaliza el texto de una expresión
+	*
+	* Los espacios separan elementos: "x y" y "xy" son expresiones distintas.
+	* @param text Texto de la expresión
+	* @return Elementos de la expresión, separados por un espacio
+	*/
+	static string normalize(const string & text) {
+		string key;
+		key.reserve(text.size());
+		for (auto & t: expression::lex(text)) {
+			if (!key.empty()) {
+				key.push_back(' ');
+			}
+			key.append(text, t.offset, t.length);
+		}
+		return key;
+	}
+
+private:
+	struct FunctionSet;
+
+	/**
+	* @brief Texto almacenado
+	*/
+	struct Entry {
+		string text; /*!< Texto de la expresión, tal como se consultó */
+		string key; /*!< Texto normalizado */
+		FunctionSet * set; /*!< Conjunto de funciones del texto */
+		std::shared_ptr<const CompiledExpression> program; /*!< Programa compilado */
+	};
+
+	/**
+	* @brief Programa compartido por los textos con la misma forma normalizada
+	*/
+	struct Shared {
+		std::shared_ptr<const CompiledExpression> program; /*!< Programa compilado */
+		size_t uses; /*!< Cantidad de textos almacenados que lo usan */
+	};
+
+	/**
+	* @brief Textos y programas de un conjunto de funciones
+	*/
+	struct FunctionSet {
+		std::shared_ptr<const vector<CustomFunction>> table; /*!< Tabla de funciones, creada en la primera compilación */
+		std::unordered_map<string, std::list<Entry>::iterator> texts; /*!< Posición de cada texto en entries */
+		std::unordered_map<string, Shared> programs; /*!< Programa de cada texto normalizado */
+	};
+
+	/**
+	* @brief Obtiene una expresión compilada, compilándola si no está en la caché
+	* @param text Texto de la expresión en notación infija
+	* @param functionSet Nombre del conjunto de funciones, nullptr para las funciones predeterminadas
+	* @param funcs Función que crea la tabla de funciones, solo si el conjunto aún no tiene tabla
+	* @return Programa compilado
+	*/
+	template <typename Functions>
+	std::shared_ptr<const CompiledExpression> get(const string & text, const string * functionSet, Functions funcs) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			FunctionSet & set = find(functionSet);
+			auto it = set.texts.find(text);
+			if (it != set.texts.end()) {
+				hits++;
+				entries.splice(entries.begin(), entries, it->second);
+				return it->second->program;
+			}
+		}
+
+		//Primera consulta del texto: normalizar sin bloquear la caché
+		string key = normalize(text);
+		std::shared_ptr<const vector<CustomFunction>> table;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			FunctionSet & set = find(functionSet);
+			auto it = set.programs.find(key);
+			if (it != set.programs.end()) {
+				hits++;
+				return insert(set, text, std::move(key), it->second.program);
+			}
+			misses++;
+			if (!set.table) {
+				set.table = funcs();
+			}
+			table = set.table;
+		}
+
+		//Compilar sin bloquear la caché
+		expression expr(text, std::move(table), optimization, std::pmr::get_default_resource());
+		std::shared_ptr<const CompiledExpression> compiled = expr.compiled();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		FunctionSet & set = find(functionSet);
+		auto it = set.programs.find(key);
+		//Otro hilo pudo compilar la misma expresión
+		return insert(set, text, std::move(key), (it != set.programs.end()) ? it->second.program : compiled);
+	}
+
+	/**
+	* @brief Busca un conjunto de funciones, creándolo si no existe; requiere el bloqueo
+	* @param functionSet Nombre del conjunto, nullptr para las funciones predeterminadas
+	* @return Conjunto de funciones
+	*/
+	FunctionSet & find(const string * functionSet) {
+		if (functionSet == nullptr) {
+			return defaults;
+		}
+		return sets[*functionSet];
+	}
+
+	/**
+	* @brief Almacena un texto como el usado más recientemente; requiere el bloqueo
+	*
+	* Si otro hilo ya almacenó el texto, se conserva su entrada.
+	* @param set Conjunto de funciones del texto
+	* @param text Texto de la expresión
+	* @param key Texto normalizado
+	* @param program Programa compilado del texto normalizado
+	* @return Programa almacenado para el texto
+	*/
+	std::shared_ptr<const CompiledExpression> insert(FunctionSet & set, const string & text, string key,
+			std::shared_ptr<const CompiledExpression> program) {
+		auto it = set.texts.find(text);
+		if (it != set.texts.end()) {
+			entries.splice(entries.begin(), entries, it->second);
+			return it->second->program;
+		}
+		set.programs.try_emplace(key, Shared{program, 0}).first->second.uses++;
+		entries.push_front({text, std::move(key), &set, program});
+		set.texts[text] = entries.begin();
+		while (entries.size() > capacity) {
+			Entry & last = entries.back();
+			auto p = last.set->programs.find(last.key);
+			if (--p->second.uses == 0) {
+				last.set->programs.erase(p);
+			}
+			last.set->texts.erase(last.text);
+			entries.pop_back();
+			evictions++;
+		}
+		return program;
+	}
+
+	size_t capacity; /*!< Cantidad máxima de textos almacenados */
+	Optimization optimization; /*!< Nivel de optimización de las expresiones compiladas */
+	std::mutex mutex; /*!< Protege las expresiones y los contadores */
+	std::list<Entry> entries; /*!< Textos, del usado más recientemente al menos reciente */
+	FunctionSet defaults; /*!< Expresiones con las funciones predeterminadas */
+	std::unordered_map<string, FunctionSet> sets; /*!< Expresiones de cada conjunto de funciones con nombre */
+	size_t hits; /*!< Consultas resueltas sin compilar */
+	size_t misses; /*!< Consultas que requirieron compilar */
+	size_t evictions; /*!< Expresiones descartadas */
+};
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef EXPRESSIONSET_H
+#define EXPRESSIONSET_H
+
+/**
+* @file
+* Evaluación conjunta de varias expresiones sobre los mismos valores de entrada
+* Las expresiones se agregan a un mismo grafo de subexpresiones: las subexpresiones comunes a
+* varias expresiones se calculan una sola vez, y todas las expresiones se evalúan en una sola
+* pasada por bloques sobre las columnas de entrada.
+* @author Erwin Meza Vega <emezav@unicauca.edu.co>
+* @copyright MIT License
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "expression.h"
+
+/**
+* @brief Conjunto de expresiones que se evalúan juntas
+*
+* Las variables del conjunto son las de sus expresiones, salvo pi y e, en orden de aparición,
+* después de las suministradas al crearlo. Las expresiones que comparten la tabla de funciones (por ejemplo, las
+* creadas con las funciones predeterminadas) comparten también sus llamadas a funciones
+* personalizadas. Cada instancia tiene su propio estado de evaluación y no se debe compartir entre
+* hilos sin sincronización; el programa de compiled() sí se puede compartir.
+*/
+class ExpressionSet {
+public:
+	/**
+	* @brief Crea un conjunto vacío
+	* @param names Variables iniciales, en el orden en que se suministran sus valores
+	*/
+	explicit ExpressionSet(vector<string> names = {}): names(std::move(names)) {
+	}
+
+	/**
+	* @brief Agrega una expresión al conjunto
+	*
+	* Las variables de la expresión que no están en variables() se agregan al final. Las variables
+	* predeterminadas (ver expression::defaultVariables()) son constantes, como en expression::bind(),
+	* salvo que se hayan suministrado al crear el conjunto.
+	* @param expr Expresión
+	* @return Posición del resultado de la expresión
+	*/
+	size_t add(expression & expr) {
+		for (auto & v: expr.variables()) {
+			if (std::find(names.begin(), names.end(), v) == names.end() && std::isnan(expression::defaultValue(v))) {
+				names.push_back(v);
+			}
+		}
+
+		bool resolved;
+		std::shared_ptr<const CompiledExpression> program = expr.compiled(names, resolved);
+
+		//Las llamadas se reubican en la tabla de funciones del conjunto
+		const vector<CustomFunction> * table = &program->customFunctions();
+		size_t offset = functions.size();
+		auto it = std::find_if(tables.begin(), tables.end(),
+				[table](const std::shared_ptr<const CompiledExpression> & p) { return &p->customFunctions() == table; });
+		if (it != tables.end()) {
+			offset = offsets[it - tables.begin()];
+		}else {
+			tables.push_back(program);
+			offsets.push_back(offset);
+			functions.insert(functions.end(), table->begin(), table->end());
+		}
+
+		Program code(program->instructions());
+		for (auto & ins: code) {
+			if (ins.op == OpCode::Call || ins.op == OpCode::CallN) {
+				ins.arg += offset;
+			}
+		}
+		roots.push_back(program->isValid() ? graph.insert(code, &functions) : ExpressionGraph::NONE);
+		fused.reset();
+
+		return roots.size() - 1;
+	}
+
+	/**
+	* @brief Retorna la cantidad de expresiones
+	* @return Cantidad de expresiones del conjunto
+	*/
+	size_t size() const {
+		return roots.size();
+	}
+
+	/**
+	* @brief Retorna las variables del conjunto
+	* @return Nombres de las variables, en el orden en que se suministran sus valores
+	*/
+	const vector<string> & variables() const {
+		return names;
+	}
+
+	/**
+	* @brief Compila las expresiones en un programa que calcula todos los resultados
+	*
+	* El programa se crea una sola vez, hasta que se agrega otra expresión.
+	* @return Programa inmutable, con un resultado por expresión en el orden de add()
+	*/
+	std::shared_ptr<const FusedExpression> compiled() {
+		if (!fused) {
+			fused = std::make_shared<const FusedExpression>(graph, roots, functions, names);
+			scratch.assign(fused->scratchSize(), 0.0);
+			regs.assign(fused->registers(), {nullptr, 0.0});
+		}
+		return fused;
+	}
+
+	/**
+	* @brief Evalúa todas las expresiones sobre unos valores de las variables
+	* @param values Valores, en el orden de variables()
+	* @param out Arreglo de salida, con un valor por expresión
+	*/
+	void eval(const double * values, double * out) {
+		compiled()->eval(values, out);
+	}
+
+	/**
+	* @brief Evalúa todas las expresiones sobre columnas de valores
+	*
+	* Ver FusedExpression::evalBatch(). No reserva memoria después de la primera evaluación.
+	* @param columns Una columna de n valores por cada variable, en el orden de variables()
+	* @param outs Una columna de salida de n valores por cada expresión
+	* @param n Cantidad de filas a evaluar
+	*/
+	void evalBatch(const double * const * columns, double * const * outs, size_t n) {
+		compiled()->evalRange(columns, outs, 0, n, scratch.data(), regs.data());
+	}
+
+	/**
+	* @brief Evalúa todas las expresiones sobre columnas de valores, repartiendo el trabajo entre hilos
+	* @param columns Una columna de n valores por cada variable, en el orden de variables()
+	* @param outs Una columna de salida de n valores por cada expresión
+	* @param n Cantidad de filas a evaluar
+	* @param pool Conjunto de hilos que ejecuta la evaluación
+	*/
+	void evalParallel(const double * const * columns, double * const * outs, size_t n, ThreadPool & pool) {
+		compiled()->evalParallel(columns, outs, n, pool);
+	}
+
+private:
+	vector<string> names; /*!< Variables del conjunto */
+	ExpressionGraph graph; /*!< Subexpresiones de todas las expresiones */
+	vector<size_t> roots; /*!< Nodo del resultado de cada expresión, NONE si no es válida */
+	vector<CustomFunction> functions; /*!< Funciones de todas las expresiones */
+	vector<std::shared_ptr<const CompiledExpression>> tables; /*!< Programas que mantienen las tablas de funciones ya incorporadas */
+	vector<size_t> offsets; /*!< Posición de cada tabla dentro de functions */
+	std::shared_ptr<const FusedExpression> fused; /*!< Programa compilado, nullptr si hay expresiones nuevas */
+	vector<double> scratch; /*!< Bloques intermedios de la evaluación por lotes */
+	vector<CompiledExpression::BatchValue> regs; /*!< Registros de la evaluación por lotes */
+};
+
+#endif
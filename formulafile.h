@@ -0,0 +1,482 @@
+#ifndef FORMULAFILE_H
+#define FORMULAFILE_H
+
+/**
+* @file
+* Formato binario de los programas compilados
+* Un archivo contiene varios programas: sus instrucciones, sus constantes, los nombres de sus
+* valores de entrada y los nombres de las funciones que invocan. Cargar un programa no requiere
+* analizar el texto de la expresión: las instrucciones son registros de tamaño fijo y el archivo
+* se proyecta en memoria, de modo que varios procesos comparten sus páginas.
+*
+* Todos los enteros están en orden little-endian. El archivo comienza con:
+*
+*	char magic[8]               "EXPRBIN" y un byte 0
+*	uint32 version              FormulaWriter::VERSION
+*	uint32 count                Cantidad de programas
+*	uint64 offsets[count + 1]   Posición de cada programa desde el inicio del archivo y fin del último
+*
+* Cada programa tiene la forma:
+*
+*	uint32 instructions, inputs, functions, reserved
+*	instructions registros de 24 bytes: uint32 op, arg, count, reserved; double val (IEEE 754)
+*	inputs nombres y luego functions nombres: uint32 longitud seguido de los bytes
+*
+* En las instrucciones Call y CallN, arg es la posición del nombre de la función dentro del programa.
+* @author Erwin Meza Vega <emezav@unicauca.edu.co>
+* @copyright MIT License
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "expression.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define FORMULAFILE_MMAP
+#endif
+
+/**
+* @brief Escritura de programas compilados en el formato binario
+*/
+class FormulaWriter {
+public:
+	/** Identificador del formato, al inicio del archivo */
+	static constexpr char MAGIC[8] = {'E', 'X', 'P', 'R', 'B', 'I', 'N', 0};
+
+	/** Versión del formato */
+	static constexpr uint32_t VERSION = 1;
+
+	/**
+	* @brief Agrega un programa
+	* @param program Programa compilado
+	* @return Posición del programa dentro del archivo
+	*/
+	size_t add(const CompiledExpression & program) {
+		offsets.push_back(records.size());
+
+		//Funciones referenciadas, por nombre, en orden de aparición
+		const vector<CustomFunction> & funcs = program.customFunctions();
+		vector<size_t> index(funcs.size(), SIZE_MAX);
+		vector<const string *> names;
+		for (auto & ins: program.instructions()) {
+			if ((ins.op == OpCode::Call || ins.op == OpCode::CallN) && index[ins.arg] == SIZE_MAX) {
+				index[ins.arg] = names.size();
+				names.push_back(&funcs[ins.arg].name);
+			}
+		}
+
+		put32(program.instructions().size());
+		put32(program.variables().size());
+		put32(names.size());
+		put32(0);
+		for (auto & ins: program.instructions()) {
+			bool call = ins.op == OpCode::Call || ins.op == OpCode::CallN;
+			uint64_t bits;
+			std::memcpy(&bits, &ins.val, sizeof(bits));
+			put32(static_cast<uint32_t>(ins.op));
+			put32(call ? index[ins.arg] : ins.arg);
+			put32(ins.count);
+			put32(0);
+			put64(bits);
+		}
+		for (auto & name: program.variables()) {
+			putString(name);
+		}
+		for (const string * name: names) {
+			putString(*name);
+		}
+		while (records.size() % 8 != 0) {
+			records.push_back(0);
+		}
+
+		return offsets.size() - 1;
+	}
+
+	/**
+	* @brief Retorna la cantidad de programas
+	* @return Cantidad de programas agregados
+	*/
+	size_t size() const {
+		return offsets.size();
+	}
+
+	/**
+	* @brief Genera el contenido del archivo
+	* @return Bytes del archivo
+	*/
+	vector<unsigned char> bytes() const {
+		vector<unsigned char> out(header());
+		out.insert(out.end(), records.begin(), records.end());
+		return out;
+	}
+
+	/**
+	* @brief Escribe el archivo
+	* @param path Ruta del archivo
+	* @return Verdadero si se escribió el archivo completo
+	*/
+	bool save(const string & path) const {
+		FILE * f = std::fopen(path.c_str(), "wb");
+		if (f == nullptr) {
+			return false;
+		}
+		vector<unsigned char> head(header());
+		bool ok = std::fwrite(head.data(), 1, head.size(), f) == head.size() &&
+				std::fwrite(records.data(), 1, records.size(), f) == records.size();
+		return std::fclose(f) == 0 && ok;
+	}
+
+private:
+	/**
+	* @brief Genera el encabezado y la tabla de posiciones
+	* @return Bytes del encabezado
+	*/
+	vector<unsigned char> header() const {
+		uint64_t base = 16 + 8 * (offsets.size() + 1);
+		vector<unsigned char> out(MAGIC, MAGIC + 8);
+
+		out.reserve(base);
+		append32(out, VERSION);
+		append32(out, offsets.size());
+		for (size_t o: offsets) {
+			append64(out, base + o);
+		}
+		append64(out, base + records.size());
+		return out;
+	}
+
+	/**
+	* @brief Agrega un entero de 32 bits a los programas codificados
+	* @param v Valor
+	*/
+	void put32(uint64_t v) {
+		append32(records, v);
+	}
+
+	/**
+	* @brief Agrega un entero de 64 bits a los programas codificados
+	* @param v Valor
+	*/
+	void put64(uint64_t v) {
+		append64(records, v);
+	}
+
+	/**
+	* @brief Agrega un nombre a los programas codificados, precedido por su longitud
+	* @param s Nombre
+	*/
+	void putString(const string & s) {
+		put32(s.size());
+		records.insert(records.end(), s.begin(), s.end());
+	}
+
+	/**
+	* @brief Agrega un entero de 32 bits en orden little-endian
+	* @param out Bytes de destino
+	* @param v Valor
+	*/
+	static void append32(vector<unsigned char> & out, uint64_t v) {
+		for (int i = 0; i < 4; i++) {
+			out.push_back(static_cast<unsigned char>(v >> (8 * i)));
+		}
+	}
+
+	/**
+	* @brief Agrega un entero de 64 bits en orden little-endian
+	* @param out Bytes de destino
+	* @param v Valor
+	*/
+	static void append64(vector<unsigned char> & out, uint64_t v) {
+		for (int i = 0; i < 8; i++) {
+			out.push_back(static_cast<unsigned char>(v >> (8 * i)));
+		}
+	}
+
+	vector<size_t> offsets; /*!< Posición de cada programa dentro de records */
+	vector<unsigned char> records; /*!< Programas codificados */
+};
+
+/**
+* @brief Archivo de programas compilados, proyectado en memoria
+*
+* Los programas se cargan por posición, sin leer los demás. Cada carga verifica los límites de los
+* datos, los códigos de operación y la pila del programa, y resuelve los nombres de las funciones
+* en una tabla de funciones: el programa no se carga si una función no existe o no se puede
+* invocar como en el programa original. Los programas cargados no dependen del archivo.
+*/
+class FormulaFile {
+public:
+	/**
+	* @brief Abre un archivo de programas
+	* @param path Ruta del archivo
+	*/
+	explicit FormulaFile(const string & path): data(nullptr), length(0), mapped(false) {
+#ifdef FORMULAFILE_MMAP
+		int fd = ::open(path.c_str(), O_RDONLY);
+		struct stat st;
+		if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0) {
+			void * p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+			if (p != MAP_FAILED) {
+				data = static_cast<const unsigned char *>(p);
+				length = st.st_size;
+				mapped = true;
+			}
+		}
+		if (fd >= 0) {
+			::close(fd);
+		}
+#endif
+		if (!mapped) {
+			FILE * f = std::fopen(path.c_str(), "rb");
+			if (f != nullptr) {
+				unsigned char block[1 << 16];
+				size_t n;
+				while ((n = std::fread(block, 1, sizeof(block), f)) > 0) {
+					copy.insert(copy.end(), block, block + n);
+				}
+				std::fclose(f);
+			}
+			data = copy.data();
+			length = copy.size();
+		}
+		valid = checkHeader();
+	}
+
+	/**
+	* @brief Usa un archivo de programas que ya está en memoria, sin copiarlo
+	* @param bytes Contenido del archivo; debe existir mientras exista la instancia
+	* @param size Cantidad de bytes
+	*/
+	FormulaFile(const unsigned char * bytes, size_t size): data(bytes), length(size), mapped(false) {
+		valid = checkHeader();
+	}
+
+	FormulaFile(const FormulaFile &) = delete;
+	FormulaFile & operator=(const FormulaFile &) = delete;
+
+	/**
+	* @brief Libera la proyección del archivo
+	*/
+	~FormulaFile() {
+#ifdef FORMULAFILE_MMAP
+		if (mapped) {
+			munmap(const_cast<unsigned char *>(data), length);
+		}
+#endif
+	}
+
+	/**
+	* @brief Verifica si el archivo tiene el formato y la versión esperados
+	* @return Verdadero si el encabezado es válido
+	*/
+	bool isValid() const {
+		return valid;
+	}
+
+	/**
+	* @brief Retorna la cantidad de programas
+	* @return Cantidad de programas, 0 si el archivo no es válido
+	*/
+	size_t size() const {
+		return valid ? count : 0;
+	}
+
+	/**
+	* @brief Carga un programa con las funciones predeterminadas
+	* @param i Posición del programa
+	* @return Programa, o nullptr si no se puede cargar
+	*/
+	std::shared_ptr<const CompiledExpression> load(size_t i) const {
+		return load(i, expression::defaultFunctionTable());
+	}
+
+	/**
+	* @brief Carga un programa
+	* @param i Posición del programa
+	* @param functions Tabla de funciones en la que se buscan las funciones del programa, por nombre
+	* @return Programa que comparte la tabla de funciones, o nullptr si los datos no son válidos o no
+	*         forman un programa válido, si una función no está en la tabla o si no admite la forma en que se invoca
+	*/
+	std::shared_ptr<const CompiledExpression> load(size_t i,
+			const std::shared_ptr<const vector<CustomFunction>> & functions) const {
+		if (i >= size()) {
+			return nullptr;
+		}
+		uint64_t begin = get64(data + HEADER_SIZE + 8 * i);
+		uint64_t end = get64(data + HEADER_SIZE + 8 * (i + 1));
+		if (begin > end || end > length || end - begin < 16) {
+			return nullptr;
+		}
+		const unsigned char * p = data + begin;
+		const unsigned char * limit = data + end;
+		size_t instructions = get32(p);
+		size_t inputs = get32(p + 4);
+		size_t calls = get32(p + 8);
+		if (get32(p + 12) != 0) {
+			return nullptr;
+		}
+		p += 16;
+		if (instructions > size_t(limit - p) / INSTRUCTION_SIZE) {
+			return nullptr;
+		}
+
+		const unsigned char * strings = p + instructions * INSTRUCTION_SIZE;
+		vector<string> names;
+		vector<size_t> targets;
+		for (size_t j = 0; j < inputs + calls; j++) {
+			if (limit - strings < 4 || get32(strings) > size_t(limit - strings - 4)) {
+				return nullptr;
+			}
+			string s(reinterpret_cast<const char *>(strings + 4), get32(strings));
+			strings += 4 + s.size();
+			if (s.empty()) {
+				return nullptr;
+			}
+			if (j < inputs) {
+				names.push_back(std::move(s));
+				continue;
+			}
+			//Las funciones se resuelven por nombre en la tabla
+			size_t k = 0;
+			while (k < functions->size() && (*functions)[k].name != s) {
+				k++;
+			}
+			if (k == functions->size()) {
+				return nullptr;
+			}
+			targets.push_back(k);
+		}
+		//Después de los nombres solo hay relleno hasta un múltiplo de 8 bytes
+		if (limit - strings >= 8 || std::any_of(strings, limit, [](unsigned char b) { return b != 0; })) {
+			return nullptr;
+		}
+
+		Program code;
+		code.reserve(instructions);
+		for (size_t j = 0; j < instructions; j++, p += INSTRUCTION_SIZE) {
+			uint64_t bits = get64(p + 16);
+			Instruction ins = {static_cast<OpCode>(get32(p)), get32(p + 4), 0.0, get32(p + 8)};
+			std::memcpy(&ins.val, &bits, sizeof(bits));
+			//Arg solo existe en ExpressionGraph; los códigos posteriores a Select no existen
+			uint32_t op = get32(p);
+			if (op == static_cast<uint32_t>(OpCode::Arg) || op > static_cast<uint32_t>(OpCode::Select) || get32(p + 12) != 0
+					|| !resolve(ins, inputs, instructions, targets, *functions)) {
+				return nullptr;
+			}
+			code.push_back(ins);
+		}
+
+		//validate() descarta los operadores sin operandos: el programa debe conservar todas sus instrucciones
+		std::shared_ptr<const CompiledExpression> program = std::make_shared<const CompiledExpression>(std::move(code),
+				functions, std::pmr::vector<string>(names.begin(), names.end()));
+		if (!program->isValid() || program->instructions().size() != instructions) {
+			return nullptr;
+		}
+		return program;
+	}
+
+private:
+	/** Tamaño del encabezado, sin la tabla de posiciones */
+	static const size_t HEADER_SIZE = 16;
+
+	/** Tamaño de una instrucción codificada */
+	static const size_t INSTRUCTION_SIZE = 24;
+
+	/**
+	* @brief Verifica el identificador, la versión y la tabla de posiciones
+	*
+	* Las posiciones deben ser crecientes, desde el fin de la tabla hasta el fin del archivo: un
+	* archivo truncado o con datos adicionales no es válido.
+	* @return Verdadero si el encabezado es válido
+	*/
+	bool checkHeader() {
+		if (data == nullptr || length < HEADER_SIZE ||
+				std::memcmp(data, FormulaWriter::MAGIC, sizeof(FormulaWriter::MAGIC)) != 0 ||
+				get32(data + 8) != FormulaWriter::VERSION) {
+			return false;
+		}
+		count = get32(data + 12);
+		if (count >= (length - HEADER_SIZE) / 8) {
+			return false;
+		}
+		uint64_t previous = HEADER_SIZE + 8 * (uint64_t(count) + 1);
+		if (get64(data + HEADER_SIZE) != previous || get64(data + HEADER_SIZE + 8 * count) != length) {
+			return false;
+		}
+		for (size_t i = 1; i <= count; i++) {
+			uint64_t offset = get64(data + HEADER_SIZE + 8 * i);
+			if (offset < previous) {
+				return false;
+			}
+			previous = offset;
+		}
+		return true;
+	}
+
+	/**
+	* @brief Verifica los argumentos de una instrucción y resuelve su función
+	* @param ins Instrucción; en Call y CallN, arg pasa a ser la posición de la función en la tabla
+	* @param inputs Cantidad de valores de entrada
+	* @param instructions Cantidad de instrucciones del programa
+	* @param targets Posición en la tabla de cada función del programa
+	* @param functions Tabla de funciones
+	* @return Verdadero si la instrucción es válida
+	*/
+	static bool resolve(Instruction & ins, size_t inputs, size_t instructions, const vector<size_t> & targets,
+			const vector<CustomFunction> & functions) {
+		switch (ins.op) {
+			case OpCode::Load:
+				return ins.arg < inputs;
+			case OpCode::Store:
+			case OpCode::Temp:
+				return ins.arg < instructions;
+			case OpCode::Call:
+			case OpCode::CallN:
+				if (ins.arg >= targets.size()) {
+					return false;
+				}
+				ins.arg = targets[ins.arg];
+				//Call invoca la función de una variable; CallN, la de varios argumentos
+				return functions[ins.arg].isMultiArgument() == (ins.op == OpCode::CallN);
+			default:
+				return true;
+		}
+	}
+
+	/**
+	* @brief Lee un entero de 32 bits en orden little-endian
+	* @param p Posición del entero
+	* @return Valor
+	*/
+	static uint32_t get32(const unsigned char * p) {
+		return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+	}
+
+	/**
+	* @brief Lee un entero de 64 bits en orden little-endian
+	* @param p Posición del entero
+	* @return Valor
+	*/
+	static uint64_t get64(const unsigned char * p) {
+		return uint64_t(get32(p)) | uint64_t(get32(p + 4)) << 32;
+	}
+
+	const unsigned char * data; /*!< Contenido del archivo */
+	size_t length; /*!< Cantidad de bytes del archivo */
+	bool mapped; /*!< Verdadero si data es una proyección del archivo */
+	bool valid; /*!< Verdadero si el encabezado es válido */
+	size_t count; /*!< Cantidad de programas */
+	vector<unsigned char> copy; /*!< Contenido leído, si no se pudo proyectar el archivo */
+};
+
+#endif
@@ -0,0 +1,337 @@
+#ifndef FORMULAREGISTRY_H
+#define FORMULAREGISTRY_H
+
+/**
+* @file
+* Registro de fórmulas identificadas por nombre, reemplazables mientras se evalúan
+* Los programas compilados se publican mediante punteros atómicos y se liberan con
+* reclamación por épocas (RCU): los lectores no toman bloqueos, solo incrementan un contador
+* atómico de su hilo, y un escritor libera la versión reemplazada solo cuando ningún lector
+* que pudo obtenerla sigue activo.
+* @author Erwin Meza Vega <emezav@unicauca.edu.co>
+* @copyright MIT License
+*/
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "expression.h"
+
+/**
+* @brief Registro de fórmulas que se pueden reemplazar sin detener las evaluaciones
+*
+* Cada fórmula tiene un identificador y una versión vigente, un programa compilado e inmutable.
+* Las evaluaciones (eval(), get() y Reader) no se bloquean: obtienen la versión vigente con una
+* lectura atómica dentro de una sección de lectura. Las escrituras (update(), publish() y
+* remove()) se serializan entre sí: compilan la nueva versión antes de tomar el bloqueo de
+* escritura, la publican con un intercambio atómico y esperan a que terminen las secciones de
+* lectura que pudieron ver la versión anterior antes de liberarla. Un hilo no debe escribir
+* mientras mantiene un Reader, porque esperaría por sí mismo.
+*/
+class FormulaRegistry {
+public:
+	/** Cantidad de bloques de contadores de lectores */
+	static const size_t SHARDS = 16;
+
+	/**
+	* @brief Sección de lectura: mientras existe, las versiones obtenidas con find() no se liberan
+	*
+	* Permite evaluar varias veces, o por lotes, sin repetir la entrada a la sección.
+	*/
+	class Reader {
+	public:
+		/**
+		* @brief Inicia una sección de lectura
+		* @param registry Registro
+		*/
+		explicit Reader(const FormulaRegistry & registry): registry(registry) {
+			registry.enter(shard, parity);
+		}
+
+		Reader(const Reader &) = delete;
+		Reader & operator=(const Reader &) = delete;
+
+		/**
+		* @brief Termina la sección de lectura
+		*/
+		~Reader() {
+			registry.leave(shard, parity);
+		}
+
+		/**
+		* @brief Busca la versión vigente de una fórmula
+		* @param id Identificador de la fórmula
+		* @return Programa compilado, válido hasta que termine la sección; nullptr si no existe
+		*/
+		const CompiledExpression * find(const string & id) const {
+			const Version * v = registry.current(id);
+			return (v != nullptr) ? v->program.get() : nullptr;
+		}
+
+		/**
+		* @brief Retorna el número de la versión vigente de una fórmula
+		* @param id Identificador de la fórmula
+		* @return Número de versión, desde 1; 0 si la fórmula no existe
+		*/
+		uint64_t version(const string & id) const {
+			const Version * v = registry.current(id);
+			return (v != nullptr) ? v->number : 0;
+		}
+
+	private:
+		const FormulaRegistry & registry; /*!< Registro */
+		size_t shard; /*!< Bloque de contadores de la sección */
+		size_t parity; /*!< Paridad de la época en que inició la sección */
+	};
+
+	/**
+	* @brief Crea un registro vacío
+	* @param opt Nivel de optimización de las fórmulas compiladas por update()
+	*/
+	explicit FormulaRegistry(Optimization opt = Optimization::Strict): optimization(opt), epoch(0) {
+		table.store(new Table(), std::memory_order_relaxed);
+	}
+
+	FormulaRegistry(const FormulaRegistry &) = delete;
+	FormulaRegistry & operator=(const FormulaRegistry &) = delete;
+
+	/**
+	* @brief Libera todas las versiones; no debe haber lecturas en curso
+	*/
+	~FormulaRegistry() {
+		Table * t = table.load(std::memory_order_relaxed);
+		for (auto & entry: *t) {
+			delete entry.second->current.load(std::memory_order_relaxed);
+			delete entry.second;
+		}
+		delete t;
+	}
+
+	/**
+	* @brief Compila una fórmula con las funciones predeterminadas y la publica como versión vigente
+	*
+	* Si el texto no produce un programa válido, la versión vigente se conserva.
+	* @param id Identificador de la fórmula; se agrega si no existe
+	* @param text Texto de la fórmula en notación infija
+	* @param names Nombres de las variables, en el orden en que se suministran sus valores
+	* @return Falso si la fórmula no es válida
+	*/
+	bool update(const string & id, const string & text, const vector<string> & names) {
+		bool resolved;
+		expression e(text, optimization);
+		return publish(id, e.compiled(names, resolved));
+	}
+
+	/**
+	* @brief Compila y publica una fórmula en un hilo aparte, ver update()
+	*
+	* Las evaluaciones usan la versión anterior hasta que la nueva se publica.
+	* @param id Identificador de la fórmula; se agrega si no existe
+	* @param text Texto de la fórmula en notación infija
+	* @param names Nombres de las variables, en el orden en que se suministran sus valores
+	* @return Resultado futuro de update()
+	*/
+	std::future<bool> updateAsync(string id, string text, vector<string> names) {
+		return std::async(std::launch::async, [this, id = std::move(id), text = std::move(text), names = std::move(names)] {
+			return update(id, text, names);
+		});
+	}
+
+	/**
+	* @brief Publica un programa compilado como versión vigente de una fórmula
+	*
+	* Retorna cuando ya no hay lectores de la versión reemplazada, que se libera.
+	* @param id Identificador de la fórmula; se agrega si no existe
+	* @param program Programa compilado
+	* @return Falso si el programa es nullptr o no es válido
+	*/
+	bool publish(const string & id, std::shared_ptr<const CompiledExpression> program) {
+		if (!program || !program->isValid()) {
+			return false;
+		}
+		std::lock_guard<std::mutex> lock(writer);
+
+		Table * t = table.load(std::memory_order_relaxed);
+		auto it = t->find(id);
+		if (it == t->end()) {
+			//Una fórmula nueva publica una copia de la tabla; la anterior se libera al terminar sus lecturas
+			Slot * slot = new Slot();
+			slot->current.store(new Version{std::move(program), 1}, std::memory_order_relaxed);
+			Table * copy = new Table(*t);
+			(*copy)[id] = slot;
+			table.store(copy, std::memory_order_seq_cst);
+			synchronize();
+			delete t;
+			return true;
+		}
+
+		Slot * slot = it->second;
+		const Version * old = slot->current.load(std::memory_order_relaxed);
+		slot->current.store(new Version{std::move(program), old->number + 1}, std::memory_order_seq_cst);
+		synchronize();
+		delete old;
+		return true;
+	}
+
+	/**
+	* @brief Elimina una fórmula
+	* @param id Identificador de la fórmula
+	* @return Falso si la fórmula no existe
+	*/
+	bool remove(const string & id) {
+		std::lock_guard<std::mutex> lock(writer);
+
+		Table * t = table.load(std::memory_order_relaxed);
+		auto it = t->find(id);
+		if (it == t->end()) {
+			return false;
+		}
+		Slot * slot = it->second;
+		Table * copy = new Table(*t);
+		copy->erase(id);
+		table.store(copy, std::memory_order_seq_cst);
+		synchronize();
+		delete slot->current.load(std::memory_order_relaxed);
+		delete slot;
+		delete t;
+		return true;
+	}
+
+	/**
+	* @brief Evalúa la versión vigente de una fórmula
+	* @param id Identificador de la fórmula
+	* @param values Valores de las variables, en el orden de los nombres de la versión vigente
+	* @return Resultado de la fórmula, NAN si no existe
+	*/
+	double eval(const string & id, const double * values) const {
+		Reader reader(*this);
+		const CompiledExpression * program = reader.find(id);
+		return (program != nullptr) ? program->eval(values) : NAN;
+	}
+
+	/**
+	* @brief Obtiene la versión vigente de una fórmula, que se mantiene mientras exista la referencia
+	* @param id Identificador de la fórmula
+	* @return Programa compilado, nullptr si la fórmula no existe
+	*/
+	std::shared_ptr<const CompiledExpression> get(const string & id) const {
+		Reader reader(*this);
+		const Version * v = current(id);
+		return (v != nullptr) ? v->program : nullptr;
+	}
+
+	/**
+	* @brief Retorna el número de la versión vigente de una fórmula
+	* @param id Identificador de la fórmula
+	* @return Número de versión, desde 1; 0 si la fórmula no existe
+	*/
+	uint64_t version(const string & id) const {
+		Reader reader(*this);
+		return reader.version(id);
+	}
+
+	/**
+	* @brief Retorna la cantidad de fórmulas
+	* @return Cantidad de fórmulas registradas
+	*/
+	size_t size() const {
+		Reader reader(*this);
+		return table.load(std::memory_order_seq_cst)->size();
+	}
+
+private:
+	/**
+	* @brief Versión publicada de una fórmula
+	*/
+	struct Version {
+		std::shared_ptr<const CompiledExpression> program; /*!< Programa compilado */
+		uint64_t number; /*!< Número de la versión */
+	};
+
+	/**
+	* @brief Fórmula: puntero atómico a su versión vigente
+	*/
+	struct Slot {
+		std::atomic<const Version *> current{nullptr}; /*!< Versión vigente */
+	};
+
+	/** Tabla inmutable de fórmulas, reemplazada completa al agregar o eliminar */
+	typedef std::unordered_map<string, Slot *> Table;
+
+	/**
+	* @brief Contadores de lectores activos de un grupo de hilos, por paridad de la época
+	*/
+	struct alignas(64) Shard {
+		std::atomic<size_t> readers[2] = {{0}, {0}}; /*!< Secciones de lectura activas iniciadas en cada paridad */
+	};
+
+	Optimization optimization; /*!< Nivel de optimización de update() */
+	std::atomic<Table *> table; /*!< Tabla vigente */
+	std::atomic<uint64_t> epoch; /*!< Época actual: cada escritura la avanza */
+	mutable Shard shards[SHARDS]; /*!< Contadores de lectores */
+	std::mutex writer; /*!< Serializa las escrituras */
+
+	/**
+	* @brief Busca la versión vigente de una fórmula; requiere una sección de lectura
+	*/
+	const Version * current(const string & id) const {
+		const Table * t = table.load(std::memory_order_seq_cst);
+		auto it = t->find(id);
+		return (it != t->end()) ? it->second->current.load(std::memory_order_seq_cst) : nullptr;
+	}
+
+	/**
+	* @brief Inicia una sección de lectura en el bloque de contadores del hilo
+	*
+	* El contador se incrementa en la paridad de la época actual; si la época avanzó mientras
+	* tanto, se reintenta, de modo que la sección siempre pertenece a una época que los
+	* escritores siguientes esperan.
+	* @param shard Recibe el bloque de contadores
+	* @param parity Recibe la paridad de la época
+	*/
+	void enter(size_t & shard, size_t & parity) const {
+		static std::atomic<size_t> next{0};
+		static thread_local size_t index = next.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+		shard = index;
+		for (;;) {
+			uint64_t e = epoch.load(std::memory_order_seq_cst);
+			parity = e & 1;
+			shards[shard].readers[parity].fetch_add(1, std::memory_order_seq_cst);
+			if (epoch.load(std::memory_order_seq_cst) == e) {
+				return;
+			}
+			shards[shard].readers[parity].fetch_sub(1, std::memory_order_release);
+		}
+	}
+
+	/**
+	* @brief Termina una sección de lectura
+	*/
+	void leave(size_t shard, size_t parity) const {
+		shards[shard].readers[parity].fetch_sub(1, std::memory_order_release);
+	}
+
+	/**
+	* @brief Avanza la época y espera a que terminen las secciones de lectura de la época anterior
+	*
+	* Después de retornar, ningún lector mantiene un puntero reemplazado antes de la llamada.
+	*/
+	void synchronize() {
+		uint64_t e = epoch.fetch_add(1, std::memory_order_seq_cst);
+		size_t parity = e & 1;
+		for (size_t s = 0; s < SHARDS; s++) {
+			while (shards[s].readers[parity].load(std::memory_order_acquire) != 0) {
+				std::this_thread::yield();
+			}
+		}
+	}
+};
+
+#endif
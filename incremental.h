@@ -0,0 +1,270 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+/**
+* @file
+* Reevaluación incremental de las expresiones
+* Conserva el valor de cada subexpresión entre evaluaciones. Al cambiar el valor de una
+* variable solo se recalculan las subexpresiones que dependen de ella, desde la variable
+* hasta el resultado, y la propagación se detiene en las subexpresiones cuyo valor no cambia.
+* @author Erwin Meza Vega <emezav@unicauca.edu.co>
+* @copyright MIT License
+*/
+
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "expression.h"
+
+/**
+* @brief Evaluador con estado que recalcula solo las subexpresiones afectadas por los cambios
+*
+* Las variables conservan su valor entre evaluaciones: inicialmente tienen el valor de
+* expression::defaultVariables(), o NAN si no están definidas. Las llamadas a funciones impuras
+* y las llamadas sin argumentos se recalculan en cada evaluación (ver ExpressionGraph::varies()).
+* Cada instancia tiene su propio estado y no se debe compartir entre hilos sin sincronización.
+*/
+class IncrementalExpression {
+public:
+	/**
+	* @brief Crea un evaluador incremental de una expresión
+	*
+	* El programa se compila con el nivel de optimización de la expresión y sus subexpresiones
+	* comunes se calculan una sola vez.
+	* @param expr Expresión; las variables se identifican por los nombres de expr.variables()
+	*/
+	explicit IncrementalExpression(expression & expr):
+		names(expr.variables()), root(ExpressionGraph::NONE), evaluated(0) {
+		bool resolved;
+		std::shared_ptr<const CompiledExpression> program = expr.compiled(names, resolved);
+		ExpressionGraph graph;
+
+		//Valores iniciales de las variables
+		vector<Variable> defaults = expression::defaultVariables();
+		inputs.assign(names.size(), NAN);
+		loads.assign(names.size(), ExpressionGraph::NONE);
+		for (size_t i = 0; i < names.size(); i++) {
+			for (auto & v: defaults) {
+				if (v.name == names[i]) {
+					inputs[i] = v.val;
+				}
+			}
+		}
+
+		functions = program->customFunctions();
+		root = program->isValid() ? graph.insert(program->instructions(), &functions) : ExpressionGraph::NONE;
+		if (root == ExpressionGraph::NONE) {
+			return;
+		}
+
+		//Los nodos posteriores al resultado no contribuyen a él
+		nodes.assign(graph.nodes().begin(), graph.nodes().begin() + root + 1);
+		values.assign(nodes.size(), 0.0);
+		pending.assign(nodes.size(), false);
+
+		//Subexpresiones que dependen de cada nodo, agrupadas por nodo
+		first.assign(nodes.size() + 1, 0);
+		for (auto & n: nodes) {
+			for (size_t c: {n.a, n.b}) {
+				if (c != ExpressionGraph::NONE) {
+					first[c + 1]++;
+				}
+			}
+		}
+		for (size_t i = 0; i < nodes.size(); i++) {
+			first[i + 1] += first[i];
+		}
+		parents.resize(first[nodes.size()]);
+		vector<size_t> next(first.begin(), first.end() - 1);
+		for (size_t i = 0; i < nodes.size(); i++) {
+			if (nodes[i].op == OpCode::Load) {
+				loads[nodes[i].arg] = i;
+			}
+			//Una llamada sin lista de argumentos no tiene argumentos
+			bool call = nodes[i].op == OpCode::Call || nodes[i].op == OpCode::CallN;
+			if (call && ExpressionGraph::varies(functions[nodes[i].arg], (nodes[i].a != ExpressionGraph::NONE) ? 1 : 0)) {
+				calls.push_back(i);
+			}
+			for (size_t c: {nodes[i].a, nodes[i].b}) {
+				if (c != ExpressionGraph::NONE) {
+					parents[next[c]++] = i;
+				}
+			}
+		}
+
+		//Evaluación inicial de todas las subexpresiones, en orden
+		for (size_t i = 0; i < nodes.size(); i++) {
+			values[i] = calculate(i);
+		}
+		evaluated = nodes.size();
+	}
+
+	/**
+	* @brief Asigna el valor de una variable
+	*
+	* La variable no se recalcula hasta la siguiente invocación de eval().
+	* @param name Nombre de la variable
+	* @param val Valor de la variable
+	* @return Verdadero si la expresión tiene la variable
+	*/
+	bool set(const string & name, double val) {
+		for (size_t i = 0; i < names.size(); i++) {
+			if (names[i] == name) {
+				set(i, val);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	* @brief Asigna el valor de una variable por su posición
+	* @param input Posición de la variable en variables()
+	* @param val Valor de la variable
+	*/
+	void set(size_t input, double val) {
+		inputs[input] = val;
+		size_t id = loads[input];
+		if (id != ExpressionGraph::NONE && !pending[id]) {
+			pending[id] = true;
+			dirty.push(id);
+		}
+	}
+
+	/**
+	* @brief Evalúa la expresión, recalculando solo las subexpresiones afectadas
+	*
+	* Las subexpresiones pendientes y las llamadas a funciones que varían entre invocaciones se
+	* recalculan en orden, de modo que cada una se calcula una sola vez después de sus operandos.
+	* Si el valor de una subexpresión no cambia, las que dependen de ella no se marcan.
+	* @return Resultado de la expresión, NAN si no es válida
+	*/
+	double eval() {
+		if (root == ExpressionGraph::NONE) {
+			return NAN;
+		}
+
+		evaluated = 0;
+		for (size_t id: calls) {
+			if (!pending[id]) {
+				pending[id] = true;
+				dirty.push(id);
+			}
+		}
+		while (!dirty.empty()) {
+			size_t id = dirty.top();
+			dirty.pop();
+			pending[id] = false;
+			evaluated++;
+
+			//Las listas de argumentos no tienen valor propio: siempre se propagan
+			double val = calculate(id);
+			if (same(val, values[id]) && nodes[id].op != OpCode::Arg) {
+				continue;
+			}
+			values[id] = val;
+			for (size_t p = first[id]; p < first[id + 1]; p++) {
+				size_t parent = parents[p];
+				if (!pending[parent]) {
+					pending[parent] = true;
+					dirty.push(parent);
+				}
+			}
+		}
+
+		return values[root];
+	}
+
+	/**
+	* @brief Retorna los nombres de las variables
+	* @return Nombres de las variables, en el orden de set(size_t, double)
+	*/
+	const vector<string> & variables() const {
+		return names;
+	}
+
+	/**
+	* @brief Retorna la cantidad de subexpresiones del programa
+	* @return Cantidad de subexpresiones distintas que contribuyen al resultado
+	*/
+	size_t size() const {
+		return nodes.size();
+	}
+
+	/**
+	* @brief Retorna la cantidad de subexpresiones recalculadas por la última evaluación
+	* @return Subexpresiones recalculadas por eval(), o size() después de crear el evaluador
+	*/
+	size_t lastEvaluated() const {
+		return evaluated;
+	}
+
+private:
+	/**
+	* @brief Calcula el valor de un nodo a partir de los valores actuales de sus operandos
+	* @param id Identificador del nodo
+	* @return Valor del nodo
+	*/
+	double calculate(size_t id) const {
+		const ExpressionGraph::Node & n = nodes[id];
+		switch (n.op) {
+			case OpCode::Const:
+				return n.val;
+			case OpCode::Load:
+				return inputs[n.arg];
+			case OpCode::Call:
+				return functions[n.arg](values[n.a]);
+			case OpCode::CallN:
+				return ExpressionGraph::call(functions[n.arg], nodes.data(), id, values.data());
+			case OpCode::Arg:
+				return 0.0;
+			case OpCode::Select: {
+				const ExpressionGraph::Node & list = nodes[n.a];
+				return (values[nodes[list.a].a] != 0.0) ? values[nodes[list.a].b] : values[list.b];
+			}
+			case OpCode::Add:
+			case OpCode::Sub:
+			case OpCode::Mul:
+			case OpCode::Div:
+			case OpCode::Pow:
+			case OpCode::Lt:
+			case OpCode::Le:
+			case OpCode::Gt:
+			case OpCode::Ge:
+			case OpCode::Eq:
+			case OpCode::Ne:
+			case OpCode::And:
+			case OpCode::Or:
+				return CompiledExpression::calculate(values[n.a], values[n.b], n.op);
+			default:
+				return CompiledExpression::calculateUnary(values[n.a], n.op);
+		}
+	}
+
+	/**
+	* @brief Compara dos valores por su representación, de modo que NAN es igual a NAN y 0 distinto de -0
+	*/
+	static bool same(double a, double b) {
+		return std::memcmp(&a, &b, sizeof a) == 0;
+	}
+
+	vector<string> names; /*!< Nombres de las variables */
+	vector<CustomFunction> functions; /*!< Funciones referenciadas por el programa */
+	vector<ExpressionGraph::Node> nodes; /*!< Subexpresiones, con los operandos antes que cada nodo */
+	size_t root; /*!< Nodo del resultado, NONE si el programa no es válido */
+	vector<double> values; /*!< Valor actual de cada subexpresión */
+	vector<double> inputs; /*!< Valor actual de cada variable */
+	vector<size_t> loads; /*!< Nodo de cada variable, NONE si el resultado no depende de ella */
+	vector<size_t> calls; /*!< Llamadas que se recalculan en cada evaluación */
+	vector<size_t> first; /*!< Posición en parents de los nodos que dependen de cada nodo */
+	vector<size_t> parents; /*!< Nodos que dependen de cada nodo, agrupados por nodo */
+	vector<bool> pending; /*!< Verdadero para los nodos marcados para recalcular */
+	std::priority_queue<size_t, vector<size_t>, std::greater<size_t>> dirty; /*!< Nodos por recalcular, en orden */
+	size_t evaluated; /*!< Subexpresiones recalculadas por la última evaluación */
+};
+
+#endif
@@ -0,0 +1,675 @@
+#ifndef INTERVAL_H
+#define INTERVAL_H
+
+/**
+* @file
+* Evaluación de los programas compilados en aritmética de intervalos
+* Cada operación produce un intervalo que contiene todos sus resultados sobre los intervalos de
+* sus operandos, redondeado hacia afuera: los operadores y sqrt se amplían 1 ULP, las funciones
+* de cmath (que no garantizan el redondeo correcto) 2 ULP. Los límites permiten descartar
+* regiones completas, e.g. un intervalo de entrada en el que la expresión no tiene raíces.
+* @author Erwin Meza Vega <emezav@unicauca.edu.co>
+* @copyright MIT License
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "expression.h"
+
+/**
+* @brief Intervalo cerrado [lo, hi] de valores reales, posiblemente infinito
+*
+* El intervalo vacío (lo y hi NAN) representa una operación que produce NAN para todos sus operandos.
+*/
+struct Interval {
+	double lo; /*!< Límite inferior */
+	double hi; /*!< Límite superior */
+
+	/**
+	* @brief Intervalo de un solo valor
+	*/
+	static Interval point(double x) {
+		return {x, x};
+	}
+
+	/**
+	* @brief Intervalo de todos los reales
+	*/
+	static Interval entire() {
+		return {-HUGE_VAL, HUGE_VAL};
+	}
+
+	/**
+	* @brief Intervalo vacío
+	*/
+	static Interval empty() {
+		return {NAN, NAN};
+	}
+
+	/**
+	* @brief Verifica si el intervalo es vacío
+	*/
+	bool isEmpty() const {
+		return !(lo <= hi);
+	}
+
+	/**
+	* @brief Verifica si el intervalo contiene un valor
+	*/
+	bool contains(double x) const {
+		return lo <= x && x <= hi;
+	}
+
+	/**
+	* @brief Retorna el ancho del intervalo, 0 si es vacío
+	*/
+	double width() const {
+		return isEmpty() ? 0.0 : hi - lo;
+	}
+};
+
+/**
+* @brief Programa compilado evaluado en aritmética de intervalos
+*
+* eval() retorna un intervalo que contiene el resultado de CompiledExpression::eval() para todos
+* los valores de entrada dentro de los intervalos de entrada, excepto los resultados NAN; el
+* parámetro nan indica si alguno de los resultados puede ser NAN. Las comparaciones y los
+* operadores lógicos producen [0, 0], [1, 1] o [0, 1], y if(c, a, b) la unión de las ramas que la
+* condición puede elegir. Las funciones personalizadas, cuyo comportamiento se desconoce,
+* producen entire(). Una instancia se puede compartir entre hilos.
+*/
+class IntervalExpression {
+public:
+	/**
+	* @brief Crea la evaluación por intervalos de un programa
+	* @param program Programa compilado, con las variables en el orden de sus intervalos de entrada
+	*/
+	explicit IntervalExpression(std::shared_ptr<const CompiledExpression> program): program(std::move(program)) {
+	}
+
+	/**
+	* @brief Crea la evaluación por intervalos del programa de una expresión, con las variables asociadas mediante bind()
+	* @param expr Expresión
+	*/
+	explicit IntervalExpression(expression & expr): IntervalExpression(expr.compiled()) {
+	}
+
+	/**
+	* @brief Evalúa el programa sobre intervalos de entrada
+	* @param inputs Un intervalo por cada valor de entrada del programa
+	* @param nan Si no es nullptr, recibe verdadero si algún resultado puede ser NAN
+	* @return Intervalo que contiene los resultados que no son NAN, vacío si el programa no es válido
+	*/
+	Interval eval(const Interval * inputs, bool * nan = nullptr) const {
+		if (!program->isValid()) {
+			if (nan != nullptr) {
+				*nan = true;
+			}
+			return Interval::empty();
+		}
+		const size_t LOCAL = CompiledExpression::LOCAL_STACK;
+		Value local[LOCAL];
+		vector<Value> heap;
+		Value * st = local;
+		if (program->stackSize() > LOCAL) {
+			heap.resize(program->stackSize());
+			st = heap.data();
+		}
+		Value r = run(inputs, st);
+		if (nan != nullptr) {
+			*nan = r.nan;
+		}
+		return r.range;
+	}
+
+	/**
+	* @brief Evalúa un programa de un solo valor de entrada sobre un intervalo
+	* @param x Intervalo del valor de entrada
+	* @param nan Si no es nullptr, recibe verdadero si algún resultado puede ser NAN
+	* @return Intervalo que contiene los resultados que no son NAN
+	*/
+	Interval eval(Interval x, bool * nan = nullptr) const {
+		return eval(&x, nan);
+	}
+
+	/**
+	* @brief Verifica si el programa puede tomar un valor sobre los intervalos de entrada
+	*
+	* Si retorna falso, ningún punto de los intervalos produce y, e.g. no hay raíces con y = 0.
+	* @param inputs Un intervalo por cada valor de entrada del programa
+	* @param y Valor buscado
+	* @return Falso si y está fuera de los límites de eval()
+	*/
+	bool mayContain(const Interval * inputs, double y = 0.0) const {
+		return eval(inputs).contains(y);
+	}
+
+	/**
+	* @brief Retorna el programa compilado
+	*/
+	const CompiledExpression & compiled() const {
+		return *program;
+	}
+
+	/**
+	* @brief Suma de intervalos
+	*/
+	static Interval add(Interval a, Interval b) {
+		if (a.isEmpty() || b.isEmpty()) {
+			return Interval::empty();
+		}
+		return {down(a.lo + b.lo), up(a.hi + b.hi)};
+	}
+
+	/**
+	* @brief Resta de intervalos
+	*/
+	static Interval sub(Interval a, Interval b) {
+		if (a.isEmpty() || b.isEmpty()) {
+			return Interval::empty();
+		}
+		return {down(a.lo - b.hi), up(a.hi - b.lo)};
+	}
+
+	/**
+	* @brief Producto de intervalos
+	*/
+	static Interval mul(Interval a, Interval b) {
+		if (a.isEmpty() || b.isEmpty()) {
+			return Interval::empty();
+		}
+		return hull(a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi, 1);
+	}
+
+	/**
+	* @brief Cociente de intervalos; entire() si el divisor contiene 0
+	*/
+	static Interval div(Interval a, Interval b) {
+		if (a.isEmpty() || b.isEmpty()) {
+			return Interval::empty();
+		}
+		if (b.contains(0.0)) {
+			return Interval::entire();
+		}
+		return hull(a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi, 1);
+	}
+
+	/**
+	* @brief Potencia de intervalos, a^b
+	*/
+	static Interval pow(Interval a, Interval b) {
+		if (a.isEmpty() || b.isEmpty()) {
+			return Interval::empty();
+		}
+		if (b.lo == b.hi && b.lo == std::nearbyint(b.lo) && std::fabs(b.lo) < 9007199254740992.0) {
+			return powi(a, b.lo);
+		}
+		if (a.lo < 0) {
+			if (b.lo != b.hi) {
+				return Interval::entire();
+			}
+			//pow(-1, ±inf) = 1 y pow(-2, ±inf) es 0 o inf
+			if (std::isinf(b.lo)) {
+				return Interval::entire();
+			}
+			//Con un exponente no entero, las bases negativas producen NAN
+			if (a.hi < 0) {
+				return Interval::empty();
+			}
+			a.lo = 0.0;
+		}
+		//a^b = exp(b ln a) es bilineal en (ln a, b): los extremos están en las esquinas
+		return hull(std::pow(a.lo, b.lo), std::pow(a.lo, b.hi), std::pow(a.hi, b.lo), std::pow(a.hi, b.hi), 2);
+	}
+
+	/**
+	* @brief Operación unaria o función predefinida sobre un intervalo
+	* @param a Operando
+	* @param op Código de operación
+	* @return Intervalo del resultado
+	*/
+	static Interval unary(Interval a, OpCode op) {
+		if (a.isEmpty()) {
+			return Interval::empty();
+		}
+		switch (op) {
+			case OpCode::Neg:
+				return {-a.hi, -a.lo};
+			case OpCode::Abs:
+				if (a.lo >= 0) {
+					return a;
+				}
+				if (a.hi <= 0) {
+					return {-a.hi, -a.lo};
+				}
+				return {0.0, std::max(-a.lo, a.hi)};
+			case OpCode::Sqrt:
+				if (a.hi < 0) {
+					return Interval::empty();
+				}
+				return {std::max(0.0, down(std::sqrt(std::max(a.lo, 0.0)))), up(std::sqrt(a.hi))};
+			case OpCode::Ln:
+			case OpCode::Log:
+				if (a.hi < 0) {
+					return Interval::empty();
+				}
+				return {down(logarithm(std::max(a.lo, 0.0), op), 2), up(logarithm(a.hi, op), 2)};
+			case OpCode::Exp:
+				return {std::max(0.0, down(std::exp(a.lo), 2)), up(std::exp(a.hi), 2)};
+			case OpCode::Sin:
+				return periodic(a, 0.0);
+			case OpCode::Cos:
+				return periodic(a, PI / 2);
+			case OpCode::Tan:
+				if (!std::isfinite(a.lo) || !std::isfinite(a.hi) || passes(a.lo, a.hi, PI / 2, PI)) {
+					return Interval::entire();
+				}
+				return {down(std::tan(a.lo), 2), up(std::tan(a.hi), 2)};
+			default:
+				return Interval::entire();
+		}
+	}
+
+private:
+	/** Aproximación de pi; passes() compensa su error con un margen */
+	static constexpr double PI = 3.14159265358979323846;
+
+	/**
+	* @brief Intervalo del resultado de una instrucción, e indicador de resultados NAN
+	*/
+	struct Value {
+		Interval range; /*!< Límites de los resultados que no son NAN */
+		bool nan; /*!< Verdadero si algún resultado puede ser NAN */
+	};
+
+	std::shared_ptr<const CompiledExpression> program; /*!< Programa compilado */
+
+	/**
+	* @brief Ejecuta el programa sobre una pila de intervalos
+	*/
+	Value run(const Interval * inputs, Value * st) const {
+		const vector<CustomFunction> & functions = program->customFunctions();
+		size_t depth = program->stackSize() - program->temporaries();
+		size_t top = 0;
+
+		for (auto & ins: program->instructions()) {
+			switch (ins.op) {
+				case OpCode::Const:
+					st[top++] = {Interval::point(ins.val), ins.val != ins.val};
+					break;
+				case OpCode::Load:
+					st[top++] = {inputs[ins.arg], inputs[ins.arg].isEmpty()};
+					break;
+				case OpCode::Store:
+					st[depth + ins.arg] = st[top - 1];
+					break;
+				case OpCode::Temp:
+					st[top++] = st[depth + ins.arg];
+					break;
+				case OpCode::Call: {
+					OpCode op = functions[ins.arg].op;
+					if (op == OpCode::Call) {
+						st[top - 1] = {Interval::entire(), true};
+					}else {
+						st[top - 1] = {unary(st[top - 1].range, op), st[top - 1].nan || domain(st[top - 1].range, op)};
+					}
+					break;
+				}
+				case OpCode::CallN:
+					top -= ins.count;
+					if (functions[ins.arg].op == OpCode::Pow && ins.count == 2) {
+						st[top] = binary(st[top], st[top + 1], OpCode::Pow);
+					}else {
+						st[top] = call(functions[ins.arg], st + top, ins.count);
+					}
+					top++;
+					break;
+				case OpCode::Add:
+				case OpCode::Sub:
+				case OpCode::Mul:
+				case OpCode::Div:
+				case OpCode::Pow:
+					top--;
+					st[top - 1] = binary(st[top - 1], st[top], ins.op);
+					break;
+				case OpCode::Lt:
+				case OpCode::Le:
+				case OpCode::Gt:
+				case OpCode::Ge:
+				case OpCode::Eq:
+				case OpCode::Ne:
+					top--;
+					st[top - 1] = compare(st[top - 1], st[top], ins.op);
+					break;
+				case OpCode::And:
+					top--;
+					st[top - 1] = truth(canBeFalse(st[top - 1]) || canBeFalse(st[top]), canBeTrue(st[top - 1]) && canBeTrue(st[top]));
+					break;
+				case OpCode::Or:
+					top--;
+					st[top - 1] = truth(canBeFalse(st[top - 1]) && canBeFalse(st[top]), canBeTrue(st[top - 1]) || canBeTrue(st[top]));
+					break;
+				case OpCode::Not:
+					st[top - 1] = truth(canBeTrue(st[top - 1]), canBeFalse(st[top - 1]));
+					break;
+				case OpCode::Select: {
+					//Solo cuentan las ramas que la condición puede elegir
+					top -= 2;
+					bool t = canBeTrue(st[top - 1]);
+					bool f = canBeFalse(st[top - 1]);
+					Value a = t ? st[top] : Value{Interval::empty(), false};
+					Value b = f ? st[top + 1] : Value{Interval::empty(), false};
+					st[top - 1] = {join(a.range, b.range), a.nan || b.nan};
+					break;
+				}
+				default:
+					st[top - 1] = {unary(st[top - 1].range, ins.op), st[top - 1].nan || domain(st[top - 1].range, ins.op)};
+					break;
+			}
+		}
+		return st[0];
+	}
+
+	/**
+	* @brief Operación binaria, con los casos que pueden producir NAN
+	*/
+	static Value binary(Value a, Value b, OpCode op) {
+		const Interval & x = a.range;
+		const Interval & y = b.range;
+		bool nan = a.nan || b.nan;
+		bool xinf = std::isinf(x.lo) || std::isinf(x.hi);
+		bool yinf = std::isinf(y.lo) || std::isinf(y.hi);
+		switch (op) {
+			case OpCode::Add:
+				//inf + -inf
+				nan = nan || (x.hi == HUGE_VAL && y.lo == -HUGE_VAL) || (x.lo == -HUGE_VAL && y.hi == HUGE_VAL);
+				return {add(x, y), nan};
+			case OpCode::Sub:
+				nan = nan || (x.hi == HUGE_VAL && y.hi == HUGE_VAL) || (x.lo == -HUGE_VAL && y.lo == -HUGE_VAL);
+				return {sub(x, y), nan};
+			case OpCode::Mul:
+				//0 * inf
+				nan = nan || (x.contains(0.0) && yinf) || (y.contains(0.0) && xinf);
+				return {mul(x, y), nan};
+			case OpCode::Div:
+				//0 / 0, inf / inf
+				nan = nan || (x.contains(0.0) && y.contains(0.0)) || (xinf && yinf);
+				return {div(x, y), nan};
+			default: {
+				//pow(NAN, 0) = pow(1, NAN) = 1: un operando NAN no se propaga si el otro lo anula
+				bool one = ((a.nan || x.isEmpty()) && y.contains(0.0)) || ((b.nan || y.isEmpty()) && x.contains(1.0));
+				if ((x.lo == 1.0 && x.hi == 1.0 && !a.nan) || (y.lo == 0.0 && y.hi == 0.0 && !b.nan)) {
+					return {Interval::point(1.0), false};
+				}
+				bool integer = y.lo == y.hi && y.lo == std::nearbyint(y.lo);
+				nan = nan || (x.lo < 0 && !integer);
+				Interval r = pow(x, y);
+				return {one ? join(r, Interval::point(1.0)) : r, nan};
+			}
+		}
+	}
+
+	/**
+	* @brief Comparación, que nunca produce NAN: con un operando NAN solo != se cumple
+	*/
+	static Value compare(Value a, Value b, OpCode op) {
+		const Interval & x = a.range;
+		const Interval & y = b.range;
+		bool nan = a.nan || b.nan || x.isEmpty() || y.isEmpty();
+		bool defined = !x.isEmpty() && !y.isEmpty();
+		//Algún par de valores cumple la comparación (t) o no la cumple (f)
+		bool t;
+		bool f;
+		switch (op) {
+			case OpCode::Lt:
+				t = defined && x.lo < y.hi;
+				f = nan || x.hi >= y.lo;
+				break;
+			case OpCode::Le:
+				t = defined && x.lo <= y.hi;
+				f = nan || x.hi > y.lo;
+				break;
+			case OpCode::Gt:
+				t = defined && x.hi > y.lo;
+				f = nan || x.lo <= y.hi;
+				break;
+			case OpCode::Ge:
+				t = defined && x.hi >= y.lo;
+				f = nan || x.lo < y.hi;
+				break;
+			default: {
+				bool equal = defined && x.lo <= y.hi && y.lo <= x.hi;
+				bool different = nan || x.lo != x.hi || y.lo != y.hi || x.lo != y.lo;
+				t = (op == OpCode::Eq) ? equal : different;
+				f = (op == OpCode::Eq) ? different : equal;
+				break;
+			}
+		}
+		return truth(f, t);
+	}
+
+	/**
+	* @brief Resultado de una comparación o de un operador lógico
+	* @param f Verdadero si el resultado puede ser 0
+	* @param t Verdadero si el resultado puede ser 1
+	*/
+	static Value truth(bool f, bool t) {
+		if (!f && !t) {
+			return {Interval::empty(), false};
+		}
+		return {{f ? 0.0 : 1.0, t ? 1.0 : 0.0}, false};
+	}
+
+	/**
+	* @brief Verifica si un valor puede ser distinto de 0, que incluye NAN
+	*/
+	static bool canBeTrue(const Value & v) {
+		return v.nan || (!v.range.isEmpty() && !(v.range.lo == 0.0 && v.range.hi == 0.0));
+	}
+
+	/**
+	* @brief Verifica si un valor puede ser 0
+	*/
+	static bool canBeFalse(const Value & v) {
+		return v.range.contains(0.0);
+	}
+
+	/**
+	* @brief Unión de dos intervalos, ignorando los vacíos
+	*/
+	static Interval join(Interval a, Interval b) {
+		if (a.isEmpty()) {
+			return b;
+		}
+		if (b.isEmpty()) {
+			return a;
+		}
+		return {std::min(a.lo, b.lo), std::max(a.hi, b.hi)};
+	}
+
+	/**
+	* @brief Verifica si una operación unaria puede producir NAN sobre un intervalo
+	*/
+	static bool domain(Interval a, OpCode op) {
+		switch (op) {
+			case OpCode::Sqrt:
+			case OpCode::Ln:
+			case OpCode::Log:
+				return a.lo < 0;
+			case OpCode::Sin:
+			case OpCode::Cos:
+			case OpCode::Tan:
+				return std::isinf(a.lo) || std::isinf(a.hi);
+			default:
+				return false;
+		}
+	}
+
+	/**
+	* @brief Función de varios argumentos: min, max, clamp, atan2 e hypot de defaultFunctions()
+	* @param f Función
+	* @param x Argumentos
+	* @param n Cantidad de argumentos
+	* @return Intervalo del resultado, entire() para las demás funciones
+	*/
+	static Value call(const CustomFunction & f, const Value * x, size_t n) {
+		const char * name = nullptr;
+		for (auto & b: BUILTIN_MULTI_FUNCTIONS) {
+			if (f.fnArgs != nullptr && f.fnArgs == b.fn) {
+				name = b.name;
+			}
+		}
+		string fn = (name != nullptr) ? name : "";
+		if (fn == "min" || fn == "max") {
+			return extreme(x, n, fn == "max");
+		}
+		if (fn == "clamp") {
+			Value lower = extreme(x, 2, true);
+			Value args[2] = {lower, x[2]};
+			return extreme(args, 2, false);
+		}
+		bool nan = x[0].nan || x[1].nan;
+		if (fn == "atan2") {
+			if (x[0].range.isEmpty() || x[1].range.isEmpty()) {
+				return {Interval::empty(), true};
+			}
+			return {{down(-PI, 2), up(PI, 2)}, nan};
+		}
+		if (fn == "hypot") {
+			Interval a = unary(x[0].range, OpCode::Abs);
+			Interval b = unary(x[1].range, OpCode::Abs);
+			if (a.isEmpty() || b.isEmpty()) {
+				return {Interval::empty(), true};
+			}
+			return {{std::max(0.0, down(std::hypot(a.lo, b.lo), 2)), up(std::hypot(a.hi, b.hi), 2)}, nan};
+		}
+		return {Interval::entire(), true};
+	}
+
+	/**
+	* @brief Mínimo o máximo de varios argumentos, que ignora los argumentos NAN como vmath::minimum()
+	*
+	* El resultado es el extremo de los argumentos que no son NAN en cada punto: el límite del lado
+	* opuesto al extremo solo lo acotan los argumentos que nunca son NAN.
+	* @param x Argumentos
+	* @param n Cantidad de argumentos
+	* @param maximum Verdadero para el máximo
+	* @return Intervalo del resultado
+	*/
+	static Value extreme(const Value * x, size_t n, bool maximum) {
+		double near = NAN;
+		double farDefined = NAN;
+		double farAny = NAN;
+		bool nan = true;
+		for (size_t j = 0; j < n; j++) {
+			const Interval & r = x[j].range;
+			if (r.isEmpty()) {
+				continue;
+			}
+			double a = maximum ? r.hi : r.lo;
+			double b = maximum ? r.lo : r.hi;
+			near = (near != near) ? a : (maximum ? std::max(near, a) : std::min(near, a));
+			farAny = (farAny != farAny) ? b : (maximum ? std::min(farAny, b) : std::max(farAny, b));
+			if (!x[j].nan) {
+				farDefined = (farDefined != farDefined) ? b : (maximum ? std::max(farDefined, b) : std::min(farDefined, b));
+				nan = false;
+			}
+		}
+		if (near != near) {
+			return {Interval::empty(), true};
+		}
+		double far = (farDefined == farDefined) ? farDefined : farAny;
+		return maximum ? Value{{far, near}, nan} : Value{{near, far}, nan};
+	}
+
+	/**
+	* @brief Potencia con exponente entero
+	*/
+	static Interval powi(Interval a, double k) {
+		if (k == 0) {
+			return Interval::point(1.0);
+		}
+		if (k < 0) {
+			Interval p = powi(a, -k);
+			return div(Interval::point(1.0), p);
+		}
+		bool odd = std::fmod(k, 2.0) != 0.0;
+		if (odd) {
+			return {down(std::pow(a.lo, k), 2), up(std::pow(a.hi, k), 2)};
+		}
+		Interval m = unary(a, OpCode::Abs);
+		return {std::max(0.0, down(std::pow(m.lo, k), 2)), up(std::pow(m.hi, k), 2)};
+	}
+
+	/**
+	* @brief Seno sobre un intervalo desplazado: sin(x + shift), con shift 0 o pi/2 (coseno)
+	*/
+	static Interval periodic(Interval a, double shift) {
+		if (!std::isfinite(a.lo) || !std::isfinite(a.hi) || a.hi - a.lo >= 2 * PI ||
+				std::max(std::fabs(a.lo), std::fabs(a.hi)) > 1e8) {
+			return {-1.0, 1.0};
+		}
+		double fa = (shift == 0.0) ? std::sin(a.lo) : std::cos(a.lo);
+		double fb = (shift == 0.0) ? std::sin(a.hi) : std::cos(a.hi);
+		Interval r = {std::max(-1.0, down(std::min(fa, fb), 2)), std::min(1.0, up(std::max(fa, fb), 2))};
+		//Máximos en x + shift = pi/2 + 2k pi, mínimos en x + shift = -pi/2 + 2k pi
+		if (passes(a.lo, a.hi, PI / 2 - shift, 2 * PI)) {
+			r.hi = 1.0;
+		}
+		if (passes(a.lo, a.hi, -PI / 2 - shift, 2 * PI)) {
+			r.lo = -1.0;
+		}
+		return r;
+	}
+
+	/**
+	* @brief Verifica si algún punto phase + k * period está en [lo, hi], con un margen por el error de pi
+	*/
+	static bool passes(double lo, double hi, double phase, double period) {
+		double margin = 1e-9 * (1.0 + std::max(std::fabs(lo), std::fabs(hi)));
+		double k = std::ceil((lo - margin - phase) / period);
+		return phase + k * period <= hi + margin;
+	}
+
+	/**
+	* @brief Logaritmo natural o en base 10
+	*/
+	static double logarithm(double x, OpCode op) {
+		return (op == OpCode::Ln) ? std::log(x) : std::log10(x);
+	}
+
+	/**
+	* @brief Intervalo de cuatro valores, ampliado ulps; entire() si alguno es NAN
+	*/
+	static Interval hull(double a, double b, double c, double d, int ulps) {
+		if (a != a || b != b || c != c || d != d) {
+			return Interval::entire();
+		}
+		return {down(std::min({a, b, c, d}), ulps), up(std::max({a, b, c, d}), ulps)};
+	}
+
+	/**
+	* @brief Redondea hacia abajo un límite finito
+	*/
+	static double down(double x, int ulps = 1) {
+		for (int i = 0; i < ulps && std::isfinite(x); i++) {
+			x = std::nextafter(x, -HUGE_VAL);
+		}
+		return x;
+	}
+
+	/**
+	* @brief Redondea hacia arriba un límite finito
+	*/
+	static double up(double x, int ulps = 1) {
+		for (int i = 0; i < ulps && std::isfinite(x); i++) {
+			x = std::nextafter(x, HUGE_VAL);
+		}
+		return x;
+	}
+};
+
+#endif
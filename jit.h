@@ -0,0 +1,592 @@
+#ifndef JIT_H
+#define JIT_H
+
+/**
+* @file
+* Compilación a código nativo de los programas compilados de las expresiones
+* Traduce las instrucciones de un CompiledExpression a una función x86-64 (System V) con la
+* pila de evaluación en los registros xmm0-xmm14. Las funciones y pow se invocan con la
+* convención de llamadas de C, guardando los registros de la pila en el marco de la función;
+* las funciones de varios argumentos reciben sus argumentos en el marco, como un arreglo.
+* Las comparaciones, los operadores lógicos e if(c, a, b) se traducen sin saltos, con máscaras
+* de cmpsd combinadas con andpd, andnpd y orpd. En otras plataformas, o si se define EXPRESSION_NO_JIT, NativeExpression usa el intérprete.
+* @author Erwin Meza Vega <emezav@unicauca.edu.co>
+* @copyright MIT License
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "expression.h"
+
+#if defined(__x86_64__) && defined(__linux__) && !defined(EXPRESSION_NO_JIT)
+/** Plataforma soportada por el compilador a código nativo */
+#define EXPRESSION_JIT 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/**
+* @brief Expresión compilada a código nativo, con el intérprete como alternativa
+*
+* La compilación es explícita: solo conviene para las expresiones que se evalúan muchas veces.
+* Si la plataforma no está soportada, el programa no es válido o su pila excede MAX_DEPTH
+* valores, las evaluaciones se delegan a CompiledExpression::eval(). El código nativo produce
+* los mismos valores que el intérprete. Una instancia se puede compartir entre hilos.
+*/
+class NativeExpression {
+public:
+	/** Función nativa: recibe los valores de entrada y retorna el resultado */
+	typedef double (*Function)(const double * values);
+
+	/** Profundidad máxima de la pila que se mantiene en registros */
+	static const size_t MAX_DEPTH = 15;
+
+	/**
+	* @brief Compila un programa a código nativo
+	* @param program Programa compilado, con las variables en el orden de sus valores de entrada
+	*/
+	explicit NativeExpression(std::shared_ptr<const CompiledExpression> program):
+		program(std::move(program)), function(nullptr), memory(nullptr), size(0) {
+#ifdef EXPRESSION_JIT
+		size_t depth = this->program->stackSize() - this->program->temporaries();
+		if (this->program->isValid() && depth <= MAX_DEPTH) {
+			Emitter emitter(*this->program);
+			if (emitter.emit()) {
+				install(emitter.code);
+			}
+		}
+#endif
+	}
+
+	/**
+	* @brief Compila el programa de una expresión, con las variables asociadas mediante bind()
+	* @param expr Expresión
+	*/
+	explicit NativeExpression(expression & expr): NativeExpression(expr.compiled()) {
+	}
+
+	NativeExpression(const NativeExpression &) = delete;
+	NativeExpression & operator=(const NativeExpression &) = delete;
+
+	/**
+	* @brief Libera el código nativo
+	*/
+	~NativeExpression() {
+#ifdef EXPRESSION_JIT
+		if (memory != nullptr) {
+			munmap(memory, size);
+		}
+#endif
+	}
+
+	/**
+	* @brief Verifica si la plataforma permite compilar a código nativo
+	* @return Verdadero si la plataforma está soportada
+	*/
+	static bool available() {
+#ifdef EXPRESSION_JIT
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	/**
+	* @brief Verifica si el programa se compiló a código nativo
+	* @return Verdadero si las evaluaciones ejecutan código nativo
+	*/
+	bool isNative() const {
+		return function != nullptr;
+	}
+
+	/**
+	* @brief Retorna la función nativa
+	* @return Función nativa, nullptr si la evaluación usa el intérprete
+	*/
+	Function native() const {
+		return function;
+	}
+
+	/**
+	* @brief Retorna el programa compilado
+	* @return Programa que se compiló a código nativo
+	*/
+	const std::shared_ptr<const CompiledExpression> & compiled() const {
+		return program;
+	}
+
+	/**
+	* @brief Evalúa la expresión
+	* @param values Valores de entrada, en el orden de compiled()->variables()
+	* @return Resultado de la expresión, NAN si no es válida
+	*/
+	double eval(const double * values) const {
+		if (function != nullptr) {
+			return function(values);
+		}
+		return program->eval(values);
+	}
+
+	/**
+	* @brief Sobrecarga del operador ()
+	* @param values Valores de entrada, en el orden de compiled()->variables()
+	* @return Resultado de la expresión, NAN si no es válida
+	*/
+	double operator()(const double * values) const {
+		return eval(values);
+	}
+
+private:
+#ifdef EXPRESSION_JIT
+	/**
+	* @brief Generador de código x86-64
+	*
+	* La posición i de la pila de evaluación se mantiene en xmm(i); xmm15 es temporal.
+	* rbx conserva el apuntador a los valores de entrada, [rsp, rsp + 8 * MAX_DEPTH)
+	* guarda los registros de la pila durante las llamadas y los temporales del programa
+	* se almacenan a partir de [rsp + SPILL].
+	*/
+	struct Emitter {
+		explicit Emitter(const CompiledExpression & p): program(p),
+			frame((uint32_t) ((SPILL + p.temporaries() * sizeof(double) + 15) / 16 * 16)) {
+		}
+
+		/**
+		* @brief Genera el código del programa
+		* @return Verdadero si todas las instrucciones se pudieron traducir
+		*/
+		bool emit() {
+			size_t top = 0;
+
+			byte(0x53); // push rbx
+			bytes({0x48, 0x89, 0xFB}); // mov rbx, rdi
+			bytes({0x48, 0x81, 0xEC}); // sub rsp, frame
+			imm32(frame);
+
+			for (auto & ins: program.instructions()) {
+				switch (ins.op) {
+					case OpCode::Const: {
+						uint64_t bits;
+						std::memcpy(&bits, &ins.val, sizeof bits);
+						movImm(bits);
+						movq(top);
+						top++;
+						break;
+					}
+					case OpCode::Load:
+						if (ins.arg > 0x0FFFFFFF) {
+							return false;
+						}
+						movsd(0x10, top, 3); // movsd xmm(top), [rbx + disp32]
+						imm32((uint32_t) (ins.arg * sizeof(double)));
+						top++;
+						break;
+					case OpCode::Store:
+						movsd(0x11, top - 1, 4); // movsd [rsp + disp32], xmm(top - 1)
+						imm32((uint32_t) (SPILL + ins.arg * sizeof(double)));
+						break;
+					case OpCode::Temp:
+						movsd(0x10, top, 4); // movsd xmm(top), [rsp + disp32]
+						imm32((uint32_t) (SPILL + ins.arg * sizeof(double)));
+						top++;
+						break;
+					case OpCode::Add:
+						arith(0x58, top);
+						top--;
+						break;
+					case OpCode::Sub:
+						arith(0x5C, top);
+						top--;
+						break;
+					case OpCode::Mul:
+						arith(0x59, top);
+						top--;
+						break;
+					case OpCode::Div:
+						arith(0x5E, top);
+						top--;
+						break;
+					case OpCode::Pow:
+						call2(top - 2, (void *) +[](double a, double b) -> double { return pow(a, b); });
+						top--;
+						break;
+					case OpCode::Neg:
+						movImm(0x8000000000000000ull);
+						movq(15);
+						reg(0x66, 0x57, top - 1, 15); // xorpd
+						break;
+					case OpCode::Abs:
+						movImm(0x7FFFFFFFFFFFFFFFull);
+						movq(15);
+						reg(0x66, 0x54, top - 1, 15); // andpd
+						break;
+					case OpCode::Sqrt:
+						reg(0xF2, 0x51, top - 1, top - 1); // sqrtsd
+						break;
+					case OpCode::Lt:
+						compare(top - 2, top - 1, 1, false);
+						top--;
+						break;
+					case OpCode::Le:
+						compare(top - 2, top - 1, 2, false);
+						top--;
+						break;
+					case OpCode::Gt:
+						compare(top - 2, top - 1, 1, true);
+						top--;
+						break;
+					case OpCode::Ge:
+						compare(top - 2, top - 1, 2, true);
+						top--;
+						break;
+					case OpCode::Eq:
+						compare(top - 2, top - 1, 0, false);
+						top--;
+						break;
+					case OpCode::Ne:
+						compare(top - 2, top - 1, 4, false);
+						top--;
+						break;
+					case OpCode::And:
+					case OpCode::Or:
+						nonZero(top - 2);
+						nonZero(top - 1);
+						reg(0x66, (ins.op == OpCode::And) ? 0x54 : 0x56, top - 2, top - 1); // andpd, orpd
+						one(top - 2);
+						top--;
+						break;
+					case OpCode::Not:
+						reg(0x66, 0x57, 15, 15); // xorpd xmm15, xmm15
+						cmp(top - 1, 15, 0); // cmpeqsd
+						one(top - 1);
+						break;
+					case OpCode::Select:
+						//(a & m) | (b & ~m), con m = (c != 0)
+						nonZero(top - 3);
+						reg(0x66, 0x54, top - 2, top - 3); // andpd
+						reg(0x66, 0x55, top - 3, top - 1); // andnpd
+						reg(0x66, 0x56, top - 3, top - 2); // orpd
+						top -= 2;
+						break;
+					case OpCode::Call: {
+						const CustomFunction & f = program.customFunctions()[ins.arg];
+						if (f.fn != nullptr) {
+							call1(top - 1, (void *) f.fn, nullptr);
+						}else {
+							call1(top - 1, (void *) &invoke, &f);
+						}
+						break;
+					}
+					case OpCode::CallN:
+						callArgs(top, top - ins.count, ins.count, program.customFunctions()[ins.arg]);
+						top = top - ins.count + 1;
+						break;
+					default: {
+						double (*fn)(double) = nullptr;
+						for (auto & b: BUILTIN_FUNCTIONS) {
+							if (b.op == ins.op) {
+								fn = b.fn;
+							}
+						}
+						if (fn == nullptr) {
+							return false;
+						}
+						call1(top - 1, (void *) fn, nullptr);
+						break;
+					}
+				}
+			}
+
+			//El resultado queda en xmm0
+			bytes({0x48, 0x81, 0xC4}); // add rsp, frame
+			imm32(frame);
+			byte(0x5B); // pop rbx
+			byte(0xC3); // ret
+			return true;
+		}
+
+		/**
+		* @brief Invoca una función personalizada definida con std::function
+		* @param f Función
+		* @param x Valor de la variable
+		* @return Valor de la función en x
+		*/
+		static double invoke(const CustomFunction * f, double x) {
+			return (*f)(x);
+		}
+
+		/**
+		* @brief Invoca una función personalizada de varios argumentos
+		* @param f Función
+		* @param x Valores de los argumentos
+		* @param n Cantidad de argumentos
+		* @return Valor de la función
+		*/
+		static double invokeArgs(const CustomFunction * f, const double * x, size_t n) {
+			return (*f)(x, n);
+		}
+
+		/**
+		* @brief Invoca una función de varios argumentos sobre xmm(first) a xmm(first + n - 1)
+		*
+		* Al guardar los registros de la pila en el marco, los argumentos quedan en posiciones
+		* consecutivas de [rsp]: la función recibe su dirección como el arreglo de argumentos.
+		* @param top Tope de la pila
+		* @param first Posición de la pila del primer argumento y del resultado
+		* @param n Cantidad de argumentos
+		* @param f Función
+		*/
+		void callArgs(size_t top, size_t first, size_t n, const CustomFunction & f) {
+			spill(top, 0x11);
+			if (f.fnArgs != nullptr) {
+				lea(7, first); // lea rdi, [rsp + 8 * first]
+				byte(0xBE); // mov esi, imm32
+				imm32((uint32_t) n);
+				callRax((void *) f.fnArgs);
+			}else {
+				bytes({0x48, 0xBF}); // mov rdi, imm64
+				imm64((uint64_t) (uintptr_t) &f);
+				lea(6, first); // lea rsi, [rsp + 8 * first]
+				byte(0xBA); // mov edx, imm32
+				imm32((uint32_t) n);
+				callRax((void *) &invokeArgs);
+			}
+			if (first != 0) {
+				reg(0x66, 0x28, first, 0); // movapd xmm(first), xmm0
+			}
+			spill(first, 0x10);
+		}
+
+		/**
+		* @brief lea r, [rsp + 8 * slot] para un registro entero r (rsi = 6, rdi = 7)
+		*/
+		void lea(unsigned char r, size_t slot) {
+			bytes({0x48, 0x8D});
+			byte((unsigned char) (0x80 | (r << 3) | 4));
+			byte(0x24); // SIB: [rsp]
+			imm32((uint32_t) (slot * sizeof(double)));
+		}
+
+		/**
+		* @brief Invoca una función de una variable sobre xmm(slot)
+		* @param slot Posición de la pila con el argumento y el resultado
+		* @param fn Dirección de la función
+		* @param arg Primer argumento entero (rdi), nullptr si la función no lo recibe
+		*/
+		void call1(size_t slot, void * fn, const void * arg) {
+			spill(slot, 0x11);
+			if (slot != 0) {
+				reg(0x66, 0x28, 0, slot); // movapd xmm0, xmm(slot)
+			}
+			if (arg != nullptr) {
+				bytes({0x48, 0xBF}); // mov rdi, imm64
+				imm64((uint64_t) (uintptr_t) arg);
+			}
+			callRax(fn);
+			if (slot != 0) {
+				reg(0x66, 0x28, slot, 0); // movapd xmm(slot), xmm0
+			}
+			spill(slot, 0x10);
+		}
+
+		/**
+		* @brief Invoca una función de dos variables sobre xmm(slot) y xmm(slot + 1)
+		* @param slot Posición de la pila con el primer argumento y el resultado
+		* @param fn Dirección de la función
+		*/
+		void call2(size_t slot, void * fn) {
+			spill(slot, 0x11);
+			if (slot != 0) {
+				reg(0x66, 0x28, 0, slot); // movapd xmm0, xmm(slot)
+				reg(0x66, 0x28, 1, slot + 1); // movapd xmm1, xmm(slot + 1)
+			}
+			callRax(fn);
+			if (slot != 0) {
+				reg(0x66, 0x28, slot, 0); // movapd xmm(slot), xmm0
+			}
+			spill(slot, 0x10);
+		}
+
+		/**
+		* @brief Guarda (0x11) o restaura (0x10) los registros xmm0 a xmm(count - 1)
+		* @param count Cantidad de registros
+		* @param op Código de movsd
+		*/
+		void spill(size_t count, unsigned char op) {
+			for (size_t i = 0; i < count; i++) {
+				movsd(op, i, 4); // movsd [rsp + disp32] <-> xmm(i)
+				imm32((uint32_t) (i * sizeof(double)));
+			}
+		}
+
+		/**
+		* @brief Operador binario escalar: xmm(top - 2) op= xmm(top - 1)
+		*/
+		void arith(unsigned char op, size_t top) {
+			reg(0xF2, op, top - 2, top - 1);
+		}
+
+		/**
+		* @brief Comparación: xmm(a) = (xmm(a) op xmm(b)) ? 1.0 : 0.0
+		* @param a Primer operando y resultado
+		* @param b Segundo operando, se sobrescribe
+		* @param predicate Predicado de cmpsd: 0 igual, 1 menor, 2 menor o igual, 4 distinto
+		* @param swap Verdadero para comparar xmm(b) op xmm(a), i.e. mayor y mayor o igual
+		*/
+		void compare(size_t a, size_t b, unsigned char predicate, bool swap) {
+			if (swap) {
+				cmp(b, a, predicate);
+				reg(0x66, 0x28, a, b); // movapd xmm(a), xmm(b)
+			}else {
+				cmp(a, b, predicate);
+			}
+			one(a);
+		}
+
+		/**
+		* @brief cmpsd xmm(dst), xmm(src), predicate: xmm(dst) recibe una máscara de unos o de ceros
+		*/
+		void cmp(size_t dst, size_t src, unsigned char predicate) {
+			reg(0xF2, 0xC2, dst, src);
+			byte(predicate);
+		}
+
+		/**
+		* @brief Reemplaza xmm(slot) por la máscara de xmm(slot) != 0, verdadera para NAN
+		*/
+		void nonZero(size_t slot) {
+			reg(0x66, 0x57, 15, 15); // xorpd xmm15, xmm15
+			cmp(slot, 15, 4); // cmpneqsd
+		}
+
+		/**
+		* @brief Convierte la máscara de xmm(slot) en 1.0 o 0.0
+		*/
+		void one(size_t slot) {
+			movImm(0x3FF0000000000000ull);
+			movq(15);
+			reg(0x66, 0x54, slot, 15); // andpd
+		}
+
+		/**
+		* @brief Instrucción SSE entre registros
+		*/
+		void reg(unsigned char prefix, unsigned char op, size_t dst, size_t src) {
+			byte(prefix);
+			rex(false, dst, src);
+			bytes({0x0F, op});
+			byte((unsigned char) (0xC0 | ((dst & 7) << 3) | (src & 7)));
+		}
+
+		/**
+		* @brief movsd entre un registro y [rbx + disp32] (base 3) o [rsp + disp32] (base 4)
+		*
+		* El desplazamiento se agrega después con imm32().
+		* @param op 0x10 para cargar el registro, 0x11 para almacenarlo
+		*/
+		void movsd(unsigned char op, size_t r, int base) {
+			byte(0xF2);
+			rex(false, r, 0);
+			bytes({0x0F, op});
+			byte((unsigned char) (0x80 | ((r & 7) << 3) | base));
+			if (base == 4) {
+				byte(0x24); // SIB: [rsp]
+			}
+		}
+
+		/**
+		* @brief movq xmm(dst), rax
+		*/
+		void movq(size_t dst) {
+			byte(0x66);
+			rex(true, dst, 0);
+			bytes({0x0F, 0x6E});
+			byte((unsigned char) (0xC0 | ((dst & 7) << 3)));
+		}
+
+		/**
+		* @brief mov rax, imm64
+		*/
+		void movImm(uint64_t value) {
+			bytes({0x48, 0xB8});
+			imm64(value);
+		}
+
+		/**
+		* @brief mov rax, imm64; call rax
+		*/
+		void callRax(void * fn) {
+			movImm((uint64_t) (uintptr_t) fn);
+			bytes({0xFF, 0xD0});
+		}
+
+		/**
+		* @brief Prefijo REX, si lo requieren los registros o el tamaño del operando
+		*/
+		void rex(bool w, size_t r, size_t b) {
+			unsigned char v = (unsigned char) (0x40 | (w ? 8 : 0) | ((r & 8) ? 4 : 0) | ((b & 8) ? 1 : 0));
+			if (v != 0x40) {
+				byte(v);
+			}
+		}
+
+		void byte(unsigned char b) {
+			code.push_back(b);
+		}
+
+		void bytes(std::initializer_list<unsigned char> b) {
+			code.insert(code.end(), b);
+		}
+
+		void imm32(uint32_t v) {
+			for (int i = 0; i < 4; i++) {
+				byte((unsigned char) (v >> (8 * i)));
+			}
+		}
+
+		void imm64(uint64_t v) {
+			for (int i = 0; i < 8; i++) {
+				byte((unsigned char) (v >> (8 * i)));
+			}
+		}
+
+		/** Espacio del marco para los registros de la pila, múltiplo de 16 para alinear las llamadas */
+		static const uint32_t SPILL = 128;
+
+		const CompiledExpression & program; /*!< Programa a traducir */
+		uint32_t frame; /*!< Tamaño del marco: registros de la pila y temporales, múltiplo de 16 */
+		std::vector<unsigned char> code; /*!< Código generado */
+	};
+
+	/**
+	* @brief Copia el código generado a memoria ejecutable
+	* @param code Código generado
+	*/
+	void install(const std::vector<unsigned char> & code) {
+		size_t page = (size_t) sysconf(_SC_PAGESIZE);
+		size_t bytes = (code.size() + page - 1) / page * page;
+		void * p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED) {
+			return;
+		}
+		std::memcpy(p, code.data(), code.size());
+		if (mprotect(p, bytes, PROT_READ | PROT_EXEC) != 0) {
+			munmap(p, bytes);
+			return;
+		}
+		memory = p;
+		size = bytes;
+		function = (Function) p;
+	}
+#endif
+
+	std::shared_ptr<const CompiledExpression> program; /*!< Programa compilado, usado también por el intérprete */
+	Function function; /*!< Función nativa, nullptr si se usa el intérprete */
+	void * memory; /*!< Memoria ejecutable del código nativo */
+	size_t size; /*!< Tamaño de la memoria ejecutable */
+};
+
+#endif
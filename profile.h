@@ -0,0 +1,294 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/**
+* @file
+* Contadores de perfilado de las expresiones
+* Se habilitan definiendo EXPRESSION_PROFILE antes de incluir expression.h, igual en todas las
+* unidades de compilación; sin esa definición, la evaluación no registra nada. Los contadores
+* de evaluación se reparten en SHARDS bloques, uno por hilo, que se actualizan con operaciones
+* atómicas relajadas y se suman al tomar una instantánea.
+* @author Erwin Meza Vega <emezav@unicauca.edu.co>
+* @copyright MIT License
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+* @brief Contadores de una expresión: compilación, evaluaciones, resultados y llamadas a funciones
+*
+* Una instancia se comparte entre la expresión, sus copias y sus programas compilados, y se
+* puede actualizar desde varios hilos. Las evaluaciones que reciben un programa no válido (la
+* pila no termina con exactamente un valor) se cuentan como errores de pila, no como NAN.
+*/
+class ExpressionProfile {
+public:
+	/** Cantidad de bloques de contadores de evaluación */
+	static const size_t SHARDS = 16;
+
+	/** Una de cada SAMPLE evaluaciones individuales mide su tiempo */
+	static const unsigned SAMPLE = 16;
+
+	/** Reloj de las mediciones */
+	typedef std::chrono::steady_clock Clock;
+
+	/**
+	* @brief Valores de los contadores en un instante
+	*/
+	struct Snapshot {
+		uint64_t parseNanos = 0; /*!< Tiempo de análisis del texto, en nanosegundos */
+		uint64_t compileNanos = 0; /*!< Tiempo de compilación de los programas, en nanosegundos */
+		uint64_t compilations = 0; /*!< Cantidad de programas compilados */
+		uint64_t evals = 0; /*!< Cantidad de evaluaciones, una por fila en la evaluación por lotes */
+		uint64_t evalNanos = 0; /*!< Tiempo de evaluación, estimado por muestreo en las evaluaciones individuales */
+		uint64_t ops = 0; /*!< Cantidad de instrucciones ejecutadas */
+		uint64_t nans = 0; /*!< Evaluaciones válidas con resultado NAN */
+		uint64_t stackErrors = 0; /*!< Evaluaciones de un programa o una RPN que no produce exactamente un valor */
+		std::vector<std::pair<std::string, uint64_t>> calls; /*!< Llamadas por nombre de función, sin las que no se invocaron */
+
+		/**
+		* @brief Retorna la cantidad promedio de instrucciones por evaluación
+		* @return ops / evals, 0 si no hay evaluaciones
+		*/
+		double opsPerEval() const {
+			return evals > 0 ? double(ops) / double(evals) : 0.0;
+		}
+	};
+
+	/**
+	* @brief Crea los contadores de una expresión
+	* @param functions Nombres de las funciones, en el orden de la tabla de funciones de la expresión
+	*/
+	explicit ExpressionProfile(std::vector<std::string> functions):
+		functions(std::move(functions)), shards(new Shard[SHARDS]) {
+		for (size_t s = 0; s < SHARDS; s++) {
+			shards[s].calls.reset(new std::atomic<uint64_t>[this->functions.size()]);
+			for (size_t f = 0; f < this->functions.size(); f++) {
+				shards[s].calls[f].store(0, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	ExpressionProfile(const ExpressionProfile &) = delete;
+	ExpressionProfile & operator=(const ExpressionProfile &) = delete;
+
+	/**
+	* @brief Registra el análisis del texto de la expresión
+	* @param nanos Duración en nanosegundos
+	*/
+	void parsed(uint64_t nanos) {
+		parseNanos.fetch_add(nanos, std::memory_order_relaxed);
+	}
+
+	/**
+	* @brief Registra la compilación de un programa
+	* @param nanos Duración en nanosegundos
+	*/
+	void compiled(uint64_t nanos) {
+		compileNanos.fetch_add(nanos, std::memory_order_relaxed);
+		compilations.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/**
+	* @brief Registra evaluaciones en el bloque de contadores del hilo
+	* @param evals Cantidad de evaluaciones
+	* @param ops Instrucciones ejecutadas
+	* @param nanos Duración en nanosegundos, 0 si no se midió
+	* @param nans Resultados NAN
+	* @param errors Evaluaciones con error de pila
+	*/
+	void evaluated(uint64_t evals, uint64_t ops, uint64_t nanos, uint64_t nans, uint64_t errors) {
+		Shard & s = shard();
+		s.evals.fetch_add(evals, std::memory_order_relaxed);
+		s.ops.fetch_add(ops, std::memory_order_relaxed);
+		if (nanos != 0) {
+			s.nanos.fetch_add(nanos, std::memory_order_relaxed);
+		}
+		if (nans != 0) {
+			s.nans.fetch_add(nans, std::memory_order_relaxed);
+		}
+		if (errors != 0) {
+			s.errors.fetch_add(errors, std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	* @brief Registra llamadas a una función
+	* @param function Posición de la función en la tabla de funciones
+	* @param n Cantidad de llamadas
+	*/
+	void called(size_t function, uint64_t n) {
+		if (function < functions.size()) {
+			shard().calls[function].fetch_add(n, std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	* @brief Decide si la evaluación individual actual mide su tiempo
+	* @return Verdadero una de cada SAMPLE veces en cada hilo
+	*/
+	static bool sample() {
+		static thread_local unsigned tick = 0;
+		return (++tick % SAMPLE) == 0;
+	}
+
+	/**
+	* @brief Retorna los nanosegundos transcurridos desde un instante
+	* @param start Instante inicial
+	* @return Duración en nanosegundos
+	*/
+	static uint64_t since(Clock::time_point start) {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+	}
+
+	/**
+	* @brief Suma los contadores de todos los hilos
+	*
+	* Los contadores se leen sin detener las evaluaciones en curso: cada valor es exacto, pero
+	* la instantánea puede mezclar evaluaciones registradas durante la lectura.
+	* @return Valores de los contadores
+	*/
+	Snapshot snapshot() const {
+		Snapshot r;
+		r.parseNanos = parseNanos.load(std::memory_order_relaxed);
+		r.compileNanos = compileNanos.load(std::memory_order_relaxed);
+		r.compilations = compilations.load(std::memory_order_relaxed);
+		std::vector<uint64_t> calls(functions.size(), 0);
+		for (size_t i = 0; i < SHARDS; i++) {
+			const Shard & s = shards[i];
+			r.evals += s.evals.load(std::memory_order_relaxed);
+			r.evalNanos += s.nanos.load(std::memory_order_relaxed);
+			r.ops += s.ops.load(std::memory_order_relaxed);
+			r.nans += s.nans.load(std::memory_order_relaxed);
+			r.stackErrors += s.errors.load(std::memory_order_relaxed);
+			for (size_t f = 0; f < functions.size(); f++) {
+				calls[f] += s.calls[f].load(std::memory_order_relaxed);
+			}
+		}
+		for (size_t f = 0; f < functions.size(); f++) {
+			if (calls[f] != 0) {
+				r.calls.emplace_back(functions[f], calls[f]);
+			}
+		}
+		return r;
+	}
+
+	/**
+	* @brief Escribe los contadores en el formato de texto de Prometheus
+	* @param label Valor de la etiqueta expression, e.g. el texto o un identificador de la expresión
+	* @return Métricas, con sus líneas # TYPE
+	*/
+	std::string prometheus(const std::string & label) const {
+		return prometheus({{label, snapshot()}});
+	}
+
+	/**
+	* @brief Escribe los contadores de varias expresiones en el formato de texto de Prometheus
+	*
+	* Cada métrica aparece una sola vez, con una muestra por expresión.
+	* @param profiles Etiqueta y contadores de cada expresión
+	* @return Métricas, con sus líneas # TYPE
+	*/
+	static std::string prometheus(const std::vector<std::pair<std::string, Snapshot>> & profiles) {
+		struct Metric {
+			const char * name;
+			uint64_t Snapshot::* value;
+			bool seconds;
+		};
+		static const Metric metrics[] = {
+			{"expression_parse_seconds_total", &Snapshot::parseNanos, true},
+			{"expression_compile_seconds_total", &Snapshot::compileNanos, true},
+			{"expression_compilations_total", &Snapshot::compilations, false},
+			{"expression_evaluations_total", &Snapshot::evals, false},
+			{"expression_eval_seconds_total", &Snapshot::evalNanos, true},
+			{"expression_operations_total", &Snapshot::ops, false},
+			{"expression_nan_results_total", &Snapshot::nans, false},
+			{"expression_stack_errors_total", &Snapshot::stackErrors, false}
+		};
+
+		std::string out;
+		for (auto & m: metrics) {
+			out += std::string("# TYPE ") + m.name + " counter\n";
+			for (auto & p: profiles) {
+				uint64_t v = p.second.*m.value;
+				out += m.name + ("{expression=\"" + escape(p.first) + "\"} ") +
+					(m.seconds ? seconds(v) : std::to_string(v)) + "\n";
+			}
+		}
+		out += "# TYPE expression_function_calls_total counter\n";
+		for (auto & p: profiles) {
+			for (auto & c: p.second.calls) {
+				out += "expression_function_calls_total{expression=\"" + escape(p.first) +
+					"\",function=\"" + escape(c.first) + "\"} " + std::to_string(c.second) + "\n";
+			}
+		}
+		return out;
+	}
+
+private:
+	/**
+	* @brief Contadores de evaluación de un grupo de hilos, en su propia línea de caché
+	*/
+	struct alignas(64) Shard {
+		std::atomic<uint64_t> evals{0}; /*!< Evaluaciones */
+		std::atomic<uint64_t> nanos{0}; /*!< Tiempo de evaluación */
+		std::atomic<uint64_t> ops{0}; /*!< Instrucciones ejecutadas */
+		std::atomic<uint64_t> nans{0}; /*!< Resultados NAN */
+		std::atomic<uint64_t> errors{0}; /*!< Errores de pila */
+		std::unique_ptr<std::atomic<uint64_t>[]> calls; /*!< Llamadas por posición de la función */
+	};
+
+	std::vector<std::string> functions; /*!< Nombres de las funciones */
+	std::unique_ptr<Shard[]> shards; /*!< Contadores de evaluación por hilo */
+	std::atomic<uint64_t> parseNanos{0}; /*!< Tiempo de análisis */
+	std::atomic<uint64_t> compileNanos{0}; /*!< Tiempo de compilación */
+	std::atomic<uint64_t> compilations{0}; /*!< Programas compilados */
+
+	/**
+	* @brief Retorna el bloque de contadores del hilo actual
+	*
+	* Cada hilo recibe un bloque al registrar su primera evaluación; los hilos se reparten los
+	* bloques en orden, así que solo comparten bloque si hay más de SHARDS hilos.
+	*/
+	Shard & shard() {
+		static std::atomic<size_t> next{0};
+		static thread_local size_t index = next.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+		return shards[index];
+	}
+
+	/**
+	* @brief Escribe una duración en segundos, con precisión de nanosegundos
+	*/
+	static std::string seconds(uint64_t nanos) {
+		char buf[32];
+		snprintf(buf, sizeof(buf), "%.9f", double(nanos) * 1e-9);
+		return buf;
+	}
+
+	/**
+	* @brief Escapa el valor de una etiqueta de Prometheus
+	*/
+	static std::string escape(const std::string & s) {
+		std::string r;
+		for (char c: s) {
+			if (c == '\\' || c == '"') {
+				r.push_back('\\');
+				r.push_back(c);
+			}else if (c == '\n') {
+				r += "\\n";
+			}else {
+				r.push_back(c);
+			}
+		}
+		return r;
+	}
+};
+
+#endif
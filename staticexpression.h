@@ -0,0 +1,724 @@
+#ifndef STATICEXPRESSION_H
+#define STATICEXPRESSION_H
+
+/**
+* @file
+* Expresiones compiladas en tiempo de compilación del programa (C++20)
+* compile_expr<"texto">() ejecuta la separación en elementos y el algoritmo Shunting Yard en
+* tiempo de compilación, con las mismas reglas de precedencia y asociatividad de expression.
+* El resultado es un objeto cuya evaluación es una expresión de C++ sin intérprete, que el
+* compilador puede expandir en línea y vectorizar. Los paréntesis no balanceados y las
+* expresiones mal formadas producen errores de compilación.
+*
+*   constexpr auto f = compile_expr<"x^4 - 6*x^3 + 12*x^2 - 10*x + 3">();
+*   double y = f(3.0);
+*
+* Solo se admiten las funciones de un argumento de BUILTIN_FUNCTIONS; las comas de las
+* funciones de varios argumentos, incluyendo if(c, a, b), son un error de compilación. Las
+* comparaciones y los operadores lógicos sí se admiten. pi y e toman los valores de
+* expression::defaultVariables(). Las demás variables se reciben en orden de aparición.
+* Requiere C++20 (parámetros de plantilla de tipo clase); con estándares anteriores este
+* archivo no declara nada.
+* @author Erwin Meza Vega <emezav@unicauca.edu.co>
+* @copyright MIT License
+*/
+
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "expression.h"
+
+#if __cplusplus >= 202002L && defined(__cpp_nontype_template_args) && __cpp_nontype_template_args >= 201911L
+
+/**
+* @brief Texto de una expresión usable como parámetro de plantilla
+*/
+template <size_t N>
+struct FixedString {
+	char text[N] = {}; /*!< Caracteres, incluyendo el terminador */
+
+	/**
+	* @brief Copia una cadena literal
+	* @param s Cadena literal
+	*/
+	constexpr FixedString(const char (&s)[N]) {
+		for (size_t i = 0; i < N; i++) {
+			text[i] = s[i];
+		}
+	}
+
+	/**
+	* @brief Retorna el texto sin el terminador
+	* @return Vista del texto
+	*/
+	constexpr std::string_view view() const {
+		return std::string_view(text, N - 1);
+	}
+};
+
+/**
+* @brief Programa de una expresión construido en tiempo de compilación
+*
+* Cada instrucción conoce la posición de sus operandos en el programa, de modo que
+* la evaluación recorre el árbol de la expresión en lugar de una pila.
+*/
+template <size_t N>
+struct StaticProgram {
+	OpCode op[N] = {}; /*!< Código de operación de cada instrucción */
+	size_t arg[N] = {}; /*!< Posición de la variable (Load) */
+	double val[N] = {}; /*!< Valor de la constante (Const) */
+	size_t left[N] = {}; /*!< Posición del primer (o único) operando */
+	size_t right[N] = {}; /*!< Posición del segundo operando */
+	size_t size = 0; /*!< Cantidad de instrucciones; la última es la raíz */
+	size_t offset[N] = {}; /*!< Posición del nombre de cada variable en el texto */
+	size_t length[N] = {}; /*!< Longitud del nombre de cada variable */
+	size_t inputs = 0; /*!< Cantidad de variables */
+};
+
+namespace staticexpr {
+
+	/**
+	* @brief Verifica si un caracter es un dígito
+	*/
+	constexpr bool isDigit(char c) {
+		return c >= '0' && c <= '9';
+	}
+
+	/**
+	* @brief Verifica si un caracter separa elementos
+	*/
+	constexpr bool isSeparator(char c) {
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '(' || c == ')' || c == ','
+				|| expression::isOperator(c);
+	}
+
+	/**
+	* @brief Verifica si un texto es la mantisa de un número, como expression::isMantissa()
+	*/
+	constexpr bool isMantissa(std::string_view str) {
+		bool digits = false;
+		bool point = false;
+
+		for (char c: str) {
+			if (isDigit(c)) {
+				digits = true;
+			}else if (c == '.' && !point) {
+				point = true;
+			}else {
+				return false;
+			}
+		}
+		return digits;
+	}
+
+	/**
+	* @brief Entero sin signo de precisión fija, para convertir los números en tiempo de compilación
+	*
+	* Los 4096 bits alcanzan para MAX_DIGITS dígitos significativos divididos entre la potencia de
+	* 10 del menor exponente que no se redondea a 0.
+	*/
+	struct BigInt {
+		static constexpr size_t WORDS = 128;
+		uint32_t w[WORDS] = {}; /*!< Palabras, de la menos significativa a la más significativa */
+		size_t size = 0; /*!< Cantidad de palabras usadas */
+
+		/** this = this * m + a */
+		constexpr void mulAdd(uint32_t m, uint32_t a) {
+			uint64_t carry = a;
+			for (size_t i = 0; i < size; i++) {
+				uint64_t t = uint64_t(w[i]) * m + carry;
+				w[i] = uint32_t(t);
+				carry = t >> 32;
+			}
+			if (carry != 0) {
+				w[size++] = uint32_t(carry);
+			}
+		}
+
+		/** this = this * 10^k */
+		constexpr void mulPow10(int k) {
+			for (; k >= 9; k -= 9) {
+				mulAdd(1000000000u, 0);
+			}
+			uint32_t p = 1;
+			for (; k > 0; k--) {
+				p *= 10;
+			}
+			mulAdd(p, 0);
+		}
+
+		/** this = this * 2^k */
+		constexpr void shiftLeft(size_t k) {
+			size_t words = k / 32;
+			unsigned bits = k % 32;
+			if (size == 0) {
+				return;
+			}
+			w[size] = 0;
+			for (size_t i = size + 1; i-- > 0;) {
+				uint64_t t = uint64_t(w[i]) << bits;
+				if (i + words < WORDS) {
+					w[i + words] = uint32_t(t) | ((bits != 0 && i > 0) ? uint32_t(uint64_t(w[i - 1]) >> (32 - bits)) : 0);
+				}
+			}
+			for (size_t i = 0; i < words; i++) {
+				w[i] = 0;
+			}
+			size += words + 1;
+			trim();
+		}
+
+		/** this = this / 2 */
+		constexpr void halve() {
+			for (size_t i = 0; i < size; i++) {
+				w[i] = (w[i] >> 1) | ((i + 1 < size) ? (w[i + 1] << 31) : 0);
+			}
+			trim();
+		}
+
+		/** this = this - b, con b <= this */
+		constexpr void subtract(const BigInt & b) {
+			int64_t borrow = 0;
+			for (size_t i = 0; i < size; i++) {
+				int64_t t = int64_t(w[i]) - ((i < b.size) ? b.w[i] : 0) - borrow;
+				borrow = (t < 0);
+				w[i] = uint32_t(t + (borrow << 32));
+			}
+			trim();
+		}
+
+		/** Elimina las palabras más significativas nulas */
+		constexpr void trim() {
+			while (size > 0 && w[size - 1] == 0) {
+				size--;
+			}
+		}
+
+		/** Cantidad de bits significativos */
+		constexpr int bits() const {
+			if (size == 0) {
+				return 0;
+			}
+			int n = 32 * int(size - 1);
+			for (uint32_t t = w[size - 1]; t != 0; t >>= 1) {
+				n++;
+			}
+			return n;
+		}
+
+		/** Bit k */
+		constexpr bool bit(int k) const {
+			return size_t(k / 32) < size && ((w[k / 32] >> (k % 32)) & 1);
+		}
+
+		/** Compara con b: negativo, cero o positivo */
+		constexpr int compare(const BigInt & b) const {
+			if (size != b.size) {
+				return (size < b.size) ? -1 : 1;
+			}
+			for (size_t i = size; i-- > 0;) {
+				if (w[i] != b.w[i]) {
+					return (w[i] < b.w[i]) ? -1 : 1;
+				}
+			}
+			return 0;
+		}
+	};
+
+	/** Dígitos significativos que se conservan; los demás solo indican si el valor es mayor */
+	constexpr int MAX_DIGITS = 800;
+
+	/**
+	* @brief Redondea al double más cercano, con empates al par, un valor (q + f) * 2^e2, 0 <= f < 1
+	* @param q Parte entera; si inexact es verdadero debe tener al menos 55 bits
+	* @param e2 Exponente binario
+	* @param inexact Verdadero si f es distinto de 0
+	* @return Valor redondeado, incluidos los subnormales, 0 e infinito
+	*/
+	constexpr double roundToDouble(uint64_t q, int e2, bool inexact) {
+		if (q == 0) {
+			return 0.0;
+		}
+		int length = 0;
+		for (uint64_t t = q; t != 0; t >>= 1) {
+			length++;
+		}
+		int e = length - 1 + e2; //Exponente del bit más significativo
+		int precision = (e >= -1022) ? 53 : e + 1075;
+		if (precision < 0) {
+			return 0.0;
+		}
+		int drop = length - precision;
+		uint64_t mantissa = q;
+		if (drop > 0) {
+			uint64_t rest = q & ((uint64_t(1) << drop) - 1);
+			uint64_t half = uint64_t(1) << (drop - 1);
+			mantissa = (drop < 64) ? q >> drop : 0;
+			if (rest > half || (rest == half && (inexact || (mantissa & 1)))) {
+				mantissa++;
+			}
+		}else {
+			mantissa = q << -drop;
+		}
+		if (e < -1022) {
+			//Subnormal; si el redondeo llega a 2^52 la representación es la del menor normal
+			return std::bit_cast<double>(mantissa);
+		}
+		if (mantissa == (uint64_t(1) << 53)) {
+			mantissa >>= 1;
+			e++;
+		}
+		if (e > 1023) {
+			return HUGE_VAL;
+		}
+		return std::bit_cast<double>((uint64_t(e + 1023) << 52) | (mantissa & ((uint64_t(1) << 52) - 1)));
+	}
+
+	/**
+	* @brief Convierte un número en tiempo de compilación
+	*
+	* El resultado está correctamente redondeado, igual al de std::from_chars: los números con hasta
+	* 15 dígitos significativos y exponente decimal entre -22 y 22 se calculan con una operación en
+	* double, y los demás con aritmética entera exacta sobre sus primeros MAX_DIGITS dígitos.
+	* @param s Texto del número
+	* @param val Referencia al valor obtenido
+	* @return Verdadero si todo el texto es un número
+	*/
+	constexpr bool parseNumber(std::string_view s, double & val) {
+		BigInt m;
+		uint64_t mantissa = 0;
+		int digits = 0;
+		int exp10 = 0;
+		size_t i = 0;
+		bool any = false;
+		bool inexact = false; //Dígitos distintos de cero después de los primeros MAX_DIGITS
+
+		auto digit = [&](char c, bool fraction) {
+			if (digits == 0 && c == '0') {
+				exp10 -= fraction;
+			}else if (digits < MAX_DIGITS) {
+				mantissa = mantissa * 10 + (c - '0');
+				m.mulAdd(10, c - '0');
+				digits++;
+				exp10 -= fraction;
+			}else {
+				inexact = inexact || c != '0';
+				exp10 += !fraction;
+			}
+		};
+		for (; i < s.size() && isDigit(s[i]); i++, any = true) {
+			digit(s[i], false);
+		}
+		if (i < s.size() && s[i] == '.') {
+			for (i++; i < s.size() && isDigit(s[i]); i++, any = true) {
+				digit(s[i], true);
+			}
+		}
+		if (!any) {
+			return false;
+		}
+		if (i < s.size() && (s[i] == 'e' || s[i] == 'E')) {
+			bool negative = false;
+			int e = 0;
+			i++;
+			if (i < s.size() && (s[i] == '+' || s[i] == '-')) {
+				negative = (s[i] == '-');
+				i++;
+			}
+			if (i == s.size()) {
+				return false;
+			}
+			for (; i < s.size() && isDigit(s[i]); i++) {
+				e = (e < 10000) ? e * 10 + (s[i] - '0') : e;
+			}
+			exp10 += negative ? -e : e;
+		}
+		if (i != s.size()) {
+			return false;
+		}
+
+		if (digits == 0) {
+			val = 0.0;
+		}else if (digits <= 15 && exp10 >= -22 && exp10 <= 22) {
+			//Ambos operandos son exactos: el resultado tiene un solo redondeo
+			double p = 1.0;
+			for (int k = 0; k < (exp10 < 0 ? -exp10 : exp10); k++) {
+				p *= 10.0;
+			}
+			val = (exp10 < 0) ? double(mantissa) / p : double(mantissa) * p;
+		}else if (digits + exp10 > 310) {
+			//Mayor o igual a 10^310
+			val = HUGE_VAL;
+		}else if (digits + exp10 < -324) {
+			//Menor que 10^-324, menos de la mitad del menor subnormal
+			val = 0.0;
+		}else if (exp10 >= 0) {
+			//Entero exacto: sus 64 bits más significativos y si los demás son cero
+			m.mulPow10(exp10);
+			int length = m.bits();
+			int shift = (length > 64) ? length - 64 : 0;
+			uint64_t q = 0;
+			for (int k = 63; k >= 0; k--) {
+				q = (q << 1) | m.bit(k + shift);
+			}
+			for (int k = 0; k < shift && !inexact; k++) {
+				inexact = m.bit(k);
+			}
+			val = roundToDouble(q, shift, inexact);
+		}else {
+			//Cociente de 61 o 62 bits de m * 2^s / 10^-exp10 por división larga, y si hay resto
+			BigInt d;
+			d.w[0] = 1;
+			d.size = 1;
+			d.mulPow10(-exp10);
+			int s2 = 61 - (m.bits() - d.bits());
+			if (s2 >= 0) {
+				m.shiftLeft(s2);
+			}else {
+				d.shiftLeft(-s2);
+			}
+			uint64_t q = 0;
+			d.shiftLeft(63);
+			for (int k = 63; k >= 0; k--, d.halve()) {
+				if (m.compare(d) >= 0) {
+					m.subtract(d);
+					q |= uint64_t(1) << k;
+				}
+			}
+			val = roundToDouble(q, -s2, inexact || m.size != 0);
+		}
+		return true;
+	}
+
+	/**
+	* @brief Busca una función predefinida por nombre
+	* @param name Nombre de la función
+	* @param op Referencia al código de operación de la función
+	* @return Verdadero si la función existe
+	*/
+	constexpr bool findBuiltin(std::string_view name, OpCode & op) {
+		for (auto & b: BUILTIN_FUNCTIONS) {
+			if (name == b.name) {
+				op = b.op;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	* @brief Precedencia de un elemento de la pila de operadores
+	*/
+	constexpr int precedence(const Token & t, std::string_view src) {
+		return (t.kind == TokenKind::Operator) ? expression::precedence(expression::getOpCode(src.substr(t.offset, t.length))) : 0;
+	}
+
+	/**
+	* @brief Construye el programa de una expresión
+	*
+	* Sigue los mismos pasos de expression: separa los elementos, obtiene la RPN con el
+	* algoritmo Shunting Yard y la traduce a instrucciones. Los errores de sintaxis se
+	* reportan con throw, que en una evaluación constante es un error de compilación.
+	* @param text Texto de la expresión
+	* @return Programa de la expresión
+	*/
+	template <size_t N>
+	constexpr StaticProgram<N> compile(const FixedString<N> & text) {
+		std::string_view src = text.view();
+		StaticProgram<N> p;
+
+		//Verificar parentesis
+		int open = 0;
+		for (char c: src) {
+			open += (c == '(') - (c == ')');
+			if (open < 0) {
+				throw "compile_expr: paréntesis no balanceados";
+			}
+		}
+		if (open != 0) {
+			throw "compile_expr: paréntesis no balanceados";
+		}
+
+		//Separar los elementos
+		Token tokens[N] = {};
+		size_t count = 0;
+		for (size_t pos = 0; pos < src.size();) {
+			char c = src[pos];
+			if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+				pos++;
+				continue;
+			}
+			if (c == ',') {
+				throw "compile_expr: las funciones de varios argumentos no se admiten";
+			}
+			if (c == '(' || c == ')' || expression::isOperator(c)) {
+				TokenKind kind = (c == '(') ? TokenKind::LeftParen : (c == ')') ? TokenKind::RightParen : TokenKind::Operator;
+				size_t len = (kind == TokenKind::Operator) ? expression::operatorLength(src, pos) : 1;
+				tokens[count++] = {kind, pos, len, 0.0};
+				pos += len;
+				continue;
+			}
+			size_t start = pos;
+			while (pos < src.size() && !isSeparator(src[pos])) {
+				pos++;
+				//Signo del exponente de un número
+				if ((src[pos - 1] == 'e' || src[pos - 1] == 'E') && pos + 1 < src.size()
+						&& (src[pos] == '+' || src[pos] == '-') && isDigit(src[pos + 1])
+						&& isMantissa(src.substr(start, pos - 1 - start))) {
+					pos++;
+				}
+			}
+			Token t = {TokenKind::Name, start, pos - start, 0.0};
+			if (parseNumber(src.substr(start, pos - start), t.val)) {
+				t.kind = TokenKind::Number;
+			}
+			tokens[count++] = t;
+		}
+
+		//Shunting Yard Algorithm
+		Token rpn[N] = {};
+		Token operators[N] = {};
+		size_t out = 0;
+		size_t top = 0;
+		for (size_t i = 0; i < count; i++) {
+			Token token = tokens[i];
+			OpCode op = OpCode::Call;
+			switch (token.kind) {
+				case TokenKind::Name:
+					if (findBuiltin(src.substr(token.offset, token.length), op)) {
+						token.kind = TokenKind::Function;
+						operators[top++] = token;
+					}else {
+						rpn[out++] = token;
+					}
+					break;
+				case TokenKind::Operator: {
+					op = expression::getOpCode(src.substr(token.offset, token.length));
+					int prec = expression::precedence(op);
+					while (top > 0 && operators[top - 1].kind != TokenKind::LeftParen
+							&& (precedence(operators[top - 1], src) > prec
+								|| (precedence(operators[top - 1], src) == prec && expression::isLeftAssociative(op)))) {
+						rpn[out++] = operators[--top];
+					}
+					operators[top++] = token;
+					break;
+				}
+				case TokenKind::LeftParen:
+					operators[top++] = token;
+					break;
+				case TokenKind::RightParen:
+					while (top > 0 && operators[top - 1].kind != TokenKind::LeftParen) {
+						rpn[out++] = operators[--top];
+					}
+					if (top > 0) {
+						top--;
+					}
+					if (top > 0 && operators[top - 1].kind == TokenKind::Function) {
+						rpn[out++] = operators[--top];
+					}
+					break;
+				default:
+					rpn[out++] = token;
+					break;
+			}
+		}
+		while (top > 0) {
+			if (operators[top - 1].kind != TokenKind::LeftParen) {
+				rpn[out++] = operators[top - 1];
+			}
+			top--;
+		}
+
+		//Traducir a instrucciones, enlazando cada operación con sus operandos
+		size_t stack[N] = {};
+		size_t depth = 0;
+		for (size_t i = 0; i < out; i++) {
+			const Token & t = rpn[i];
+			std::string_view item = src.substr(t.offset, t.length);
+			OpCode op = OpCode::Const;
+			double val = t.val;
+			size_t arg = 0;
+
+			switch (t.kind) {
+				case TokenKind::Number:
+					break;
+				case TokenKind::Function:
+					findBuiltin(item, op);
+					break;
+				case TokenKind::Operator:
+					op = expression::getOpCode(item);
+					if (op == OpCode::Const) {
+						throw "compile_expr: operador desconocido";
+					}
+					break;
+				default:
+					//Variables predeterminadas, con los valores de defaultVariables()
+					if (item == "pi") {
+						val = 3.14159265358979323846;
+					}else if (item == "e") {
+						val = 2.71828182845904523536;
+					}else {
+						op = OpCode::Load;
+						for (arg = 0; arg < p.inputs; arg++) {
+							if (src.substr(p.offset[arg], p.length[arg]) == item) {
+								break;
+							}
+						}
+						if (arg == p.inputs) {
+							p.offset[arg] = t.offset;
+							p.length[arg] = t.length;
+							p.inputs++;
+						}
+					}
+					break;
+			}
+
+			size_t k = CompiledExpression::arity(op);
+			if (depth < k) {
+				throw "compile_expr: falta un operando";
+			}
+			size_t n = p.size++;
+			p.op[n] = op;
+			p.arg[n] = arg;
+			p.val[n] = val;
+			if (k == 2) {
+				p.right[n] = stack[--depth];
+				p.left[n] = stack[--depth];
+			}else if (k == 1) {
+				p.left[n] = stack[--depth];
+			}
+			stack[depth++] = n;
+		}
+		if (depth != 1) {
+			throw "compile_expr: la expresión debe producir exactamente un valor";
+		}
+
+		return p;
+	}
+
+	/**
+	* @brief Fila de un conjunto de columnas, usada por la evaluación por lotes
+	*/
+	struct Row {
+		const double * const * columns; /*!< Columnas de valores */
+		size_t row; /*!< Fila */
+
+		double operator[](size_t k) const {
+			return columns[k][row];
+		}
+	};
+
+}
+
+/**
+* @brief Expresión compilada en tiempo de compilación del programa
+*
+* La evaluación se expande en una expresión de C++ por instrucción del programa, sin pila ni
+* ciclo de interpretación. Produce los mismos valores que CompiledExpression::eval() con
+* Optimization::None.
+*/
+template <FixedString S>
+class StaticExpression {
+public:
+	/** Programa de la expresión */
+	static constexpr auto program = staticexpr::compile(S);
+
+	/**
+	* @brief Retorna la cantidad de variables de la expresión
+	* @return Cantidad de valores de entrada
+	*/
+	static constexpr size_t inputs() {
+		return program.inputs;
+	}
+
+	/**
+	* @brief Retorna el nombre de una variable
+	* @param i Posición de la variable
+	* @return Nombre de la variable, en el orden de los valores de entrada
+	*/
+	static constexpr std::string_view variable(size_t i) {
+		return S.view().substr(program.offset[i], program.length[i]);
+	}
+
+	/**
+	* @brief Evalúa la expresión
+	* @param values Valores de las variables, en orden de aparición
+	* @return Resultado de la expresión
+	*/
+	static double eval(const double * values) {
+		return node<program.size - 1>(values);
+	}
+
+	/**
+	* @brief Evalúa la expresión sobre columnas de valores
+	* @param columns Una columna de n valores por cada variable
+	* @param out Arreglo de salida, con capacidad para n valores
+	* @param n Cantidad de valores a evaluar
+	*/
+	static void evalBatch(const double * const * columns, double * out, size_t n) {
+		for (size_t i = 0; i < n; i++) {
+			out[i] = node<program.size - 1>(staticexpr::Row{columns, i});
+		}
+	}
+
+	/**
+	* @brief Evalúa una expresión de una variable sobre un arreglo de valores
+	* @param x Valores de la variable
+	* @param out Arreglo de salida, con capacidad para n valores
+	* @param n Cantidad de valores a evaluar
+	*/
+	static void evalBatch(const double * x, double * out, size_t n) {
+		static_assert(inputs() <= 1, "evalBatch(x): la expresión tiene más de una variable");
+		for (size_t i = 0; i < n; i++) {
+			out[i] = node<program.size - 1>(x + i);
+		}
+	}
+
+	/**
+	* @brief Sobrecarga del operador ()
+	* @param args Valores de las variables, en orden de aparición
+	* @return Resultado de la expresión
+	*/
+	template <typename... Args>
+	double operator()(Args... args) const {
+		static_assert(sizeof...(Args) == inputs(), "compile_expr: cantidad incorrecta de variables");
+		const double values[sizeof...(Args) + 1] = {(double) args...};
+		return eval(values);
+	}
+
+private:
+	/**
+	* @brief Evalúa el subárbol de una instrucción
+	* @param in Valores de entrada, indexados por la posición de la variable
+	* @return Resultado del subárbol
+	*/
+	template <size_t I, typename Input>
+	static double node(const Input & in) {
+		constexpr OpCode op = program.op[I];
+		if constexpr (op == OpCode::Const) {
+			return program.val[I];
+		}else if constexpr (op == OpCode::Load) {
+			return in[program.arg[I]];
+		}else if constexpr (CompiledExpression::arity(op) == 2) {
+			return CompiledExpression::calculate(node<program.left[I]>(in), node<program.right[I]>(in), op);
+		}else {
+			return CompiledExpression::calculateUnary(node<program.left[I]>(in), op);
+		}
+	}
+};
+
+/**
+* @brief Compila una expresión en tiempo de compilación del programa
+* @return Expresión compilada; sus errores de sintaxis son errores de compilación
+*/
+template <FixedString S>
+constexpr StaticExpression<S> compile_expr() {
+	return {};
+}
+
+#endif
+
+#endif
@@ -0,0 +1,1191 @@
+/**
+* @file
+* Pruebas del evaluador de expresiones aritméticas
+*
+* Cada prueba escribe una línea con su resultado; el programa termina con estado 1 si alguna falla.
+*
+* Compilación (con -std=c++20 también se prueba staticexpression.h, y con -DEXPRESSION_PROFILE,
+* la integración de profile.h en la evaluación):
+*   g++ -std=c++17 -O2 test.cpp -o test -lpthread
+* @author Erwin Meza Vega <emezav@unicauca.edu.co>
+* @copyright MIT License
+*/
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <memory_resource>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "autodiff.h"
+#include "batchevaluator.h"
+#include "columnstream.h"
+#include "devicekernel.h"
+#include "expression.h"
+#include "expressioncache.h"
+#include "expressionset.h"
+#include "formulafile.h"
+#include "formularegistry.h"
+#include "incremental.h"
+#include "interval.h"
+#include "jit.h"
+#include "profile.h"
+#include "staticexpression.h"
+#include "threadpool.h"
+#include "tiered.h"
+#include "typedexpression.h"
+
+/** Cantidad de pruebas fallidas */
+static int failures = 0;
+
+/**
+* @brief Registra el resultado de una prueba
+* @param name Nombre de la prueba
+* @param ok Verdadero si la prueba se cumplió
+* @param errors Cantidad de valores incorrectos, para el mensaje
+*/
+static void check(const char * name, bool ok, size_t errors = 0) {
+	if (ok) {
+		printf("ok   %s\n", name);
+	}else {
+		printf("FAIL %s (%zu errores)\n", name, errors);
+		failures++;
+	}
+}
+
+/**
+* @brief Compara dos resultados, considerando iguales los NAN
+*/
+static bool same(double a, double b) {
+	return a == b || (a != a && b != b);
+}
+
+/**
+* @brief Varios hilos invocan evalParallel() a la vez sobre el mismo conjunto de hilos
+*
+* Cada invocación tiene sus propias pilas por número de hilo: los resultados deben coincidir
+* con los de evalBatch() en un solo hilo aunque los lotes se ejecuten simultáneamente.
+*/
+static void testConcurrentParallelFor() {
+	const size_t n = 20000;
+	const size_t callers = 3;
+	const int rounds = 50;
+	ThreadPool pool(2);
+
+	expression e("x^3 - 2*x^2 - x + 1 + sin(x)");
+	expression e2("ln(x) + cos(x) / x");
+	std::shared_ptr<const CompiledExpression> program = e.compiled();
+	ExpressionSet set({"x"});
+	set.add(e);
+	set.add(e2);
+	std::shared_ptr<const FusedExpression> fused = set.compiled();
+
+	vector<double> x(n);
+	vector<double> expected(n);
+	vector<double> fused1(n);
+	vector<double> fused2(n);
+	for (size_t i = 0; i < n; i++) {
+		x[i] = 0.1 + 4.0 * i / n;
+	}
+	const double * input[] = {x.data()};
+	double * results[] = {fused1.data(), fused2.data()};
+	program->evalBatch(input, expected.data(), n);
+	fused->evalBatch(input, results, n);
+
+	std::atomic<size_t> errors(0);
+	vector<std::thread> threads;
+	for (size_t c = 0; c < callers; c++) {
+		threads.emplace_back([&]() {
+			vector<double> out(n);
+			vector<double> out2(n);
+			const double * columns[] = {x.data()};
+			double * outs[] = {out.data(), out2.data()};
+			for (int r = 0; r < rounds; r++) {
+				program->evalParallel(columns, out.data(), n, pool);
+				for (size_t i = 0; i < n; i++) {
+					if (!same(out[i], expected[i])) {
+						errors++;
+					}
+				}
+				fused->evalParallel(columns, outs, n, pool);
+				for (size_t i = 0; i < n; i++) {
+					if (!same(out[i], fused1[i]) || !same(out2[i], fused2[i])) {
+						errors++;
+					}
+				}
+			}
+		});
+	}
+	for (auto & t: threads) {
+		t.join();
+	}
+	check("parallelFor concurrente", errors == 0, errors);
+}
+
+/**
+* @brief evalBatch() y evalParallel() coinciden con eval() valor por valor
+*
+* Las funciones vectorizadas difieren de las de <cmath> en unos pocos ULP: se compara con un
+* error relativo de 1e-12 sobre expresiones sin cancelación.
+*/
+static void testBatchAgreement() {
+	const size_t n = 10007;
+	ThreadPool pool(2);
+	vector<double> x(n);
+	vector<double> y(n);
+	for (size_t i = 0; i < n; i++) {
+		x[i] = 0.01 + 20.0 * i / n;
+		y[i] = -3.0 + 7.0 * ((i * 37) % n) / n;
+	}
+	const double * columns[] = {x.data(), y.data()};
+	size_t errors = 0;
+	for (const char * text: {"x^3 + 2*x^2 + 1", "exp(-x) * (2 + sin(y))", "sqrt(x) + ln(1 + x)", "x^-3 + x^0.5",
+			"hypot(x, y) + abs(y)", "if(y > 0, x, ~x) * 2", "max(x, y) + min(x, y, 1)", "atan2(x, 1) + cos(y)^2"}) {
+		expression e(text);
+		e.bind({"x", "y"});
+		std::shared_ptr<const CompiledExpression> program = e.compiled();
+		if (!program->isValid()) {
+			errors += n;
+			continue;
+		}
+		vector<double> batch(n);
+		vector<double> parallel(n);
+		program->evalBatch(columns, batch.data(), n);
+		program->evalParallel(columns, parallel.data(), n, pool);
+		for (size_t i = 0; i < n; i++) {
+			double v[] = {x[i], y[i]};
+			double expected = program->eval(v);
+			if (!(fabs(batch[i] - expected) <= 1e-12 * fabs(expected)) || !same(parallel[i], batch[i])) {
+				errors++;
+			}
+		}
+	}
+	check("evalBatch y evalParallel coinciden con eval", errors == 0, errors);
+}
+
+/**
+* @brief x^k por lotes con resultados subnormales
+*
+* Cerca del límite inferior del rango cada multiplicación de vmath::vpowi() perdería precisión:
+* esos resultados deben coincidir con los de eval(), que usa pow().
+*/
+static void testPowiUnderflow() {
+	vector<double> x = {1e160, 1e-110, 3e-103, 1e103, -2e-62, 1.5e-154, 7e102, 2.0};
+	vector<double> out(x.size());
+	const double * columns[] = {x.data()};
+	size_t errors = 0;
+	for (const char * text: {"x^~2", "x^3", "x^~3", "x^5", "x^~5"}) {
+		expression e(text);
+		e.bind({"x"});
+		std::shared_ptr<const CompiledExpression> program = e.compiled();
+		program->evalBatch(columns, out.data(), x.size());
+		for (size_t i = 0; i < x.size(); i++) {
+			double v[] = {x[i]};
+			double expected = program->eval(v);
+			bool exact = fabs(expected) < DBL_MIN || std::isinf(expected);
+			if (exact ? !same(out[i], expected) : !(fabs(out[i] - expected) <= 1e-14 * fabs(expected))) {
+				errors++;
+			}
+		}
+	}
+	check("x^k por lotes con resultados subnormales", errors == 0, errors);
+}
+
+/**
+* @brief sin y cos por lotes sobre argumentos fuera de vmath::TRIG_LIMIT, con el núcleo aplicado en el mismo bloque
+*
+* 2*x se calcula en un bloque de la pila y sin() escribe su resultado en ese mismo bloque: los
+* valores fuera del rango de la reducción deben calcularse a partir de la entrada.
+*/
+static void testLargeTrigInPlace() {
+	vector<double> x = {1e300, -3e6, 0.5, 1e20, 2e6, -7.25, 1e10, 4.0};
+	vector<double> out(x.size());
+	const double * columns[] = {x.data()};
+	size_t errors = 0;
+	for (const char * text: {"sin(2*x)", "cos(2*x)", "sin(x)", "cos(x + 0)"}) {
+		expression e(text);
+		e.bind({"x"});
+		std::shared_ptr<const CompiledExpression> program = e.compiled();
+		program->evalBatch(columns, out.data(), x.size());
+		for (size_t i = 0; i < x.size(); i++) {
+			double expected = program->eval(&x[i]);
+			if (!(fabs(out[i] - expected) <= 1e-12)) {
+				errors++;
+			}
+		}
+	}
+	TypedExpression<float> f("sin(x) + cos(x)");
+	f.bind({"x"});
+	vector<float> xf = {1e30f, -3e7f, 0.5f, 2e6f};
+	vector<float> outf(xf.size());
+	f.evalBatch(xf.data(), outf.data(), xf.size());
+	for (size_t i = 0; i < xf.size(); i++) {
+		if (!(fabs(outf[i] - f.eval(xf[i])) <= 1e-6f)) {
+			errors++;
+		}
+	}
+	check("sin y cos por lotes en el mismo bloque con argumentos grandes", errors == 0, errors);
+}
+
+/**
+* @brief TypedExpression<float>::evalBatch() coincide con eval() valor por valor
+*
+* Incluye funciones de varios argumentos, que se evalúan fila por fila, y bloques incompletos.
+*/
+static void testTypedBatch() {
+	const size_t n = 1000;
+	vector<float> x(n);
+	vector<float> y(n);
+	for (size_t i = 0; i < n; i++) {
+		x[i] = 0.01f + 20.0f * i / n;
+		y[i] = -3.0f + 7.0f * ((i * 37) % n) / n;
+	}
+	const float * columns[] = {x.data(), y.data()};
+	size_t errors = 0;
+	for (const char * text: {"x^3 + 2*x^2 + 1", "exp(-x) * (2 + sin(y))", "sqrt(x) + ln(1 + x)", "hypot(x, y) + abs(y)",
+			"max(x, y) + min(x, y, 1)", "clamp(y, ~1, 1) * pi", "if(y > 0, x, ~x) * e", "atan2(y, x) + cos(y)^2"}) {
+		TypedExpression<float> f(text);
+		f.bind({"x", "y"});
+		if (!f.isValid()) {
+			errors += n;
+			continue;
+		}
+		vector<float> out(n);
+		f.evalBatch(columns, out.data(), n);
+		for (size_t i = 0; i < n; i++) {
+			float v[] = {x[i], y[i]};
+			float expected = f.eval(v);
+			if (!(std::fabs(out[i] - expected) <= 1e-5f * std::max(1.0f, std::fabs(expected)))) {
+				errors++;
+			}
+		}
+	}
+	check("TypedExpression<float> por lotes coincide con eval", errors == 0, errors);
+}
+
+/**
+* @brief NativeExpression produce los mismos valores que el intérprete
+*
+* Incluye funciones de uno y varios argumentos, pow, operadores sin saltos y valores especiales
+* de entrada. En las plataformas sin código nativo solo se compara la delegación al intérprete.
+*/
+static void testNative() {
+	const double values[] = {0.0, -0.0, 1.0, -1.5, 2.75, 1e-300, 1e300, -7.0, HUGE_VAL, -HUGE_VAL, NAN};
+	size_t errors = 0;
+	for (const char * text: {"x^3 - 2*x^2 - x + 1", "sin(x) * cos(y) + exp(~x)", "sqrt(x) + ln(y) + abs(x)", "x ^ y",
+			"x / y - y / x", "if(x > y, x, y) + (x <= 1) * 2", "x > 0 && y < 1 || x == y", "max(x, y, 1) + hypot(x, y)",
+			"min(x, y) * clamp(y, ~1, 1) - atan2(x, y)", "(x + y) * (x + y) - x^-2"}) {
+		expression e(text);
+		e.bind({"x", "y"});
+		NativeExpression native(e);
+		if (NativeExpression::available() && !native.isNative()) {
+			errors++;
+		}
+		for (double x: values) {
+			for (double y: values) {
+				double v[] = {x, y};
+				if (!same(native.eval(v), native.compiled()->eval(v))) {
+					errors++;
+				}
+			}
+		}
+	}
+	check("NativeExpression coincide con el intérprete", errors == 0, errors);
+}
+
+/**
+* @brief TieredExpression pasa por los tres niveles sin cambiar sus resultados
+*
+* Dos hilos evalúan la expresión durante las promociones; el código nativo se compila en un
+* hilo secundario, de modo que se espera a que el nivel cambie.
+*/
+static void testTiered() {
+	const char * text = "x^3 - 2*x^2 - x + 1 + sin(x) * y";
+	TieredExpression tiered(text, {"x", "y"}, expression::defaultFunctions(), 10, 50);
+	expression e(text);
+	e.bind({"x", "y"});
+	std::shared_ptr<const CompiledExpression> program = e.compiled();
+	std::atomic<size_t> errors(0);
+	auto run = [&](size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			double v[] = {-3.0 + 0.01 * (i % 700), 0.5 * (i % 7)};
+			double expected = program->eval(v);
+			if (!(fabs(tiered.eval(v) - expected) <= 1e-12 * std::max(1.0, fabs(expected)))) {
+				errors++;
+			}
+		}
+	};
+	vector<std::thread> threads;
+	for (int t = 0; t < 2; t++) {
+		threads.emplace_back(run, 200);
+	}
+	for (auto & t: threads) {
+		t.join();
+	}
+	for (int k = 0; k < 1000 && NativeExpression::available() && tiered.current() != Tier::Native; k++) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	run(1000);
+	TierStats stats = tiered.stats();
+	Tier expected = NativeExpression::available() ? Tier::Native : Tier::Optimized;
+	check("TieredExpression promueve sin cambiar los resultados",
+		errors == 0 && stats.tier == expected && stats.promotions == (expected == Tier::Native ? 2u : 1u)
+		&& stats.evals == 1400, errors);
+}
+
+/**
+* @brief IncrementalExpression coincide con la evaluación completa en una secuencia de cambios
+*
+* Cada paso cambia una o dos variables al azar, a veces por el mismo valor o por NAN; un cambio
+* sin efecto no recalcula ninguna subexpresión.
+*/
+static void testIncremental() {
+	std::mt19937 random(3);
+	std::uniform_real_distribution<double> value(-4.0, 4.0);
+	size_t errors = 0;
+	for (const char * text: {"x^3 - 2*x*y + sin(z) * (x + y)", "max(x, y, z) + hypot(x, z) * if(y > 0, y, 1)",
+			"sqrt(x) + ln(y) + (x + y) * (x + y) - z", "(x > y) * z + (x <= y) * (x && z)"}) {
+		expression e(text);
+		IncrementalExpression incremental(e);
+		bool resolved;
+		std::shared_ptr<const CompiledExpression> program = e.compiled(incremental.variables(), resolved);
+		size_t n = incremental.variables().size();
+		vector<double> v(n, NAN);
+		for (int step = 0; step < 500; step++) {
+			for (int k = 0; k < 1 + step % 2; k++) {
+				size_t j = random() % n;
+				v[j] = (random() % 10 == 0) ? NAN : std::round(value(random) * 4) / 4;
+				incremental.set(j, v[j]);
+			}
+			errors += !same(incremental.eval(), program->eval(v.data()));
+			incremental.set(size_t(0), v[0]);
+			errors += !same(incremental.eval(), program->eval(v.data())) || incremental.lastEvaluated() != 1;
+		}
+	}
+	check("IncrementalExpression coincide con la evaluación completa", errors == 0, errors);
+}
+
+/**
+* @brief Recurso de memoria que cuenta sus reservas
+*/
+class CountingResource: public std::pmr::memory_resource {
+public:
+	size_t count = 0; /*!< Cantidad de reservas */
+
+private:
+	void * do_allocate(size_t bytes, size_t alignment) override {
+		count++;
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void * p, size_t bytes, size_t alignment) override {
+		std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource & other) const noexcept override {
+		return this == &other;
+	}
+};
+
+/**
+* @brief Las expresiones construidas en un recurso de memoria coinciden con las del montículo
+*
+* Mientras se construyen y evalúan, el recurso predeterminado no recibe reservas: todo sale del
+* recurso monotónico, que a su vez reserva pocos bloques. Los nombres largos no caben en el búfer
+* interno de std::string y se reservan con operator new, fuera de ambos recursos.
+*/
+static void testArena() {
+	const char * texts[] = {"x^3 - 2*x^2 - x + 1", "sin(x) * cos(y) + exp(~x)", "max(x, y, 1) + hypot(x, y)",
+		"if(x > y, x, y) + (x + y) * (x + y)", "sqrt(x) + ln(y) + pi"};
+	CountingResource heap;
+	CountingResource upstream;
+	std::pmr::memory_resource * previous = std::pmr::set_default_resource(&heap);
+	size_t errors = 0;
+	{
+		std::pmr::monotonic_buffer_resource arena(1 << 16, &upstream);
+		for (const char * text: texts) {
+			expression e(text, &arena);
+			e.bind({"x", "y"});
+			std::pmr::set_default_resource(previous);
+			expression reference(text);
+			reference.bind({"x", "y"});
+			std::pmr::set_default_resource(&heap);
+			for (double x: {-1.5, 0.0, 0.5, 2.0}) {
+				for (double y: {-2.0, 1.0, 3.5}) {
+					double v[] = {x, y};
+					errors += !same(e.compiled()->eval(v), reference.compiled()->eval(v));
+				}
+			}
+		}
+		{
+			expression named("velocidad_inicial_media * t + aceleracion_media * t^2 / 2", &arena);
+			named.bind({"velocidad_inicial_media", "aceleracion_media", "t"});
+			double v[] = {3.0, 2.0, 4.0};
+			errors += named.compiled()->eval(v) != 28.0 || named.compiled()->variables()[1] != "aceleracion_media";
+		}
+		arena.release();
+	}
+	std::pmr::set_default_resource(previous);
+	check("expresiones en un recurso de memoria", errors == 0 && heap.count == 0 && upstream.count <= 2, heap.count);
+}
+
+/**
+* @brief ColumnStream sobre CSV y sobre columnas binarias coincide con eval() fila por fila
+*
+* El CSV tiene comillas, espacios, fin de línea \r\n, campos vacíos y una columna que no se usa;
+* los bloques de 7 filas no dividen la cantidad de filas. Las columnas binarias se escriben con
+* ColumnWriter y el resultado de la evaluación con varios hilos se lee de vuelta. Como en
+* testBatchAgreement(), se admite un error relativo de 1e-12.
+*/
+static void testColumnStream() {
+	const size_t rows = 100;
+	const char * text = "x * y - ln(x) + (y > 1)";
+	expression e(text);
+	e.bind({"x", "y"});
+	std::shared_ptr<const CompiledExpression> program = e.compiled();
+	vector<double> x(rows);
+	vector<double> y(rows);
+	FILE * csv = std::fopen("test_columns.csv", "wb");
+	std::fprintf(csv, "id, \"x\" ,y\r\n");
+	for (size_t i = 0; i < rows; i++) {
+		x[i] = (i % 13 == 0) ? NAN : 0.25 * (i + 1);
+		y[i] = -2.0 + 0.0625 * ((i * 37) % rows);
+		if (i % 13 == 0) {
+			std::fprintf(csv, "%zu,,%.17g\r\n", i, y[i]);
+		}else {
+			std::fprintf(csv, "%zu, \"%.17g\" ,%.17g\r\n", i, x[i], y[i]);
+		}
+	}
+	std::fclose(csv);
+	{
+		ColumnWriter wx("test_x.bin");
+		ColumnWriter wy("test_y.bin");
+		wx(x.data(), rows);
+		wy(y.data(), rows);
+	}
+
+	size_t errors = 0;
+	auto compare = [&](const vector<double> & out) {
+		errors += (out.size() != rows) ? rows : 0;
+		for (size_t i = 0; i < rows && i < out.size(); i++) {
+			double v[] = {x[i], y[i]};
+			double expected = program->eval(v);
+			errors += !same(out[i], expected) && !(fabs(out[i] - expected) <= 1e-12 * fabs(expected));
+		}
+	};
+	vector<double> out;
+	CsvColumnSource source("test_columns.csv");
+	ColumnStream stream(e, source, 7);
+	stream.run([&out](const double * values, size_t n) { out.insert(out.end(), values, values + n); });
+	compare(out);
+
+	ThreadPool pool(2);
+	BinaryColumnSource binary({{"x", "test_x.bin"}, {"y", "test_y.bin"}});
+	ColumnStream binaryStream(e, binary, 7);
+	{
+		ColumnWriter result("test_out.bin");
+		errors += binaryStream.run([&result](const double * values, size_t n) { result(values, n); }, pool) != rows;
+	}
+	out.assign(rows + 1, 0.0);
+	FILE * in = std::fopen("test_out.bin", "rb");
+	out.resize(std::fread(out.data(), sizeof(double), out.size(), in));
+	std::fclose(in);
+	compare(out);
+	for (const char * path: {"test_columns.csv", "test_x.bin", "test_y.bin", "test_out.bin"}) {
+		std::remove(path);
+	}
+	check("ColumnStream sobre CSV y columnas binarias", errors == 0, errors);
+}
+
+/**
+* @brief Los programas guardados con FormulaWriter se cargan con los mismos resultados
+*
+* Se guardan programas con variables, temporales y funciones de varios argumentos; cada
+* programa cargado se compara valor por valor con el original, por valor y por lotes. Los
+* archivos truncados o con un bit alterado no deben producir programas incompletos.
+*/
+static void testFormulaFile() {
+	const char * texts[] = {"x^3 - 2*x*y + 1", "max(x, y, 1) + hypot(x, y) * sin(x)", "(x + y) * (x + y) - sqrt(x)",
+		"if(x > y, ln(x), y) + pi"};
+	const size_t n = 300;
+	FormulaWriter writer;
+	vector<std::shared_ptr<const CompiledExpression>> programs;
+	for (const char * text: texts) {
+		expression e(text);
+		e.bind({"x", "y"});
+		programs.push_back(e.compiled());
+		writer.add(*programs.back());
+	}
+	size_t errors = !writer.save("test_formulas.bin");
+	FormulaFile file("test_formulas.bin");
+	vector<unsigned char> bytes = writer.bytes();
+	FormulaFile memory(bytes.data(), bytes.size());
+	std::remove("test_formulas.bin");
+	errors += !file.isValid() || file.size() != programs.size() || memory.size() != programs.size();
+
+	vector<double> x(n);
+	vector<double> y(n);
+	for (size_t i = 0; i < n; i++) {
+		x[i] = -3.0 + 10.0 * i / n;
+		y[i] = (i % 17 == 0) ? NAN : 2.0 - 0.05 * ((i * 37) % n);
+	}
+	const double * columns[] = {x.data(), y.data()};
+	vector<double> expected(n);
+	vector<double> out(n);
+	for (size_t k = 0; k < programs.size() && errors == 0; k++) {
+		for (const FormulaFile * f: {&file, &memory}) {
+			std::shared_ptr<const CompiledExpression> loaded = f->load(k);
+			if (loaded == nullptr || !loaded->isValid()) {
+				errors++;
+				continue;
+			}
+			errors += loaded->variables() != programs[k]->variables();
+			programs[k]->evalBatch(columns, expected.data(), n);
+			loaded->evalBatch(columns, out.data(), n);
+			for (size_t i = 0; i < n; i++) {
+				double v[] = {x[i], y[i]};
+				errors += !same(out[i], expected[i]) || !same(loaded->eval(v), programs[k]->eval(v));
+			}
+		}
+	}
+	errors += file.load(programs.size()) != nullptr;
+
+	//Un archivo truncado no es válido; un byte alterado produce un programa válido o ninguno
+	for (size_t len = 0; len < bytes.size(); len++) {
+		FormulaFile truncated(bytes.data(), len);
+		errors += truncated.isValid();
+	}
+	std::mt19937 random(5);
+	for (int t = 0; t < 20000; t++) {
+		vector<unsigned char> corrupt(bytes);
+		corrupt[random() % corrupt.size()] ^= static_cast<unsigned char>(1 << (random() % 8));
+		FormulaFile f(corrupt.data(), corrupt.size());
+		for (size_t k = 0; k < f.size(); k++) {
+			std::shared_ptr<const CompiledExpression> loaded = f.load(k);
+			if (loaded != nullptr) {
+				vector<double> v(loaded->inputs(), 0.5);
+				errors += !loaded->isValid();
+				loaded->eval(v.data());
+			}
+		}
+	}
+	check("programas guardados y cargados con FormulaFile", errors == 0, errors);
+}
+
+/**
+* @brief ExpressionProfile suma los contadores de varios hilos y los escribe para Prometheus
+*/
+static void testProfileCounters() {
+	ExpressionProfile profile({"sin", "max"});
+	vector<std::thread> threads;
+	for (int t = 0; t < 4; t++) {
+		threads.emplace_back([&profile]() {
+			for (int i = 0; i < 1000; i++) {
+				profile.evaluated(1, 3, 0, i % 2, 0);
+				profile.called(1, 2);
+			}
+		});
+	}
+	for (auto & t: threads) {
+		t.join();
+	}
+	profile.compiled(1500000000);
+	ExpressionProfile::Snapshot s = profile.snapshot();
+	string text = profile.prometheus("a\"b");
+	bool ok = s.evals == 4000 && s.ops == 12000 && s.nans == 2000 && s.stackErrors == 0 && s.compilations == 1
+		&& s.calls.size() == 1 && s.calls[0].first == "max" && s.calls[0].second == 8000 && s.opsPerEval() == 3.0
+		&& text.find("expression_evaluations_total{expression=\"a\\\"b\"} 4000\n") != string::npos
+		&& text.find("expression_compile_seconds_total{expression=\"a\\\"b\"} 1.500000000\n") != string::npos
+		&& text.find("expression_function_calls_total{expression=\"a\\\"b\",function=\"max\"} 8000\n") != string::npos
+		&& text.find("function=\"sin\"") == string::npos;
+	check("contadores de ExpressionProfile", ok);
+}
+
+#ifdef EXPRESSION_PROFILE
+/**
+* @brief Los contadores de una expresión registran sus evaluaciones individuales y por lotes
+*/
+static void testProfile() {
+	const size_t n = 1000;
+	expression e("max(x, 1) + sqrt(x)");
+	e.bind({"x"});
+	std::shared_ptr<const CompiledExpression> program = e.compiled();
+	vector<double> x(n);
+	vector<double> out(n);
+	for (size_t i = 0; i < n; i++) {
+		x[i] = -5.0 + 10.0 * i / n;
+	}
+	const double * columns[] = {x.data()};
+	program->evalBatch(columns, out.data(), n);
+	size_t nans = 0;
+	for (size_t i = 0; i < 100; i++) {
+		nans += std::isnan(program->eval(&x[i]));
+	}
+	ExpressionProfile::Snapshot s = e.profile()->snapshot();
+	size_t max = 0;
+	for (auto & c: s.calls) {
+		max += (c.first == "max") ? c.second : 0;
+	}
+	bool ok = s.evals == n + 100 && s.nans == n / 2 + nans && max == n + 100 && s.compilations >= 1 && s.stackErrors == 0;
+	check("contadores de perfilado de las evaluaciones", ok);
+}
+#endif
+
+/**
+* @brief FormulaRegistry reemplaza fórmulas mientras otros hilos las evalúan
+*
+* La versión k de "f" es x * k: cada lector debe obtener siempre un k publicado, sin retroceder.
+* Otra fórmula se agrega y se elimina durante las lecturas, y una actualización no válida
+* conserva la versión vigente.
+*/
+static void testFormulaRegistry() {
+	const int versions = 200;
+	FormulaRegistry registry;
+	registry.update("f", "x * 1", {"x"});
+	std::atomic<bool> done(false);
+	std::atomic<size_t> errors(0);
+	vector<std::thread> readers;
+	for (int t = 0; t < 3; t++) {
+		readers.emplace_back([&]() {
+			double last = 1.0;
+			double x = 1.0;
+			while (!done.load()) {
+				double k = registry.eval("f", &x);
+				FormulaRegistry::Reader reader(registry);
+				const CompiledExpression * program = reader.find("f");
+				double k2 = (program != nullptr) ? program->eval(&x) : NAN;
+				if (!(k >= last && k2 >= k && k2 <= versions && k2 == std::floor(k2))) {
+					errors++;
+				}
+				last = k2;
+			}
+		});
+	}
+	size_t failed = 0;
+	for (int k = 2; k <= versions; k++) {
+		failed += !registry.update("f", "x * " + std::to_string(k), {"x"});
+		if (k % 50 == 0) {
+			failed += !registry.updateAsync("g", "x + 1", {"x"}).get() || !registry.remove("g");
+		}
+	}
+	failed += registry.update("f", "x * (1", {"x"});
+	done = true;
+	for (auto & t: readers) {
+		t.join();
+	}
+	double x = 2.0;
+	bool ok = errors == 0 && failed == 0 && registry.eval("f", &x) == 2.0 * versions && registry.version("f") == versions
+		&& registry.size() == 1 && registry.get("g") == nullptr && std::isnan(registry.eval("g", &x));
+	check("fórmulas reemplazadas durante la evaluación", ok, errors);
+}
+
+/**
+* @brief Los intervalos de IntervalExpression contienen todos los resultados en sus cajas de entrada
+*
+* Evalúa 2000 cajas aleatorias por expresión, algunas de ancho 0, y 100 puntos de cada caja: ningún
+* resultado puede quedar fuera del intervalo, y un resultado NAN requiere que se haya indicado nan.
+*/
+static void testIntervalSoundness() {
+	std::mt19937 random(1);
+	std::uniform_real_distribution<double> corner(-10.0, 10.0);
+	std::uniform_real_distribution<double> width(0.0, 5.0);
+	size_t outside = 0;
+	size_t missingNan = 0;
+	for (const char * text: {"x^2 - 2", "sin(x)*cos(x)", "x^3 - 2*x^2 - x + 1", "sqrt(x) + ln(x)", "exp(x) / (1 + x^2)",
+			"tan(x)", "abs(x - 1) ^ 0.3", "min(x, 1, y) + max(x, y)", "clamp(x, -1, 1) * y", "hypot(x, y) - atan2(y, x)",
+			"x ^ y", "log(x*y) - x/y", "(x+y)^-2", "1/x", "sin(x)^2 + cos(x)^2", "x ^ 1.5",
+			"1 ^ sqrt(x)", "sqrt(x) ^ 0", "(x - x + 1) ^ ln(y)", "sqrt(x) ^ (y - y)", "max(1 ^ sqrt(x), y)", "(y - y - 1) ^ (1 / 0)"}) {
+		expression e(text);
+		e.bind({"x", "y"});
+		IntervalExpression intervals(e);
+		std::shared_ptr<const CompiledExpression> program = e.compiled();
+		for (int t = 0; t < 2000; t++) {
+			double a = corner(random);
+			double w = (t % 4 == 0) ? 0.0 : width(random) * (t % 3 == 0 ? 0.01 : 1.0);
+			double b = corner(random);
+			double w2 = (t % 5 == 0) ? 0.0 : width(random);
+			Interval box[] = {{a, a + w}, {b, b + w2}};
+			bool nan;
+			Interval range = intervals.eval(box, &nan);
+			for (int k = 0; k < 100; k++) {
+				double v[] = {a + w * (k / 99.0), b + w2 * ((k * 37 % 100) / 99.0)};
+				double r = program->eval(v);
+				if (r != r) {
+					missingNan += !nan;
+				}else if (!range.contains(r)) {
+					outside++;
+				}
+			}
+		}
+	}
+	check("intervalos que contienen sus resultados", outside == 0, outside);
+	check("intervalos que indican NAN", missingNan == 0, missingNan);
+}
+
+/**
+* @brief Una tarea invoca parallelFor() sobre el mismo conjunto de hilos
+*/
+static void testNestedParallelFor() {
+	ThreadPool pool(2);
+	std::atomic<size_t> count(0);
+	pool.parallelFor(8, [&](size_t, size_t) {
+		pool.parallelFor(16, [&](size_t, size_t) {
+			count++;
+		});
+	});
+	check("parallelFor anidado", count == 8 * 16);
+}
+
+/**
+* @brief Varios hilos envían solicitudes a un BatchEvaluator que comparte el conjunto de hilos
+*        con evaluaciones paralelas
+*/
+static void testBatchEvaluator() {
+	const size_t requests = 2000;
+	ThreadPool pool(2);
+	std::shared_ptr<const CompiledExpression> program = expression("x^3 - 2*x^2 - x + 1").compiled();
+	std::atomic<size_t> errors(0);
+	{
+		BatchEvaluator evaluator(pool, 64);
+		vector<std::thread> threads;
+		for (int c = 0; c < 3; c++) {
+			threads.emplace_back([&, c]() {
+				vector<std::future<double>> results;
+				for (size_t i = 0; i < requests; i++) {
+					double x = c + 0.001 * i;
+					results.push_back(evaluator.submit(program, &x));
+				}
+				//Los lotes usan evalRange(): se comparan con evalBatch() en un solo hilo
+				for (size_t i = 0; i < requests; i++) {
+					double x = c + 0.001 * i;
+					const double * column[] = {&x};
+					double expected;
+					program->evalBatch(column, &expected, 1);
+					if (!same(results[i].get(), expected)) {
+						errors++;
+					}
+				}
+			});
+		}
+		//Evaluaciones paralelas simultáneas sobre el mismo conjunto de hilos
+		vector<double> x(50000, 0.5);
+		vector<double> out(x.size());
+		const double * columns[] = {x.data()};
+		for (int r = 0; r < 20; r++) {
+			program->evalParallel(columns, out.data(), x.size(), pool);
+		}
+		for (auto & t: threads) {
+			t.join();
+		}
+	}
+	check("BatchEvaluator concurrente", errors == 0, errors);
+}
+
+/**
+* @brief Con Optimization::Strict solo se calculan al compilar las llamadas a funciones puras
+*/
+static void testFolding() {
+	int calls = 0;
+	vector<CustomFunction> functions = expression::defaultFunctions();
+	functions.push_back({"count", [&calls](double x) { calls++; return x + calls; }});
+
+	expression strict("count(1) + x", functions);
+	double a = strict.eval(0.0);
+	double b = strict.eval(0.0);
+	check("funciones impuras sin plegar", a != b && calls == 2);
+
+	int draws = 0;
+	functions.push_back(CustomFunction::arguments("draw", 0, [&draws](const double *, size_t) { return ++draws; }));
+	functions.back().pure = true;
+	expression zero("draw() + x", functions, Optimization::Fast);
+	check("funciones sin argumentos sin plegar", zero.eval(0.0) != zero.eval(0.0));
+	expression twice("draw() - draw()", functions);
+	check("llamadas sin argumentos sin compartir", twice.eval(0.0) != 0.0);
+
+	functions[functions.size() - 2].pure = true;
+	expression pure("count(1) + x + max(1, 2)", functions);
+	int compiled = calls;
+	pure.eval(0.0);
+	string program = pure.programstr();
+	check("funciones puras plegadas", calls == compiled && program.find("count") == string::npos &&
+		program.find("max") == string::npos);
+}
+
+/**
+* @brief Las funciones impuras y sin argumentos se invocan una vez por fila en todas las evaluaciones
+*
+* Ni evalBatch() ni FusedExpression calculan una sola vez por bloque las llamadas con argumentos
+* constantes de las funciones impuras, e IncrementalExpression las recalcula en cada evaluación.
+*/
+static void testImpureCalls() {
+	const size_t n = 600;
+	int ticks = 0;
+	int noise = 0;
+	vector<CustomFunction> functions = expression::defaultFunctions();
+	functions.push_back(CustomFunction::arguments("tick", 0, [&ticks](const double *, size_t) { return ticks++; }));
+	functions.back().pure = true;
+	functions.push_back({"noise", [&noise](double x) { return x * noise++; }});
+
+	vector<double> x(n, 0.0);
+	vector<double> out(n);
+	vector<double> out2(n);
+	const double * columns[] = {x.data()};
+	size_t errors = 0;
+	expression tick("x + tick()", functions);
+	expression noisy("x + noise(1)", functions);
+	tick.bind({"x"});
+	noisy.bind({"x"});
+	tick.compiled()->evalBatch(columns, out.data(), n);
+	noisy.compiled()->evalBatch(columns, out2.data(), n);
+	for (size_t i = 0; i < n; i++) {
+		errors += out[i] != i;
+		errors += out2[i] != i;
+	}
+
+	ticks = 0;
+	noise = 0;
+	ExpressionSet set({"x"});
+	set.add(tick);
+	set.add(noisy);
+	double * outs[] = {out.data(), out2.data()};
+	set.compiled()->evalBatch(columns, outs, n);
+	for (size_t i = 0; i < n; i++) {
+		errors += out[i] != i;
+		errors += out2[i] != i;
+	}
+
+	ticks = 0;
+	expression twice("tick() - tick() + x", functions);
+	IncrementalExpression incremental(twice);
+	for (int i = 0; i < 3; i++) {
+		errors += incremental.eval() == 0.0;
+	}
+	check("funciones impuras invocadas por fila", errors == 0, errors);
+}
+
+/**
+* @brief La caché compila el mismo programa que expression, con los espacios como separadores, y
+*        separa los textos repetidos, los equivalentes y los conjuntos de funciones
+*/
+static void testCache() {
+	ExpressionCache cache;
+	double x[] = {2.0, 3.0};
+	bool same23 = same(cache.get("2 3")->eval(x), expression("2 3").eval(vector<Variable>{}));
+	bool separated = !cache.get("x y")->isValid();
+	bool shared = cache.get(" x+ y ") == cache.get("x + y") && cache.get("x + y")->eval(x) == 5.0;
+	check("caché y espacios", same23 && separated && shared);
+	check("caché con la tabla de funciones compartida",
+		&cache.get("sin(x)")->customFunctions() == expression::defaultFunctionTable().get());
+
+	//Un conjunto con nombre no comparte programas con las funciones predeterminadas
+	vector<CustomFunction> functions = expression::defaultFunctions();
+	functions.push_back({"twice", [](double v) { return 2 * v; }});
+	double one = 1.0;
+	bool sets = cache.get("twice(x)", "", functions) == nullptr && cache.get("twice(x)", "mine", functions)->eval(&one) == 2.0
+		&& !cache.get("twice(x)")->isValid();
+
+	//Las consultas repetidas y los textos equivalentes no compilan; cada texto cuenta en la capacidad
+	ExpressionCache small(2);
+	std::shared_ptr<const CompiledExpression> a = small.get("x * 2");
+	bool hits = small.get("x * 2") == a && small.get("  x *2") == a;
+	CacheStats s = small.stats();
+	hits = hits && s.hits == 2 && s.misses == 1 && s.size == 2 && s.evictions == 0;
+	//Al descartar los dos textos de x * 2 se descarta su programa, que sigue siendo válido
+	small.get("x + 1");
+	small.get("y + 0");
+	hits = hits && small.get("x*2") != a && a->eval(&one) == 2.0;
+	s = small.stats();
+	hits = hits && s.hits == 2 && s.misses == 4 && s.size == 2 && s.evictions == 3;
+	check("caché por texto y por conjunto de funciones", sets && hits);
+}
+
+/**
+* @brief La derivada simbólica de las funciones predefinidas de varios argumentos coincide con Gradient
+*/
+static void testBuiltinDerivatives() {
+	size_t errors = 0;
+	for (const char * text: {"atan2(x, 1)", "atan2(2, x)", "hypot(x, 3)", "max(x, 0)", "min(x, 1, 2*x)",
+			"clamp(x^2, 0, 1)", "max(sin(x), cos(x), 0.25)"}) {
+		expression e(text);
+		e.bind({"x"});
+		expression d = e.derivative("x");
+		Gradient g(e);
+		for (double x: {-0.5, 0.3, 0.7, 2.0}) {
+			double expected;
+			g.eval(&x, &expected);
+			if (!(fabs(d.eval(x) - expected) <= 1e-6)) {
+				errors++;
+			}
+		}
+	}
+	check("derivadas de atan2, hypot, min, max y clamp", errors == 0, errors);
+}
+
+/**
+* @brief derivative() y fusedDerivative() coinciden con constantes NAN e infinitas en la derivada
+*
+* derivative() escribe la derivada como texto y la compila de nuevo: las constantes deben leerse
+* con el mismo valor, incluidos NAN con el bit de signo y los infinitos.
+*/
+static void testDerivativeConstants() {
+	size_t errors = 0;
+	for (const char * text: {"max(ln(~1), x)", "min(x, ln(~1))", "x*exp(1000)", "x/exp(1000) + ~exp(1000)*x",
+			"if(x > 1, ln(~1), x^2)", "clamp(x, sqrt(~1), 3)"}) {
+		expression e(text);
+		e.bind({"x"});
+		expression d = e.derivative("x");
+		std::shared_ptr<const FusedExpression> fused = e.fusedDerivative("x");
+		for (double x: {0.5, 2.0}) {
+			double out[2];
+			fused->eval(&x, out);
+			if (!same(d.eval(x), out[1])) {
+				errors++;
+			}
+		}
+	}
+	check("constantes NAN e infinitas en derivative()", errors == 0, errors);
+}
+
+/**
+* @brief Los modos directo y reverso de Gradient y la derivada simbólica coinciden
+*
+* Incluye términos con derivada local 0 y derivada del operando infinita, como la comparación
+* ln(x) < 1 en x = 0, y los puntos sin derivada de abs, min, max y clamp.
+*/
+static void testGradientModes() {
+	size_t errors = 0;
+	for (const char * text: {"(ln(x) < 1) + x", "(ln(x) < 1) * y + x", "abs(x) + abs(y)", "max(x, y) + min(x, 0, y)",
+			"clamp(x, y, 1)", "atan2(y, x) + hypot(x, y)", "if(x > 0, sqrt(x), y) * (y == 0)", "x^y + x*y"}) {
+		expression e(text);
+		e.bind({"x", "y"});
+		Gradient g(e);
+		for (double x: {0.0, 1.0, 0.25}) {
+			for (double y: {0.0, 1.0, -2.0}) {
+				double v[] = {x, y};
+				double forward[2];
+				double reverse[2];
+				double fv = g.forward(v, forward);
+				double rv = g.reverse(v, reverse);
+				errors += !same(fv, rv) || !same(forward[0], reverse[0]) || !same(forward[1], reverse[1]);
+				for (size_t j = 0; j < 2; j++) {
+					expression d = e.derivative(j == 0 ? "x" : "y");
+					d.bind({"x", "y"});
+					double symbolic = d.eval(v);
+					errors += !same(symbolic, forward[j]) && !(fabs(symbolic - forward[j]) <= 1e-12 * fabs(symbolic));
+				}
+			}
+		}
+	}
+	check("gradiente en modo directo, reverso y simbólico", errors == 0, errors);
+}
+
+/**
+* @brief Gradient::eval() en modo reverso coincide con derivative() y con diferencias centrales
+*
+* Con más de FORWARD_LIMIT variables eval() usa el modo reverso; el valor debe ser el del intérprete.
+*/
+static void testGradientValues() {
+	const char * names[] = {"a", "b", "c", "d", "f", "g"};
+	size_t errors = 0;
+	for (const char * text: {"a*b*c + d^2 - f/g", "sin(a) * exp(b) + ln(c) * sqrt(d) + hypot(f, g)",
+			"a^b + c^d + max(f, g, 1)", "(a + b) * (a + b) * (c - d) / (f + g)"}) {
+		expression e(text);
+		e.bind(vector<string>(names, names + 6));
+		Gradient g(e);
+		std::shared_ptr<const CompiledExpression> program = e.compiled();
+		double v[] = {1.3, 0.7, 2.1, 1.9, 0.4, 3.3};
+		double gradient[6];
+		errors += !same(g.eval(v, gradient), program->eval(v));
+		for (size_t j = 0; j < 6; j++) {
+			Dual d = g.derivative(v, j);
+			double h = 1e-6 * std::max(1.0, fabs(v[j]));
+			double w[6];
+			std::copy(v, v + 6, w);
+			w[j] = v[j] + h;
+			double up = program->eval(w);
+			w[j] = v[j] - h;
+			double central = (up - program->eval(w)) / (2 * h);
+			errors += !(fabs(d.der - gradient[j]) <= 1e-12 * std::max(1.0, fabs(d.der)));
+			errors += !(fabs(central - gradient[j]) <= 1e-6 * std::max(1.0, fabs(central)));
+		}
+	}
+	check("gradiente en modo reverso con varias variables", errors == 0, errors);
+}
+
+/**
+* @brief eval() con variables y bind() usan los mismos valores predeterminados
+*/
+static void testDefaultVariables() {
+	expression e("pi*x");
+	double byName = e.eval({{"x", 1.0}});
+	e.bind({"x"});
+	double x = 1.0;
+	check("variables predeterminadas en eval()", byName == e.eval(&x) && fabs(byName - M_PI) < 1e-15);
+
+	//En un conjunto, pi y e son constantes salvo que se suministren como variables
+	expression f("x*e + pi");
+	f.bind({"x"});
+	ExpressionSet set;
+	set.add(e);
+	set.add(f);
+	ExpressionSet supplied({"x", "pi"});
+	supplied.add(e);
+	double out[2];
+	set.eval(&x, out);
+	double values[] = {1.0, 2.0};
+	double out2[1];
+	supplied.eval(values, out2);
+	check("variables predeterminadas en ExpressionSet", set.variables() == vector<string>{"x"} && out[0] == byName
+		&& out[1] == f.eval(&x) && supplied.variables().size() == 2 && out2[0] == 2.0);
+}
+
+/**
+* @brief evalBatch() de DeviceExpression informa cuándo el lote no se evaluó en el dispositivo
+*
+* Sin dispositivo, retorna falso con la causa en error(); el intérprete solo se usa si se solicita.
+*/
+static void testDeviceFallback() {
+	DeviceContext context;
+	expression e("x^2 + 1");
+	DeviceExpression device(e, context);
+	if (device.isDevice()) {
+		check("evaluación en el dispositivo sin dispositivo (omitida)", true);
+		return;
+	}
+	double x[] = {1.0, 2.0, 3.0};
+	double out[3];
+	const double * columns[] = {x};
+	bool strict = !device.evalBatch(columns, out, 3) && !device.error().empty() && out[0] != out[0];
+	bool fallback = !device.evalBatch(columns, out, 3, true) && out[0] == 2.0 && out[2] == 10.0;
+	check("evaluación en el dispositivo sin dispositivo", strict && fallback);
+}
+
+#if __cplusplus >= 202002L
+/**
+* @brief staticexpr::parseNumber() redondea correctamente, igual que expression::parseNumber()
+*
+* Compara la representación de los valores de textos con muchos dígitos, exponentes extremos,
+* subnormales y valores cercanos a los puntos medios entre dos double consecutivos.
+*/
+static void testStaticNumbers() {
+	size_t errors = 0;
+	auto compare = [&errors](const string & text) {
+		double a = 0.0;
+		double b = 0.0;
+		bool ok = staticexpr::parseNumber(text, a) && expression::parseNumber(text, b);
+		errors += !ok || std::memcmp(&a, &b, sizeof a) != 0;
+	};
+	for (const char * text: {"1e-300", "1.7976931348623157e308", "8.5e-200", "1e300", "4.9406564584124654e-324",
+			"2.4703282292062327e-324", "2.4703282292062328e-324", "2.2250738585072011e-308", "1.7976931348623159e308",
+			"9007199254740993", "123456789012345678901234567890", "1e23", "1e-400", "1e400", "000.000e5"}) {
+		compare(text);
+	}
+	compare("1" + string(850, '0') + "1e-600");
+	compare("0." + string(400, '0') + "1" + string(500, '9'));
+
+	std::mt19937_64 random(7);
+	char buf[64];
+	for (int i = 0; i < 20000; i++) {
+		uint64_t bits = random() & ~(uint64_t(1) << 63);
+		double x;
+		std::memcpy(&x, &bits, sizeof x);
+		if (!std::isfinite(x)) {
+			continue;
+		}
+		snprintf(buf, sizeof buf, "%.*e", int(1 + random() % 19), x);
+		compare(buf);
+		//Cerca del punto medio entre x y el siguiente double, con 41 dígitos
+		long double mid = ((long double) x + (long double) std::nextafter(x, HUGE_VAL)) / 2;
+		snprintf(buf, sizeof buf, "%.40Le", mid);
+		compare(buf);
+	}
+
+	constexpr auto f = compile_expr<"1e300*x + 8.5e-200">();
+	expression e("1e300*x + 8.5e-200", Optimization::None);
+	errors += f(1.0) != e.eval(1.0);
+	check("números de compile_expr correctamente redondeados", errors == 0, errors);
+}
+
+/**
+* @brief Compara una expresión de compile_expr con el intérprete sin optimizar
+* @return Cantidad de valores distintos entre eval(), evalBatch() y CompiledExpression::eval()
+*/
+template <FixedString S>
+static size_t staticErrors() {
+	constexpr auto f = compile_expr<S>();
+	const size_t n = 300;
+	vector<string> names;
+	for (size_t i = 0; i < f.inputs(); i++) {
+		names.emplace_back(f.variable(i));
+	}
+	expression e(string(S.view()), Optimization::None);
+	e.bind(names);
+	std::shared_ptr<const CompiledExpression> program = e.compiled();
+	vector<double> x(n);
+	vector<double> y(n);
+	for (size_t i = 0; i < n; i++) {
+		x[i] = -5.0 + 10.0 * i / n;
+		y[i] = (i % 11 == 0) ? NAN : 3.0 - 0.07 * ((i * 37) % n);
+	}
+	const double * columns[] = {x.data(), y.data()};
+	vector<double> out(n);
+	f.evalBatch(columns, out.data(), n);
+	size_t errors = 0;
+	for (size_t i = 0; i < n; i++) {
+		double v[] = {x[i], y[i]};
+		double expected = program->eval(v);
+		errors += !same(f.eval(v), expected) || !same(out[i], expected);
+	}
+	return errors;
+}
+
+/**
+* @brief compile_expr produce los mismos valores que el intérprete, por valor y por columnas
+*/
+static void testStaticExpressions() {
+	size_t errors = staticErrors<"x^3 - 2*x^2 - x + 1">() + staticErrors<"sin(x) * cos(y) + exp(~x) / 2">()
+		+ staticErrors<"sqrt(x) + ln(y) - abs(x - y)">() + staticErrors<"x ^ y + pi * e">()
+		+ staticErrors<"(x > y) * x + (x <= y) * y + (x != 0 && y < 1)">() + staticErrors<"2^3^x - (x + y) / y">();
+	check("compile_expr coincide con el intérprete", errors == 0, errors);
+}
+#endif
+
+int main() {
+	testConcurrentParallelFor();
+	testNestedParallelFor();
+	testBatchAgreement();
+	testLargeTrigInPlace();
+	testPowiUnderflow();
+	testTypedBatch();
+	testNative();
+	testTiered();
+	testIncremental();
+	testArena();
+	testColumnStream();
+	testFormulaFile();
+	testProfileCounters();
+#ifdef EXPRESSION_PROFILE
+	testProfile();
+#endif
+	testFormulaRegistry();
+	testIntervalSoundness();
+	testBatchEvaluator();
+	testFolding();
+	testImpureCalls();
+	testCache();
+	testBuiltinDerivatives();
+	testDerivativeConstants();
+	testGradientModes();
+	testGradientValues();
+	testDefaultVariables();
+	testDeviceFallback();
+#if __cplusplus >= 202002L
+	testStaticNumbers();
+	testStaticExpressions();
+#endif
+	return failures == 0 ? 0 : 1;
+}
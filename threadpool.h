@@ -0,0 +1,277 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+/**
+* @file
+* Conjunto persistente de hilos con robo de trabajo
+* Cada hilo tiene su propia cola de tareas: toma tareas del final de su cola y, cuando
+* se vacía, roba tareas del inicio de las colas de los demás hilos.
+* @author Erwin Meza Vega <emezav@unicauca.edu.co>
+* @copyright MIT License
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+* @brief Conjunto persistente de hilos de trabajo
+*/
+class ThreadPool {
+public:
+	/**
+	* @brief Cuerpo de una tarea
+	* @param task Número de la tarea, entre 0 y la cantidad de tareas
+	* @param worker Número del hilo que ejecuta la tarea, entre 0 y size() (inclusive)
+	*/
+	typedef std::function<void(size_t task, size_t worker)> Body;
+
+	/**
+	* @brief Crea el conjunto de hilos
+	* @param threads Cantidad de hilos, 0 para usar la cantidad de núcleos disponibles
+	*/
+	explicit ThreadPool(size_t threads = 0) {
+		if (threads == 0) {
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		}
+		stopping = false;
+		pending = 0;
+		for (size_t i = 0; i < threads; i++) {
+			queues.emplace_back(new Queue());
+		}
+		for (size_t i = 0; i < threads; i++) {
+			workers.emplace_back([this, i]() { work(i); });
+		}
+	}
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool & operator=(const ThreadPool &) = delete;
+
+	/**
+	* @brief Detiene los hilos, después de ejecutar las tareas pendientes
+	*/
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		available.notify_all();
+		for (auto & t: workers) {
+			t.join();
+		}
+	}
+
+	/**
+	* @brief Retorna la cantidad de hilos de trabajo
+	* @return Cantidad de hilos
+	*/
+	size_t size() const {
+		return workers.size();
+	}
+
+	/**
+	* @brief Ejecuta un conjunto de tareas y espera a que terminen
+	*
+	* Las tareas se reparten en bloques contiguos entre las colas de los hilos. El hilo que
+	* invoca este método también ejecuta tareas mientras espera, con número de hilo size(), pero
+	* solo las de su propio lote: varios hilos pueden invocar parallelFor() a la vez, y cada uno
+	* es el único que ejecuta tareas de su lote con ese número. El método se puede invocar desde
+	* una tarea. Si alguna tarea lanza una excepción, se relanza la primera al terminar todas.
+	* @param tasks Cantidad de tareas
+	* @param body Cuerpo de las tareas
+	*/
+	void parallelFor(size_t tasks, const Body & body) {
+		if (tasks == 0) {
+			return;
+		}
+
+		Batch batch(body, tasks);
+		size_t n = queues.size();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pending += tasks;
+		}
+		for (size_t w = 0; w < n; w++) {
+			size_t begin = tasks * w / n;
+			size_t end = tasks * (w + 1) / n;
+			if (begin == end) {
+				continue;
+			}
+			std::lock_guard<std::mutex> lock(queues[w]->mutex);
+			for (size_t t = begin; t < end; t++) {
+				queues[w]->jobs.push_back({&batch, t});
+			}
+		}
+		available.notify_all();
+
+		//Ayudar mientras quedan tareas de este lote
+		Job job;
+		while (batch.remaining.load(std::memory_order_acquire) > 0) {
+			if (claim(batch, job)) {
+				execute(job, n);
+			}else {
+				std::unique_lock<std::mutex> lock(batch.mutex);
+				batch.done.wait(lock, [&batch]() { return batch.remaining.load() == 0; });
+			}
+		}
+		//La última tarea libera el mutex del lote después de notificar
+		std::lock_guard<std::mutex> lock(batch.mutex);
+
+		if (batch.error) {
+			std::rethrow_exception(batch.error);
+		}
+	}
+
+private:
+	/**
+	* @brief Lote de tareas de una llamada a parallelFor()
+	*/
+	struct Batch {
+		Batch(const Body & b, size_t tasks): body(b), remaining(tasks) {}
+		const Body & body; /*!< Cuerpo de las tareas */
+		std::atomic<size_t> remaining; /*!< Tareas sin terminar */
+		std::mutex mutex; /*!< Protege la notificación de terminación */
+		std::condition_variable done; /*!< Notifica la terminación del lote */
+		std::exception_ptr error; /*!< Primera excepción lanzada por una tarea */
+	};
+
+	/**
+	* @brief Tarea en una cola
+	*/
+	struct Job {
+		Batch * batch; /*!< Lote al que pertenece la tarea */
+		size_t task; /*!< Número de la tarea */
+	};
+
+	/**
+	* @brief Cola de tareas de un hilo
+	*/
+	struct Queue {
+		std::mutex mutex; /*!< Protege la cola */
+		std::deque<Job> jobs; /*!< Tareas pendientes */
+	};
+
+	/**
+	* @brief Ciclo de un hilo de trabajo
+	* @param id Número del hilo
+	*/
+	void work(size_t id) {
+		Job job;
+		while (true) {
+			if (pop(id, job) || steal(id, job)) {
+				execute(job, id);
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(mutex);
+			available.wait(lock, [this]() { return stopping || pending > 0; });
+			if (stopping && pending == 0) {
+				return;
+			}
+		}
+	}
+
+	/**
+	* @brief Toma una tarea del final de la cola propia
+	* @param id Número del hilo
+	* @param job Referencia a la tarea obtenida
+	* @return Verdadero si se obtuvo una tarea
+	*/
+	bool pop(size_t id, Job & job) {
+		Queue & q = *queues[id];
+		std::lock_guard<std::mutex> lock(q.mutex);
+		if (q.jobs.empty()) {
+			return false;
+		}
+		job = q.jobs.back();
+		q.jobs.pop_back();
+		taken();
+		return true;
+	}
+
+	/**
+	* @brief Toma de cualquier cola la primera tarea de un lote, para el hilo que invoca parallelFor()
+	* @param batch Lote
+	* @param job Referencia a la tarea obtenida
+	* @return Verdadero si se obtuvo una tarea
+	*/
+	bool claim(const Batch & batch, Job & job) {
+		for (auto & q: queues) {
+			std::lock_guard<std::mutex> lock(q->mutex);
+			auto it = std::find_if(q->jobs.begin(), q->jobs.end(), [&batch](const Job & j) { return j.batch == &batch; });
+			if (it != q->jobs.end()) {
+				job = *it;
+				q->jobs.erase(it);
+				taken();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	* @brief Roba una tarea del inicio de la cola de otro hilo
+	* @param id Número del hilo que roba
+	* @param job Referencia a la tarea obtenida
+	* @return Verdadero si se obtuvo una tarea
+	*/
+	bool steal(size_t id, Job & job) {
+		size_t n = queues.size();
+		for (size_t i = 1; i <= n; i++) {
+			Queue & q = *queues[(id + i) % n];
+			std::lock_guard<std::mutex> lock(q.mutex);
+			if (!q.jobs.empty()) {
+				job = q.jobs.front();
+				q.jobs.pop_front();
+				taken();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	* @brief Descuenta una tarea de las tareas pendientes
+	*/
+	void taken() {
+		std::lock_guard<std::mutex> lock(mutex);
+		pending--;
+	}
+
+	/**
+	* @brief Ejecuta una tarea y notifica la terminación de su lote
+	* @param job Tarea
+	* @param id Número del hilo que la ejecuta
+	*/
+	void execute(const Job & job, size_t id) {
+		Batch & batch = *job.batch;
+		try {
+			batch.body(job.task, id);
+		}catch (...) {
+			std::lock_guard<std::mutex> lock(batch.mutex);
+			if (!batch.error) {
+				batch.error = std::current_exception();
+			}
+		}
+		std::lock_guard<std::mutex> lock(batch.mutex);
+		if (batch.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			batch.done.notify_all();
+		}
+	}
+
+	std::vector<std::unique_ptr<Queue>> queues; /*!< Colas de tareas, una por hilo */
+	std::vector<std::thread> workers; /*!< Hilos de trabajo */
+	std::mutex mutex; /*!< Protege pending y stopping */
+	std::condition_variable available; /*!< Notifica nuevas tareas a los hilos */
+	size_t pending; /*!< Tareas en las colas */
+	bool stopping; /*!< Verdadero si se está destruyendo el conjunto */
+};
+
+#endif
@@ -0,0 +1,213 @@
+#ifndef TIERED_H
+#define TIERED_H
+
+/**
+* @file
+* Ejecución por niveles de las expresiones
+* Una expresión se evalúa primero con el intérprete sobre el programa sin optimizar. Al superar
+* un número de evaluaciones se promueve al programa optimizado y, al superar un segundo umbral,
+* a código nativo compilado en un hilo secundario.
+* @author Erwin Meza Vega <emezav@unicauca.edu.co>
+* @copyright MIT License
+*/
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "expression.h"
+#include "jit.h"
+
+/**
+* @brief Nivel de ejecución de una expresión
+*/
+enum class Tier {
+	Interpreter, /*!< Intérprete sobre el programa sin optimizar */
+	Optimized, /*!< Intérprete sobre el programa optimizado */
+	Native /*!< Código nativo */
+};
+
+/**
+* @brief Contadores de la ejecución por niveles
+*/
+struct TierStats {
+	size_t evals; /*!< Evaluaciones realizadas */
+	Tier tier; /*!< Nivel de ejecución actual */
+	size_t promotions; /*!< Promociones realizadas */
+	double optimizeTime; /*!< Tiempo de compilación del programa optimizado, en segundos */
+	double nativeTime; /*!< Tiempo de compilación a código nativo, en segundos */
+};
+
+/**
+* @brief Expresión que se promueve automáticamente a niveles de ejecución más rápidos
+*
+* Los resultados no dependen del nivel, salvo por las reescrituras de la optimización (ver
+* expression::optimize()). Una instancia se puede evaluar desde varios hilos.
+*/
+class TieredExpression {
+public:
+	/** Evaluaciones antes de promover al programa optimizado */
+	static const size_t OPTIMIZE_THRESHOLD = 1000;
+
+	/** Evaluaciones antes de compilar a código nativo */
+	static const size_t NATIVE_THRESHOLD = 100000;
+
+	/**
+	* @brief Crea una expresión con ejecución por niveles
+	* @param text Texto de la expresión en notación infija
+	* @param names Nombres de las variables, en el orden en que se suministran sus valores
+	* @param funcs Funciones personalizadas
+	* @param optimizeAfter Evaluaciones antes de promover al programa optimizado
+	* @param nativeAfter Evaluaciones antes de compilar a código nativo
+	*/
+	TieredExpression(string text, vector<string> names = {"x"},
+			vector<CustomFunction> funcs = expression::defaultFunctions(),
+			size_t optimizeAfter = OPTIMIZE_THRESHOLD, size_t nativeAfter = NATIVE_THRESHOLD):
+		text(std::move(text)), names(std::move(names)), functions(std::move(funcs)),
+		optimizeAfter(optimizeAfter), nativeAfter(nativeAfter),
+		tier(Tier::Interpreter), evals(0), promotions(0), optimizing(false), compiling(false),
+		optimizeTime(0.0), nativeTime(0.0) {
+		interpreted = compile(Optimization::None);
+	}
+
+	TieredExpression(const TieredExpression &) = delete;
+	TieredExpression & operator=(const TieredExpression &) = delete;
+
+	/**
+	* @brief Espera a que termine la compilación a código nativo
+	*/
+	~TieredExpression() {
+		if (compiler.joinable()) {
+			compiler.join();
+		}
+	}
+
+	/**
+	* @brief Evalúa la expresión en el nivel actual
+	* @param values Valores de las variables, en el orden de los nombres dados al crearla
+	* @return Resultado de la expresión
+	*/
+	double eval(const double * values) {
+		size_t n = evals.fetch_add(1, std::memory_order_relaxed) + 1;
+
+		switch (tier.load(std::memory_order_acquire)) {
+			case Tier::Native:
+				return native->eval(values);
+			case Tier::Optimized:
+				if (n >= nativeAfter) {
+					promoteNative();
+				}
+				return optimized->eval(values);
+			default:
+				if (n >= optimizeAfter) {
+					promoteOptimized();
+				}
+				return interpreted->eval(values);
+		}
+	}
+
+	/**
+	* @brief Sobrecarga del operador ()
+	* @param x Valor de la primera variable (por defecto, x)
+	* @return Resultado de la expresión
+	*/
+	double operator()(double x) {
+		return eval(&x);
+	}
+
+	/**
+	* @brief Retorna el nivel de ejecución actual
+	* @return Nivel de ejecución
+	*/
+	Tier current() const {
+		return tier.load(std::memory_order_acquire);
+	}
+
+	/**
+	* @brief Retorna los contadores de la ejecución por niveles
+	*
+	* Los tiempos de compilación son válidos una vez alcanzado el nivel correspondiente.
+	* @return Evaluaciones, nivel actual, promociones y tiempos de compilación
+	*/
+	TierStats stats() const {
+		Tier t = tier.load(std::memory_order_acquire);
+		return {evals.load(std::memory_order_relaxed), t, promotions.load(std::memory_order_acquire),
+			(t != Tier::Interpreter) ? optimizeTime : 0.0, (t == Tier::Native) ? nativeTime : 0.0};
+	}
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	/**
+	* @brief Compila el programa de la expresión
+	* @param opt Nivel de optimización
+	* @return Programa compilado con las variables asociadas a names
+	*/
+	std::shared_ptr<const CompiledExpression> compile(Optimization opt) {
+		expression e(text, functions, opt);
+		e.bind(names);
+		return e.compiled();
+	}
+
+	/**
+	* @brief Promueve la expresión al programa optimizado; solo un hilo realiza la compilación
+	*/
+	void promoteOptimized() {
+		//La lectura evita escribir la línea de caché compartida en cada evaluación posterior al umbral
+		if (optimizing.load(std::memory_order_relaxed) || optimizing.exchange(true, std::memory_order_acq_rel)) {
+			return;
+		}
+		Clock::time_point start = Clock::now();
+		optimized = compile(Optimization::Strict);
+		optimizeTime = std::chrono::duration<double>(Clock::now() - start).count();
+		promotions.fetch_add(1, std::memory_order_release);
+		tier.store(Tier::Optimized, std::memory_order_release);
+	}
+
+	/**
+	* @brief Inicia la compilación a código nativo en un hilo secundario
+	*
+	* Mientras tanto se sigue evaluando el programa optimizado. Si el programa no se puede
+	* compilar a código nativo, la expresión permanece en el nivel optimizado.
+	*/
+	void promoteNative() {
+		if (compiling.load(std::memory_order_relaxed) || compiling.exchange(true, std::memory_order_acq_rel)) {
+			return;
+		}
+		compiler = std::thread([this]() {
+			Clock::time_point start = Clock::now();
+			std::unique_ptr<NativeExpression> n(new NativeExpression(optimized));
+			if (!n->isNative()) {
+				return;
+			}
+			nativeTime = std::chrono::duration<double>(Clock::now() - start).count();
+			native = std::move(n);
+			promotions.fetch_add(1, std::memory_order_release);
+			tier.store(Tier::Native, std::memory_order_release);
+		});
+	}
+
+	string text; /*!< Texto de la expresión */
+	vector<string> names; /*!< Nombres de las variables, en el orden de sus valores */
+	vector<CustomFunction> functions; /*!< Funciones personalizadas */
+	size_t optimizeAfter; /*!< Evaluaciones antes de promover al programa optimizado */
+	size_t nativeAfter; /*!< Evaluaciones antes de compilar a código nativo */
+
+	std::atomic<Tier> tier; /*!< Nivel actual; se publica después del programa correspondiente */
+	std::atomic<size_t> evals; /*!< Evaluaciones realizadas */
+	std::atomic<size_t> promotions; /*!< Promociones realizadas */
+	std::atomic<bool> optimizing; /*!< Verdadero si ya se inició la compilación optimizada */
+	std::atomic<bool> compiling; /*!< Verdadero si ya se inició la compilación a código nativo */
+	double optimizeTime; /*!< Tiempo de compilación del programa optimizado, en segundos */
+	double nativeTime; /*!< Tiempo de compilación a código nativo, en segundos */
+
+	std::shared_ptr<const CompiledExpression> interpreted; /*!< Programa sin optimizar */
+	std::shared_ptr<const CompiledExpression> optimized; /*!< Programa optimizado */
+	std::unique_ptr<NativeExpression> native; /*!< Código nativo */
+	std::thread compiler; /*!< Hilo de compilación a código nativo */
+};
+
+#endif
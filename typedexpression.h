@@ -0,0 +1,857 @@
+#ifndef TYPEDEXPRESSION_H
+#define TYPEDEXPRESSION_H
+
+/**
+* @file
+* Evaluación de expresiones con un tipo de valor configurable
+* El análisis de la expresión es el de la clase expression; el programa resultante se evalúa con
+* valores de tipo T, por ejemplo float para duplicar la cantidad de valores por registro vectorial
+* y reducir a la mitad el tráfico de memoria, o long double para obtener más precisión.
+* @author Erwin Meza Vega <emezav@unicauca.edu.co>
+* @copyright MIT License
+*/
+
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "expression.h"
+
+/**
+* @brief Expresión aritmética evaluada con valores de tipo T
+*
+* Los números de la expresión se convierten directamente al tipo T, y pi y e toman su valor con
+* la precisión de T, sin pasar por double. Las operaciones + - * / ^ ~, las comparaciones, los
+* operadores lógicos y las funciones con código de operación propio (sqrt, sin, cos, tan, ln, log,
+* exp, abs, pow, if) se calculan en T; las demás
+* funciones personalizadas, como min, max o atan2, se invocan con sus argumentos convertidos a
+* double y su resultado se convierte a T. Del programa solo se eliminan las subexpresiones
+* repetidas (ver expression::shareSubexpressions()): el plegado de constantes y las demás
+* reescrituras de expression::optimize() se calculan en double.
+*
+* T debe poder construirse a partir de double, convertirse a double con static_cast y tener los
+* operadores aritméticos y de comparación; las funciones sqrt, sin, cos, tan, log, log10, exp, fabs y pow de T se
+* buscan en std y por argumentos (ADL), de modo que un tipo de punto fijo puede definir las suyas.
+* @tparam T Tipo de los valores
+*/
+template <typename T>
+class TypedExpression {
+public:
+	/** Cantidad de valores por bloque en la evaluación por lotes */
+	static const size_t BATCH_SIZE = CompiledExpression::BATCH_SIZE;
+
+	/** Profundidad máxima de la pila que eval(const T *) reserva en la pila del hilo */
+	static const size_t LOCAL_STACK = CompiledExpression::LOCAL_STACK;
+
+	/**
+	* @brief Crea una expresión con las funciones predeterminadas
+	* @param text Texto de la expresión en notación infija
+	*/
+	explicit TypedExpression(const string & text): TypedExpression(text, expression::defaultFunctionTable()) {
+	}
+
+	/**
+	* @brief Crea una expresión que comparte una tabla de funciones
+	* @param text Texto de la expresión en notación infija
+	* @param funcs Tabla inmutable de funciones
+	*/
+	TypedExpression(const string & text, std::shared_ptr<const vector<CustomFunction>> funcs):
+		functions(funcs) {
+		//Valores de las variables no suministradas: pi, e y NAN
+		constants.resize(UNDEFINED + 1, std::numeric_limits<T>::quiet_NaN());
+		defaultValue("pi", constants[PI]);
+		defaultValue("e", constants[E]);
+
+		expression parsed(text, funcs, Optimization::None, std::pmr::get_default_resource());
+		if (parsed.isBalanced()) {
+			compile(parsed, parsed.getRPN(expression::lex(text), text), text);
+		}
+		bind({});
+		xProgram = resolve({"x"});
+	}
+
+	/**
+	* @brief Retorna los nombres de las variables de la expresión
+	* @return Nombres de las variables, en orden de aparición
+	*/
+	const vector<string> & variables() const {
+		return slots;
+	}
+
+	/**
+	* @brief Verifica si el programa produce exactamente un valor
+	* @return Verdadero si la expresión es válida
+	*/
+	bool isValid() const {
+		return valid;
+	}
+
+	/**
+	* @brief Asocia las variables de la expresión a posiciones de un arreglo de valores
+	*
+	* Las variables que no aparecen en names toman el valor de pi o e con la precisión de T si
+	* son variables predeterminadas, o NAN en otro caso.
+	* @param names Nombres de las variables, en el orden en que se suministran sus valores
+	* @return Verdadero si todas las variables de la expresión quedaron definidas
+	*/
+	bool bind(const vector<string> & names) {
+		bool resolved = true;
+		bound = resolve(names, &resolved);
+		return resolved;
+	}
+
+	/**
+	* @brief Evalúa la expresión con las variables asociadas mediante bind()
+	* @param values Valores de las variables asociadas
+	* @return Resultado de la expresión
+	*/
+	T eval(const T * values) const {
+		return run(bound, values);
+	}
+
+	/**
+	* @brief Evalúa la expresión con un valor para la variable x
+	* @param x Valor de la variable x
+	* @return Resultado de la expresión
+	*/
+	T eval(T x) const {
+		return run(xProgram, &x);
+	}
+
+	/**
+	* @brief Evalúa la expresión sobre un arreglo de valores de x
+	* @param x Valores de la variable x
+	* @param out Arreglo de salida, con capacidad para n valores
+	* @param n Cantidad de valores a evaluar
+	*/
+	void evalBatch(const T * x, T * out, size_t n) const {
+		const T * columns[] = {x};
+		runBatch(xProgram, columns, out, n);
+	}
+
+	/**
+	* @brief Evalúa la expresión por columnas, con las variables asociadas mediante bind()
+	*
+	* Cada instrucción se aplica a bloques de BATCH_SIZE valores con ciclos que el compilador
+	* puede vectorizar.
+	* @param columns Una columna de n valores por cada variable asociada
+	* @param out Arreglo de salida, con capacidad para n valores
+	* @param n Cantidad de valores a evaluar
+	*/
+	void evalBatch(const T * const * columns, T * out, size_t n) const {
+		runBatch(bound, columns, out, n);
+	}
+
+	/**
+	* @brief Convierte un número de la expresión en un valor de tipo T, con la precisión de T
+	* @param str Texto del número
+	* @param val Referencia al valor convertido
+	* @return Verdadero si todo el texto representa un número
+	*/
+	static bool parseNumber(std::string_view str, T & val) {
+		if constexpr (std::is_floating_point_v<T>) {
+#ifdef __cpp_lib_to_chars
+			const char * first = str.data();
+			const char * last = first + str.size();
+			auto res = std::from_chars(first, last, val);
+			if (res.ec == std::errc::result_out_of_range && res.ptr == last) {
+				//Desbordamiento: strtold retorna infinito o cero
+				val = static_cast<T>(strtold(string(str).c_str(), nullptr));
+				return true;
+			}
+			return res.ec == std::errc() && res.ptr == last;
+#else
+			string s(str);
+			char * p;
+			val = static_cast<T>(strtold(s.c_str(), &p));
+			return *p == 0;
+#endif
+		}else {
+			double v;
+			bool ok = expression::parseNumber(str, v);
+			val = T(v);
+			return ok;
+		}
+	}
+
+	/**
+	* @brief Valor de una variable predeterminada con la precisión de T
+	* @param name Nombre de la variable
+	* @param val Referencia al valor de la variable
+	* @return Verdadero si name es una variable predeterminada
+	*/
+	static bool defaultValue(std::string_view name, T & val) {
+		if (name == "pi") {
+			return parseNumber("3.14159265358979323846264338327950288", val);
+		}
+		if (name == "e") {
+			return parseNumber("2.71828182845904523536028747135266250", val);
+		}
+		return false;
+	}
+
+private:
+	/** Posiciones de las constantes de las variables no suministradas */
+	enum { PI, E, UNDEFINED };
+
+	/** Durante la compilación, los números se cargan como valores de entrada desde esta posición */
+	static const size_t LITERAL = SIZE_MAX / 2;
+
+	/**
+	* @brief Programa con las variables asociadas a posiciones de un arreglo de valores
+	*/
+	struct Bound {
+		Program code; /*!< Instrucciones, vacío si la expresión no es válida */
+		size_t depth = 0; /*!< Profundidad máxima de la pila, sin los temporales */
+		size_t temps = 0; /*!< Cantidad de temporales */
+		size_t args = 0; /*!< Mayor cantidad de argumentos de una instrucción CallN */
+	};
+
+	/**
+	* @brief Elemento de la pila de evaluación por lotes: una columna de valores o un escalar
+	*/
+	struct BatchValue {
+		const T * col; /*!< Columna de valores, nullptr si el elemento es escalar */
+		T val; /*!< Valor del elemento escalar */
+	};
+
+	/**
+	* @brief Genera el programa a partir de la expresión en RPN
+	*
+	* Las constantes se guardan en constants, después de las de las variables no suministradas; el
+	* argumento de cada instrucción Const es su posición. Mientras se comparten las subexpresiones
+	* repetidas, los números se representan como valores de entrada para que no se plieguen en double.
+	* @param parsed Expresión que resuelve los nombres de las funciones
+	* @param rpn Elementos de la expresión en RPN
+	* @param src Texto de la expresión
+	*/
+	void compile(expression & parsed, const std::pmr::vector<Token> & rpn, std::string_view src) {
+		bool matched = true;
+		std::unordered_map<std::string_view, size_t> literals;
+		for (auto & t: rpn) {
+			Instruction ins = {OpCode::Const, 0, 0.0};
+			std::string_view item = src.substr(t.offset, t.length);
+			switch (t.kind) {
+				case TokenKind::Number: {
+					auto it = literals.find(item);
+					if (it == literals.end()) {
+						it = literals.emplace(item, constants.size()).first;
+						constants.emplace_back();
+						parseNumber(item, constants.back());
+					}
+					ins.op = OpCode::Load;
+					ins.arg = LITERAL + it->second;
+					break;
+				}
+				case TokenKind::Function: {
+					parsed.findFunction(item, ins.arg);
+					const CustomFunction & f = (*functions)[ins.arg];
+					matched = matched && f.accepts(t.args);
+					if (f.op != OpCode::Call && CompiledExpression::arity(f.op) == t.args) {
+						ins.op = f.op;
+					}else if (f.isMultiArgument()) {
+						ins.op = OpCode::CallN;
+						ins.count = t.args;
+					}else {
+						ins.op = OpCode::Call;
+					}
+					break;
+				}
+				case TokenKind::Operator:
+					ins.op = expression::getOpCode(item);
+					matched = matched && ins.op != OpCode::Const;
+					break;
+				default: {
+					ins.op = OpCode::Load;
+					auto it = std::find(slots.begin(), slots.end(), item);
+					ins.arg = it - slots.begin();
+					if (it == slots.end()) {
+						slots.emplace_back(item);
+					}
+					break;
+				}
+			}
+			program.push_back(ins);
+		}
+
+		size_t d;
+		valid = matched && CompiledExpression::validate(program, d);
+		if (!valid) {
+			return;
+		}
+		program = expression::shareSubexpressions(std::move(program));
+		for (auto & ins: program) {
+			if (ins.op == OpCode::Load && ins.arg >= LITERAL) {
+				ins.op = OpCode::Const;
+				ins.arg -= LITERAL;
+			}
+		}
+	}
+
+	/**
+	* @brief Asocia las variables del programa a posiciones de un arreglo de valores
+	* @param names Nombres de las variables, en el orden en que se suministran sus valores
+	* @param resolved Si no es nullptr, se marca como falso si alguna variable queda indefinida
+	* @return Programa con las variables asociadas
+	*/
+	Bound resolve(const vector<string> & names, bool * resolved = nullptr) const {
+		Bound b;
+		if (!valid) {
+			return b;
+		}
+		b.code = program;
+		for (auto & ins: b.code) {
+			if (ins.op != OpCode::Load) {
+				continue;
+			}
+			const string & name = slots[ins.arg];
+			auto it = std::find(names.begin(), names.end(), name);
+			if (it != names.end()) {
+				ins.arg = it - names.begin();
+				continue;
+			}
+			//Variable no suministrada: constante con el valor predeterminado
+			ins.op = OpCode::Const;
+			ins.arg = (name == "pi") ? PI : (name == "e") ? E : UNDEFINED;
+			if (ins.arg == UNDEFINED && resolved != nullptr) {
+				*resolved = false;
+			}
+		}
+		CompiledExpression::validate(b.code, b.depth, b.temps);
+		for (auto & ins: b.code) {
+			if (ins.op == OpCode::CallN) {
+				b.args = std::max(b.args, ins.count);
+			}
+		}
+		return b;
+	}
+
+	/**
+	* @brief Evalúa un programa
+	*
+	* No reserva memoria si la pila y los temporales no exceden LOCAL_STACK.
+	* @param b Programa
+	* @param values Valores de entrada
+	* @return Resultado, NAN si el programa no es válido
+	*/
+	T run(const Bound & b, const T * values) const {
+		if (b.code.empty()) {
+			return std::numeric_limits<T>::quiet_NaN();
+		}
+		if (b.depth + b.temps <= LOCAL_STACK) {
+			T st[LOCAL_STACK];
+			return run(b, values, st);
+		}
+		vector<T> st(b.depth + b.temps);
+		return run(b, values, st.data());
+	}
+
+	/**
+	* @brief Evalúa un programa válido sobre una pila dada
+	* @param b Programa
+	* @param values Valores de entrada
+	* @param st Pila de evaluación, seguida de los temporales
+	* @return Resultado
+	*/
+	T run(const Bound & b, const T * values, T * st) const {
+		size_t top = 0;
+		for (auto & ins: b.code) {
+			switch (ins.op) {
+				case OpCode::Store:
+					st[b.depth + ins.arg] = st[top - 1];
+					break;
+				case OpCode::Temp:
+					st[top++] = st[b.depth + ins.arg];
+					break;
+				case OpCode::Const:
+					st[top++] = constants[ins.arg];
+					break;
+				case OpCode::Load:
+					st[top++] = values[ins.arg];
+					break;
+				case OpCode::Call:
+					st[top - 1] = T((*functions)[ins.arg](static_cast<double>(st[top - 1])));
+					break;
+				case OpCode::CallN:
+					top -= ins.count;
+					st[top] = call((*functions)[ins.arg], st + top, ins.count);
+					top++;
+					break;
+				case OpCode::Add:
+				case OpCode::Sub:
+				case OpCode::Mul:
+				case OpCode::Div:
+				case OpCode::Pow:
+				case OpCode::Lt:
+				case OpCode::Le:
+				case OpCode::Gt:
+				case OpCode::Ge:
+				case OpCode::Eq:
+				case OpCode::Ne:
+				case OpCode::And:
+				case OpCode::Or:
+					top--;
+					st[top - 1] = calculate(st[top - 1], st[top], ins.op);
+					break;
+				case OpCode::Select:
+					top -= 2;
+					st[top - 1] = (st[top - 1] != T(0.0)) ? st[top] : st[top + 1];
+					break;
+				default:
+					st[top - 1] = calculateUnary(st[top - 1], ins.op);
+					break;
+			}
+		}
+		return st[0];
+	}
+
+	/**
+	* @brief Evalúa un programa por bloques sobre columnas de valores
+	* @param b Programa
+	* @param columns Columnas de valores de entrada
+	* @param out Arreglo de salida
+	* @param n Cantidad de valores a evaluar
+	*/
+	void runBatch(const Bound & b, const T * const * columns, T * out, size_t n) const {
+		if (b.code.empty()) {
+			std::fill(out, out + n, std::numeric_limits<T>::quiet_NaN());
+			return;
+		}
+		//Los argumentos de las instrucciones CallN se copian después de los bloques
+		vector<T> scratch((b.depth + b.temps) * BATCH_SIZE + b.args);
+		vector<BatchValue> st(b.depth + b.temps);
+		for (size_t base = 0; base < n; base += BATCH_SIZE) {
+			size_t len = std::min(n - base, size_t(BATCH_SIZE));
+			runBlock(b, columns, base, len, scratch.data(), st.data(), out + base);
+		}
+	}
+
+	/**
+	* @brief Evalúa un programa sobre un bloque de valores
+	* @param b Programa
+	* @param columns Columnas de valores de entrada
+	* @param base Posición del bloque dentro de las columnas
+	* @param len Cantidad de valores del bloque
+	* @param scratch Bloques de la pila de evaluación y de los temporales, BATCH_SIZE valores por posición,
+	*        seguidos de b.args valores para los argumentos de CallN
+	* @param st Pila de evaluación, seguida de los temporales
+	* @param out Arreglo de salida del bloque
+	*/
+	void runBlock(const Bound & b, const T * const * columns, size_t base, size_t len,
+			T * scratch, BatchValue * st, T * out) const {
+		size_t top = 0;
+		for (auto & ins: b.code) {
+			switch (ins.op) {
+				case OpCode::Store: {
+					//El temporal conserva su propio bloque: el de la pila se reutiliza
+					BatchValue v = st[top - 1];
+					if (v.col != nullptr) {
+						T * t = scratch + (b.depth + ins.arg) * BATCH_SIZE;
+						std::copy(v.col, v.col + len, t);
+						v.col = t;
+					}
+					st[b.depth + ins.arg] = v;
+					break;
+				}
+				case OpCode::Temp:
+					st[top++] = st[b.depth + ins.arg];
+					break;
+				case OpCode::Const:
+					st[top++] = {nullptr, constants[ins.arg]};
+					break;
+				case OpCode::Load:
+					st[top++] = {columns[ins.arg] + base, T()};
+					break;
+				case OpCode::CallN: {
+					top -= ins.count;
+					T * y = scratch + top * BATCH_SIZE;
+					T * row = scratch + (b.depth + b.temps) * BATCH_SIZE;
+					for (size_t i = 0; i < len; i++) {
+						for (size_t j = 0; j < ins.count; j++) {
+							row[j] = (st[top + j].col != nullptr) ? st[top + j].col[i] : st[top + j].val;
+						}
+						y[i] = call((*functions)[ins.arg], row, ins.count);
+					}
+					st[top++] = {y, T()};
+					break;
+				}
+				case OpCode::Add:
+				case OpCode::Sub:
+				case OpCode::Mul:
+				case OpCode::Div:
+				case OpCode::Pow:
+				case OpCode::Lt:
+				case OpCode::Le:
+				case OpCode::Gt:
+				case OpCode::Ge:
+				case OpCode::Eq:
+				case OpCode::Ne:
+				case OpCode::And:
+				case OpCode::Or:
+					top--;
+					binary(st[top - 1], st[top], ins.op, scratch + (top - 1) * BATCH_SIZE, len);
+					break;
+				case OpCode::Select:
+					top -= 2;
+					select(st + top - 1, scratch + (top - 1) * BATCH_SIZE, len);
+					break;
+				default: {
+					BatchValue & v = st[top - 1];
+					bool call = ins.op == OpCode::Call;
+					if (v.col == nullptr && (!call || (*functions)[ins.arg].pure)) {
+						v.val = call ? T((*functions)[ins.arg](static_cast<double>(v.val))) : calculateUnary(v.val, ins.op);
+						break;
+					}
+					T * y = scratch + (top - 1) * BATCH_SIZE;
+					const T * x = v.col;
+					switch (ins.op) {
+						case OpCode::Neg:
+							for (size_t i = 0; i < len; i++) {
+								y[i] = -x[i];
+							}
+							break;
+						case OpCode::Not:
+							for (size_t i = 0; i < len; i++) {
+								y[i] = T((x[i] == T(0.0)) ? 1.0 : 0.0);
+							}
+							break;
+						case OpCode::Call:
+							//Una función impura con un argumento escalar se invoca una vez por fila
+							for (size_t i = 0; i < len; i++) {
+								y[i] = T((*functions)[ins.arg](static_cast<double>((x != nullptr) ? x[i] : v.val)));
+							}
+							break;
+						default:
+							unary(x, y, ins.op, len);
+							break;
+					}
+					v.col = y;
+					break;
+				}
+			}
+		}
+
+		if (st[0].col == nullptr) {
+			std::fill(out, out + len, st[0].val);
+		}else {
+			std::copy(st[0].col, st[0].col + len, out);
+		}
+	}
+
+	/**
+	* @brief Calcula una operación binaria sobre un bloque de valores
+	* @param a Primer operando, donde se almacena el resultado
+	* @param b Segundo operando
+	* @param op Código de operación
+	* @param y Bloque de la pila asociado al primer operando
+	* @param len Cantidad de valores del bloque
+	*/
+	static void binary(BatchValue & a, const BatchValue & b, OpCode op, T * y, size_t len) {
+		if (a.col == nullptr && b.col == nullptr) {
+			a.val = calculate(a.val, b.val, op);
+			return;
+		}
+		//Potencia con exponente entero: multiplicaciones sucesivas
+		if (op == OpCode::Pow && a.col != nullptr && b.col == nullptr) {
+			double k = static_cast<double>(b.val);
+			if (k == std::trunc(k) && std::fabs(k) <= 16.0) {
+				powi(a.col, static_cast<int>(k), y, len);
+				a.col = y;
+				return;
+			}
+		}
+		switch (op) {
+			case OpCode::Add:
+				apply(a, b, y, len, [](T u, T v) { return u + v; });
+				break;
+			case OpCode::Sub:
+				apply(a, b, y, len, [](T u, T v) { return u - v; });
+				break;
+			case OpCode::Mul:
+				apply(a, b, y, len, [](T u, T v) { return u * v; });
+				break;
+			case OpCode::Div:
+				apply(a, b, y, len, [](T u, T v) { return u / v; });
+				break;
+			case OpCode::Lt:
+				apply(a, b, y, len, [](T u, T v) { return T((u < v) ? 1.0 : 0.0); });
+				break;
+			case OpCode::Le:
+				apply(a, b, y, len, [](T u, T v) { return T((u <= v) ? 1.0 : 0.0); });
+				break;
+			case OpCode::Gt:
+				apply(a, b, y, len, [](T u, T v) { return T((u > v) ? 1.0 : 0.0); });
+				break;
+			case OpCode::Ge:
+				apply(a, b, y, len, [](T u, T v) { return T((u >= v) ? 1.0 : 0.0); });
+				break;
+			case OpCode::Eq:
+				apply(a, b, y, len, [](T u, T v) { return T((u == v) ? 1.0 : 0.0); });
+				break;
+			case OpCode::Ne:
+				apply(a, b, y, len, [](T u, T v) { return T((u != v) ? 1.0 : 0.0); });
+				break;
+			case OpCode::And:
+				apply(a, b, y, len, [](T u, T v) { return T(((u != T(0.0)) & (v != T(0.0))) ? 1.0 : 0.0); });
+				break;
+			case OpCode::Or:
+				apply(a, b, y, len, [](T u, T v) { return T(((u != T(0.0)) | (v != T(0.0))) ? 1.0 : 0.0); });
+				break;
+			default:
+				apply(a, b, y, len, [op](T u, T v) { return calculate(u, v, op); });
+				break;
+		}
+		a.col = y;
+	}
+
+	/**
+	* @brief Calcula if(c, a, b) sobre un bloque de valores
+	*
+	* Ambas ramas ya están calculadas: cada valor se elige sin saltos, con vmath::vselect() en
+	* double y en los demás tipos con una selección que el compilador traduce a instrucciones con
+	* máscara. Con una condición escalar el resultado es una de las ramas.
+	* @param args Condición y ramas, en posiciones consecutivas de la pila; el resultado queda en args[0]
+	* @param y Bloque de la pila de la condición, seguido de los bloques de las ramas
+	* @param len Cantidad de valores del bloque
+	*/
+	static void select(BatchValue * args, T * y, size_t len) {
+		if (args[0].col == nullptr) {
+			//La rama elegida se copia al bloque del resultado: el de la rama se reutiliza
+			BatchValue v = (args[0].val != T(0.0)) ? args[1] : args[2];
+			if (v.col != nullptr) {
+				std::copy(v.col, v.col + len, y);
+				v.col = y;
+			}
+			args[0] = v;
+			return;
+		}
+		for (size_t j = 1; j < 3; j++) {
+			if (args[j].col == nullptr) {
+				T * e = y + j * BATCH_SIZE;
+				std::fill(e, e + len, args[j].val);
+				args[j].col = e;
+			}
+		}
+		const T * c = args[0].col;
+		const T * a = args[1].col;
+		const T * b = args[2].col;
+		if constexpr (std::is_same_v<T, double>) {
+			vmath::vselect(c, a, b, y, len);
+		}else {
+			for (size_t i = 0; i < len; i++) {
+				y[i] = (c[i] != T(0.0)) ? a[i] : b[i];
+			}
+		}
+		args[0].col = y;
+	}
+
+	/**
+	* @brief Calcula una función predefinida sobre un bloque de valores
+	*
+	* En float y double, las funciones que tienen núcleo vectorial en vmath.h lo usan; en float,
+	* sobre el bloque convertido a double.
+	* @param x Operando
+	* @param y Bloque de resultados; puede coincidir con x
+	* @param op Código de operación
+	* @param len Cantidad de valores del bloque
+	*/
+	static void unary(const T * x, T * y, OpCode op, size_t len) {
+		bool vector = op == OpCode::Sqrt || op == OpCode::Sin || op == OpCode::Cos || op == OpCode::Ln ||
+				op == OpCode::Exp;
+		if constexpr (std::is_same_v<T, double>) {
+			if (vector) {
+				CompiledExpression::calculateUnaryBatch(x, y, op, len);
+				return;
+			}
+		}else if constexpr (std::is_same_v<T, float>) {
+			if (vector) {
+				double wide[BATCH_SIZE];
+				std::copy(x, x + len, wide);
+				CompiledExpression::calculateUnaryBatch(wide, wide, op, len);
+				std::copy(wide, wide + len, y);
+				return;
+			}
+		}
+		for (size_t i = 0; i < len; i++) {
+			y[i] = calculateUnary(x[i], op);
+		}
+	}
+
+	/**
+	* @brief Eleva un bloque de valores a una potencia entera por cuadrados sucesivos
+	* @param x Bases; puede coincidir con y
+	* @param k Exponente
+	* @param y Bloque de resultados
+	* @param len Cantidad de valores del bloque
+	*/
+	static void powi(const T * x, int k, T * y, size_t len) {
+		T base[BATCH_SIZE];
+		std::copy(x, x + len, base);
+		std::fill(y, y + len, T(1.0));
+		for (unsigned m = (k < 0) ? -k : k; m != 0; m >>= 1) {
+			if (m & 1) {
+				for (size_t i = 0; i < len; i++) {
+					y[i] *= base[i];
+				}
+			}
+			if (m > 1) {
+				for (size_t i = 0; i < len; i++) {
+					base[i] *= base[i];
+				}
+			}
+		}
+		if (k < 0) {
+			for (size_t i = 0; i < len; i++) {
+				y[i] = T(1.0) / y[i];
+			}
+		}
+	}
+
+	/**
+	* @brief Aplica una operación binaria elemento a elemento, con un ciclo por combinación de operandos
+	* @param a Primer operando
+	* @param b Segundo operando
+	* @param y Bloque de resultados
+	* @param len Cantidad de valores del bloque
+	* @param f Operación
+	*/
+	template <typename F>
+	static void apply(const BatchValue & a, const BatchValue & b, T * y, size_t len, F f) {
+		const T * pa = a.col;
+		const T * pb = b.col;
+		if (pa != nullptr && pb != nullptr) {
+			for (size_t i = 0; i < len; i++) {
+				y[i] = f(pa[i], pb[i]);
+			}
+		}else if (pa != nullptr) {
+			T v = b.val;
+			for (size_t i = 0; i < len; i++) {
+				y[i] = f(pa[i], v);
+			}
+		}else {
+			T u = a.val;
+			for (size_t i = 0; i < len; i++) {
+				y[i] = f(u, pb[i]);
+			}
+		}
+	}
+
+	/**
+	* @brief Invoca una función de varios argumentos con sus argumentos convertidos a double
+	*
+	* Reúne los argumentos en la pila del hilo si no exceden CompiledExpression::LOCAL_ARGS.
+	* @param f Función
+	* @param x Argumentos
+	* @param n Cantidad de argumentos
+	* @return Resultado de la función
+	*/
+	static T call(const CustomFunction & f, const T * x, size_t n) {
+		double local[CompiledExpression::LOCAL_ARGS];
+		vector<double> heap;
+		double * args = local;
+		if (n > CompiledExpression::LOCAL_ARGS) {
+			heap.resize(n);
+			args = heap.data();
+		}
+		for (size_t j = 0; j < n; j++) {
+			args[j] = static_cast<double>(x[j]);
+		}
+		return T(f(args, n));
+	}
+
+	/**
+	* @brief Calcula el resultado de una operación binaria
+	* @param a Primer operando
+	* @param b Segundo operando
+	* @param op Código de operación
+	* @return Resultado de la operación
+	*/
+	static T calculate(T a, T b, OpCode op) {
+		using std::pow;
+		switch (op) {
+			case OpCode::Add:
+				return a + b;
+			case OpCode::Sub:
+				return a - b;
+			case OpCode::Mul:
+				return a * b;
+			case OpCode::Div:
+				return a / b;
+			case OpCode::Lt:
+				return T((a < b) ? 1.0 : 0.0);
+			case OpCode::Le:
+				return T((a <= b) ? 1.0 : 0.0);
+			case OpCode::Gt:
+				return T((a > b) ? 1.0 : 0.0);
+			case OpCode::Ge:
+				return T((a >= b) ? 1.0 : 0.0);
+			case OpCode::Eq:
+				return T((a == b) ? 1.0 : 0.0);
+			case OpCode::Ne:
+				return T((a != b) ? 1.0 : 0.0);
+			case OpCode::And:
+				return T((a != T(0.0) && b != T(0.0)) ? 1.0 : 0.0);
+			case OpCode::Or:
+				return T((a != T(0.0) || b != T(0.0)) ? 1.0 : 0.0);
+			default:
+				return pow(a, b);
+		}
+	}
+
+	/**
+	* @brief Calcula el resultado de una operación unaria o de una función predefinida
+	* @param a Operando
+	* @param op Código de operación
+	* @return Resultado de la operación
+	*/
+	static T calculateUnary(T a, OpCode op) {
+		using std::sqrt;
+		using std::sin;
+		using std::cos;
+		using std::tan;
+		using std::log;
+		using std::log10;
+		using std::exp;
+		using std::fabs;
+		switch (op) {
+			case OpCode::Neg:
+				return -a;
+			case OpCode::Sqrt:
+				return sqrt(a);
+			case OpCode::Sin:
+				return sin(a);
+			case OpCode::Cos:
+				return cos(a);
+			case OpCode::Tan:
+				return tan(a);
+			case OpCode::Ln:
+				return log(a);
+			case OpCode::Log:
+				return log10(a);
+			case OpCode::Exp:
+				return exp(a);
+			case OpCode::Abs:
+				return fabs(a);
+			case OpCode::Not:
+				return T((a == T(0.0)) ? 1.0 : 0.0);
+			default:
+				return std::numeric_limits<T>::quiet_NaN();
+		}
+	}
+
+	std::shared_ptr<const vector<CustomFunction>> functions; /*!< Funciones referenciadas por el programa */
+	vector<string> slots; /*!< Nombres de las variables, en el orden de sus posiciones */
+	vector<T> constants; /*!< Constantes del programa, con la precisión de T */
+	Program program; /*!< Programa con las variables en el orden de variables() */
+	Bound bound; /*!< Programa con las variables asociadas mediante bind() */
+	Bound xProgram; /*!< Programa con la variable x, para eval(T) */
+	bool valid = false; /*!< Verdadero si el programa produce exactamente un valor */
+};
+
+#endif
@@ -0,0 +1,646 @@
+#ifndef VMATH_H
+#define VMATH_H
+
+/**
+* @file
+* Núcleos vectoriales para la evaluación por lotes de expresiones
+* Cada núcleo aplica una operación sobre un arreglo de valores reales con ciclos sin saltos
+* que el compilador traduce a instrucciones SIMD (SSE2/AVX2/AVX-512 en x86-64, NEON en AArch64).
+* Las funciones exp, ln, sin y cos se calculan con aproximaciones polinomiales vectorizables:
+*  - vexp, vlog: error máximo de 2 ULP respecto a std::exp / std::log en todo el rango.
+*  - vsin, vcos: error máximo de 2 ULP para |x| <= vmath::TRIG_LIMIT; fuera de este rango se usa
+*    std::sin / std::cos. Cerca de las raíces distintas de cero el error absoluto es menor a 1e-16.
+* Los ciclos se vectorizan con -O3 (o -O2 -ftree-vectorize -fvect-cost-model=dynamic).
+* @author Erwin Meza Vega <emezav@unicauca.edu.co>
+* @copyright MIT License
+*/
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__linux__) && !defined(VMATH_NO_CLONES)
+/** Genera versiones AVX-512 y AVX2 de cada núcleo, seleccionadas al cargar el programa */
+#define VMATH_KERNEL __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define VMATH_KERNEL
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__)
+/** Los núcleos son elemento a elemento: la salida puede coincidir con una entrada */
+#define VMATH_IVDEP _Pragma("GCC ivdep")
+#else
+#define VMATH_IVDEP
+#endif
+
+namespace vmath {
+
+	/** Límite de |x| para la reducción de argumento de vsin y vcos */
+	const double TRIG_LIMIT = 1647099.0; // 2^20 * pi / 2
+
+	/** Constante para redondear al entero más cercano (1.5 * 2^52) */
+	const double ROUND_SHIFT = 6755399441055744.0;
+
+	/**
+	* @brief Reinterpreta los bits de un real como entero
+	* @param x Valor real
+	* @return Bits del valor
+	*/
+	inline uint64_t bits(double x) {
+		uint64_t u;
+		memcpy(&u, &x, sizeof u);
+		return u;
+	}
+
+	/**
+	* @brief Reinterpreta un entero como los bits de un real
+	* @param u Bits del valor
+	* @return Valor real
+	*/
+	inline double real(uint64_t u) {
+		double x;
+		memcpy(&x, &u, sizeof x);
+		return x;
+	}
+
+	/**
+	* @brief Selecciona entre dos valores con operaciones de bits, sin saltos
+	*
+	* Evita que el compilador convierta la selección en un salto condicional, lo que
+	* impediría vectorizar el ciclo en arquitecturas sin instrucciones con máscara.
+	* @param c Condición
+	* @param a Valor si la condición es verdadera
+	* @param b Valor si la condición es falsa
+	* @return a si c es verdadera, b en caso contrario
+	*/
+	inline double select(bool c, double a, double b) {
+		uint64_t m = -(uint64_t)c;
+		return real((bits(a) & m) | (bits(b) & ~m));
+	}
+
+	/**
+	* @brief Mínimo de dos valores, sin saltos
+	*
+	* Igual que std::fmin, si uno de los valores es NAN retorna el otro.
+	*/
+	inline double minimum(double a, double b) {
+		return select(b < a || a != a, b, a);
+	}
+
+	/**
+	* @brief Máximo de dos valores, sin saltos
+	*
+	* Igual que std::fmax, si uno de los valores es NAN retorna el otro.
+	*/
+	inline double maximum(double a, double b) {
+		return select(b > a || a != a, b, a);
+	}
+
+	/**
+	* @brief Calcula 2^n para un entero n en [-1022, 1023] representado como real
+	* @param n Exponente
+	* @return 2^n
+	*/
+	inline double pow2(double n) {
+		uint64_t k = bits(n + ROUND_SHIFT) - bits(ROUND_SHIFT);
+		return real((k + 1023) << 52);
+	}
+
+	/**
+	* @brief Exponencial de un valor, sin saltos
+	* @param x Valor
+	* @return e^x
+	*/
+	inline double exp(double x) {
+		const double LOG2E = 1.44269504088896338700e+00;
+		const double LN2_HI = 6.93147180369123816490e-01;
+		const double LN2_LO = 1.90821492927058770002e-10;
+
+		double xc = select(x > 709.8, 709.8, x);
+		xc = select(xc < -745.2, -745.2, xc);
+
+		//x = n ln2 + r, |r| <= ln2 / 2
+		double n = (xc * LOG2E + ROUND_SHIFT) - ROUND_SHIFT;
+		double r = (xc - n * LN2_HI) - n * LN2_LO;
+
+		double p = 1.0 / 6227020800.0;
+		p = p * r + 1.0 / 479001600.0;
+		p = p * r + 1.0 / 39916800.0;
+		p = p * r + 1.0 / 3628800.0;
+		p = p * r + 1.0 / 362880.0;
+		p = p * r + 1.0 / 40320.0;
+		p = p * r + 1.0 / 5040.0;
+		p = p * r + 1.0 / 720.0;
+		p = p * r + 1.0 / 120.0;
+		p = p * r + 1.0 / 24.0;
+		p = p * r + 1.0 / 6.0;
+		p = p * r + 0.5;
+		p = p * r + 1.0;
+		p = p * r + 1.0;
+
+		//2^n en dos factores para cubrir resultados subnormales y desbordamiento
+		double n1 = (n * 0.5 + ROUND_SHIFT) - ROUND_SHIFT;
+		double n2 = n - n1;
+		return p * pow2(n1) * pow2(n2);
+	}
+
+	/**
+	* @brief Logaritmo natural de un valor, sin saltos
+	* @param x Valor
+	* @return ln(x)
+	*/
+	inline double log(double x) {
+		const double LN2_HI = 6.93147180369123816490e-01;
+		const double LN2_LO = 1.90821492927058770002e-10;
+		const double SQRT2 = 1.41421356237309504880;
+
+		//Normalizar los subnormales
+		bool sub = x < 2.2250738585072014e-308;
+		double xs = select(sub, x * 18014398509481984.0, x);
+
+		//x = m 2^k, m en [sqrt(2)/2, sqrt(2))
+		uint64_t u = bits(xs);
+		double k = real(bits(ROUND_SHIFT) + ((u >> 52) & 0x7ff)) - ROUND_SHIFT - 1023.0;
+		double m = real((u & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+		bool big = m > SQRT2;
+		m = select(big, m * 0.5, m);
+		k = select(big, k + 1.0, k);
+		k = select(sub, k - 54.0, k);
+
+		//ln(1 + f) = 2 atanh(s), s = f / (2 + f)
+		double f = m - 1.0;
+		double s = f / (2.0 + f);
+		double z = s * s;
+		double R = 2.0 / 23.0;
+		R = R * z + 2.0 / 21.0;
+		R = R * z + 2.0 / 19.0;
+		R = R * z + 2.0 / 17.0;
+		R = R * z + 2.0 / 15.0;
+		R = R * z + 2.0 / 13.0;
+		R = R * z + 2.0 / 11.0;
+		R = R * z + 2.0 / 9.0;
+		R = R * z + 2.0 / 7.0;
+		R = R * z + 2.0 / 5.0;
+		R = R * z + 2.0 / 3.0;
+		R = R * z;
+
+		double y = k * LN2_HI + ((f - s * (f - R)) + k * LN2_LO);
+
+		//Casos especiales: 0, negativos, infinito y NAN
+		y = select(x == 0.0, -INFINITY, y);
+		y = select(x < 0.0, NAN, y);
+		y = select(x == INFINITY, INFINITY, y);
+		return select(x != x, x, y);
+	}
+
+	/**
+	* @brief Reduce un ángulo a [-pi/4, pi/4]
+	* @param x Ángulo, |x| <= TRIG_LIMIT
+	* @param q Referencia al cuadrante del ángulo (0 a 3)
+	* @return Ángulo reducido
+	*/
+	inline double reduce(double x, uint64_t & q) {
+		const double INV_PIO2 = 6.36619772367581382433e-01;
+		const double PIO2_1 = 1.57079632673412561417e+00;
+		const double PIO2_2 = 6.07710050630396597660e-11;
+		const double PIO2_3 = 2.02226624871116645580e-21;
+		const double PIO2_3T = 8.47842766036889956997e-32;
+
+		double t = x * INV_PIO2 + ROUND_SHIFT;
+		q = bits(t) & 3;
+		double n = t - ROUND_SHIFT;
+
+		//Reducción de Cody-Waite en tres etapas, acumulando el error de cada resta
+		double r1 = x - n * PIO2_1;
+		double w2 = n * PIO2_2;
+		double r2 = r1 - w2;
+		double e2 = (r1 - r2) - w2;
+		double w3 = n * PIO2_3;
+		double r3 = r2 - w3;
+		double e3 = (r2 - r3) - w3;
+		return r3 + ((e2 + e3) - n * PIO2_3T);
+	}
+
+	/**
+	* @brief Seno en [-pi/4, pi/4]
+	* @param r Ángulo reducido
+	* @return sin(r)
+	*/
+	inline double sinKernel(double r) {
+		double z = r * r;
+		double p = -1.0 / 121645100408832000.0;
+		p = p * z + 1.0 / 355687428096000.0;
+		p = p * z - 1.0 / 1307674368000.0;
+		p = p * z + 1.0 / 6227020800.0;
+		p = p * z - 1.0 / 39916800.0;
+		p = p * z + 1.0 / 362880.0;
+		p = p * z - 1.0 / 5040.0;
+		p = p * z + 1.0 / 120.0;
+		p = p * z - 1.0 / 6.0;
+		return r + r * z * p;
+	}
+
+	/**
+	* @brief Coseno en [-pi/4, pi/4]
+	* @param r Ángulo reducido
+	* @return cos(r)
+	*/
+	inline double cosKernel(double r) {
+		double z = r * r;
+		double p = 1.0 / 2432902008176640000.0;
+		p = p * z - 1.0 / 6402373705728000.0;
+		p = p * z + 1.0 / 20922789888000.0;
+		p = p * z - 1.0 / 87178291200.0;
+		p = p * z + 1.0 / 479001600.0;
+		p = p * z - 1.0 / 3628800.0;
+		p = p * z + 1.0 / 40320.0;
+		p = p * z - 1.0 / 720.0;
+		p = p * z + 1.0 / 24.0;
+		double hz = 0.5 * z;
+		double w = 1.0 - hz;
+		return w + (((1.0 - w) - hz) + z * z * p);
+	}
+
+	/**
+	* @brief Seno de un valor, sin saltos
+	* @param x Ángulo, |x| <= TRIG_LIMIT
+	* @return sin(x)
+	*/
+	inline double sin(double x) {
+		uint64_t q;
+		double r = reduce(x, q);
+		double s = sinKernel(r);
+		double c = cosKernel(r);
+		double y = select(q & 1, c, s);
+		y = select(q & 2, -y, y);
+		return select(x == 0.0, x, y);
+	}
+
+	/**
+	* @brief Coseno de un valor, sin saltos
+	* @param x Ángulo, |x| <= TRIG_LIMIT
+	* @return cos(x)
+	*/
+	inline double cos(double x) {
+		uint64_t q;
+		double r = reduce(x, q);
+		double s = sinKernel(r);
+		double c = cosKernel(r);
+		double y = select(q & 1, s, c);
+		return select((q + 1) & 2, -y, y);
+	}
+
+	/**
+	* @brief y = -x
+	*/
+	VMATH_KERNEL inline void vneg(const double * x, double * y, size_t n) {
+		VMATH_IVDEP
+		for (size_t i = 0; i < n; i++) {
+			y[i] = -x[i];
+		}
+	}
+
+	/**
+	* @brief y = a + b
+	*/
+	VMATH_KERNEL inline void vadd(const double * a, const double * b, double * y, size_t n) {
+		VMATH_IVDEP
+		for (size_t i = 0; i < n; i++) {
+			y[i] = a[i] + b[i];
+		}
+	}
+
+	/**
+	* @brief y = a - b
+	*/
+	VMATH_KERNEL inline void vsub(const double * a, const double * b, double * y, size_t n) {
+		VMATH_IVDEP
+		for (size_t i = 0; i < n; i++) {
+			y[i] = a[i] - b[i];
+		}
+	}
+
+	/**
+	* @brief y = a * b
+	*/
+	VMATH_KERNEL inline void vmul(const double * a, const double * b, double * y, size_t n) {
+		VMATH_IVDEP
+		for (size_t i = 0; i < n; i++) {
+			y[i] = a[i] * b[i];
+		}
+	}
+
+	/**
+	* @brief y = a / b
+	*/
+	VMATH_KERNEL inline void vdiv(const double * a, const double * b, double * y, size_t n) {
+		VMATH_IVDEP
+		for (size_t i = 0; i < n; i++) {
+			y[i] = a[i] / b[i];
+		}
+	}
+
+	/**
+	* @brief y = x^k para un exponente entero, por multiplicaciones sucesivas
+	*
+	* Cada multiplicación y el recíproco de k < 0 redondean una vez: si el resultado y, con k < 0,
+	* x^|k| son normales, el error es a lo sumo |k| ULP respecto al valor exacto y |k| + 1 ULP
+	* respecto a std::pow. En el rango subnormal cada redondeo pierde precisión relativa, así que
+	* esos elementos se calculan con std::pow. y puede ser el mismo arreglo que x.
+	*/
+	VMATH_KERNEL inline void vpowi(const double * x, int k, double * y, size_t n) {
+		const size_t CHUNK = 64;
+		unsigned e = k < 0 ? -k : k;
+		double b[CHUNK];
+		double r[CHUNK];
+
+		for (size_t base = 0; base < n; base += CHUNK) {
+			size_t len = n - base < CHUNK ? n - base : CHUNK;
+			for (size_t i = 0; i < len; i++) {
+				b[i] = x[base + i];
+				r[i] = 1.0;
+			}
+			//Exponenciación binaria, el mismo exponente para todos los elementos
+			for (unsigned m = e; m != 0; m >>= 1) {
+				if (m & 1) {
+					for (size_t i = 0; i < len; i++) {
+						r[i] *= b[i];
+					}
+				}
+				if (m > 1) {
+					for (size_t i = 0; i < len; i++) {
+						b[i] *= b[i];
+					}
+				}
+			}
+			if (k < 0) {
+				for (size_t i = 0; i < len; i++) {
+					r[i] = 1.0 / r[i];
+				}
+			}
+			//|r| > 2^1022 con k < 0 indica que x^|k| es subnormal o cero
+			double limit = (k < 0) ? 0x1p1022 : HUGE_VAL;
+			size_t tiny = 0;
+			for (size_t i = 0; i < len; i++) {
+				tiny += (std::fabs(r[i]) < DBL_MIN) | (std::fabs(r[i]) > limit);
+			}
+			if (tiny != 0) {
+				for (size_t i = 0; i < len; i++) {
+					if (std::fabs(r[i]) < DBL_MIN || std::fabs(r[i]) > limit) {
+						r[i] = std::pow(x[base + i], (double) k);
+					}
+				}
+			}
+			for (size_t i = 0; i < len; i++) {
+				y[base + i] = r[i];
+			}
+		}
+	}
+
+	/**
+	* @brief y = a^b
+	*/
+	inline void vpow(const double * a, const double * b, double * y, size_t n) {
+		VMATH_IVDEP
+		for (size_t i = 0; i < n; i++) {
+			y[i] = std::pow(a[i], b[i]);
+		}
+	}
+
+	/**
+	* @brief y = minimum(a, b)
+	*/
+	VMATH_KERNEL inline void vmin(const double * a, const double * b, double * y, size_t n) {
+		VMATH_IVDEP
+		for (size_t i = 0; i < n; i++) {
+			y[i] = minimum(a[i], b[i]);
+		}
+	}
+
+	/**
+	* @brief y = maximum(a, b)
+	*/
+	VMATH_KERNEL inline void vmax(const double * a, const double * b, double * y, size_t n) {
+		VMATH_IVDEP
+		for (size_t i = 0; i < n; i++) {
+			y[i] = maximum(a[i], b[i]);
+		}
+	}
+
+	/**
+	* @brief y = (a < b), 1 si se cumple y 0 en otro caso
+	*
+	* Igual que en C, las comparaciones con NAN no se cumplen, excepto !=.
+	*/
+	VMATH_KERNEL inline void vlt(const double * a, const double * b, double * y, size_t n) {
+		VMATH_IVDEP
+		for (size_t i = 0; i < n; i++) {
+			y[i] = select(a[i] < b[i], 1.0, 0.0);
+		}
+	}
+
+	/**
+	* @brief y = (a <= b), 1 si se cumple y 0 en otro caso
+	*/
+	VMATH_KERNEL inline void vle(const double * a, const double * b, double * y, size_t n) {
+		VMATH_IVDEP
+		for (size_t i = 0; i < n; i++) {
+			y[i] = select(a[i] <= b[i], 1.0, 0.0);
+		}
+	}
+
+	/**
+	* @brief y = (a > b), 1 si se cumple y 0 en otro caso
+	*/
+	VMATH_KERNEL inline void vgt(const double * a, const double * b, double * y, size_t n) {
+		VMATH_IVDEP
+		for (size_t i = 0; i < n; i++) {
+			y[i] = select(a[i] > b[i], 1.0, 0.0);
+		}
+	}
+
+	/**
+	* @brief y = (a >= b), 1 si se cumple y 0 en otro caso
+	*/
+	VMATH_KERNEL inline void vge(const double * a, const double * b, double * y, size_t n) {
+		VMATH_IVDEP
+		for (size_t i = 0; i < n; i++) {
+			y[i] = select(a[i] >= b[i], 1.0, 0.0);
+		}
+	}
+
+	/**
+	* @brief y = (a == b), 1 si se cumple y 0 en otro caso
+	*/
+	VMATH_KERNEL inline void veq(const double * a, const double * b, double * y, size_t n) {
+		VMATH_IVDEP
+		for (size_t i = 0; i < n; i++) {
+			y[i] = select(a[i] == b[i], 1.0, 0.0);
+		}
+	}
+
+	/**
+	* @brief y = (a != b), 1 si se cumple y 0 en otro caso
+	*/
+	VMATH_KERNEL inline void vne(const double * a, const double * b, double * y, size_t n) {
+		VMATH_IVDEP
+		for (size_t i = 0; i < n; i++) {
+			y[i] = select(a[i] != b[i], 1.0, 0.0);
+		}
+	}
+
+	/**
+	* @brief y = (a && b): 1 si ambos valores son distintos de 0, 0 en otro caso
+	*
+	* Igual que en C, NAN es verdadero. Los dos operandos ya están calculados: no hay evaluación
+	* en cortocircuito.
+	*/
+	VMATH_KERNEL inline void vand(const double * a, const double * b, double * y, size_t n) {
+		VMATH_IVDEP
+		for (size_t i = 0; i < n; i++) {
+			y[i] = select((a[i] != 0.0) & (b[i] != 0.0), 1.0, 0.0);
+		}
+	}
+
+	/**
+	* @brief y = (a || b): 1 si alguno de los valores es distinto de 0, 0 en otro caso
+	*/
+	VMATH_KERNEL inline void vor(const double * a, const double * b, double * y, size_t n) {
+		VMATH_IVDEP
+		for (size_t i = 0; i < n; i++) {
+			y[i] = select((a[i] != 0.0) | (b[i] != 0.0), 1.0, 0.0);
+		}
+	}
+
+	/**
+	* @brief y = !x: 1 si x es 0, 0 en otro caso
+	*/
+	VMATH_KERNEL inline void vnot(const double * x, double * y, size_t n) {
+		VMATH_IVDEP
+		for (size_t i = 0; i < n; i++) {
+			y[i] = select(x[i] == 0.0, 1.0, 0.0);
+		}
+	}
+
+	/**
+	* @brief y = if(c, a, b): a donde c es distinto de 0, b en otro caso
+	*
+	* Cada valor se elige con una máscara, sin saltos: las funciones por partes se vectorizan
+	* igual que las demás operaciones. y puede coincidir con c.
+	*/
+	VMATH_KERNEL inline void vselect(const double * c, const double * a, const double * b, double * y, size_t n) {
+		VMATH_IVDEP
+		for (size_t i = 0; i < n; i++) {
+			y[i] = select(c[i] != 0.0, a[i], b[i]);
+		}
+	}
+
+	/**
+	* @brief y = atan2(a, b)
+	*/
+	inline void vatan2(const double * a, const double * b, double * y, size_t n) {
+		for (size_t i = 0; i < n; i++) {
+			y[i] = std::atan2(a[i], b[i]);
+		}
+	}
+
+	/**
+	* @brief y = hypot(a, b)
+	*/
+	inline void vhypot(const double * a, const double * b, double * y, size_t n) {
+		for (size_t i = 0; i < n; i++) {
+			y[i] = std::hypot(a[i], b[i]);
+		}
+	}
+
+	/**
+	* @brief y = e^x
+	*/
+	VMATH_KERNEL inline void vexp(const double * x, double * y, size_t n) {
+		VMATH_IVDEP
+		for (size_t i = 0; i < n; i++) {
+			y[i] = exp(x[i]);
+		}
+	}
+
+	/**
+	* @brief y = ln(x)
+	*/
+	VMATH_KERNEL inline void vlog(const double * x, double * y, size_t n) {
+		VMATH_IVDEP
+		for (size_t i = 0; i < n; i++) {
+			y[i] = log(x[i]);
+		}
+	}
+
+	/**
+	* @brief y = sin(x)
+	*
+	* y puede coincidir con x: cada tramo de la entrada se copia antes de escribir los resultados,
+	* de modo que los valores fuera de TRIG_LIMIT se recalculan con std::sin a partir de la entrada.
+	*/
+	VMATH_KERNEL inline void vsin(const double * x, double * y, size_t n) {
+		const size_t CHUNK = 64;
+		double in[CHUNK];
+
+		for (size_t base = 0; base < n; base += CHUNK) {
+			size_t len = n - base < CHUNK ? n - base : CHUNK;
+			std::memcpy(in, x + base, len * sizeof(double));
+			for (size_t i = 0; i < len; i++) {
+				y[base + i] = sin(in[i]);
+			}
+			for (size_t i = 0; i < len; i++) {
+				if (std::fabs(in[i]) > TRIG_LIMIT) {
+					y[base + i] = std::sin(in[i]);
+				}
+			}
+		}
+	}
+
+	/**
+	* @brief y = cos(x)
+	*
+	* y puede coincidir con x: cada tramo de la entrada se copia antes de escribir los resultados,
+	* de modo que los valores fuera de TRIG_LIMIT se recalculan con std::cos a partir de la entrada.
+	*/
+	VMATH_KERNEL inline void vcos(const double * x, double * y, size_t n) {
+		const size_t CHUNK = 64;
+		double in[CHUNK];
+
+		for (size_t base = 0; base < n; base += CHUNK) {
+			size_t len = n - base < CHUNK ? n - base : CHUNK;
+			std::memcpy(in, x + base, len * sizeof(double));
+			for (size_t i = 0; i < len; i++) {
+				y[base + i] = cos(in[i]);
+			}
+			for (size_t i = 0; i < len; i++) {
+				if (std::fabs(in[i]) > TRIG_LIMIT) {
+					y[base + i] = std::cos(in[i]);
+				}
+			}
+		}
+	}
+
+	/**
+	* @brief y = sqrt(x)
+	*/
+	VMATH_KERNEL inline void vsqrt(const double * x, double * y, size_t n) {
+		VMATH_IVDEP
+		for (size_t i = 0; i < n; i++) {
+			y[i] = std::sqrt(x[i]);
+		}
+	}
+
+	/**
+	* @brief y = |x|
+	*/
+	VMATH_KERNEL inline void vabs(const double * x, double * y, size_t n) {
+		VMATH_IVDEP
+		for (size_t i = 0; i < n; i++) {
+			y[i] = std::fabs(x[i]);
+		}
+	}
+}
+
+#endif